@@ -0,0 +1,22 @@
+<?php
+
+namespace App\Http\Middleware;
+
+use App\Support\NativeEvents;
+use Closure;
+use Illuminate\Http\Request;
+use Symfony\Component\HttpFoundation\Response;
+
+class DispatchNativeEvents
+{
+    /**
+     * Dispatch the results of native actions that finished since the last
+     * request, unless the runtime already dispatched them on its own.
+     */
+    public function handle(Request $request, Closure $next): Response
+    {
+        NativeEvents::dispatchPending();
+
+        return $next($request);
+    }
+}
@@ -3,6 +3,7 @@
 namespace App\Providers;
 
 use Illuminate\Support\ServiceProvider;
+use Symfony\Component\HttpFoundation\BinaryFileResponse;
 
 class AppServiceProvider extends ServiceProvider
 {
@@ -19,6 +20,10 @@ public function register(): void
      */
     public function boot(): void
     {
-        //
+        // Inside the mobile shell the native layer streams files (with Range
+        // support) itself, so let BinaryFileResponse hand it the path.
+        if (config('nativephp.running')) {
+            BinaryFileResponse::trustXSendfileTypeHeader();
+        }
     }
 }
@@ -0,0 +1,86 @@
+<?php
+
+namespace App\Support;
+
+use ReflectionClass;
+use Throwable;
+
+class NativeEvents
+{
+    /**
+     * Dispatch every native action result the mobile runtime has queued,
+     * oldest first, and return how many there were.
+     */
+    public static function dispatchPending(): int
+    {
+        if (! function_exists('nativephp_events')) {
+            return 0;
+        }
+
+        return static::dispatchResults(nativephp_events());
+    }
+
+    /**
+     * Dispatch results shaped the way nativephp_events() returns them. Event
+     * classes are built from the payload's named arguments, anything else is
+     * dispatched by name with the payload and count. Coalesced results keep
+     * the latest payload with the merged "count", which an event class gets
+     * if its constructor takes one; a "batch" lists every payload and each
+     * is dispatched on its own.
+     */
+    public static function dispatchResults(array $results): int
+    {
+        foreach ($results as $result) {
+            $payload = json_decode($result['payload'], true);
+            $batch = ($result['batch'] ?? false) && is_array($payload) && array_is_list($payload);
+
+            foreach ($batch ? $payload : [$payload] as $each) {
+                static::dispatch($result['event'], static::arguments($each), $batch ? 1 : (int) ($result['count'] ?? 1));
+            }
+        }
+
+        return count($results);
+    }
+
+    protected static function dispatch(string $event, array $payload, int $count): void
+    {
+        // Cancelled actions and bare callbacks have no event
+        if ($event === '') {
+            return;
+        }
+
+        try {
+            if (class_exists($event)) {
+                if (static::takesCount($event) && ! array_key_exists('count', $payload)) {
+                    $payload['count'] = $count;
+                }
+
+                event(new $event(...$payload));
+            } else {
+                event($event, [$payload, $count]);
+            }
+        } catch (Throwable $e) {
+            report($e);
+        }
+    }
+
+    protected static function arguments(mixed $payload): array
+    {
+        return match (true) {
+            is_array($payload) => $payload,
+            $payload === null => [],
+            default => [$payload],
+        };
+    }
+
+    protected static function takesCount(string $class): bool
+    {
+        foreach ((new ReflectionClass($class))->getConstructor()?->getParameters() ?? [] as $parameter) {
+            if ($parameter->getName() === 'count') {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
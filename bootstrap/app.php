@@ -1,5 +1,6 @@
 <?php
 
+use App\Http\Middleware\DispatchNativeEvents;
 use Illuminate\Foundation\Application;
 use Illuminate\Foundation\Configuration\Exceptions;
 use Illuminate\Foundation\Configuration\Middleware;
@@ -11,7 +12,9 @@
         health: '/up',
     )
     ->withMiddleware(function (Middleware $middleware) {
-        //
+        $middleware->web(append: [
+            DispatchNativeEvents::class,
+        ]);
     })
     ->withExceptions(function (Exceptions $exceptions) {
         //
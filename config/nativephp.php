@@ -79,6 +79,19 @@
 
     'author' => env('NATIVEPHP_APP_AUTHOR'),
 
+    /*
+    |--------------------------------------------------------------------------
+    | Running In The Mobile Shell
+    |--------------------------------------------------------------------------
+    |
+    | Set by the native runtime on every request it hands to Laravel. Code
+    | that only makes sense inside the app, such as letting the native layer
+    | stream files itself, checks this rather than the environment.
+    |
+    */
+
+    'running' => (bool) env('NATIVEPHP_RUNNING', false),
+
     /*
     |--------------------------------------------------------------------------
     | Default Native App Service Provider
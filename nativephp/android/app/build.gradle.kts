@@ -70,6 +70,16 @@ android {
         viewBinding = true
     }
 
+    testOptions {
+        // Plain JVM tests run code that logs through android.util.Log
+        unitTests.isReturnDefaultValues = true
+    }
+
+    androidResources {
+        // Keep the bundle stored so it can be opened by file descriptor and extracted natively
+        noCompress += "zip"
+    }
+
     externalNativeBuild {
         cmake {
             path = file("src/main/cpp/CMakeLists.txt")
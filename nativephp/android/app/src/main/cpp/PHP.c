@@ -1,4 +1,6 @@
 #include "PHP.h"
+#include "trace/request_memory.h"
+#include "trace/trace.h"
 #include <android/log.h>
 #include <string.h>
 #include <stdlib.h>
@@ -7,14 +9,23 @@
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 static php_stream *g_stdout_stream = NULL;
+static php_stream *g_body_stream = NULL;
+// SAPI-owned request strings; PHP reads them but never frees them
+static char *g_request_uri = NULL;
+static char *g_request_method = NULL;
 extern void pipe_php_output(const char* str);
 
 void initialize_php_with_request(const char *post_data, const char *method, const char *uri) {
     LOGI("🛠️ Starting PHP request startup");
     LOGI("🐛 initialize_php_with_request called with method=%s uri=%s body=%s", method, uri, post_data);
+    // Anything left from a request that skipped finish_php_request() went with its resources
+    g_body_stream = NULL;
 
     // Step 1: Bootstrap PHP internals (superglobals, session, etc)
-    if (php_request_startup() == FAILURE) {
+    trace_span startup_span = trace_span_begin("php_request_startup", "php", 0);
+    int startup_result = php_request_startup();
+    trace_span_end(&startup_span);
+    if (startup_result == FAILURE) {
         LOGE("❌ php_request_startup() failed");
         php_module_shutdown();
         return;
@@ -93,17 +104,17 @@ void initialize_php_with_request(const char *post_data, const char *method, cons
     php_output_activate();
 
     // Step 5: Setup POST/PATCH/PUT body if needed
-    if (post_data) {
+    if (post_data && *post_data) {
         size_t post_data_length = strlen(post_data);
 
         LOGI("📮 Detected POST request");
         LOGI("📦 POST body length: %zu", post_data_length);
         LOGI("📦 POST body preview (first 200 chars): %.200s", post_data);
 
-        php_stream *mem_stream = php_stream_memory_create(TEMP_STREAM_DEFAULT);
-        php_stream_write(mem_stream, post_data, post_data_length);
+        g_body_stream = php_stream_memory_create(TEMP_STREAM_DEFAULT);
+        php_stream_write(g_body_stream, post_data, post_data_length);
 
-        SG(request_info).request_body = mem_stream;
+        SG(request_info).request_body = g_body_stream;
         SG(request_info).content_length = post_data_length;
 
         const char *content_type = getenv("CONTENT_TYPE");
@@ -118,12 +129,32 @@ void initialize_php_with_request(const char *post_data, const char *method, cons
 
 
     // Finalize request startup state
-    SG(request_info).request_uri = strdup(uri);
-    SG(request_info).request_method = method;
+    // Copies, since the caller's strings can be released before the request ends
+    release_php_request();
+    g_request_uri = bridge_strdup(uri);
+    g_request_method = bridge_strdup(method);
+    SG(request_info).request_uri = g_request_uri;
+    SG(request_info).request_method = g_request_method;
     PG(during_request_startup) = 0;
     EG(exit_status) = 0;
 }
 
+void finish_php_request(void) {
+    if (g_body_stream) {
+        SG(request_info).request_body = NULL;
+        php_stream_close(g_body_stream);
+        g_body_stream = NULL;
+    }
+    // Freed with the request's resources; don't keep pointing at it
+    g_stdout_stream = NULL;
+}
+
+void release_php_request(void) {
+    bridge_free(g_request_uri);
+    bridge_free(g_request_method);
+    g_request_uri = NULL;
+    g_request_method = NULL;
+}
 
 // Add this new function to read output from the stdout stream
 // Function to capture stdout content after PHP execution
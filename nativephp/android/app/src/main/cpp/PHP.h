@@ -10,6 +10,10 @@ extern "C" {
 typedef void (*phpOutputCallback)(const char* output);
 void override_embed_module_output(phpOutputCallback callback);
 void initialize_php_with_request(const char* post_data, const char* method, const char* uri);
+// Before engine shutdown: closes the request body stream
+void finish_php_request(void);
+// After engine shutdown: frees the request strings handed to SAPI
+void release_php_request(void);
 size_t capture_php_output(const char *str, size_t str_length);
 
 #ifdef __cplusplus
@@ -0,0 +1,563 @@
+#include "bundle_archive.h"
+#include "bundle_index.h"
+
+#include <android/log.h>
+#include <php.h>
+#include <php_streams.h>
+#include <zend_stream.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "BundleArchive"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+static bundle_index *g_bundle = NULL;
+static char *g_root = NULL;
+static size_t g_root_len = 0;
+static char *g_real_root = NULL;     // the root with symlinks resolved, when that differs
+static size_t g_real_root_len = 0;
+static char **g_disk_paths = NULL;
+static int g_disk_path_count = 0;
+static time_t g_mount_time = 0;
+
+static zend_result (*original_stream_open)(zend_file_handle *handle) = NULL;
+static zend_string *(*original_resolve_path)(zend_string *filename) = NULL;
+static zif_handler original_realpath = NULL;
+
+// ---------------------------------------------------------------------------
+// Path handling
+// ---------------------------------------------------------------------------
+
+// Collapse "//", "." and ".." so composer's "vendor/composer/../foo" style
+// paths land on the same index entry as the plain one.
+static size_t normalize_path(const char *path, char *out, size_t size) {
+    char joined[PATH_MAX * 2];
+
+    if (strncmp(path, "file://", 7) == 0) path += 7;
+
+    if (path[0] == '/') {
+        snprintf(joined, sizeof(joined), "%s", path);
+    } else {
+        char cwd[PATH_MAX];
+        if (!getcwd(cwd, sizeof(cwd))) return 0;
+        snprintf(joined, sizeof(joined), "%s/%s", cwd, path);
+    }
+
+    size_t len = 0;
+    const char *p = joined;
+    while (*p) {
+        while (*p == '/') p++;
+        if (!*p) break;
+
+        const char *segment = p;
+        while (*p && *p != '/') p++;
+        size_t segment_len = (size_t) (p - segment);
+
+        if (segment_len == 1 && segment[0] == '.') continue;
+        if (segment_len == 2 && segment[0] == '.' && segment[1] == '.') {
+            while (len > 0 && out[len - 1] != '/') len--;
+            if (len > 0) len--;
+            continue;
+        }
+
+        if (len + segment_len + 2 > size) return 0;
+        out[len++] = '/';
+        memcpy(out + len, segment, segment_len);
+        len += segment_len;
+    }
+
+    if (len == 0) out[len++] = '/';
+    out[len] = '\0';
+    return len;
+}
+
+// If `path` is served from the bundle, fill `absolute` with its normalised form
+// and return its name relative to the mount root.
+static const char *archive_name(const char *path, char *absolute, size_t size, size_t *name_len) {
+    if (!g_bundle || !path) return NULL;
+
+    size_t len = normalize_path(path, absolute, size);
+    size_t root_len;
+    if (len >= g_root_len && memcmp(absolute, g_root, g_root_len) == 0) {
+        root_len = g_root_len;
+    } else if (g_real_root && len >= g_real_root_len && memcmp(absolute, g_real_root, g_real_root_len) == 0) {
+        // Scripts on disk see their resolved path in __DIR__, so the root can arrive either way
+        root_len = g_real_root_len;
+    } else {
+        return NULL;
+    }
+    if (len > root_len && absolute[root_len] != '/') return NULL;
+
+    const char *name = len == root_len ? absolute + len : absolute + root_len + 1;
+    size_t n = strlen(name);
+
+    for (int i = 0; i < g_disk_path_count; i++) {
+        size_t disk_len = strlen(g_disk_paths[i]);
+        if (n >= disk_len && memcmp(name, g_disk_paths[i], disk_len) == 0 &&
+            (n == disk_len || name[disk_len] == '/')) {
+            return NULL;
+        }
+    }
+
+    *name_len = n;
+    return name;
+}
+
+static const bundle_entry *archive_file(const char *path, char *absolute, size_t size) {
+    size_t name_len;
+    const char *name = archive_name(path, absolute, size, &name_len);
+    if (!name) return NULL;
+
+    const bundle_entry *entry = bundle_index_find(g_bundle, name, name_len);
+    return entry && !entry->is_dir ? entry : NULL;
+}
+
+static int archive_dir(const char *path, char *absolute, size_t size) {
+    size_t name_len;
+    const char *name = archive_name(path, absolute, size, &name_len);
+    return name && bundle_index_is_dir(g_bundle, name, name_len);
+}
+
+static void fill_stat(zend_stat_t *sb, const bundle_entry *entry) {
+    memset(sb, 0, sizeof(*sb));
+    sb->st_nlink = 1;
+    sb->st_uid = getuid();
+    sb->st_gid = getgid();
+
+    if (entry && !entry->is_dir) {
+        sb->st_mode = S_IFREG | 0444;
+        sb->st_size = (zend_off_t) entry->size;
+        sb->st_ino = (ino_t) (entry - g_bundle->entries) + 1;
+        sb->st_mtime = sb->st_atime = sb->st_ctime = bundle_entry_mtime(entry);
+    } else {
+        sb->st_mode = S_IFDIR | 0555;
+        sb->st_mtime = sb->st_atime = sb->st_ctime = entry ? bundle_entry_mtime(entry) : g_mount_time;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// File streams
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const bundle_entry *entry;
+    const unsigned char *data;
+    unsigned char *owned;
+    size_t position;
+} bundle_file;
+
+static bundle_file *open_bundle_file(const bundle_entry *entry) {
+    bundle_file *file = ecalloc(1, sizeof(bundle_file));
+    if (bundle_index_read(g_bundle, entry, &file->data, &file->owned) != 0) {
+        efree(file);
+        return NULL;
+    }
+    file->entry = entry;
+    return file;
+}
+
+static void close_bundle_file(bundle_file *file) {
+    free(file->owned);
+    efree(file);
+}
+
+static size_t read_bundle_file(bundle_file *file, char *buf, size_t count) {
+    size_t remaining = file->entry->size - file->position;
+    if (count > remaining) count = remaining;
+    memcpy(buf, file->data + file->position, count);
+    file->position += count;
+    return count;
+}
+
+static ssize_t bundle_stream_write(php_stream *stream, const char *buf, size_t count) {
+    return -1;
+}
+
+static ssize_t bundle_stream_read(php_stream *stream, char *buf, size_t count) {
+    bundle_file *file = (bundle_file *) stream->abstract;
+    size_t n = read_bundle_file(file, buf, count);
+    if (file->position >= file->entry->size) stream->eof = 1;
+    return (ssize_t) n;
+}
+
+static int bundle_stream_close(php_stream *stream, int close_handle) {
+    close_bundle_file((bundle_file *) stream->abstract);
+    return 0;
+}
+
+static int bundle_stream_flush(php_stream *stream) {
+    return 0;
+}
+
+static int bundle_stream_seek(php_stream *stream, zend_off_t offset, int whence, zend_off_t *newoffset) {
+    bundle_file *file = (bundle_file *) stream->abstract;
+    zend_off_t base = whence == SEEK_CUR ? (zend_off_t) file->position
+                    : whence == SEEK_END ? (zend_off_t) file->entry->size : 0;
+    zend_off_t target = base + offset;
+
+    if (target < 0 || (uint64_t) target > file->entry->size) return -1;
+
+    file->position = (size_t) target;
+    stream->eof = 0;
+    *newoffset = target;
+    return 0;
+}
+
+static int bundle_stream_stat(php_stream *stream, php_stream_statbuf *ssb) {
+    fill_stat(&ssb->sb, ((bundle_file *) stream->abstract)->entry);
+    return 0;
+}
+
+static const php_stream_ops bundle_stream_ops = {
+        bundle_stream_write,
+        bundle_stream_read,
+        bundle_stream_close,
+        bundle_stream_flush,
+        "bundle",
+        bundle_stream_seek,
+        NULL, // cast
+        bundle_stream_stat,
+        NULL, // set_option
+};
+
+// ---------------------------------------------------------------------------
+// Directory streams
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    size_t first;
+    size_t position;
+    size_t prefix_len;
+    char prefix[PATH_MAX];
+    char last[PATH_MAX];
+} bundle_dir;
+
+static ssize_t bundle_dir_read(php_stream *stream, char *buf, size_t count) {
+    bundle_dir *dir = (bundle_dir *) stream->abstract;
+    php_stream_dirent *ent = (php_stream_dirent *) buf;
+
+    if (count != sizeof(php_stream_dirent)) return -1;
+
+    // Everything under "prefix/" is contiguous in the sorted index; only report
+    // the first path component below it, once.
+    while (dir->position < g_bundle->count) {
+        const bundle_entry *entry = &g_bundle->entries[dir->position++];
+        if (entry->name_len <= dir->prefix_len || memcmp(entry->name, dir->prefix, dir->prefix_len) != 0) {
+            dir->position = g_bundle->count;
+            break;
+        }
+
+        const char *child = entry->name + dir->prefix_len;
+        const char *slash = strchr(child, '/');
+        size_t child_len = slash ? (size_t) (slash - child) : strlen(child);
+        if (child_len >= sizeof(ent->d_name)) continue;
+        if (strlen(dir->last) == child_len && memcmp(dir->last, child, child_len) == 0) continue;
+
+        memcpy(dir->last, child, child_len);
+        dir->last[child_len] = '\0';
+        memcpy(ent->d_name, child, child_len);
+        ent->d_name[child_len] = '\0';
+        ent->d_type = (slash || entry->is_dir) ? DT_DIR : DT_REG;
+        return sizeof(php_stream_dirent);
+    }
+
+    stream->eof = 1;
+    return 0;
+}
+
+static int bundle_dir_close(php_stream *stream, int close_handle) {
+    efree(stream->abstract);
+    return 0;
+}
+
+static int bundle_dir_rewind(php_stream *stream, zend_off_t offset, int whence, zend_off_t *newoffs) {
+    bundle_dir *dir = (bundle_dir *) stream->abstract;
+    dir->position = dir->first;
+    dir->last[0] = '\0';
+    stream->eof = 0;
+    return 0;
+}
+
+static const php_stream_ops bundle_dir_ops = {
+        NULL,
+        bundle_dir_read,
+        bundle_dir_close,
+        NULL,
+        "bundle dir",
+        bundle_dir_rewind,
+        NULL,
+        NULL,
+        NULL,
+};
+
+// ---------------------------------------------------------------------------
+// file:// wrapper
+// ---------------------------------------------------------------------------
+
+#define PLAIN_OPS (php_plain_files_wrapper.wops)
+
+static php_stream *bundle_wrapper_open(php_stream_wrapper *wrapper, const char *filename, const char *mode,
+                                       int options, zend_string **opened_path, php_stream_context *context STREAMS_DC) {
+    char absolute[PATH_MAX];
+    const bundle_entry *entry = archive_file(filename, absolute, sizeof(absolute));
+    if (!entry) {
+        return PLAIN_OPS->stream_opener(&php_plain_files_wrapper, filename, mode, options,
+                                        opened_path, context STREAMS_REL_CC);
+    }
+
+    if (strpbrk(mode, "wax+c")) {
+        php_error_docref(NULL, E_WARNING, "%s is read-only inside the app bundle", filename);
+        return NULL;
+    }
+
+    bundle_file *file = open_bundle_file(entry);
+    if (!file) return NULL;
+
+    php_stream *stream = php_stream_alloc_rel(&bundle_stream_ops, file, NULL, mode);
+    if (!stream) {
+        close_bundle_file(file);
+        return NULL;
+    }
+    // Reads are a memcpy out of the mapping, so PHP's read buffer would only add a copy
+    stream->flags |= PHP_STREAM_FLAG_NO_BUFFER;
+
+    if (opened_path) {
+        *opened_path = zend_string_init(absolute, strlen(absolute), 0);
+    }
+    return stream;
+}
+
+static int bundle_wrapper_url_stat(php_stream_wrapper *wrapper, const char *url, int flags,
+                                   php_stream_statbuf *ssb, php_stream_context *context) {
+    char absolute[PATH_MAX];
+    size_t name_len;
+    const char *name = archive_name(url, absolute, sizeof(absolute), &name_len);
+
+    if (name) {
+        const bundle_entry *entry = bundle_index_find(g_bundle, name, name_len);
+        if (entry || bundle_index_is_dir(g_bundle, name, name_len)) {
+            fill_stat(&ssb->sb, entry);
+            return 0;
+        }
+    }
+
+    return PLAIN_OPS->url_stat(&php_plain_files_wrapper, url, flags, ssb, context);
+}
+
+static php_stream *bundle_wrapper_opendir(php_stream_wrapper *wrapper, const char *filename, const char *mode,
+                                          int options, zend_string **opened_path, php_stream_context *context STREAMS_DC) {
+    char absolute[PATH_MAX];
+    size_t name_len;
+    const char *name = archive_name(filename, absolute, sizeof(absolute), &name_len);
+
+    if (!name || !bundle_index_is_dir(g_bundle, name, name_len) || name_len + 2 > PATH_MAX) {
+        return PLAIN_OPS->dir_opener(&php_plain_files_wrapper, filename, mode, options,
+                                     opened_path, context STREAMS_REL_CC);
+    }
+
+    bundle_dir *dir = ecalloc(1, sizeof(bundle_dir));
+    if (name_len > 0) {
+        memcpy(dir->prefix, name, name_len);
+        dir->prefix[name_len] = '/';
+        dir->prefix_len = name_len + 1;
+    }
+    dir->first = bundle_index_lower_bound(g_bundle, dir->prefix, dir->prefix_len);
+    dir->position = dir->first;
+
+    php_stream *stream = php_stream_alloc(&bundle_dir_ops, dir, NULL, mode);
+    if (!stream) {
+        efree(dir);
+    }
+    return stream;
+}
+
+static int bundle_wrapper_unlink(php_stream_wrapper *wrapper, const char *url, int options,
+                                 php_stream_context *context) {
+    return PLAIN_OPS->unlink(&php_plain_files_wrapper, url, options, context);
+}
+
+static int bundle_wrapper_rename(php_stream_wrapper *wrapper, const char *url_from, const char *url_to,
+                                 int options, php_stream_context *context) {
+    return PLAIN_OPS->rename(&php_plain_files_wrapper, url_from, url_to, options, context);
+}
+
+static int bundle_wrapper_mkdir(php_stream_wrapper *wrapper, const char *url, int mode, int options,
+                                php_stream_context *context) {
+    return PLAIN_OPS->stream_mkdir(&php_plain_files_wrapper, url, mode, options, context);
+}
+
+static int bundle_wrapper_rmdir(php_stream_wrapper *wrapper, const char *url, int options,
+                                php_stream_context *context) {
+    return PLAIN_OPS->stream_rmdir(&php_plain_files_wrapper, url, options, context);
+}
+
+static int bundle_wrapper_metadata(php_stream_wrapper *wrapper, const char *url, int option, void *value,
+                                   php_stream_context *context) {
+    return PLAIN_OPS->stream_metadata(&php_plain_files_wrapper, url, option, value, context);
+}
+
+static const php_stream_wrapper_ops bundle_wrapper_ops = {
+        bundle_wrapper_open,
+        NULL,
+        NULL,
+        bundle_wrapper_url_stat,
+        bundle_wrapper_opendir,
+        "plainfile",
+        bundle_wrapper_unlink,
+        bundle_wrapper_rename,
+        bundle_wrapper_mkdir,
+        bundle_wrapper_rmdir,
+        bundle_wrapper_metadata,
+};
+
+static php_stream_wrapper bundle_wrapper = {
+        &bundle_wrapper_ops,
+        NULL,
+        0,
+};
+
+// ---------------------------------------------------------------------------
+// Engine hooks: include/require, include_once resolution and realpath()
+// ---------------------------------------------------------------------------
+
+static ssize_t bundle_zend_read(void *handle, char *buf, size_t len) {
+    return (ssize_t) read_bundle_file((bundle_file *) handle, buf, len);
+}
+
+static size_t bundle_zend_fsize(void *handle) {
+    return (size_t) ((bundle_file *) handle)->entry->size;
+}
+
+static void bundle_zend_close(void *handle) {
+    close_bundle_file((bundle_file *) handle);
+}
+
+static zend_result bundle_stream_open_function(zend_file_handle *handle) {
+    char absolute[PATH_MAX];
+    const bundle_entry *entry = handle->filename
+                                ? archive_file(ZSTR_VAL(handle->filename), absolute, sizeof(absolute))
+                                : NULL;
+    if (!entry) {
+        return original_stream_open(handle);
+    }
+
+    bundle_file *file = open_bundle_file(entry);
+    if (!file) return FAILURE;
+
+    handle->type = ZEND_HANDLE_STREAM;
+    handle->handle.stream.handle = file;
+    handle->handle.stream.isatty = 0;
+    handle->handle.stream.reader = bundle_zend_read;
+    handle->handle.stream.fsizer = bundle_zend_fsize;
+    handle->handle.stream.closer = bundle_zend_close;
+
+    if (!handle->opened_path) {
+        handle->opened_path = zend_string_init(absolute, strlen(absolute), 0);
+    }
+    return SUCCESS;
+}
+
+static zend_string *bundle_resolve_path(zend_string *filename) {
+    char absolute[PATH_MAX];
+    if (archive_file(ZSTR_VAL(filename), absolute, sizeof(absolute))) {
+        return zend_string_init(absolute, strlen(absolute), 0);
+    }
+    return original_resolve_path(filename);
+}
+
+static ZEND_NAMED_FUNCTION(bundle_realpath) {
+    if (ZEND_NUM_ARGS() == 1 && Z_TYPE_P(ZEND_CALL_ARG(execute_data, 1)) == IS_STRING) {
+        char absolute[PATH_MAX];
+        const char *path = Z_STRVAL_P(ZEND_CALL_ARG(execute_data, 1));
+        if (archive_file(path, absolute, sizeof(absolute)) || archive_dir(path, absolute, sizeof(absolute))) {
+            RETURN_STRING(absolute);
+        }
+    }
+    original_realpath(execute_data, return_value);
+}
+
+void bundle_archive_activate(void) {
+    if (!g_bundle) return;
+
+    // A per-request wrapper table overrides the plain wrapper for unqualified paths too
+    php_unregister_url_stream_wrapper_volatile(ZSTR_KNOWN(ZEND_STR_FILE));
+    if (php_register_url_stream_wrapper_volatile(ZSTR_KNOWN(ZEND_STR_FILE), &bundle_wrapper) != SUCCESS) {
+        LOGE("Failed to install bundle file:// wrapper");
+        return;
+    }
+
+    if (zend_stream_open_function != bundle_stream_open_function) {
+        original_stream_open = zend_stream_open_function;
+        zend_stream_open_function = bundle_stream_open_function;
+    }
+
+    if (zend_resolve_path != bundle_resolve_path) {
+        original_resolve_path = zend_resolve_path;
+        zend_resolve_path = bundle_resolve_path;
+    }
+
+    zend_function *realpath_fn = zend_hash_str_find_ptr(CG(function_table), "realpath", sizeof("realpath") - 1);
+    if (realpath_fn && realpath_fn->type == ZEND_INTERNAL_FUNCTION &&
+        realpath_fn->internal_function.handler != bundle_realpath) {
+        original_realpath = realpath_fn->internal_function.handler;
+        realpath_fn->internal_function.handler = bundle_realpath;
+    }
+}
+
+int bundle_archive_mount(const char *path, int64_t offset, int64_t length,
+                         const char *root, const char *const *disk_paths, int disk_path_count) {
+    bundle_archive_unmount();
+
+    char normalized[PATH_MAX];
+    if (normalize_path(root, normalized, sizeof(normalized)) == 0) return -1;
+
+    g_bundle = bundle_index_open(path, offset, length);
+    if (!g_bundle) return -1;
+
+    g_root = strdup(normalized);
+    g_root_len = strlen(g_root);
+
+    char resolved[PATH_MAX];
+    if (realpath(normalized, resolved) && strcmp(resolved, normalized) != 0) {
+        g_real_root = strdup(resolved);
+        g_real_root_len = strlen(g_real_root);
+    }
+    g_mount_time = time(NULL);
+
+    g_disk_paths = calloc(disk_path_count > 0 ? disk_path_count : 1, sizeof(char *));
+    for (int i = 0; i < disk_path_count; i++) {
+        g_disk_paths[g_disk_path_count++] = strdup(disk_paths[i]);
+    }
+
+    LOGI("📦 Mounted bundle at %s (%zu entries, %d disk paths)", g_root, g_bundle->count, g_disk_path_count);
+    return 0;
+}
+
+void bundle_archive_unmount(void) {
+    bundle_index_close(g_bundle);
+    g_bundle = NULL;
+
+    free(g_root);
+    g_root = NULL;
+    g_root_len = 0;
+    free(g_real_root);
+    g_real_root = NULL;
+    g_real_root_len = 0;
+
+    for (int i = 0; i < g_disk_path_count; i++) {
+        free(g_disk_paths[i]);
+    }
+    free(g_disk_paths);
+    g_disk_paths = NULL;
+    g_disk_path_count = 0;
+}
+
+int bundle_archive_is_mounted(void) {
+    return g_bundle != NULL;
+}
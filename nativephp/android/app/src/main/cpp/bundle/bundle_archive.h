@@ -0,0 +1,28 @@
+#ifndef BUNDLE_ARCHIVE_H
+#define BUNDLE_ARCHIVE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Serve the Laravel tree to PHP straight out of the bundle zip ===
+
+// Map the bundle and expose its contents under `root`, as if it had been
+// extracted there. Paths under any of `disk_paths` (relative to root, e.g.
+// "storage", ".env") always go to the real filesystem. Returns 0 on success.
+int bundle_archive_mount(const char *path, int64_t offset, int64_t length,
+                         const char *root, const char *const *disk_paths, int disk_path_count);
+void bundle_archive_unmount(void);
+int bundle_archive_is_mounted(void);
+
+// Install the file:// wrapper and include hooks for the current request.
+// Must run after every php_embed_init(), since startup resets them.
+void bundle_archive_activate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUNDLE_ARCHIVE_H
@@ -0,0 +1,439 @@
+#include "bundle_delta.h"
+#include "bundle_index.h"
+#include "bundle_manifest.h"
+#include "sha256.h"
+
+#include <android/log.h>
+#include <zlib.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_TAG "BundleDelta"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+#define STAGING_DIR ".delta_staging"
+
+typedef enum {
+    DELTA_ADD,
+    DELTA_PATCH,
+    DELTA_REMOVE,
+} delta_kind;
+
+typedef struct {
+    delta_kind kind;
+    char sha256[SHA256_HEX_SIZE];
+    uint64_t size;
+    uint32_t base_crc;
+    uint32_t crc;           // of the reconstructed file, for the new manifest
+    const char *path;
+} delta_op;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1000.0 + (double) ts.tv_nsec / 1e6;
+}
+
+static int read_varint(const unsigned char **p, const unsigned char *end, uint64_t *value) {
+    uint64_t result = 0;
+    int shift = 0;
+    while (*p < end && shift < 64) {
+        unsigned char byte = *(*p)++;
+        result |= (uint64_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+        shift += 7;
+    }
+    return -1;
+}
+
+int bundle_delta_patch(const unsigned char *source, size_t source_size,
+                       const unsigned char *patch, size_t patch_size,
+                       unsigned char **output, size_t *output_size) {
+    const unsigned char *p = patch;
+    const unsigned char *end = patch + patch_size;
+    uint64_t target_size;
+
+    if (patch_size < 4 || memcmp(p, BUNDLE_DELTA_MAGIC, 4) != 0) return -1;
+    p += 4;
+    if (read_varint(&p, end, &target_size) != 0) return -1;
+
+    unsigned char *out = malloc(target_size ? target_size : 1);
+    if (!out) return -1;
+
+    uint64_t written = 0;
+    while (p < end) {
+        unsigned char op = *p++;
+        uint64_t offset, length;
+
+        if (op == BUNDLE_DELTA_OP_END) break;
+
+        if (op == BUNDLE_DELTA_OP_COPY) {
+            if (read_varint(&p, end, &offset) != 0 || read_varint(&p, end, &length) != 0 ||
+                offset > source_size || length > source_size - offset || length > target_size - written) {
+                goto corrupt;
+            }
+            memcpy(out + written, source + offset, length);
+        } else if (op == BUNDLE_DELTA_OP_ADD) {
+            if (read_varint(&p, end, &length) != 0 ||
+                length > (uint64_t) (end - p) || length > target_size - written) {
+                goto corrupt;
+            }
+            memcpy(out + written, p, length);
+            p += length;
+        } else {
+            goto corrupt;
+        }
+        written += length;
+    }
+
+    if (written != target_size) goto corrupt;
+
+    *output = out;
+    *output_size = (size_t) target_size;
+    return 0;
+
+corrupt:
+    free(out);
+    return -1;
+}
+
+static int is_safe_path(const char *path) {
+    if (path[0] == '\0' || path[0] == '/') return 0;
+    for (const char *p = path; *p; p++) {
+        if (p[0] == '.' && p[1] == '.' && (p == path || p[-1] == '/') && (p[2] == '/' || p[2] == '\0')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int make_parents(char *path) {
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        int failed = mkdir(path, 0755) != 0 && errno != EEXIST;
+        *p = '/';
+        if (failed) return -1;
+    }
+    return 0;
+}
+
+// "dir/name" into `out`; -1 if it doesn't fit
+static int join_path(char *out, size_t size, const char *dir, const char *name) {
+    int length = snprintf(out, size, "%s/%s", dir, name);
+    return length < 0 || (size_t) length >= size ? -1 : 0;
+}
+
+static int write_file(char *path, const unsigned char *data, size_t size) {
+    if (make_parents(path) != 0) return -1;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = write(fd, data + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            return -1;
+        }
+        done += (size_t) n;
+    }
+    return close(fd);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    return remove(path);
+}
+
+static void remove_tree(const char *path) {
+    nftw(path, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static int parse_manifest(char *text, delta_op **ops_out, size_t *count_out) {
+    size_t capacity = 64, count = 0;
+    delta_op *ops = malloc(capacity * sizeof(delta_op));
+    if (!ops) return -1;
+
+    char *line = text;
+    while (line && *line) {
+        char *end = strchr(line, '\n');
+        if (end) *end = '\0';
+
+        char kind[16], sha[SHA256_HEX_SIZE], base[16];
+        unsigned long long size;
+        int path_offset = 0;
+
+        if (line[0] != '#' && line[0] != '\0') {
+            if (sscanf(line, "%15s %64s %llu %15s %n", kind, sha, &size, base, &path_offset) != 4 || path_offset == 0) {
+                LOGE("Malformed delta line: %s", line);
+                free(ops);
+                return -1;
+            }
+
+            if (count == capacity) {
+                capacity *= 2;
+                delta_op *grown = realloc(ops, capacity * sizeof(delta_op));
+                if (!grown) {
+                    free(ops);
+                    return -1;
+                }
+                ops = grown;
+            }
+
+            delta_op *op = &ops[count++];
+            memset(op, 0, sizeof(*op));
+            op->path = line + path_offset;
+            op->size = size;
+            snprintf(op->sha256, sizeof(op->sha256), "%s", sha);
+            op->base_crc = (uint32_t) strtoul(base, NULL, 16);
+
+            if (strcmp(kind, "add") == 0) {
+                op->kind = DELTA_ADD;
+            } else if (strcmp(kind, "patch") == 0) {
+                op->kind = DELTA_PATCH;
+            } else if (strcmp(kind, "remove") == 0) {
+                op->kind = DELTA_REMOVE;
+            } else {
+                LOGE("Unknown delta op %s", kind);
+                free(ops);
+                return -1;
+            }
+
+            if (!is_safe_path(op->path)) {
+                LOGE("Refusing unsafe delta path %s", op->path);
+                free(ops);
+                return -1;
+            }
+        }
+
+        line = end ? end + 1 : NULL;
+    }
+
+    *ops_out = ops;
+    *count_out = count;
+    return 0;
+}
+
+static const bundle_entry *payload_entry(const bundle_index *patch, const char *dir, const char *path) {
+    char name[4096];
+    if (join_path(name, sizeof(name), dir, path) != 0) return NULL;
+    const bundle_entry *entry = bundle_index_find(patch, name, strlen(name));
+    return entry && !entry->is_dir ? entry : NULL;
+}
+
+// Build the new file for one op in memory, verify it and write it under staging.
+static int stage_op(const bundle_index *patch, delta_op *op, const char *destination,
+                    const char *staging, const bundle_manifest *installed, uint64_t *bytes) {
+    const unsigned char *payload;
+    unsigned char *owned = NULL;
+    unsigned char *patched = NULL;
+    const unsigned char *content;
+    size_t content_size;
+    char path[4096];
+
+    const bundle_entry *entry = payload_entry(patch, op->kind == DELTA_ADD ? "files" : "patches", op->path);
+    if (!entry || bundle_index_read(patch, entry, &payload, &owned) != 0) {
+        LOGE("Missing payload for %s", op->path);
+        return -1;
+    }
+
+    if (op->kind == DELTA_ADD) {
+        content = payload;
+        content_size = (size_t) entry->size;
+    } else {
+        const bundle_manifest_entry *base = bundle_manifest_find(installed, op->path);
+        if (!base || base->crc != op->base_crc) {
+            LOGE("Installed %s isn't the file this patch was made against", op->path);
+            free(owned);
+            return -1;
+        }
+
+        int fd = join_path(path, sizeof(path), destination, op->path) == 0 ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || (uint64_t) st.st_size != base->size) {
+            LOGE("Installed %s is missing or has changed size", op->path);
+            if (fd >= 0) close(fd);
+            free(owned);
+            return -1;
+        }
+
+        void *source = st.st_size > 0 ? mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+        close(fd);
+        if (source == MAP_FAILED) {
+            free(owned);
+            return -1;
+        }
+
+        int result = bundle_delta_patch((const unsigned char *) source, (size_t) st.st_size,
+                                        payload, (size_t) entry->size, &patched, &content_size);
+        if (source) munmap(source, (size_t) st.st_size);
+        if (result != 0) {
+            LOGE("Corrupt patch for %s", op->path);
+            free(owned);
+            return -1;
+        }
+        content = patched;
+    }
+
+    char digest[SHA256_HEX_SIZE];
+    sha256_hex(content, content_size, digest);
+
+    int result = 0;
+    if (content_size != op->size || strcmp(digest, op->sha256) != 0) {
+        LOGE("Hash mismatch for %s", op->path);
+        result = -1;
+    } else {
+        result = join_path(path, sizeof(path), staging, op->path) == 0 ? write_file(path, content, content_size) : -1;
+        op->crc = (uint32_t) crc32(crc32(0L, Z_NULL, 0), content, (uInt) content_size);
+        *bytes += content_size;
+    }
+
+    free(patched);
+    free(owned);
+    return result;
+}
+
+int bundle_delta_apply(const char *patch_path, const char *destination, bundle_delta_stats *stats) {
+    double started = now_ms();
+    bundle_delta_stats local_stats;
+    memset(&local_stats, 0, sizeof(local_stats));
+
+    char manifest_file[4096], staging[4096], from[4096], to[4096];
+    if (join_path(manifest_file, sizeof(manifest_file), destination, BUNDLE_MANIFEST_FILE) != 0 ||
+        join_path(staging, sizeof(staging), destination, STAGING_DIR) != 0) {
+        LOGE("Install path too long: %s", destination);
+        return -1;
+    }
+
+    bundle_manifest installed;
+    if (bundle_manifest_load(&installed, manifest_file) != 0 || installed.count == 0) {
+        LOGE("No install manifest in %s, a delta can't be applied", destination);
+        bundle_manifest_free(&installed);
+        return -1;
+    }
+
+    bundle_index *patch = bundle_index_open(patch_path, 0, 0);
+    if (!patch) {
+        bundle_manifest_free(&installed);
+        return -1;
+    }
+    local_stats.bytes_downloaded = patch->length;
+
+    const bundle_entry *manifest_entry = bundle_index_find(patch, BUNDLE_DELTA_MANIFEST, strlen(BUNDLE_DELTA_MANIFEST));
+    const unsigned char *manifest_data;
+    unsigned char *manifest_owned = NULL;
+    char *text = NULL;
+    delta_op *ops = NULL;
+    size_t op_count = 0;
+    int result = -1;
+
+    if (!manifest_entry || bundle_index_read(patch, manifest_entry, &manifest_data, &manifest_owned) != 0) {
+        LOGE("Patch has no %s", BUNDLE_DELTA_MANIFEST);
+        goto done;
+    }
+
+    text = malloc(manifest_entry->size + 1);
+    if (!text) goto done;
+    memcpy(text, manifest_data, manifest_entry->size);
+    text[manifest_entry->size] = '\0';
+
+    if (parse_manifest(text, &ops, &op_count) != 0) goto done;
+
+    // Stage and verify everything before the installed tree is touched
+    remove_tree(staging);
+    if (mkdir(staging, 0755) != 0) goto done;
+
+    for (size_t i = 0; i < op_count; i++) {
+        // The staging path is the longest, so if it fits every path for this op does
+        if (join_path(from, sizeof(from), staging, ops[i].path) != 0) {
+            LOGE("Path too long: %s", ops[i].path);
+            goto done;
+        }
+        if (ops[i].kind == DELTA_REMOVE) continue;
+        if (stage_op(patch, &ops[i], destination, staging, &installed, &local_stats.bytes_written) != 0) {
+            goto done;
+        }
+    }
+
+    // Between here and the new manifest being saved the tree is a mix of versions,
+    // and without a manifest the next install starts from a clean tree.
+    unlink(manifest_file);
+
+    for (size_t i = 0; i < op_count; i++) {
+        if (join_path(to, sizeof(to), destination, ops[i].path) != 0) goto done;
+
+        if (ops[i].kind == DELTA_REMOVE) {
+            if (unlink(to) == 0) local_stats.files_removed++;
+            char *slash;
+            while ((slash = strrchr(to, '/')) && (size_t) (slash - to) > strlen(destination)) {
+                *slash = '\0';
+                if (rmdir(to) != 0) break;
+            }
+            continue;
+        }
+
+        if (join_path(from, sizeof(from), staging, ops[i].path) != 0) goto done;
+        if (make_parents(to) != 0 || rename(from, to) != 0) {
+            LOGE("Cannot move %s into place: %s", ops[i].path, strerror(errno));
+            goto done;
+        }
+
+        if (ops[i].kind == DELTA_ADD) {
+            local_stats.files_added++;
+        } else {
+            local_stats.files_patched++;
+        }
+    }
+
+    bundle_manifest updated;
+    memset(&updated, 0, sizeof(updated));
+    for (size_t i = 0; i < installed.count; i++) {
+        int replaced = 0;
+        for (size_t j = 0; j < op_count && !replaced; j++) {
+            replaced = strcmp(ops[j].path, installed.entries[i].path) == 0;
+        }
+        if (!replaced) {
+            bundle_manifest_add(&updated, installed.entries[i].path, installed.entries[i].crc, installed.entries[i].size);
+        }
+    }
+    for (size_t j = 0; j < op_count; j++) {
+        if (ops[j].kind != DELTA_REMOVE) {
+            bundle_manifest_add(&updated, ops[j].path, ops[j].crc, ops[j].size);
+        }
+    }
+    bundle_manifest_sort(&updated);
+    result = bundle_manifest_save(&updated, manifest_file);
+    bundle_manifest_free(&updated);
+
+done:
+    remove_tree(staging);
+    free(ops);
+    free(text);
+    free(manifest_owned);
+    bundle_index_close(patch);
+    bundle_manifest_free(&installed);
+
+    local_stats.elapsed_ms = now_ms() - started;
+    LOGI("Delta %s in %.1f ms: %d added, %d patched, %d removed, %llu bytes written from a %llu byte patch",
+         result == 0 ? "applied" : "failed", local_stats.elapsed_ms,
+         local_stats.files_added, local_stats.files_patched, local_stats.files_removed,
+         (unsigned long long) local_stats.bytes_written, (unsigned long long) local_stats.bytes_downloaded);
+
+    if (stats) *stats = local_stats;
+    return result;
+}
@@ -0,0 +1,54 @@
+#ifndef BUNDLE_DELTA_H
+#define BUNDLE_DELTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Apply a delta OTA patch to an installed bundle ===
+//
+// A patch is a zip holding `delta.manifest` plus file payloads:
+//
+//     # bundle delta v1
+//     add     <sha256> <size> -           <path>    payload in files/<path>
+//     patch   <sha256> <size> <base crc>  <path>    payload in patches/<path>
+//     remove  -        0      -           <path>
+//
+// `add` also covers replaced files. Patch payloads are a COPY/ADD op stream
+// against the installed file (see BUNDLE_DELTA_MAGIC). Every output is checked
+// against its SHA-256 in a staging directory before anything installed is
+// touched, and the installed .bundle_manifest must vouch for each base file.
+
+#define BUNDLE_DELTA_MANIFEST "delta.manifest"
+#define BUNDLE_DELTA_MAGIC "NPD1"
+
+#define BUNDLE_DELTA_OP_END 0x00
+#define BUNDLE_DELTA_OP_COPY 0x01  // varint source offset, varint length
+#define BUNDLE_DELTA_OP_ADD 0x02   // varint length, then that many literal bytes
+
+typedef struct {
+    int files_added;
+    int files_patched;
+    int files_removed;
+    uint64_t bytes_downloaded;  // size of the patch zip
+    uint64_t bytes_written;
+    double elapsed_ms;
+} bundle_delta_stats;
+
+// Returns 0 on success. On failure the installed tree is left as it was
+// unless the failure happened while moving verified files into place.
+int bundle_delta_apply(const char *patch_path, const char *destination, bundle_delta_stats *stats);
+
+// Reconstruct a single file; exposed for tools and tests.
+int bundle_delta_patch(const unsigned char *source, size_t source_size,
+                       const unsigned char *patch, size_t patch_size,
+                       unsigned char **output, size_t *output_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUNDLE_DELTA_H
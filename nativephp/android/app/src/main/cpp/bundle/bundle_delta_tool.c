@@ -0,0 +1,84 @@
+// Host helper for delta OTA patches.
+//
+//     bundle_delta_tool manifest <bundle.zip> <installed-dir>
+//         write the .bundle_manifest an install of <bundle.zip> would leave behind
+//     bundle_delta_tool apply <patch.zip> <installed-dir>
+//         apply a patch made by tools/ota-fixture/make-delta.php
+//     bundle_delta_tool install <bundle.zip> <installed-dir>
+//         full install over an existing tree, as the app does for a
+//         non-delta update (only when built against libzip)
+//
+// Patches are produced by PHP so the server side doesn't need a toolchain;
+// this is only here so tests can exercise the same applier the app runs.
+
+#include "bundle_delta.h"
+#ifdef BUNDLE_DELTA_TOOL_EXTRACT
+#include "bundle_extract.h"
+#endif
+#include "bundle_index.h"
+#include "bundle_manifest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int write_manifest(const char *zip_path, const char *destination) {
+    bundle_index *index = bundle_index_open(zip_path, 0, 0);
+    if (!index) {
+        fprintf(stderr, "cannot open %s\n", zip_path);
+        return 1;
+    }
+
+    bundle_manifest manifest;
+    memset(&manifest, 0, sizeof(manifest));
+    for (size_t i = 0; i < index->count; i++) {
+        const bundle_entry *entry = &index->entries[i];
+        if (!entry->is_dir) bundle_manifest_add(&manifest, entry->name, entry->crc, entry->size);
+    }
+    bundle_manifest_sort(&manifest);
+
+    char file[4096];
+    snprintf(file, sizeof(file), "%s/%s", destination, BUNDLE_MANIFEST_FILE);
+    int result = bundle_manifest_save(&manifest, file);
+
+    bundle_manifest_free(&manifest);
+    bundle_index_close(index);
+    return result == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s manifest <bundle.zip> <dir> | apply <patch.zip> <dir> | install <bundle.zip> <dir>\n",
+                argv[0]);
+        return 2;
+    }
+
+    if (strcmp(argv[1], "manifest") == 0) {
+        return write_manifest(argv[2], argv[3]);
+    }
+
+    if (strcmp(argv[1], "apply") == 0) {
+        bundle_delta_stats stats;
+        int result = bundle_delta_apply(argv[2], argv[3], &stats);
+        printf("%s: %d added, %d patched, %d removed, %.1f ms\n", result == 0 ? "applied" : "FAILED",
+               stats.files_added, stats.files_patched, stats.files_removed, stats.elapsed_ms);
+        return result == 0 ? 0 : 1;
+    }
+
+#ifdef BUNDLE_DELTA_TOOL_EXTRACT
+    if (strcmp(argv[1], "install") == 0) {
+        // Same options LaravelEnvironment.installBundleFile() extracts with
+        bundle_extract_options options = {
+                .skip_unchanged = 1,
+                .use_manifest = 1,
+        };
+        bundle_extract_stats stats;
+        int result = bundle_extract(argv[2], 0, 0, argv[3], &options, &stats);
+        printf("%s: %d written, %d skipped, %d removed, %.1f ms\n", result == 0 ? "installed" : "FAILED",
+               stats.files_written, stats.files_skipped, stats.files_removed, stats.elapsed_ms);
+        return result == 0 ? 0 : 1;
+    }
+#endif
+
+    fprintf(stderr, "unknown command %s\n", argv[1]);
+    return 2;
+}
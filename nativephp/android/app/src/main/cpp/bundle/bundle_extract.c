@@ -0,0 +1,502 @@
+#include "bundle_extract.h"
+#include "bundle_manifest.h"
+
+#include <android/log.h>
+#include <zip.h>
+#include <zlib.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_TAG "BundleExtract"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+#define MAX_EXTRACT_THREADS 8
+
+typedef struct {
+    zip_uint64_t index;
+    zip_uint64_t size;
+    zip_uint64_t comp_size;
+    uint32_t crc;
+    int trusted;            // the installed manifest says it's already on disk
+    char *path;             // absolute destination path
+    const char *name;       // path relative to the destination, points into `path`
+} extract_entry;
+
+typedef struct {
+    const char *archive_path;
+    int64_t offset;
+    int64_t length;
+    const bundle_extract_options *options;
+    size_t buffer_size;
+
+    extract_entry *entries;
+    size_t entry_count;
+    atomic_size_t next;
+
+    atomic_int files_written;
+    atomic_int files_skipped;
+    atomic_int errors;
+    atomic_uint_fast64_t bytes_written;
+} extract_job;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1000.0 + (double) ts.tv_nsec / 1e6;
+}
+
+// Each caller gets its own FILE* and zip_t so workers never share a file offset.
+static zip_t *open_archive(const char *path, int64_t offset, int64_t length) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        LOGE("Cannot open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    zip_error_t error;
+    zip_error_init(&error);
+
+    zip_source_t *source = zip_source_filep_create(fp, (zip_uint64_t) offset,
+                                                   length > 0 ? length : ZIP_LENGTH_TO_END, &error);
+    if (!source) {
+        LOGE("Cannot create zip source: %s", zip_error_strerror(&error));
+        zip_error_fini(&error);
+        fclose(fp);
+        return NULL;
+    }
+
+    zip_t *archive = zip_open_from_source(source, ZIP_RDONLY, &error);
+    if (!archive) {
+        LOGE("Cannot open bundle archive: %s", zip_error_strerror(&error));
+        zip_source_free(source);
+    }
+
+    zip_error_fini(&error);
+    return archive;
+}
+
+// Entries are written relative to the destination, so refuse anything that could escape it.
+static int is_safe_entry_name(const char *name) {
+    if (name[0] == '\0' || name[0] == '/') return 0;
+
+    const char *segment = name;
+    while (segment) {
+        if (segment[0] == '.' && segment[1] == '.' && (segment[2] == '/' || segment[2] == '\0')) {
+            return 0;
+        }
+        segment = strchr(segment, '/');
+        if (segment) segment++;
+    }
+    return 1;
+}
+
+static int matches_any(const char *const *paths, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        size_t len = strlen(paths[i]);
+        if (strncmp(name, paths[i], len) == 0 && (name[len] == '\0' || name[len] == '/')) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int is_selected(const bundle_extract_options *options, const char *name) {
+    if (!options || options->only_path_count <= 0) return 1;
+    return matches_any(options->only_paths, options->only_path_count, name);
+}
+
+// Create every missing component of `path` after the first `skip` bytes.
+static int make_dirs(char *path, size_t skip, int *created) {
+    for (char *p = path + (skip > 0 ? skip : 1); *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(path, 0755) == 0) {
+            (*created)++;
+        } else if (errno != EEXIST) {
+            *p = '/';
+            return -1;
+        }
+        *p = '/';
+    }
+    if (mkdir(path, 0755) == 0) {
+        (*created)++;
+    } else if (errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+static int file_matches(const extract_entry *entry, unsigned char *buffer, size_t buffer_size) {
+    struct stat st;
+    if (stat(entry->path, &st) != 0 || !S_ISREG(st.st_mode) || (zip_uint64_t) st.st_size != entry->size) {
+        return 0;
+    }
+
+    int fd = open(entry->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    ssize_t n;
+    while ((n = read(fd, buffer, buffer_size)) > 0) {
+        crc = crc32(crc, buffer, (uInt) n);
+    }
+    close(fd);
+
+    return n == 0 && (uint32_t) crc == entry->crc;
+}
+
+static int write_entry(zip_t *archive, const extract_entry *entry,
+                       unsigned char *buffer, size_t buffer_size, uint64_t *written) {
+    zip_file_t *zf = zip_fopen_index(archive, entry->index, 0);
+    if (!zf) {
+        LOGE("Cannot open entry %s: %s", entry->path, zip_strerror(archive));
+        return -1;
+    }
+
+    // A slot cloned for a delta shares inodes with the running slot through
+    // hard links, so replace the file rather than truncating it in place
+    if (unlink(entry->path) != 0 && errno != ENOENT) {
+        LOGE("Cannot replace %s: %s", entry->path, strerror(errno));
+        zip_fclose(zf);
+        return -1;
+    }
+
+    int fd = open(entry->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOGE("Cannot create %s: %s", entry->path, strerror(errno));
+        zip_fclose(zf);
+        return -1;
+    }
+
+    int result = 0;
+    zip_int64_t n;
+    while ((n = zip_fread(zf, buffer, buffer_size)) > 0) {
+        unsigned char *p = buffer;
+        zip_int64_t remaining = n;
+        while (remaining > 0) {
+            ssize_t w = write(fd, p, (size_t) remaining);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                LOGE("Write failed for %s: %s", entry->path, strerror(errno));
+                result = -1;
+                break;
+            }
+            p += w;
+            remaining -= w;
+        }
+        if (result != 0) break;
+        *written += (uint64_t) n;
+    }
+
+    // zip_fread returns -1 on a CRC mismatch as well as on read errors
+    if (n < 0) {
+        LOGE("Inflate failed for %s: %s", entry->path, zip_file_strerror(zf));
+        result = -1;
+    }
+
+    close(fd);
+    zip_fclose(zf);
+
+    if (result != 0) unlink(entry->path);
+    return result;
+}
+
+static void *extract_worker(void *arg) {
+    extract_job *job = (extract_job *) arg;
+
+    unsigned char *buffer = malloc(job->buffer_size);
+    zip_t *archive = open_archive(job->archive_path, job->offset, job->length);
+    if (!buffer || !archive) {
+        // Another worker can still drain the queue, but count the failure.
+        atomic_fetch_add(&job->errors, 1);
+        free(buffer);
+        if (archive) zip_discard(archive);
+        return NULL;
+    }
+
+    size_t i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->entry_count) {
+        extract_entry *entry = &job->entries[i];
+
+        if (job->options && job->options->skip_unchanged &&
+            file_matches(entry, buffer, job->buffer_size)) {
+            atomic_fetch_add(&job->files_skipped, 1);
+            continue;
+        }
+
+        uint64_t written = 0;
+        if (write_entry(archive, entry, buffer, job->buffer_size, &written) == 0) {
+            atomic_fetch_add(&job->files_written, 1);
+        } else {
+            atomic_fetch_add(&job->errors, 1);
+        }
+        atomic_fetch_add(&job->bytes_written, written);
+    }
+
+    zip_discard(archive);
+    free(buffer);
+    return NULL;
+}
+
+// Trusted entries go to the end, where the workers never reach. Of the rest, largest
+// compressed entries first so one big file doesn't end up last on a single worker.
+static int compare_entries(const void *a, const void *b) {
+    const extract_entry *ea = (const extract_entry *) a;
+    const extract_entry *eb = (const extract_entry *) b;
+    if (ea->trusted != eb->trusted) return ea->trusted - eb->trusted;
+    if (ea->comp_size == eb->comp_size) return 0;
+    return ea->comp_size < eb->comp_size ? 1 : -1;
+}
+
+// Mark entries the installed manifest already accounts for. The size check catches
+// files that were deleted or rewritten behind the manifest's back without reading them.
+static int trust_installed(extract_entry *entries, size_t count, const bundle_manifest *installed) {
+    int trusted = 0;
+    for (size_t i = 0; i < count; i++) {
+        const bundle_manifest_entry *previous = bundle_manifest_find(installed, entries[i].name);
+        if (!previous || previous->crc != entries[i].crc || previous->size != entries[i].size) continue;
+
+        struct stat st;
+        if (stat(entries[i].path, &st) == 0 && S_ISREG(st.st_mode) && (zip_uint64_t) st.st_size == entries[i].size) {
+            entries[i].trusted = 1;
+            trusted++;
+        }
+    }
+    return trusted;
+}
+
+// Delete files the previous install wrote that the new bundle no longer has,
+// then any directories that leaves empty.
+static int remove_stale(const char *destination, const bundle_manifest *installed,
+                        const bundle_manifest *current, const bundle_extract_options *options) {
+    int removed = 0;
+    size_t dest_len = strlen(destination);
+    char full[4096];
+
+    for (size_t i = 0; i < installed->count; i++) {
+        const char *name = installed->entries[i].path;
+        if (bundle_manifest_find(current, name)) continue;
+        if (matches_any(options->keep_paths, options->keep_path_count, name)) continue;
+        if (!is_safe_entry_name(name)) continue;
+
+        snprintf(full, sizeof(full), "%s/%s", destination, name);
+        if (unlink(full) == 0) {
+            removed++;
+        } else if (errno != ENOENT) {
+            LOGE("Cannot remove %s: %s", full, strerror(errno));
+            continue;
+        }
+
+        char *slash;
+        while ((slash = strrchr(full, '/')) && (size_t) (slash - full) > dest_len) {
+            *slash = '\0';
+            if (rmdir(full) != 0) break;
+        }
+    }
+    return removed;
+}
+
+int bundle_extract(const char *path, int64_t offset, int64_t length,
+                   const char *destination,
+                   const bundle_extract_options *options,
+                   bundle_extract_stats *stats) {
+    double started = now_ms();
+    bundle_extract_stats local_stats;
+    memset(&local_stats, 0, sizeof(local_stats));
+
+    zip_t *archive = open_archive(path, offset, length);
+    if (!archive) return -1;
+
+    zip_int64_t count = zip_get_num_entries(archive, 0);
+    if (count < 0) {
+        zip_discard(archive);
+        return -1;
+    }
+
+    extract_entry *entries = calloc((size_t) count + 1, sizeof(extract_entry));
+    if (!entries) {
+        zip_discard(archive);
+        return -1;
+    }
+
+    size_t dest_len = strlen(destination);
+    char *root = strdup(destination);
+    if (!root || make_dirs(root, 0, &local_stats.directories_created) != 0) {
+        LOGE("Cannot create destination %s: %s", destination, strerror(errno));
+        free(root);
+        free(entries);
+        zip_discard(archive);
+        return -1;
+    }
+    free(root);
+    size_t file_count = 0;
+    char last_parent[4096] = "";
+    int result = 0;
+
+    // Single pass over the central directory: validate names and create every directory up front.
+    for (zip_int64_t i = 0; i < count; i++) {
+        zip_stat_t st;
+        zip_stat_init(&st);
+        if (zip_stat_index(archive, (zip_uint64_t) i, 0, &st) != 0 || !(st.valid & ZIP_STAT_NAME)) {
+            local_stats.errors++;
+            continue;
+        }
+
+        if (!is_safe_entry_name(st.name)) {
+            LOGE("Refusing unsafe entry name: %s", st.name);
+            local_stats.errors++;
+            continue;
+        }
+
+        if (!is_selected(options, st.name)) continue;
+
+        size_t name_len = strlen(st.name);
+        char *full = malloc(dest_len + name_len + 2);
+        if (!full) {
+            local_stats.errors++;
+            continue;
+        }
+        snprintf(full, dest_len + name_len + 2, "%s/%s", destination, st.name);
+
+        if (st.name[name_len - 1] == '/') {
+            full[dest_len + name_len] = '\0';
+            if (make_dirs(full, dest_len, &local_stats.directories_created) != 0) {
+                LOGE("Cannot create directory %s: %s", full, strerror(errno));
+                local_stats.errors++;
+            }
+            free(full);
+            continue;
+        }
+
+        char *slash = strrchr(full, '/');
+        *slash = '\0';
+        if (strcmp(full, last_parent) != 0) {
+            if (make_dirs(full, dest_len, &local_stats.directories_created) != 0) {
+                LOGE("Cannot create directory %s: %s", full, strerror(errno));
+                local_stats.errors++;
+            }
+            snprintf(last_parent, sizeof(last_parent), "%s", full);
+        }
+        *slash = '/';
+
+        extract_entry *entry = &entries[file_count++];
+        entry->index = (zip_uint64_t) i;
+        entry->size = (st.valid & ZIP_STAT_SIZE) ? st.size : 0;
+        entry->comp_size = (st.valid & ZIP_STAT_COMP_SIZE) ? st.comp_size : entry->size;
+        entry->crc = (st.valid & ZIP_STAT_CRC) ? st.crc : 0;
+        entry->path = full;
+        entry->name = full + dest_len + 1;
+    }
+
+    zip_discard(archive);
+    local_stats.entries = (int) count;
+
+    int use_manifest = options && options->use_manifest;
+    char manifest_file[4096];
+    bundle_manifest installed;
+    memset(&installed, 0, sizeof(installed));
+    size_t trusted = 0;
+
+    if (use_manifest) {
+        snprintf(manifest_file, sizeof(manifest_file), "%s/%s", destination, BUNDLE_MANIFEST_FILE);
+        if (bundle_manifest_load(&installed, manifest_file) != 0) {
+            LOGE("Unreadable %s, checking every file instead", manifest_file);
+        }
+        trusted = (size_t) trust_installed(entries, file_count, &installed);
+
+        // Until the new manifest is saved the tree is in between versions, so don't
+        // let an interrupted install leave behind a manifest that vouches for it.
+        unlink(manifest_file);
+    }
+
+    qsort(entries, file_count, sizeof(extract_entry), compare_entries);
+
+    extract_job job;
+    memset(&job, 0, sizeof(job));
+    job.archive_path = path;
+    job.offset = offset;
+    job.length = length;
+    job.options = options;
+    job.buffer_size = (options && options->buffer_size > 0) ? options->buffer_size : BUNDLE_EXTRACT_BUFFER_SIZE;
+    job.entries = entries;
+    job.entry_count = file_count - trusted;
+    atomic_init(&job.next, 0);
+    atomic_init(&job.files_written, 0);
+    atomic_init(&job.files_skipped, 0);
+    atomic_init(&job.errors, 0);
+    atomic_init(&job.bytes_written, 0);
+
+    int threads = options ? options->threads : 0;
+    if (threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? (int) cores : 1;
+        if (threads > MAX_EXTRACT_THREADS) threads = MAX_EXTRACT_THREADS;
+    }
+    if ((size_t) threads > job.entry_count) threads = job.entry_count > 0 ? (int) job.entry_count : 1;
+
+    pthread_t workers[MAX_EXTRACT_THREADS * 4];
+    int max_workers = (int) (sizeof(workers) / sizeof(workers[0]));
+    if (threads > max_workers) threads = max_workers;
+
+    int started_workers = 0;
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&workers[started_workers], NULL, extract_worker, &job) == 0) {
+            started_workers++;
+        }
+    }
+
+    // The calling thread works too, so a failed pthread_create only costs parallelism.
+    extract_worker(&job);
+
+    for (int t = 0; t < started_workers; t++) {
+        pthread_join(workers[t], NULL);
+    }
+
+    local_stats.files_written = atomic_load(&job.files_written);
+    local_stats.files_skipped = atomic_load(&job.files_skipped) + (int) trusted;
+    local_stats.errors += atomic_load(&job.errors);
+    local_stats.bytes_written = atomic_load(&job.bytes_written);
+
+    if (use_manifest && local_stats.errors == 0) {
+        bundle_manifest current;
+        memset(&current, 0, sizeof(current));
+        for (size_t i = 0; i < file_count; i++) {
+            bundle_manifest_add(&current, entries[i].name, entries[i].crc, entries[i].size);
+        }
+        bundle_manifest_sort(&current);
+
+        local_stats.files_removed = remove_stale(destination, &installed, &current, options);
+        if (bundle_manifest_save(&current, manifest_file) != 0) {
+            local_stats.errors++;
+        }
+        bundle_manifest_free(&current);
+    }
+    bundle_manifest_free(&installed);
+
+    local_stats.elapsed_ms = now_ms() - started;
+
+    for (size_t i = 0; i < file_count; i++) {
+        free(entries[i].path);
+    }
+    free(entries);
+
+    LOGI("Extracted %d entries with %d threads in %.1f ms: %d written, %d skipped, %d removed, %d dirs, %d errors, %llu bytes",
+         local_stats.entries, started_workers + 1, local_stats.elapsed_ms,
+         local_stats.files_written, local_stats.files_skipped, local_stats.files_removed,
+         local_stats.directories_created, local_stats.errors,
+         (unsigned long long) local_stats.bytes_written);
+
+    if (local_stats.errors > 0) result = -1;
+    if (stats) *stats = local_stats;
+    return result;
+}
@@ -0,0 +1,50 @@
+#ifndef BUNDLE_EXTRACT_H
+#define BUNDLE_EXTRACT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Parallel Laravel bundle extraction (libzip) ===
+
+typedef struct {
+    int threads;            // worker count, <= 0 means one per online core
+    size_t buffer_size;     // per-worker copy buffer, 0 means BUNDLE_EXTRACT_BUFFER_SIZE
+    int skip_unchanged;     // leave files alone whose size and CRC already match
+    const char *const *only_paths;  // extract just these relative paths and what's below them
+    int only_path_count;            // 0 means extract everything
+    int use_manifest;               // trust and update destination/.bundle_manifest, delete files it no longer lists
+    const char *const *keep_paths;  // never delete these relative paths or anything below them
+    int keep_path_count;
+} bundle_extract_options;
+
+typedef struct {
+    int entries;
+    int directories_created;
+    int files_written;
+    int files_skipped;
+    int files_removed;
+    int errors;
+    uint64_t bytes_written;
+    double elapsed_ms;
+} bundle_extract_stats;
+
+#define BUNDLE_EXTRACT_BUFFER_SIZE (256 * 1024)
+
+// Extract the zip found at [offset, offset + length) of `path` into `destination`.
+// A length <= 0 means "to the end of the file". `path` may be /proc/self/fd/N,
+// which is how the APK asset is passed in without copying it out first.
+// Returns 0 on success, -1 if the archive couldn't be opened or any entry failed.
+int bundle_extract(const char *path, int64_t offset, int64_t length,
+                   const char *destination,
+                   const bundle_extract_options *options,
+                   bundle_extract_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUNDLE_EXTRACT_H
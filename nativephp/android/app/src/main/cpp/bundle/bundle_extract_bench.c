@@ -0,0 +1,72 @@
+// Host benchmark for bundle_extract().
+//
+// Build a bundle the same way the app does, from a Laravel tree that has had
+// `composer install --no-dev` run in it:
+//
+//     (cd /path/to/laravel && zip -qr /tmp/laravel_bundle.zip .)
+//     ./bundle_extract_bench /tmp/laravel_bundle.zip /tmp/bundle_out [threads]
+//
+// Each scenario runs against an empty destination unless it says "warm", in
+// which case the previous scenario's output is left in place so the size and
+// CRC check gets to skip everything. The manifest reinstall only stats files.
+
+#include "bundle_extract.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int remove_tree(const char *path) {
+    char command[4096];
+    snprintf(command, sizeof(command), "rm -rf '%s'", path);
+    return system(command);
+}
+
+static void run(const char *label, const char *zip_path, const char *destination,
+                int threads, size_t buffer_size, int skip_unchanged, int use_manifest, int cold) {
+    if (cold) remove_tree(destination);
+
+    bundle_extract_options options = {
+            .threads = threads,
+            .buffer_size = buffer_size,
+            .skip_unchanged = skip_unchanged,
+            .use_manifest = use_manifest,
+    };
+    bundle_extract_stats stats;
+    int result = bundle_extract(zip_path, 0, 0, destination, &options, &stats);
+
+    printf("%-34s %9.1f ms  %6d written  %6d skipped  %5d removed  %5d dirs  %8.1f MB  %s\n",
+           label, stats.elapsed_ms, stats.files_written, stats.files_skipped, stats.files_removed,
+           stats.directories_created, (double) stats.bytes_written / (1024.0 * 1024.0),
+           result == 0 ? "ok" : "FAILED");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <bundle.zip> <scratch-dir> [threads]\n", argv[0]);
+        return 2;
+    }
+
+    const char *zip_path = argv[1];
+    const char *destination = argv[2];
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+
+    if (access(zip_path, R_OK) != 0) {
+        fprintf(stderr, "cannot read %s\n", zip_path);
+        return 2;
+    }
+
+    // Baseline mirrors LaravelEnvironment.unzip(): one thread, 4 KB buffer, no skip check.
+    run("baseline 1 thread / 4 KB", zip_path, destination, 1, 4096, 0, 0, 1);
+    run("1 thread / 256 KB", zip_path, destination, 1, 0, 0, 0, 1);
+    run("parallel / 256 KB", zip_path, destination, threads, 0, 0, 0, 1);
+    run("parallel / 256 KB warm (CRC skip)", zip_path, destination, threads, 0, 1, 0, 0);
+
+    // First manifest install writes everything, the second should touch nothing
+    run("manifest install", zip_path, destination, threads, 0, 1, 1, 1);
+    run("manifest reinstall", zip_path, destination, threads, 0, 1, 1, 0);
+
+    remove_tree(destination);
+    return 0;
+}
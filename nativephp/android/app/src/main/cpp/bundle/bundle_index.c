@@ -0,0 +1,340 @@
+#include "bundle_index.h"
+
+#include <android/log.h>
+#include <zlib.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "BundleIndex"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+#define EOCD_SIGNATURE 0x06054b50
+#define EOCD_SIZE 22
+#define ZIP64_LOCATOR_SIGNATURE 0x07064b50
+#define ZIP64_LOCATOR_SIZE 20
+#define ZIP64_EOCD_SIGNATURE 0x06064b50
+#define CENTRAL_SIGNATURE 0x02014b50
+#define CENTRAL_SIZE 46
+#define LOCAL_SIGNATURE 0x04034b50
+#define LOCAL_SIZE 30
+
+static uint16_t read_u16(const unsigned char *p) {
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t read_u32(const unsigned char *p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint64_t read_u64(const unsigned char *p) {
+    return (uint64_t) read_u32(p) | ((uint64_t) read_u32(p + 4) << 32);
+}
+
+static int find_central_directory(const bundle_index *index, uint64_t *cd_offset, uint64_t *cd_size, uint64_t *count) {
+    if (index->length < EOCD_SIZE) return -1;
+
+    // The EOCD sits at the very end, followed by an optional comment of up to 64 KB
+    uint64_t lowest = index->length > EOCD_SIZE + 0xFFFF ? index->length - EOCD_SIZE - 0xFFFF : 0;
+    uint64_t pos = index->length - EOCD_SIZE;
+    const unsigned char *eocd = NULL;
+    for (;;) {
+        if (read_u32(index->base + pos) == EOCD_SIGNATURE) {
+            eocd = index->base + pos;
+            break;
+        }
+        if (pos == lowest) break;
+        pos--;
+    }
+    if (!eocd) return -1;
+
+    *count = read_u16(eocd + 10);
+    *cd_size = read_u32(eocd + 12);
+    *cd_offset = read_u32(eocd + 16);
+
+    if (pos >= ZIP64_LOCATOR_SIZE) {
+        const unsigned char *locator = eocd - ZIP64_LOCATOR_SIZE;
+        if (read_u32(locator) == ZIP64_LOCATOR_SIGNATURE) {
+            uint64_t zip64_offset = read_u64(locator + 8);
+            if (zip64_offset + 56 > index->length) return -1;
+            const unsigned char *zip64 = index->base + zip64_offset;
+            if (read_u32(zip64) != ZIP64_EOCD_SIGNATURE) return -1;
+            *count = read_u64(zip64 + 32);
+            *cd_size = read_u64(zip64 + 40);
+            *cd_offset = read_u64(zip64 + 48);
+        }
+    }
+
+    if (*cd_offset > index->length || *cd_size > index->length - *cd_offset) return -1;
+    return 0;
+}
+
+static void apply_zip64_extra(bundle_entry *entry, const unsigned char *extra, uint16_t extra_len,
+                              uint32_t size32, uint32_t comp32, uint32_t offset32) {
+    const unsigned char *end = extra + extra_len;
+    while (extra + 4 <= end) {
+        uint16_t id = read_u16(extra);
+        uint16_t len = read_u16(extra + 2);
+        const unsigned char *field = extra + 4;
+        if (field + len > end) return;
+
+        if (id == 0x0001) {
+            const unsigned char *p = field;
+            if (size32 == 0xFFFFFFFF && p + 8 <= field + len) { entry->size = read_u64(p); p += 8; }
+            if (comp32 == 0xFFFFFFFF && p + 8 <= field + len) { entry->comp_size = read_u64(p); p += 8; }
+            if (offset32 == 0xFFFFFFFF && p + 8 <= field + len) { entry->local_offset = read_u64(p); }
+            return;
+        }
+        extra = field + len;
+    }
+}
+
+static int is_safe_name(const char *name, size_t len) {
+    if (len == 0 || name[0] == '/') return 0;
+    for (size_t i = 0; i + 1 < len; i++) {
+        if (name[i] == '.' && name[i + 1] == '.' &&
+            (i == 0 || name[i - 1] == '/') && (i + 2 == len || name[i + 2] == '/')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(((const bundle_entry *) a)->name, ((const bundle_entry *) b)->name);
+}
+
+bundle_index *bundle_index_open(const char *path, int64_t offset, int64_t length) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOGE("Cannot open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    if (length <= 0) {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= offset) {
+            close(fd);
+            return NULL;
+        }
+        length = st.st_size - offset;
+    }
+
+    long page = sysconf(_SC_PAGESIZE);
+    int64_t map_offset = offset - (offset % page);
+    size_t map_length = (size_t) (length + (offset - map_offset));
+
+    void *map = mmap(NULL, map_length, PROT_READ, MAP_PRIVATE, fd, (off_t) map_offset);
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOGE("Cannot map %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    bundle_index *index = calloc(1, sizeof(bundle_index));
+    if (!index) {
+        munmap(map, map_length);
+        return NULL;
+    }
+    index->map = map;
+    index->map_length = map_length;
+    index->base = (const unsigned char *) map + (offset - map_offset);
+    index->length = (uint64_t) length;
+
+    uint64_t cd_offset, cd_size, count;
+    if (find_central_directory(index, &cd_offset, &cd_size, &count) != 0) {
+        LOGE("No central directory in %s", path);
+        bundle_index_close(index);
+        return NULL;
+    }
+
+    index->entries = calloc(count ? count : 1, sizeof(bundle_entry));
+    index->names = malloc(cd_size + 1);
+    if (!index->entries || !index->names) {
+        bundle_index_close(index);
+        return NULL;
+    }
+
+    const unsigned char *p = index->base + cd_offset;
+    const unsigned char *end = p + cd_size;
+    char *names = index->names;
+
+    for (uint64_t i = 0; i < count; i++) {
+        if (p + CENTRAL_SIZE > end || read_u32(p) != CENTRAL_SIGNATURE) {
+            LOGE("Corrupt central directory at entry %llu", (unsigned long long) i);
+            bundle_index_close(index);
+            return NULL;
+        }
+
+        uint16_t name_len = read_u16(p + 28);
+        uint16_t extra_len = read_u16(p + 30);
+        uint16_t comment_len = read_u16(p + 32);
+        const unsigned char *name = p + CENTRAL_SIZE;
+        const unsigned char *next = name + name_len + extra_len + comment_len;
+        if (next > end) {
+            bundle_index_close(index);
+            return NULL;
+        }
+
+        size_t len = name_len;
+        int is_dir = len > 0 && name[len - 1] == '/';
+        if (is_dir) len--;
+
+        if (is_safe_name((const char *) name, len)) {
+            bundle_entry *entry = &index->entries[index->count++];
+            uint32_t size32 = read_u32(p + 24);
+            uint32_t comp32 = read_u32(p + 20);
+            uint32_t offset32 = read_u32(p + 42);
+
+            memcpy(names, name, len);
+            names[len] = '\0';
+            entry->name = names;
+            entry->name_len = (uint32_t) len;
+            names += len + 1;
+
+            entry->method = read_u16(p + 10);
+            entry->is_dir = (uint8_t) is_dir;
+            entry->dos_time = ((uint32_t) read_u16(p + 14) << 16) | read_u16(p + 12);
+            entry->crc = read_u32(p + 16);
+            entry->comp_size = comp32;
+            entry->size = size32;
+            entry->local_offset = offset32;
+            apply_zip64_extra(entry, name + name_len, extra_len, size32, comp32, offset32);
+        }
+
+        p = next;
+    }
+
+    qsort(index->entries, index->count, sizeof(bundle_entry), compare_names);
+
+    LOGI("Indexed %zu entries from %s", index->count, path);
+    return index;
+}
+
+void bundle_index_close(bundle_index *index) {
+    if (!index) return;
+    if (index->map) munmap(index->map, index->map_length);
+    free(index->entries);
+    free(index->names);
+    free(index);
+}
+
+size_t bundle_index_lower_bound(const bundle_index *index, const char *name, size_t name_len) {
+    size_t low = 0, high = index->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        const bundle_entry *entry = &index->entries[mid];
+        size_t shared = entry->name_len < name_len ? entry->name_len : name_len;
+        int cmp = memcmp(entry->name, name, shared);
+        if (cmp == 0) cmp = entry->name_len < name_len ? -1 : (entry->name_len > name_len);
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+const bundle_entry *bundle_index_find(const bundle_index *index, const char *name, size_t name_len) {
+    size_t i = bundle_index_lower_bound(index, name, name_len);
+    if (i < index->count && index->entries[i].name_len == name_len &&
+        memcmp(index->entries[i].name, name, name_len) == 0) {
+        return &index->entries[i];
+    }
+    return NULL;
+}
+
+int bundle_index_is_dir(const bundle_index *index, const char *name, size_t name_len) {
+    if (name_len == 0) return 1;
+
+    const bundle_entry *entry = bundle_index_find(index, name, name_len);
+    if (entry) return entry->is_dir;
+
+    // Zips don't have to list directories, so also accept any "name/..." path
+    char prefix[4096];
+    if (name_len + 1 >= sizeof(prefix)) return 0;
+    memcpy(prefix, name, name_len);
+    prefix[name_len] = '/';
+
+    size_t i = bundle_index_lower_bound(index, prefix, name_len + 1);
+    return i < index->count && index->entries[i].name_len > name_len &&
+           memcmp(index->entries[i].name, prefix, name_len + 1) == 0;
+}
+
+int bundle_index_read(const bundle_index *index, const bundle_entry *entry,
+                      const unsigned char **data, unsigned char **owned) {
+    *data = NULL;
+    *owned = NULL;
+
+    if (entry->is_dir || entry->local_offset + LOCAL_SIZE > index->length) return -1;
+
+    const unsigned char *local = index->base + entry->local_offset;
+    if (read_u32(local) != LOCAL_SIGNATURE) return -1;
+
+    uint64_t data_offset = entry->local_offset + LOCAL_SIZE + read_u16(local + 26) + read_u16(local + 28);
+    if (data_offset > index->length || entry->comp_size > index->length - data_offset) return -1;
+
+    const unsigned char *compressed = index->base + data_offset;
+
+    if (entry->method == BUNDLE_METHOD_STORED) {
+        *data = compressed;
+        return 0;
+    }
+
+    if (entry->method != BUNDLE_METHOD_DEFLATED) {
+        LOGE("Unsupported compression method %u for %s", entry->method, entry->name);
+        return -1;
+    }
+
+    unsigned char *out = malloc(entry->size ? entry->size : 1);
+    if (!out) return -1;
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+        free(out);
+        return -1;
+    }
+
+    zs.next_in = (Bytef *) compressed;
+    zs.avail_in = (uInt) entry->comp_size;
+    zs.next_out = out;
+    zs.avail_out = (uInt) entry->size;
+
+    int status = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+
+    if (status != Z_STREAM_END || zs.total_out != entry->size) {
+        LOGE("Inflate failed for %s", entry->name);
+        free(out);
+        return -1;
+    }
+
+    *data = out;
+    *owned = out;
+    return 0;
+}
+
+time_t bundle_entry_mtime(const bundle_entry *entry) {
+    uint16_t date = (uint16_t) (entry->dos_time >> 16);
+    uint16_t time = (uint16_t) (entry->dos_time & 0xFFFF);
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = ((date >> 9) & 0x7F) + 80;
+    tm.tm_mon = ((date >> 5) & 0x0F) - 1;
+    tm.tm_mday = date & 0x1F;
+    tm.tm_hour = (time >> 11) & 0x1F;
+    tm.tm_min = (time >> 5) & 0x3F;
+    tm.tm_sec = (time & 0x1F) * 2;
+    tm.tm_isdst = -1;
+
+    return mktime(&tm);
+}
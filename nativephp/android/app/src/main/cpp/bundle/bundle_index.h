@@ -0,0 +1,64 @@
+#ifndef BUNDLE_INDEX_H
+#define BUNDLE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Memory-mapped view of a bundle zip's central directory ===
+
+#define BUNDLE_METHOD_STORED 0
+#define BUNDLE_METHOD_DEFLATED 8
+
+typedef struct {
+    const char *name;       // relative path without trailing slash, NUL terminated
+    uint32_t name_len;
+    uint16_t method;
+    uint8_t is_dir;
+    uint32_t crc;
+    uint32_t dos_time;      // DOS date in the high 16 bits, time in the low 16
+    uint64_t comp_size;
+    uint64_t size;
+    uint64_t local_offset;
+} bundle_entry;
+
+typedef struct {
+    void *map;
+    size_t map_length;
+    const unsigned char *base;  // start of the zip inside the mapping
+    uint64_t length;
+
+    bundle_entry *entries;      // sorted by name
+    size_t count;
+    char *names;
+} bundle_index;
+
+// Map [offset, offset + length) of `path` and index its central directory.
+// A length <= 0 means "to the end of the file". Returns NULL on failure.
+bundle_index *bundle_index_open(const char *path, int64_t offset, int64_t length);
+void bundle_index_close(bundle_index *index);
+
+const bundle_entry *bundle_index_find(const bundle_index *index, const char *name, size_t name_len);
+
+// True for explicit directory entries and for any prefix of a stored path.
+int bundle_index_is_dir(const bundle_index *index, const char *name, size_t name_len);
+
+// First entry whose name sorts at or after `name`, for walking a directory's children.
+size_t bundle_index_lower_bound(const bundle_index *index, const char *name, size_t name_len);
+
+// Contents of a file entry. STORED entries point straight into the mapping and
+// leave *owned NULL; DEFLATED entries are inflated into *owned, which the caller frees.
+int bundle_index_read(const bundle_index *index, const bundle_entry *entry,
+                      const unsigned char **data, unsigned char **owned);
+
+time_t bundle_entry_mtime(const bundle_entry *entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUNDLE_INDEX_H
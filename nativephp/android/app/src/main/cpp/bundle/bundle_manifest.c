@@ -0,0 +1,128 @@
+#include "bundle_manifest.h"
+
+#include <android/log.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOG_TAG "BundleManifest"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+int bundle_manifest_add(bundle_manifest *manifest, const char *path, uint32_t crc, uint64_t size) {
+    if (manifest->count == manifest->capacity) {
+        size_t capacity = manifest->capacity ? manifest->capacity * 2 : 1024;
+        bundle_manifest_entry *grown = realloc(manifest->entries, capacity * sizeof(bundle_manifest_entry));
+        if (!grown) return -1;
+        manifest->entries = grown;
+        manifest->capacity = capacity;
+    }
+
+    bundle_manifest_entry *entry = &manifest->entries[manifest->count++];
+    entry->path = path;
+    entry->crc = crc;
+    entry->size = size;
+    return 0;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(((const bundle_manifest_entry *) a)->path, ((const bundle_manifest_entry *) b)->path);
+}
+
+void bundle_manifest_sort(bundle_manifest *manifest) {
+    qsort(manifest->entries, manifest->count, sizeof(bundle_manifest_entry), compare_paths);
+}
+
+const bundle_manifest_entry *bundle_manifest_find(const bundle_manifest *manifest, const char *path) {
+    size_t low = 0, high = manifest->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = strcmp(manifest->entries[mid].path, path);
+        if (cmp == 0) return &manifest->entries[mid];
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return NULL;
+}
+
+int bundle_manifest_load(bundle_manifest *manifest, const char *file) {
+    memset(manifest, 0, sizeof(*manifest));
+
+    FILE *fp = fopen(file, "rb");
+    if (!fp) return errno == ENOENT ? 0 : -1;
+
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    manifest->data = malloc((size_t) length + 1);
+    if (!manifest->data || fread(manifest->data, 1, (size_t) length, fp) != (size_t) length) {
+        fclose(fp);
+        bundle_manifest_free(manifest);
+        return -1;
+    }
+    fclose(fp);
+    manifest->data[length] = '\0';
+
+    char *line = manifest->data;
+    while (*line) {
+        char *end = strchr(line, '\n');
+        if (end) *end = '\0';
+
+        unsigned int crc;
+        unsigned long long size;
+        int path_offset = 0;
+        if (line[0] != '#' && sscanf(line, "%8x %llu %n", &crc, &size, &path_offset) == 2 && path_offset > 0) {
+            bundle_manifest_add(manifest, line + path_offset, crc, size);
+        }
+
+        if (!end) break;
+        line = end + 1;
+    }
+
+    bundle_manifest_sort(manifest);
+    return 0;
+}
+
+void bundle_manifest_free(bundle_manifest *manifest) {
+    free(manifest->entries);
+    free(manifest->data);
+    memset(manifest, 0, sizeof(*manifest));
+}
+
+int bundle_manifest_save(const bundle_manifest *manifest, const char *file) {
+    char temp[4096];
+    snprintf(temp, sizeof(temp), "%s.tmp", file);
+
+    FILE *fp = fopen(temp, "wb");
+    if (!fp) {
+        LOGE("Cannot write %s: %s", temp, strerror(errno));
+        return -1;
+    }
+
+    fputs("# bundle manifest v1\n", fp);
+    for (size_t i = 0; i < manifest->count; i++) {
+        const bundle_manifest_entry *entry = &manifest->entries[i];
+        fprintf(fp, "%08" PRIx32 " %" PRIu64 " %s\n", entry->crc, entry->size, entry->path);
+    }
+
+    int failed = ferror(fp);
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) failed = 1;
+    if (fclose(fp) != 0) failed = 1;
+
+    if (failed || rename(temp, file) != 0) {
+        LOGE("Cannot save manifest %s: %s", file, strerror(errno));
+        unlink(temp);
+        return -1;
+    }
+
+    LOGI("Saved manifest with %zu files", manifest->count);
+    return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef BUNDLE_MANIFEST_H
+#define BUNDLE_MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Record of what an install put on disk ===
+//
+// One line per file, "<crc32 hex> <size> <relative path>", sorted by path.
+// The CRC and size come from the bundle's central directory, so building it
+// costs nothing and the bundle doesn't need a separate hash list.
+
+#define BUNDLE_MANIFEST_FILE ".bundle_manifest"
+
+typedef struct {
+    const char *path;
+    uint32_t crc;
+    uint64_t size;
+} bundle_manifest_entry;
+
+typedef struct {
+    bundle_manifest_entry *entries;
+    size_t count;
+    size_t capacity;
+    char *data;             // backing storage for paths read from disk
+} bundle_manifest;
+
+// Returns 0 and an empty manifest if the file doesn't exist.
+int bundle_manifest_load(bundle_manifest *manifest, const char *file);
+void bundle_manifest_free(bundle_manifest *manifest);
+
+// `path` must outlive the manifest. Call bundle_manifest_sort() before lookups.
+int bundle_manifest_add(bundle_manifest *manifest, const char *path, uint32_t crc, uint64_t size);
+void bundle_manifest_sort(bundle_manifest *manifest);
+const bundle_manifest_entry *bundle_manifest_find(const bundle_manifest *manifest, const char *path);
+
+// Written to a temp file and renamed into place, so a reader never sees half of it.
+int bundle_manifest_save(const bundle_manifest *manifest, const char *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUNDLE_MANIFEST_H
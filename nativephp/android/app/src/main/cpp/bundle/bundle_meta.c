@@ -0,0 +1,132 @@
+#include "bundle_meta.h"
+#include "bundle_index.h"
+
+#include <android/log.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOG_TAG "BundleMeta"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+static char *copy_trimmed(const char *start, const char *end) {
+    while (start < end && isspace((unsigned char) *start)) start++;
+    while (end > start && isspace((unsigned char) end[-1])) end--;
+
+    char *out = malloc((size_t) (end - start) + 1);
+    if (!out) return NULL;
+    memcpy(out, start, (size_t) (end - start));
+    out[end - start] = '\0';
+    return out;
+}
+
+// Inflates a small entry into a NUL terminated string
+static char *read_entry(const bundle_index *index, const char *name, size_t *length) {
+    const bundle_entry *entry = bundle_index_find(index, name, strlen(name));
+    if (!entry || entry->is_dir) return NULL;
+
+    const unsigned char *data;
+    unsigned char *owned;
+    if (bundle_index_read(index, entry, &data, &owned) != 0) {
+        LOGE("Cannot read %s from bundle", name);
+        return NULL;
+    }
+
+    char *out = malloc(entry->size + 1);
+    if (out) {
+        memcpy(out, data, entry->size);
+        out[entry->size] = '\0';
+        if (length) *length = entry->size;
+    }
+    free(owned);
+    return out;
+}
+
+bundle_meta *bundle_meta_read(const char *path, int64_t offset, int64_t length) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    bundle_index *index = bundle_index_open(path, offset, length);
+    if (!index) return NULL;
+
+    bundle_meta *meta = calloc(1, sizeof(bundle_meta));
+    if (!meta) {
+        bundle_index_close(index);
+        return NULL;
+    }
+
+    meta->env = read_entry(index, ".env", &meta->env_length);
+    char *version = read_entry(index, ".version", NULL);
+    if (version) {
+        meta->version_file = copy_trimmed(version, version + strlen(version));
+        free(version);
+    }
+
+    // Copy the file names out so the mapping can go
+    size_t total = 0;
+    for (size_t i = 0; i < index->count; i++) {
+        if (!index->entries[i].is_dir) total += index->entries[i].name_len + 1;
+    }
+    meta->files = malloc((index->count ? index->count : 1) * sizeof(char *));
+    meta->names = malloc(total ? total : 1);
+    if (!meta->files || !meta->names) {
+        bundle_index_close(index);
+        bundle_meta_free(meta);
+        return NULL;
+    }
+
+    char *names = meta->names;
+    for (size_t i = 0; i < index->count; i++) {
+        const bundle_entry *entry = &index->entries[i];
+        if (entry->is_dir) continue;
+        memcpy(names, entry->name, entry->name_len + 1);
+        meta->files[meta->file_count++] = names;
+        names += entry->name_len + 1;
+    }
+    bundle_index_close(index);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed_ms = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    LOGI("Read bundle metadata: %zu files, .env %s, %.2f ms",
+         meta->file_count, meta->env ? "found" : "missing", elapsed_ms);
+    return meta;
+}
+
+void bundle_meta_free(bundle_meta *meta) {
+    if (!meta) return;
+    free(meta->env);
+    free(meta->version_file);
+    free(meta->files);
+    free(meta->names);
+    free(meta);
+}
+
+char *bundle_meta_env_value(const bundle_meta *meta, const char *name) {
+    if (!meta->env) return NULL;
+
+    size_t name_len = strlen(name);
+    const char *line = meta->env;
+    const char *end = meta->env + meta->env_length;
+
+    while (line < end) {
+        const char *eol = memchr(line, '\n', (size_t) (end - line));
+        if (!eol) eol = end;
+
+        if ((size_t) (eol - line) > name_len && memcmp(line, name, name_len) == 0 && line[name_len] == '=') {
+            return copy_trimmed(line + name_len + 1, eol);
+        }
+        line = eol + 1;
+    }
+    return NULL;
+}
+
+char *bundle_meta_version(const bundle_meta *meta) {
+    char *version = bundle_meta_env_value(meta, "NATIVEPHP_APP_VERSION");
+    if (version && *version) return version;
+    free(version);
+
+    return meta->version_file ? strdup(meta->version_file) : NULL;
+}
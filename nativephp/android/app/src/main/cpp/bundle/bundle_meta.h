@@ -0,0 +1,42 @@
+#ifndef BUNDLE_META_H
+#define BUNDLE_META_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === What startup needs to know about a bundle zip, read in one pass ===
+//
+// The central directory is indexed once and only the two small entries the
+// app asks about (.env and .version) are inflated; everything else is
+// answered from memory afterwards.
+
+typedef struct {
+    char *env;              // contents of .env, NUL terminated, or NULL
+    size_t env_length;
+    char *version_file;     // trimmed contents of .version, or NULL
+
+    const char **files;     // regular files in the bundle, sorted
+    size_t file_count;
+    char *names;            // backing storage for files
+} bundle_meta;
+
+// Same arguments as bundle_index_open(). Returns NULL if the zip can't be indexed.
+bundle_meta *bundle_meta_read(const char *path, int64_t offset, int64_t length);
+void bundle_meta_free(bundle_meta *meta);
+
+// Value of the first `NAME=` line in .env, trimmed, into a malloc'd string the
+// caller frees. NULL if there's no .env or no such line.
+char *bundle_meta_env_value(const bundle_meta *meta, const char *name);
+
+// NATIVEPHP_APP_VERSION from .env, else the .version file. Caller frees.
+char *bundle_meta_version(const bundle_meta *meta);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUNDLE_META_H
@@ -0,0 +1,603 @@
+#include "bundle_stream.h"
+#include "bundle_manifest.h"
+
+#include <android/log.h>
+#include <zlib.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_TAG "BundleStream"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+#define LOCAL_HEADER_SIG 0x04034b50
+#define CENTRAL_HEADER_SIG 0x02014b50
+#define END_OF_CENTRAL_SIG 0x06054b50
+#define DESCRIPTOR_SIG 0x08074b50
+#define LOCAL_HEADER_SIZE 30
+
+#define FLAG_ENCRYPTED 0x0001
+#define FLAG_DESCRIPTOR 0x0008
+
+#define OUTPUT_BUFFER_SIZE (256 * 1024)
+
+typedef enum {
+    STREAM_HEADER,
+    STREAM_NAME,
+    STREAM_DATA,
+    STREAM_DESCRIPTOR,
+    STREAM_DONE,
+    STREAM_FAILED,
+} stream_state;
+
+struct bundle_stream {
+    char staging[4096];
+    stream_state state;
+
+    // Header and descriptor bytes are gathered here until `need` have arrived
+    unsigned char *pending;
+    size_t pending_length;
+    size_t pending_capacity;
+    size_t need;
+
+    // Current entry
+    char name[4096];
+    uint16_t flags;
+    uint16_t method;
+    uint32_t crc;
+    uint64_t comp_size;
+    uint64_t size;
+    int zip64;
+    uint64_t consumed;
+    uint64_t written;
+    uint32_t running_crc;
+    int fd;
+    z_stream zs;
+    int inflating;
+    unsigned char *output;
+
+    bundle_manifest manifest;
+    bundle_stream_stats stats;
+    double started;
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1000.0 + (double) ts.tv_nsec / 1e6;
+}
+
+static uint16_t le16(const unsigned char *p) {
+    return (uint16_t) (p[0] | p[1] << 8);
+}
+
+static uint32_t le32(const unsigned char *p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint64_t le64(const unsigned char *p) {
+    return (uint64_t) le32(p) | (uint64_t) le32(p + 4) << 32;
+}
+
+// Entries are written relative to the staging directory, so refuse anything that could escape it.
+static int is_safe_entry_name(const char *name) {
+    if (name[0] == '\0' || name[0] == '/') return 0;
+
+    const char *segment = name;
+    while (segment) {
+        if (segment[0] == '.' && segment[1] == '.' && (segment[2] == '/' || segment[2] == '\0')) {
+            return 0;
+        }
+        segment = strchr(segment, '/');
+        if (segment) segment++;
+    }
+    return 1;
+}
+
+// "dir/name" into `out`; -1 if it doesn't fit
+static int join_path(char *out, size_t size, const char *dir, const char *name) {
+    int length = snprintf(out, size, "%s/%s", dir, name);
+    return length < 0 || (size_t) length >= size ? -1 : 0;
+}
+
+// Where the previous install waits while the new one moves into place
+static int old_path(char *out, size_t size, const char *destination) {
+    int length = snprintf(out, size, "%s.old", destination);
+    return length < 0 || (size_t) length >= size ? -1 : 0;
+}
+
+static int make_dirs(char *path, size_t skip, int *created) {
+    for (char *p = path + (skip > 0 ? skip : 1); *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(path, 0755) == 0) {
+            (*created)++;
+        } else if (errno != EEXIST) {
+            *p = '/';
+            return -1;
+        }
+        *p = '/';
+    }
+    return 0;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    return remove(path);
+}
+
+static void remove_tree(const char *path) {
+    nftw(path, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static int path_exists(const char *path) {
+    struct stat st;
+    return lstat(path, &st) == 0;
+}
+
+static int fail(bundle_stream *stream, const char *reason) {
+    if (stream->state != STREAM_FAILED) {
+        LOGE("Stream install failed at %s: %s", stream->name[0] ? stream->name : "archive start", reason);
+    }
+    stream->state = STREAM_FAILED;
+    return -1;
+}
+
+// Gather bytes into `pending` until `need` of them are there. Returns 1 once complete.
+static int gather(bundle_stream *stream, const unsigned char **data, size_t *length) {
+    if (stream->need > stream->pending_capacity) {
+        unsigned char *grown = realloc(stream->pending, stream->need);
+        if (!grown) return -1;
+        stream->pending = grown;
+        stream->pending_capacity = stream->need;
+    }
+
+    size_t take = stream->need - stream->pending_length;
+    if (take > *length) take = *length;
+    memcpy(stream->pending + stream->pending_length, *data, take);
+    stream->pending_length += take;
+    *data += take;
+    *length -= take;
+
+    return stream->pending_length == stream->need;
+}
+
+static int write_output(bundle_stream *stream, const unsigned char *data, size_t length) {
+    stream->running_crc = (uint32_t) crc32(stream->running_crc, data, (uInt) length);
+    stream->written += length;
+
+    while (length > 0) {
+        ssize_t n = write(stream->fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        length -= (size_t) n;
+    }
+    return 0;
+}
+
+static int begin_entry(bundle_stream *stream) {
+    const unsigned char *header = stream->pending;
+    uint16_t name_length = le16(header + 26);
+    uint16_t extra_length = le16(header + 28);
+    const unsigned char *extra = header + LOCAL_HEADER_SIZE + name_length;
+
+    if (name_length >= sizeof(stream->name)) return fail(stream, "entry name too long");
+    memcpy(stream->name, header + LOCAL_HEADER_SIZE, name_length);
+    stream->name[name_length] = '\0';
+
+    stream->flags = le16(header + 6);
+    stream->method = le16(header + 8);
+    stream->crc = le32(header + 14);
+    stream->comp_size = le32(header + 18);
+    stream->size = le32(header + 22);
+    stream->zip64 = 0;
+    stream->consumed = 0;
+    stream->written = 0;
+    stream->running_crc = (uint32_t) crc32(0L, Z_NULL, 0);
+
+    for (size_t offset = 0; offset + 4 <= extra_length;) {
+        uint16_t id = le16(extra + offset);
+        uint16_t field_length = le16(extra + offset + 2);
+        const unsigned char *field = extra + offset + 4;
+        if (offset + 4 + field_length > extra_length) break;
+
+        if (id == 0x0001) {
+            size_t at = 0;
+            stream->zip64 = 1;
+            if (stream->size == 0xFFFFFFFF && at + 8 <= field_length) {
+                stream->size = le64(field + at);
+                at += 8;
+            }
+            if (stream->comp_size == 0xFFFFFFFF && at + 8 <= field_length) {
+                stream->comp_size = le64(field + at);
+            }
+        }
+        offset += 4 + field_length;
+    }
+
+    if (stream->flags & FLAG_ENCRYPTED) return fail(stream, "encrypted entries aren't supported");
+    if (stream->method != 0 && stream->method != Z_DEFLATED) return fail(stream, "unsupported compression method");
+    if (stream->method == 0 && (stream->flags & FLAG_DESCRIPTOR)) {
+        return fail(stream, "stored entry without sizes can't be streamed");
+    }
+    if (!is_safe_entry_name(stream->name)) return fail(stream, "unsafe entry name");
+
+    char path[4096];
+    int is_dir = name_length > 0 && stream->name[name_length - 1] == '/';
+    if (join_path(path, sizeof(path), stream->staging, stream->name) != 0) return fail(stream, "entry path too long");
+
+    if (make_dirs(path, strlen(stream->staging) + 1, &stream->stats.directories_created) != 0) {
+        return fail(stream, strerror(errno));
+    }
+
+    if (is_dir) {
+        if (mkdir(path, 0755) == 0) {
+            stream->stats.directories_created++;
+        } else if (errno != EEXIST) {
+            return fail(stream, strerror(errno));
+        }
+        stream->fd = -1;
+    } else {
+        stream->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (stream->fd < 0) return fail(stream, strerror(errno));
+    }
+
+    if (stream->method == Z_DEFLATED) {
+        memset(&stream->zs, 0, sizeof(stream->zs));
+        if (inflateInit2(&stream->zs, -MAX_WBITS) != Z_OK) return fail(stream, "inflateInit2 failed");
+        stream->inflating = 1;
+    }
+
+    stream->state = STREAM_DATA;
+    return 0;
+}
+
+static int end_entry(bundle_stream *stream) {
+    if (stream->inflating) {
+        inflateEnd(&stream->zs);
+        stream->inflating = 0;
+    }
+
+    if (stream->fd >= 0) {
+        int closed = close(stream->fd);
+        stream->fd = -1;
+        if (closed != 0) return fail(stream, strerror(errno));
+    }
+
+    if (stream->running_crc != stream->crc || stream->written != stream->size) {
+        return fail(stream, "CRC or size mismatch");
+    }
+
+    size_t name_length = strlen(stream->name);
+    if (name_length > 0 && stream->name[name_length - 1] != '/') {
+        char *path = strdup(stream->name);
+        if (!path || bundle_manifest_add(&stream->manifest, path, stream->crc, stream->size) != 0) {
+            free(path);
+            return fail(stream, "out of memory");
+        }
+        stream->stats.files_written++;
+        stream->stats.bytes_written += stream->size;
+    }
+
+    stream->name[0] = '\0';
+    stream->state = STREAM_HEADER;
+    stream->need = LOCAL_HEADER_SIZE;
+    stream->pending_length = 0;
+    return 0;
+}
+
+static int feed_data(bundle_stream *stream, const unsigned char **data, size_t *length) {
+    if (stream->method == 0) {
+        uint64_t remaining = stream->comp_size - stream->consumed;
+        size_t take = remaining < *length ? (size_t) remaining : *length;
+
+        if (take > 0 && write_output(stream, *data, take) != 0) return fail(stream, strerror(errno));
+        stream->consumed += take;
+        *data += take;
+        *length -= take;
+
+        return stream->consumed == stream->comp_size ? end_entry(stream) : 0;
+    }
+
+    // With a data descriptor the compressed size is unknown, so only the end
+    // of the deflate stream says where the entry stops.
+    size_t available = *length;
+    if (!(stream->flags & FLAG_DESCRIPTOR) && stream->comp_size - stream->consumed < available) {
+        available = (size_t) (stream->comp_size - stream->consumed);
+    }
+
+    stream->zs.next_in = (Bytef *) *data;
+    stream->zs.avail_in = (uInt) available;
+
+    int status = Z_OK;
+    while (status != Z_STREAM_END) {
+        stream->zs.next_out = stream->output;
+        stream->zs.avail_out = OUTPUT_BUFFER_SIZE;
+
+        status = inflate(&stream->zs, Z_NO_FLUSH);
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+            return fail(stream, "corrupt deflate data");
+        }
+
+        size_t produced = OUTPUT_BUFFER_SIZE - stream->zs.avail_out;
+        if (produced > 0 && write_output(stream, stream->output, produced) != 0) {
+            return fail(stream, strerror(errno));
+        }
+
+        // Needs more input
+        if (produced == 0 && status != Z_STREAM_END) break;
+    }
+
+    size_t used = available - stream->zs.avail_in;
+    stream->consumed += used;
+    *data += used;
+    *length -= used;
+
+    if (status != Z_STREAM_END) {
+        if (!(stream->flags & FLAG_DESCRIPTOR) && stream->consumed == stream->comp_size) {
+            return fail(stream, "deflate data ended early");
+        }
+        return 0;
+    }
+
+    if (stream->flags & FLAG_DESCRIPTOR) {
+        stream->state = STREAM_DESCRIPTOR;
+        stream->need = 4;
+        stream->pending_length = 0;
+        return 0;
+    }
+
+    if (stream->consumed != stream->comp_size) return fail(stream, "compressed size mismatch");
+    return end_entry(stream);
+}
+
+static int feed_descriptor(bundle_stream *stream) {
+    size_t size_width = stream->zip64 ? 8 : 4;
+
+    // The descriptor signature is optional, so the first word decides the layout
+    if (stream->need == 4) {
+        stream->need = le32(stream->pending) == DESCRIPTOR_SIG ? 8 + 2 * size_width : 4 + 2 * size_width;
+        return 0;
+    }
+
+    const unsigned char *p = stream->pending + (stream->need == 8 + 2 * size_width ? 4 : 0);
+    stream->crc = le32(p);
+    stream->comp_size = size_width == 8 ? le64(p + 4) : le32(p + 4);
+    stream->size = size_width == 8 ? le64(p + 12) : le32(p + 8);
+
+    if (stream->comp_size != stream->consumed) return fail(stream, "compressed size mismatch");
+    return end_entry(stream);
+}
+
+bundle_stream *bundle_stream_open(const char *staging) {
+    bundle_stream *stream = calloc(1, sizeof(bundle_stream));
+    if (!stream) return NULL;
+
+    if (strlen(staging) >= sizeof(stream->staging)) {
+        LOGE("Staging path too long: %s", staging);
+        free(stream);
+        return NULL;
+    }
+
+    stream->output = malloc(OUTPUT_BUFFER_SIZE);
+    if (!stream->output) {
+        free(stream);
+        return NULL;
+    }
+
+    snprintf(stream->staging, sizeof(stream->staging), "%s", staging);
+    stream->state = STREAM_HEADER;
+    stream->need = LOCAL_HEADER_SIZE;
+    stream->fd = -1;
+    stream->started = now_ms();
+
+    remove_tree(staging);
+    if (mkdir(staging, 0755) != 0) {
+        LOGE("Cannot create staging directory %s: %s", staging, strerror(errno));
+        free(stream->output);
+        free(stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+int bundle_stream_feed(bundle_stream *stream, const unsigned char *data, size_t length) {
+    stream->stats.bytes_received += length;
+
+    while (length > 0) {
+        int complete;
+
+        switch (stream->state) {
+            case STREAM_HEADER:
+                complete = gather(stream, &data, &length);
+                if (complete < 0) return fail(stream, "out of memory");
+                if (!complete) break;
+
+                uint32_t signature = le32(stream->pending);
+                if (signature == CENTRAL_HEADER_SIG || signature == END_OF_CENTRAL_SIG) {
+                    // Everything after the last entry is the central directory, which we don't need
+                    stream->state = STREAM_DONE;
+                    return 0;
+                }
+                if (signature != LOCAL_HEADER_SIG) return fail(stream, "not a zip local header");
+
+                stream->need = LOCAL_HEADER_SIZE + le16(stream->pending + 26) + le16(stream->pending + 28);
+                stream->state = STREAM_NAME;
+                break;
+
+            case STREAM_NAME:
+                complete = gather(stream, &data, &length);
+                if (complete < 0) return fail(stream, "out of memory");
+                if (complete && begin_entry(stream) != 0) return -1;
+                break;
+
+            case STREAM_DATA:
+                if (feed_data(stream, &data, &length) != 0) return -1;
+                break;
+
+            case STREAM_DESCRIPTOR:
+                complete = gather(stream, &data, &length);
+                if (complete < 0) return fail(stream, "out of memory");
+                if (complete && feed_descriptor(stream) != 0) return -1;
+                break;
+
+            case STREAM_DONE:
+                return 0;
+
+            case STREAM_FAILED:
+                return -1;
+        }
+    }
+
+    // Zero-length entries complete without any data arriving
+    if (stream->state == STREAM_DATA && stream->method == 0 && stream->comp_size == 0) {
+        return end_entry(stream);
+    }
+
+    return stream->state == STREAM_FAILED ? -1 : 0;
+}
+
+static void free_stream(bundle_stream *stream) {
+    if (stream->inflating) inflateEnd(&stream->zs);
+    if (stream->fd >= 0) close(stream->fd);
+
+    for (size_t i = 0; i < stream->manifest.count; i++) {
+        free((char *) stream->manifest.entries[i].path);
+    }
+    bundle_manifest_free(&stream->manifest);
+
+    free(stream->pending);
+    free(stream->output);
+    free(stream);
+}
+
+int bundle_stream_finish(bundle_stream *stream, bundle_stream_stats *stats) {
+    // An entry with no data at the very end is only known to be complete here
+    if (stream->state == STREAM_DATA && stream->method == 0 && stream->consumed == stream->comp_size) {
+        end_entry(stream);
+    }
+
+    int result = -1;
+    if (stream->state != STREAM_DONE) {
+        fail(stream, "archive ended before its central directory");
+    } else {
+        char file[4096];
+        bundle_manifest_sort(&stream->manifest);
+        if (join_path(file, sizeof(file), stream->staging, BUNDLE_MANIFEST_FILE) != 0) {
+            fail(stream, "manifest path too long");
+        } else if (bundle_manifest_save(&stream->manifest, file) == 0) {
+            result = stream->stats.files_written;
+        }
+    }
+
+    stream->stats.elapsed_ms = now_ms() - stream->started;
+    LOGI("Stream install %s in %.1f ms: %d files, %d dirs, %llu bytes received, %llu written",
+         result >= 0 ? "staged" : "failed", stream->stats.elapsed_ms,
+         stream->stats.files_written, stream->stats.directories_created,
+         (unsigned long long) stream->stats.bytes_received,
+         (unsigned long long) stream->stats.bytes_written);
+
+    if (stats) *stats = stream->stats;
+    if (result < 0) remove_tree(stream->staging);
+    free_stream(stream);
+    return result;
+}
+
+void bundle_stream_abort(bundle_stream *stream) {
+    remove_tree(stream->staging);
+    free_stream(stream);
+}
+
+int bundle_stream_commit(const char *staging, const char *destination,
+                         const char *const *keep_paths, int keep_count) {
+    char marker[4096], from[4096], to[4096], old[4096];
+    int created = 0;
+
+    if (join_path(marker, sizeof(marker), staging, BUNDLE_STREAM_COMMIT_MARKER) != 0 ||
+        old_path(old, sizeof(old), destination) != 0) {
+        LOGE("Cannot commit %s, path too long", destination);
+        return -1;
+    }
+
+    // From here on a crash rolls forward, since user data may already live in staging
+    int fd = open(marker, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 || fsync(fd) != 0) {
+        LOGE("Cannot mark %s for commit: %s", staging, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    close(fd);
+
+    for (int i = 0; i < keep_count; i++) {
+        if (join_path(from, sizeof(from), destination, keep_paths[i]) != 0 ||
+            join_path(to, sizeof(to), staging, keep_paths[i]) != 0) {
+            LOGE("Cannot carry %s over, path too long", keep_paths[i]);
+            return -1;
+        }
+        if (!path_exists(from)) continue;
+
+        remove_tree(to);
+        if (make_dirs(to, strlen(staging) + 1, &created) != 0 || rename(from, to) != 0) {
+            LOGE("Cannot carry %s over: %s", keep_paths[i], strerror(errno));
+            return -1;
+        }
+    }
+
+    remove_tree(old);
+    if (rename(destination, old) != 0 && errno != ENOENT) {
+        LOGE("Cannot move %s aside: %s", destination, strerror(errno));
+        return -1;
+    }
+    if (rename(staging, destination) != 0) {
+        LOGE("Cannot move %s into place: %s", staging, strerror(errno));
+        return -1;
+    }
+
+    if (join_path(marker, sizeof(marker), destination, BUNDLE_STREAM_COMMIT_MARKER) == 0) unlink(marker);
+    remove_tree(old);
+
+    LOGI("Committed %s", destination);
+    return 0;
+}
+
+int bundle_stream_recover(const char *staging, const char *destination,
+                          const char *const *keep_paths, int keep_count) {
+    char marker[4096], old[4096];
+    if (old_path(old, sizeof(old), destination) != 0 ||
+        join_path(marker, sizeof(marker), staging, BUNDLE_STREAM_COMMIT_MARKER) != 0) {
+        LOGE("Cannot recover %s, path too long", destination);
+        return 0;
+    }
+
+    if (path_exists(marker)) {
+        LOGI("Finishing an interrupted commit of %s", staging);
+        if (bundle_stream_commit(staging, destination, keep_paths, keep_count) == 0) return 1;
+    } else if (path_exists(staging)) {
+        LOGI("Discarding incomplete staging directory %s", staging);
+        remove_tree(staging);
+    }
+
+    // Crashed between the swap and the cleanup: the new tree is in place
+    int swapped = path_exists(old) && path_exists(destination);
+    if (join_path(marker, sizeof(marker), destination, BUNDLE_STREAM_COMMIT_MARKER) == 0 && path_exists(marker)) {
+        unlink(marker);
+        swapped = 1;
+    }
+
+    if (!path_exists(destination) && path_exists(old)) {
+        rename(old, destination);
+    }
+    remove_tree(old);
+    return swapped;
+}
@@ -0,0 +1,62 @@
+#ifndef BUNDLE_STREAM_H
+#define BUNDLE_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Install a bundle zip while it is still downloading ===
+//
+// Bytes are pushed in as they arrive and each local entry is inflated and
+// written into a staging directory, with its CRC checked as soon as the entry
+// ends. Nothing is ever written outside the staging directory until
+// bundle_stream_commit() swaps it in for the installed tree.
+//
+// Entries are read in local-header order, so the zip must not use data
+// descriptors on STORED entries (zip -r and ZipOutputStream don't).
+
+#define BUNDLE_STREAM_COMMIT_MARKER ".commit_pending"
+
+typedef struct bundle_stream bundle_stream;
+
+typedef struct {
+    int files_written;
+    int directories_created;
+    uint64_t bytes_received;
+    uint64_t bytes_written;
+    double elapsed_ms;
+} bundle_stream_stats;
+
+// Clears anything already in `staging`. Returns NULL on failure.
+bundle_stream *bundle_stream_open(const char *staging);
+
+// Returns 0 while the stream is healthy. Once it fails every later call fails.
+int bundle_stream_feed(bundle_stream *stream, const unsigned char *data, size_t length);
+
+// Checks the archive ended cleanly, writes the staged .bundle_manifest and
+// frees the stream. Returns the number of files written or -1.
+int bundle_stream_finish(bundle_stream *stream, bundle_stream_stats *stats);
+
+// Frees the stream and removes the staging directory.
+void bundle_stream_abort(bundle_stream *stream);
+
+// Moves `keep_paths` (user data) from the installed tree into staging, then
+// swaps staging in. A crash part way through is finished by bundle_stream_recover().
+int bundle_stream_commit(const char *staging, const char *destination,
+                         const char *const *keep_paths, int keep_count);
+
+// Run before anything reads the installed tree: finishes an interrupted commit
+// or throws away a staging directory that never got that far. Returns 1 when
+// `destination` now holds a commit whose caller never saw it succeed, so the
+// caller can do what it would have done next; 0 otherwise.
+int bundle_stream_recover(const char *staging, const char *destination,
+                           const char *const *keep_paths, int keep_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUNDLE_STREAM_H
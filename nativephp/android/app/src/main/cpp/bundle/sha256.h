@@ -0,0 +1,35 @@
+#ifndef BUNDLE_SHA256_H
+#define BUNDLE_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Minimal SHA-256 for verifying bundle contents ===
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_HEX_SIZE (SHA256_DIGEST_SIZE * 2 + 1)
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char block[64];
+    size_t used;
+} sha256_ctx;
+
+void sha256_init(sha256_ctx *ctx);
+void sha256_update(sha256_ctx *ctx, const void *data, size_t length);
+void sha256_final(sha256_ctx *ctx, unsigned char digest[SHA256_DIGEST_SIZE]);
+
+// One-shot helper writing a lowercase hex digest into `hex`.
+void sha256_hex(const void *data, size_t length, char hex[SHA256_HEX_SIZE]);
+void sha256_to_hex(const unsigned char digest[SHA256_DIGEST_SIZE], char hex[SHA256_HEX_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BUNDLE_SHA256_H
@@ -0,0 +1,31 @@
+#ifndef HOST_ANDROID_LOG_H
+#define HOST_ANDROID_LOG_H
+
+// Stand-in for the NDK logger so the portable sources build on a Linux host.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef enum android_LogPriority {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+} android_LogPriority;
+
+// Warnings and errors only, unless NATIVEPHP_VERBOSE is set
+static inline int host_log_enabled(int prio) {
+    static int verbose = -1;
+    if (verbose < 0) verbose = getenv("NATIVEPHP_VERBOSE") != NULL;
+    return verbose || prio >= ANDROID_LOG_WARN;
+}
+
+#define __android_log_print(prio, tag, ...) \
+    (host_log_enabled(prio) ? (fprintf(stderr, "%s: ", (tag)), fprintf(stderr, __VA_ARGS__), fputc('\n', stderr)) : 0)
+
+#endif // HOST_ANDROID_LOG_H
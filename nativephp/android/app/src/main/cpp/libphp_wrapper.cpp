@@ -8,6 +8,7 @@
 #include <dlfcn.h>
 #include <android/log.h>
 #include <link.h>
+#include "trace/trace.h"
 
 
 #define VIS_LOG_TAG "JNI-Symbols"
@@ -25,11 +26,13 @@ static int print_phdr(struct dl_phdr_info *info, size_t size, void *data) {
 
 __attribute__((constructor))
 void list_loaded_libraries() {
+    TRACE_SCOPE("list_loaded_libraries", "loader");
     dl_iterate_phdr(print_phdr, NULL);
 }
 
 __attribute__((constructor))
 static void expose_symbols_to_php() {
+    TRACE_SCOPE("expose_symbols_to_php", "loader");
     void* handle = dlopen("libphp_wrapper.so", RTLD_NOW | RTLD_GLOBAL);
     if (!handle) {
         __android_log_print(ANDROID_LOG_ERROR, "SymbolExport", "❌ dlopen(libphp_wrapper.so) failed: %s", dlerror());
@@ -53,6 +56,7 @@ static php_request_startup_func original_php_request_startup = nullptr;
 static php_request_shutdown_func original_php_request_shutdown = nullptr;
 
 static void __attribute__((constructor)) init_wrapper() {
+    TRACE_SCOPE("init_wrapper", "loader");
     LOGI("Initializing PHP wrapper");
 
     // Load compat library first
@@ -0,0 +1,371 @@
+#include "native_actions.h"
+
+#include <android/log.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TAG "NativeActions"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
+
+#define DEFAULT_LIMIT 1024
+
+typedef struct action_entry {
+    native_action_result result;
+    native_action_callback callback;
+    native_coalesce_mode mode;  // how later events merge into this one
+    uint64_t completed_ns;      // first completion, for the window and wait times
+    struct action_entry *next;
+} action_entry;
+
+typedef struct coalesce_rule {
+    char *event;
+    native_coalesce_mode mode;
+    uint64_t window_ns;
+    struct coalesce_rule *next;
+} coalesce_rule;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static native_action_launcher g_launcher = NULL;
+static uint64_t g_next_handle = 1;
+
+// Started and not yet completed, newest first
+static action_entry *g_in_flight = NULL;
+static size_t g_in_flight_count = 0;
+
+// Completed, waiting for the PHP thread, oldest first
+static action_entry *g_completed = NULL;
+static action_entry *g_completed_tail = NULL;
+static size_t g_completed_count = 0;
+
+static coalesce_rule *g_rules = NULL;
+static size_t g_limit = DEFAULT_LIMIT;
+static native_action_stats g_stats;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static void free_entry(action_entry *entry) {
+    free(entry->result.action);
+    free(entry->result.event);
+    free(entry->result.payload);
+    free(entry);
+}
+
+// Takes `handle` off the in-flight list. Called with the lock held.
+static action_entry *unlink_in_flight(uint64_t handle) {
+    for (action_entry **link = &g_in_flight; *link; link = &(*link)->next) {
+        if ((*link)->result.handle == handle) {
+            action_entry *entry = *link;
+            *link = entry->next;
+            entry->next = NULL;
+            g_in_flight_count--;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+void native_actions_set_launcher(native_action_launcher launcher) {
+    pthread_mutex_lock(&g_lock);
+    g_launcher = launcher;
+    pthread_mutex_unlock(&g_lock);
+}
+
+uint64_t native_actions_begin(const char *action, const char *args, native_action_callback callback) {
+    action_entry *entry = calloc(1, sizeof(*entry));
+    if (!entry) return 0;
+    entry->result.action = strdup(action);
+    entry->callback = callback;
+
+    pthread_mutex_lock(&g_lock);
+    native_action_launcher launcher = g_launcher;
+    uint64_t handle = g_next_handle++;
+    entry->result.handle = handle;
+    // In flight before the launch, since the platform may complete it before launch returns
+    if (launcher) {
+        entry->next = g_in_flight;
+        g_in_flight = entry;
+        g_in_flight_count++;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (!launcher) {
+        LOGE("❌ No launcher for %s", action);
+        free_entry(entry);
+        return 0;
+    }
+
+    if (launcher(handle, action, args ? args : "{}") != 0) {
+        LOGE("❌ Failed to launch %s", action);
+        pthread_mutex_lock(&g_lock);
+        entry = unlink_in_flight(handle);
+        pthread_mutex_unlock(&g_lock);
+        if (entry) free_entry(entry);
+        return 0;
+    }
+
+    LOGI("🚀 Started %s as #%llu", action, (unsigned long long) handle);
+    return handle;
+}
+
+// Called with the lock held
+static const coalesce_rule *find_rule(const char *event) {
+    for (coalesce_rule *rule = g_rules; rule; rule = rule->next) {
+        if (strcmp(rule->event, event) == 0) return rule;
+    }
+    return NULL;
+}
+
+// The newest queued result `event` can still merge into. Called with the lock held.
+static action_entry *find_merge_target(const char *event, const coalesce_rule *rule, uint64_t now) {
+    action_entry *target = NULL;
+    for (action_entry *entry = g_completed; entry; entry = entry->next) {
+        if (entry->result.handle == 0 && entry->mode == rule->mode &&
+            strcmp(entry->result.event, event) == 0 && now - entry->completed_ns <= rule->window_ns) {
+            target = entry;
+        }
+    }
+    return target;
+}
+
+// [payload], growing by one element per merge
+static char *list_payload(const char *previous, const char *payload) {
+    size_t kept = previous ? strlen(previous) - 1 : 1;
+    size_t size = kept + 1 + strlen(payload) + 2;
+    char *list = malloc(size);
+    if (!list) return NULL;
+    if (previous) snprintf(list, size, "%.*s,%s]", (int) kept, previous, payload);
+    else snprintf(list, size, "[%s]", payload);
+    return list;
+}
+
+static int merge(action_entry *entry, const char *payload, int code) {
+    char *merged = entry->result.batch ? list_payload(entry->result.payload, payload) : strdup(payload);
+    if (!merged) return -1;
+    free(entry->result.payload);
+    entry->result.payload = merged;
+    entry->result.code = code;
+    entry->result.count++;
+    return 0;
+}
+
+// Keeps the queue within the limit by dropping the oldest handle 0 result
+// nothing waits on. Called with the lock held.
+static void enforce_limit(void) {
+    while (g_completed_count > g_limit) {
+        action_entry *previous = NULL, *entry = g_completed;
+        while (entry && (entry->result.handle != 0 || entry->callback)) {
+            previous = entry;
+            entry = entry->next;
+        }
+        if (!entry) return;
+
+        if (previous) previous->next = entry->next;
+        else g_completed = entry->next;
+        if (g_completed_tail == entry) g_completed_tail = previous;
+        g_completed_count--;
+        g_stats.dropped++;
+        LOGE("⚠️ Queue full, dropped %s", entry->result.event);
+        free_entry(entry);
+    }
+}
+
+int native_actions_complete(uint64_t handle, const char *event, const char *payload, int code) {
+    action_entry *entry;
+    uint64_t now = now_ns();
+    event = event ? event : "";
+    payload = payload && payload[0] ? payload : "{}";
+
+    pthread_mutex_lock(&g_lock);
+    g_stats.completed++;
+    const coalesce_rule *rule = handle == 0 ? find_rule(event) : NULL;
+    if (rule) {
+        action_entry *target = find_merge_target(event, rule, now);
+        if (target && merge(target, payload, code) == 0) {
+            g_stats.coalesced++;
+            pthread_mutex_unlock(&g_lock);
+            return 0;
+        }
+    }
+
+    if (handle == 0) {
+        entry = calloc(1, sizeof(*entry));
+        if (entry) entry->result.action = strdup("");
+    } else {
+        entry = unlink_in_flight(handle);
+    }
+    if (!entry) {
+        pthread_mutex_unlock(&g_lock);
+        LOGE("❌ Completion for unknown action #%llu", (unsigned long long) handle);
+        return -1;
+    }
+
+    entry->mode = rule ? rule->mode : NATIVE_COALESCE_NONE;
+    entry->completed_ns = now;
+    entry->result.event = strdup(event);
+    entry->result.batch = entry->mode == NATIVE_COALESCE_LIST;
+    entry->result.payload = entry->result.batch ? list_payload(NULL, payload) : strdup(payload);
+    if (!entry->result.payload) {
+        entry->result.batch = 0;
+        entry->result.payload = strdup("{}");
+    }
+    entry->result.code = code;
+    entry->result.count = 1;
+    if (g_completed_tail) g_completed_tail->next = entry;
+    else g_completed = entry;
+    g_completed_tail = entry;
+    g_completed_count++;
+    enforce_limit();
+    if (g_completed_count > g_stats.queued_peak) g_stats.queued_peak = g_completed_count;
+    pthread_mutex_unlock(&g_lock);
+
+    LOGI("✅ #%llu completed with %s (%d)", (unsigned long long) handle, event[0] ? event : "no event", code);
+    return 0;
+}
+
+void native_actions_coalesce(const char *event, native_coalesce_mode mode, unsigned window_ms) {
+    pthread_mutex_lock(&g_lock);
+    coalesce_rule **link = &g_rules;
+    while (*link && strcmp((*link)->event, event) != 0) link = &(*link)->next;
+
+    if (mode == NATIVE_COALESCE_NONE) {
+        if (*link) {
+            coalesce_rule *rule = *link;
+            *link = rule->next;
+            free(rule->event);
+            free(rule);
+        }
+    } else {
+        if (!*link) {
+            *link = calloc(1, sizeof(coalesce_rule));
+            if (*link) (*link)->event = strdup(event);
+        }
+        if (*link) {
+            (*link)->mode = mode;
+            (*link)->window_ns = (uint64_t) window_ms * 1000000ull;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void native_actions_set_limit(size_t limit) {
+    pthread_mutex_lock(&g_lock);
+    g_limit = limit > 0 ? limit : 1;
+    enforce_limit();
+    pthread_mutex_unlock(&g_lock);
+}
+
+void native_actions_stats(native_action_stats *stats) {
+    pthread_mutex_lock(&g_lock);
+    *stats = g_stats;
+    stats->queued = g_completed_count;
+    pthread_mutex_unlock(&g_lock);
+}
+
+size_t native_actions_in_flight(void) {
+    pthread_mutex_lock(&g_lock);
+    size_t count = g_in_flight_count;
+    pthread_mutex_unlock(&g_lock);
+    return count;
+}
+
+size_t native_actions_completed(void) {
+    pthread_mutex_lock(&g_lock);
+    size_t count = g_completed_count;
+    pthread_mutex_unlock(&g_lock);
+    return count;
+}
+
+void native_actions_run_callbacks(void) {
+    // One at a time and outside the lock, since a callback may start another action
+    for (;;) {
+        native_action_callback callback = NULL;
+        int code = 0;
+
+        pthread_mutex_lock(&g_lock);
+        for (action_entry *entry = g_completed; entry; entry = entry->next) {
+            if (entry->callback) {
+                callback = entry->callback;
+                code = entry->result.code;
+                entry->callback = NULL;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&g_lock);
+
+        if (!callback) return;
+        callback(code);
+    }
+}
+
+native_action_result *native_actions_take(size_t *count) {
+    uint64_t now = now_ns();
+
+    pthread_mutex_lock(&g_lock);
+    action_entry *entries = g_completed;
+    size_t taken = g_completed_count;
+    g_completed = g_completed_tail = NULL;
+    g_completed_count = 0;
+    if (taken > 0) {
+        g_stats.delivered += taken;
+        g_stats.batches++;
+        for (action_entry *entry = entries; entry; entry = entry->next) {
+            uint64_t waited = now - entry->completed_ns;
+            g_stats.wait_total_ns += waited;
+            if (waited > g_stats.wait_max_ns) g_stats.wait_max_ns = waited;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    *count = 0;
+    if (taken == 0) return NULL;
+
+    native_action_result *results = malloc(taken * sizeof(*results));
+    for (action_entry *entry = entries; entry;) {
+        action_entry *next = entry->next;
+        // Completed after the last native_actions_run_callbacks(); the entry
+        // is off the queue now, so this is the only chance to run it
+        if (entry->callback) entry->callback(entry->result.code);
+        if (results) {
+            results[(*count)++] = entry->result;
+            free(entry);
+        } else {
+            free_entry(entry);
+        }
+        entry = next;
+    }
+    return results;
+}
+
+void native_actions_free(native_action_result *results, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(results[i].action);
+        free(results[i].event);
+        free(results[i].payload);
+    }
+    free(results);
+}
+
+void native_actions_reset(void) {
+    pthread_mutex_lock(&g_lock);
+    action_entry *lists[] = {g_in_flight, g_completed};
+    g_in_flight = g_completed = g_completed_tail = NULL;
+    g_in_flight_count = g_completed_count = 0;
+    memset(&g_stats, 0, sizeof(g_stats));
+    pthread_mutex_unlock(&g_lock);
+
+    for (int i = 0; i < 2; i++) {
+        for (action_entry *entry = lists[i]; entry;) {
+            action_entry *next = entry->next;
+            free_entry(entry);
+            entry = next;
+        }
+    }
+}
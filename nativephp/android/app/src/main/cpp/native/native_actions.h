@@ -0,0 +1,109 @@
+#ifndef NATIVE_ACTIONS_H
+#define NATIVE_ACTIONS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Asynchronous native actions ===
+//
+// PHP starts an action (camera, biometric prompt, alert...) and gets a handle
+// back straight away. The platform runs it and completes the handle from
+// whatever thread it finishes on; completions wait here until the PHP thread
+// takes them at its next request, so a result never needs a WebView round
+// trip to reach Laravel.
+//
+// Handles start at 1. The platform may also complete handle 0 for events
+// nothing asked for.
+//
+// High-rate handle 0 events (location, sensors, repeated file callbacks) can
+// be coalesced by event name while they wait, so PHP gets one result per
+// window instead of one per event. Payloads are passed through untouched, so
+// they still fit the event they were completed with:
+//
+//     NATIVE_COALESCE_LAST   the latest payload
+//     NATIVE_COALESCE_COUNT  the latest payload, with the merged count in `count`
+//     NATIVE_COALESCE_LIST   a batch: a JSON array of every payload, oldest first
+//
+// Results for a handle are never merged or dropped.
+
+// Starts `action` on the platform. Returns non-zero if it couldn't be started.
+typedef int (*native_action_launcher)(uint64_t handle, const char *action, const char *args);
+
+// Runs on the PHP thread, inside a request, with the completion's code
+typedef void (*native_action_callback)(int code);
+
+typedef enum {
+    NATIVE_COALESCE_NONE,
+    NATIVE_COALESCE_LAST,
+    NATIVE_COALESCE_COUNT,
+    NATIVE_COALESCE_LIST
+} native_coalesce_mode;
+
+typedef struct {
+    uint64_t handle;
+    char *action;   // what was started, "" for handle 0
+    char *event;    // Laravel event class, "" when there's nothing to dispatch (cancelled)
+    char *payload;  // JSON object, or an array of them for a batch
+    int code;       // action specific, e.g. the alert button index or -1 when cancelled
+    unsigned count; // completions merged into this result, 1 unless coalesced
+    int batch;      // payload lists every merged payload (NATIVE_COALESCE_LIST)
+} native_action_result;
+
+// Backpressure on the queue between the platform and PHP, since the last reset
+typedef struct {
+    uint64_t completed;     // completions received
+    uint64_t coalesced;     // merged into a result already queued
+    uint64_t dropped;       // handle 0 results pushed out by the queue limit
+    uint64_t delivered;     // results taken by PHP
+    uint64_t batches;       // takes that found something
+    uint64_t queued;        // waiting now
+    uint64_t queued_peak;
+    uint64_t wait_max_ns;   // longest a result waited between completion and take
+    uint64_t wait_total_ns; // over all delivered results, for the mean
+} native_action_stats;
+
+void native_actions_set_launcher(native_action_launcher launcher);
+
+// Registers the action and launches it. `args` is a JSON object or NULL.
+// `callback` runs at the first request after completion. Returns 0 if
+// there's no launcher or the launch failed.
+uint64_t native_actions_begin(const char *action, const char *args, native_action_callback callback);
+
+// From any thread. Returns -1 for a handle that isn't in flight.
+int native_actions_complete(uint64_t handle, const char *event, const char *payload, int code);
+
+// Merge handle 0 `event`s completing within `window_ms` of the first one
+// still queued. NATIVE_COALESCE_NONE removes the rule.
+void native_actions_coalesce(const char *event, native_coalesce_mode mode, unsigned window_ms);
+
+// Most results kept waiting (default 1024). Past it the oldest handle 0
+// result without a callback is dropped.
+void native_actions_set_limit(size_t limit);
+
+void native_actions_stats(native_action_stats *stats);
+
+size_t native_actions_in_flight(void);
+size_t native_actions_completed(void);
+
+// On the PHP thread, once the request is open: runs the callbacks of
+// completed actions. Their results stay queued for native_actions_take().
+void native_actions_run_callbacks(void);
+
+// Moves every completed result out, oldest first, first running any callback
+// native_actions_run_callbacks() didn't get to. Returns NULL when empty.
+native_action_result *native_actions_take(size_t *count);
+void native_actions_free(native_action_result *results, size_t count);
+
+// Drops everything in flight and queued and clears the stats, keeping the
+// launcher, coalescing rules and limit
+void native_actions_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NATIVE_ACTIONS_H
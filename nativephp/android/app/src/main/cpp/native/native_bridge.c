@@ -1,6 +1,11 @@
 #include "native_bridge.h"
+#include "native_actions.h"
 #include <jni.h>
 #include <android/log.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include "../PHP.h"
@@ -9,348 +14,294 @@
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
 
+#define MAX_ACTION_ARGS 4
+
 // These are declared in native_bridge.h and defined in php_bridge.c
 extern JavaVM *g_jvm;
 extern jobject g_bridge_instance;
 
-void NativePHPVibrate(void) {
-    LOGI("✅ NativePHPVibrate called");
-
-    JNIEnv *env;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
-        LOGI("Thread not attached. Attaching...");
-        if ((*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL) != JNI_OK) {
-            LOGE("❌ Failed to attach thread to JVM");
-            return;
+typedef enum {
+    RETURNS_VOID,
+    RETURNS_BOOLEAN,
+    RETURNS_STRING
+} action_return;
+
+typedef struct {
+    const char *method;
+    const char *signature;
+    // Filled in from the signature by native_bridge_resolve()
+    int arg_count;
+    char arg_types[MAX_ACTION_ARGS];  // 'S' for String, 'J' for long
+    action_return returns;
+    jmethodID id;
+} action_entry;
+
+// One line per action: the PHPBridge method and its JNI signature
+static action_entry g_actions[NATIVE_ACTION_COUNT] = {
+        [NATIVE_ACTION_VIBRATE]           = {"nativeVibrate", "()V"},
+        [NATIVE_ACTION_SHOW_TOAST]        = {"nativeShowToast", "(Ljava/lang/String;)V"},
+        [NATIVE_ACTION_SHARE]             = {"nativeShare", "(Ljava/lang/String;Ljava/lang/String;)V"},
+        [NATIVE_ACTION_TOGGLE_FLASHLIGHT] = {"nativeToggleFlashlight", "()V"},
+        [NATIVE_ACTION_BEGIN]             = {"nativeBeginAction", "(JLjava/lang/String;Ljava/lang/String;)V"},
+        [NATIVE_ACTION_SECURE_SET]        = {"nativeSecureSet", "(Ljava/lang/String;Ljava/lang/String;)Z"},
+        [NATIVE_ACTION_SECURE_GET]        = {"nativeSecureGet", "(Ljava/lang/String;)Ljava/lang/String;"},
+};
+
+static jclass g_bridge_class = NULL;
+static pthread_key_t g_detach_key;
+static __thread JNIEnv *t_env = NULL;
+
+#define STRING_TYPE "Ljava/lang/String;"
+
+// "(JLjava/lang/String;)Z": a long and a String argument, returns boolean
+static int parse_signature(action_entry *entry) {
+    const char *p = entry->signature;
+    if (*p++ != '(') return -1;
+
+    entry->arg_count = 0;
+    while (*p != ')') {
+        if (entry->arg_count == MAX_ACTION_ARGS) return -1;
+        if (*p == 'J') {
+            p++;
+            entry->arg_types[entry->arg_count++] = 'J';
+        } else if (strncmp(p, STRING_TYPE, strlen(STRING_TYPE)) == 0) {
+            p += strlen(STRING_TYPE);
+            entry->arg_types[entry->arg_count++] = 'S';
+        } else {
+            return -1;
         }
     }
+    p++;
 
-    if (g_bridge_instance) {
-        jclass cls = (*env)->GetObjectClass(env, g_bridge_instance);
-        if (!cls) {
-            LOGE("❌ Failed to get class from g_bridge_instance");
-            return;
-        }
-
-        // Now call the Kotlin-side nativeVibrate() method (no args)
-        jmethodID mid = (*env)->GetMethodID(env, cls, "nativeVibrate", "()V");
-        if (!mid) {
-            LOGE("❌ Failed to find method: nativeVibrate()");
-            (*env)->DeleteLocalRef(env, cls);
-            return;
-        }
+    if (strcmp(p, "V") == 0) entry->returns = RETURNS_VOID;
+    else if (strcmp(p, "Z") == 0) entry->returns = RETURNS_BOOLEAN;
+    else if (strcmp(p, STRING_TYPE) == 0) entry->returns = RETURNS_STRING;
+    else return -1;
+    return 0;
+}
 
-        (*env)->CallVoidMethod(env, g_bridge_instance, mid);
-        (*env)->DeleteLocalRef(env, cls);
-        LOGI("✅ nativeVibrate() method called");
-    } else {
-        LOGE("❌ g_bridge_instance is NULL");
-    }
+static void detach_thread(void *env) {
+    (void) env;
+    (*g_jvm)->DetachCurrentThread(g_jvm);
 }
 
-void NativePHPShowToast(const char *message) {
-    LOGI("✅ NativePHPShowToast called");
+static int launch_action(uint64_t handle, const char *action, const char *args) {
+    return native_bridge_call(NATIVE_ACTION_BEGIN, NULL, (int64_t) handle, action, args);
+}
 
-    JNIEnv *env;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
-        LOGI("Thread not attached. Attaching...");
-        if ((*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL) != JNI_OK) {
-            LOGE("❌ Failed to attach thread");
-            return;
+int native_bridge_resolve(JNIEnv *env, jclass bridge_class) {
+    pthread_key_create(&g_detach_key, detach_thread);
+    g_bridge_class = (*env)->NewGlobalRef(env, bridge_class);
+
+    int missing = 0;
+    for (int i = 0; i < NATIVE_ACTION_COUNT; i++) {
+        action_entry *entry = &g_actions[i];
+        if (parse_signature(entry) != 0) {
+            LOGE("❌ Unsupported signature %s for %s", entry->signature, entry->method);
+            missing++;
+            continue;
         }
-    }
-
-    if (g_bridge_instance) {
-        jclass cls = (*env)->GetObjectClass(env, g_bridge_instance);
-        jmethodID mid = (*env)->GetMethodID(env, cls, "nativeShowToast", "(Ljava/lang/String;)V");
-        if (mid) {
-            jstring jmsg = (*env)->NewStringUTF(env, message);
-            (*env)->CallVoidMethod(env, g_bridge_instance, mid, jmsg);
-            (*env)->DeleteLocalRef(env, jmsg);
-            LOGI("✅ Called nativeShowToast()");
-        } else {
-            LOGE("❌ nativeShowToast(String) method not found");
+        entry->id = (*env)->GetMethodID(env, g_bridge_class, entry->method, entry->signature);
+        if (!entry->id) {
+            (*env)->ExceptionClear(env);
+            LOGE("❌ %s%s not found on PHPBridge", entry->method, entry->signature);
+            missing++;
         }
-        (*env)->DeleteLocalRef(env, cls);
-    } else {
-        LOGE("❌ g_bridge_instance is NULL");
     }
+    native_actions_set_launcher(launch_action);
+    return missing;
 }
 
-void NativePHPShowAlert(
-        const char *title,
-        const char *message,
-        const char **buttonTitles,
-        int buttonCount,
-        void (*callback)(int)
-) {
-    LOGI("✅ NativePHPShowAlert called");
+// The calling thread's env. Java threads (the PHP executor) already have one;
+// any other thread is attached once and detached by the key's destructor on exit.
+static JNIEnv *current_env(void) {
+    if (t_env) return t_env;
 
     JNIEnv *env;
     if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
         LOGI("Thread not attached. Attaching...");
         if ((*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL) != JNI_OK) {
-            LOGE("❌ Failed to attach thread");
-            return;
+            LOGE("❌ Failed to attach thread to JVM");
+            return NULL;
         }
+        pthread_setspecific(g_detach_key, env);
     }
+    t_env = env;
+    return env;
+}
 
-    if (g_bridge_instance) {
-        jclass cls = (*env)->GetObjectClass(env, g_bridge_instance);
-        jmethodID mid = (*env)->GetMethodID(env, cls, "nativeShowAlert",
-                                            "(Ljava/lang/String;Ljava/lang/String;)V");
-        if (mid) {
-            jstring jtitle = (*env)->NewStringUTF(env, title);
-            jstring jmessage = (*env)->NewStringUTF(env, message);
-            (*env)->CallVoidMethod(env, g_bridge_instance, mid, jtitle, jmessage);
-            (*env)->DeleteLocalRef(env, jtitle);
-            (*env)->DeleteLocalRef(env, jmessage);
-            LOGI("✅ Called nativeShowAlert()");
-        } else {
-            LOGE("❌ nativeShowAlert(String, String) method not found");
-        }
-        (*env)->DeleteLocalRef(env, cls);
-    } else {
+int native_bridge_call(native_action action, native_result *result, ...) {
+    const action_entry *entry = &g_actions[action];
+    if (result) memset(result, 0, sizeof(*result));
+
+    if (!entry->id) {
+        LOGE("❌ %s isn't available", entry->method);
+        return -1;
+    }
+    if (!g_bridge_instance) {
         LOGE("❌ g_bridge_instance is NULL");
+        return -1;
     }
+    JNIEnv *env = current_env();
+    if (!env) return -1;
 
-    // Call the callback immediately with button index 0 (simulate default OK button)
-    if (callback) {
-        callback(0);
+    // The PHP thread never returns to Java between calls, so local refs are freed here
+    if ((*env)->PushLocalFrame(env, MAX_ACTION_ARGS + 1) != JNI_OK) {
+        (*env)->ExceptionClear(env);
+        return -1;
     }
-}
-
-void NativePHPShare(const char *title, const char *message) {
-    LOGI("✅ NativePHPShare called");
 
-    JNIEnv *env;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
-        LOGI("Thread not attached. Attaching...");
-        if ((*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL) != JNI_OK) {
-            LOGE("❌ Failed to attach thread");
-            return;
+    jvalue args[MAX_ACTION_ARGS];
+    va_list list;
+    va_start(list, result);
+    for (int i = 0; i < entry->arg_count; i++) {
+        if (entry->arg_types[i] == 'J') {
+            args[i].j = (jlong) va_arg(list, int64_t);
+            continue;
         }
+        const char *arg = va_arg(list, const char *);
+        args[i].l = arg ? (*env)->NewStringUTF(env, arg) : NULL;
+    }
+    va_end(list);
+
+    jobject returned = NULL;
+    jboolean boolean = JNI_FALSE;
+    switch (entry->returns) {
+        case RETURNS_VOID:
+            (*env)->CallVoidMethodA(env, g_bridge_instance, entry->id, args);
+            break;
+        case RETURNS_BOOLEAN:
+            boolean = (*env)->CallBooleanMethodA(env, g_bridge_instance, entry->id, args);
+            break;
+        case RETURNS_STRING:
+            returned = (*env)->CallObjectMethodA(env, g_bridge_instance, entry->id, args);
+            break;
     }
 
-    if (g_bridge_instance) {
-        jclass cls = (*env)->GetObjectClass(env, g_bridge_instance);
-        jmethodID mid = (*env)->GetMethodID(env, cls, "nativeShare",
-                                            "(Ljava/lang/String;Ljava/lang/String;)V");
-        if (mid) {
-            jstring jtitle = (*env)->NewStringUTF(env, title);
-            jstring jmessage = (*env)->NewStringUTF(env, message);
-
-            (*env)->CallVoidMethod(env, g_bridge_instance, mid, jtitle, jmessage);
-
-            (*env)->DeleteLocalRef(env, jtitle);
-            (*env)->DeleteLocalRef(env, jmessage);
-            LOGI("✅ Called nativeShare()");
-        } else {
-            LOGE("❌ nativeShare(String, String) method not found");
+    int status = 0;
+    if ((*env)->ExceptionCheck(env)) {
+        LOGE("❌ %s() threw", entry->method);
+        (*env)->ExceptionDescribe(env);
+        (*env)->ExceptionClear(env);
+        status = -1;
+    } else if (result) {
+        result->boolean = boolean;
+        if (returned) {
+            const char *chars = (*env)->GetStringUTFChars(env, (jstring) returned, NULL);
+            if (chars) {
+                result->string = strdup(chars);
+                (*env)->ReleaseStringUTFChars(env, (jstring) returned, chars);
+            }
         }
-        (*env)->DeleteLocalRef(env, cls);
-    } else {
-        LOGE("❌ g_bridge_instance is NULL");
     }
 
+    (*env)->PopLocalFrame(env, NULL);
+    LOGI("✅ Called %s()", entry->method);
+    return status;
 }
 
-void NativePHPOpenCamera(void) {
-    LOGI("✅ NativePHPOpenCamera called");
-
-    JNIEnv *env;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
-        LOGI("Thread not attached. Attaching...");
-        if ((*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL) != JNI_OK) {
-            LOGE("❌ Failed to attach thread");
-            return;
-        }
-    }
-
-    if (g_bridge_instance) {
-        jclass cls = (*env)->GetObjectClass(env, g_bridge_instance);
-        jmethodID mid = (*env)->GetMethodID(env, cls, "nativeOpenCamera", "()V");
-        if (mid) {
-            (*env)->CallVoidMethod(env, g_bridge_instance, mid);
-            LOGI("✅ Called nativeOpenCamera()");
-        } else {
-            LOGE("❌ nativeOpenCamera() method not found");
-        }
-        (*env)->DeleteLocalRef(env, cls);
-    } else {
-        LOGE("❌ g_bridge_instance is NULL");
-    }
+void NativePHPVibrate(void) {
+    native_bridge_call(NATIVE_ACTION_VIBRATE, NULL);
 }
 
-void NativePHPToggleFlashlight(void) {
-    LOGI("🌀 NativePHPToggleFlashlight()");
+void NativePHPShowToast(const char *message) {
+    native_bridge_call(NATIVE_ACTION_SHOW_TOAST, NULL, message);
+}
 
-    JNIEnv *env;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **)&env, JNI_VERSION_1_6) != JNI_OK) {
-        if ((*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL) != JNI_OK) {
-            LOGE("❌ Failed to attach JNI thread");
-            return;
-        }
+// Small JSON documents for action arguments; anything that doesn't fit sets `overflow`
+typedef struct {
+    char data[8192];
+    size_t used;
+    int overflow;
+} json_buffer;
+
+static void json_append(json_buffer *json, const char *text) {
+    size_t length = strlen(text);
+    if (json->used + length >= sizeof(json->data)) {
+        json->overflow = 1;
+        return;
     }
+    memcpy(json->data + json->used, text, length + 1);
+    json->used += length;
+}
 
-    if (g_bridge_instance) {
-        jclass cls = (*env)->GetObjectClass(env, g_bridge_instance);
-        jmethodID mid = (*env)->GetMethodID(env, cls, "nativeToggleFlashlight", "()V");
-
-        if (mid) {
-            (*env)->CallVoidMethod(env, g_bridge_instance, mid);
-            LOGI("✅ Flashlight toggle sent to Kotlin");
-        } else {
-            LOGE("❌ nativeToggleFlashlight() method not found");
-        }
-
-        (*env)->DeleteLocalRef(env, cls);
-    } else {
-        LOGE("❌ g_bridge_instance is NULL");
+static void json_append_string(json_buffer *json, const char *value) {
+    json_append(json, "\"");
+    for (const unsigned char *c = (const unsigned char *) (value ? value : ""); *c; c++) {
+        char escaped[8] = {(char) *c, '\0'};
+        if (*c == '"' || *c == '\\') snprintf(escaped, sizeof(escaped), "\\%c", *c);
+        else if (*c < 0x20) snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+        json_append(json, escaped);
     }
+    json_append(json, "\"");
 }
 
-void NativePHPLocalAuthChallenge(void) {
-    LOGI("✅ NativePHPLocalAuthChallenge called");
-
-    JNIEnv *env;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
-        if ((*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL) != JNI_OK) {
-            LOGE("❌ Failed to attach JNI thread");
-            return;
-        }
+void NativePHPShowAlert(
+        const char *title,
+        const char *message,
+        const char **buttonTitles,
+        int buttonCount,
+        void (*callback)(int)
+) {
+    json_buffer args = {.used = 0};
+    json_append(&args, "{\"title\":");
+    json_append_string(&args, title);
+    json_append(&args, ",\"message\":");
+    json_append_string(&args, message);
+    json_append(&args, ",\"buttons\":[");
+    for (int i = 0; i < buttonCount; i++) {
+        if (i > 0) json_append(&args, ",");
+        json_append_string(&args, buttonTitles[i]);
+    }
+    json_append(&args, "]}");
+    if (args.overflow) {
+        LOGE("❌ Alert too large to show");
+        return;
     }
 
-    if (g_bridge_instance) {
-        jclass cls = (*env)->GetObjectClass(env, g_bridge_instance);
-        jmethodID mid = (*env)->GetMethodID(env, cls, "nativeStartBiometric", "()V");
-        if (mid) {
-            (*env)->CallVoidMethod(env, g_bridge_instance, mid);
-            LOGI("📦 Enqueued 'biometric' native call to PHPBridge");
-        } else {
-            LOGE("❌ Could not find enqueueNativeCall(String)");
-        }
+    // The callback gets the pressed button's index at the first request after the tap
+    native_actions_begin("alert", args.data, callback);
+}
 
-        (*env)->DeleteLocalRef(env, cls);
-    } else {
-        LOGE("❌ g_bridge_instance is NULL");
-    }
+void NativePHPShare(const char *title, const char *message) {
+    native_bridge_call(NATIVE_ACTION_SHARE, NULL, title, message);
 }
 
-void NativePHPGetPushToken(void)
-{
-    LOGI("🚀 NativePHPGetPushToken called");
+void NativePHPOpenCamera(void) {
+    native_actions_begin("camera", NULL, NULL);
+}
 
-    JNIEnv *env;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
-        if ((*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL) != JNI_OK) {
-            LOGE("❌ Failed to attach JNI thread");
-            return;
-        }
-    }
+void NativePHPToggleFlashlight(void) {
+    native_bridge_call(NATIVE_ACTION_TOGGLE_FLASHLIGHT, NULL);
+}
 
-    if (g_bridge_instance) {
-        jclass cls = (*env)->GetObjectClass(env, g_bridge_instance);
-        jmethodID mid = (*env)->GetMethodID(env, cls, "nativeGetPushToken", "()V");
-        if (mid) {
-            (*env)->CallVoidMethod(env, g_bridge_instance, mid);
-            LOGI("📦 Called nativeGetPushToken() to get FCM token");
-        } else {
-            LOGE("❌ Could not find nativeGetPushToken()");
-        }
+void NativePHPLocalAuthChallenge(void) {
+    native_actions_begin("biometric", NULL, NULL);
+}
 
-        (*env)->DeleteLocalRef(env, cls);
-    } else {
-        LOGE("❌ g_bridge_instance is NULL");
-    }
+void NativePHPGetPushToken(void) {
+    native_actions_begin("push-token", NULL, NULL);
 }
 
-void NativePHPSecureSet(const char *key, const char *value)
-{
+void NativePHPSecureSet(const char *key, const char *value) {
     LOGI("🔐 NativePHPSecureSet called with key: %s", key);
 
-    JNIEnv *env;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
-        if ((*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL) != JNI_OK) {
-            LOGE("❌ Failed to attach JNI thread");
-            return;
-        }
-    }
-
-    if (g_bridge_instance) {
-        jclass cls = (*env)->GetObjectClass(env, g_bridge_instance);
-        jmethodID mid = (*env)->GetMethodID(env, cls, "nativeSecureSet", "(Ljava/lang/String;Ljava/lang/String;)Z");
-        
-        if (mid) {
-            jstring jkey = (*env)->NewStringUTF(env, key);
-            jstring jvalue = (*env)->NewStringUTF(env, value);
-            
-            jboolean result = (*env)->CallBooleanMethod(env, g_bridge_instance, mid, jkey, jvalue);
-            
-            (*env)->DeleteLocalRef(env, jkey);
-            (*env)->DeleteLocalRef(env, jvalue);
-            (*env)->DeleteLocalRef(env, cls);
-            
-            LOGI("✅ Secure storage set completed with result: %d", result);
-        } else {
-            LOGE("❌ nativeSecureSet(String, String) method not found");
-            (*env)->DeleteLocalRef(env, cls);
-        }
-    } else {
-        LOGE("❌ g_bridge_instance is NULL");
+    native_result result;
+    if (native_bridge_call(NATIVE_ACTION_SECURE_SET, &result, key, value) == 0) {
+        LOGI("✅ Secure storage set completed with result: %d", result.boolean);
     }
 }
 
-void NativePHPSecureGet(const char *key, void *return_value)
-{
+void NativePHPSecureGet(const char *key, void *return_value) {
     LOGI("🔓 NativePHPSecureGet called with key: %s", key);
 
-    zval *retval = (zval*)return_value;
-
-    JNIEnv *env;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
-        if ((*g_jvm)->AttachCurrentThread(g_jvm, &env, NULL) != JNI_OK) {
-            LOGE("❌ Failed to attach JNI thread");
-            ZVAL_NULL(retval);
-            return;
-        }
-    }
-
-    if (g_bridge_instance) {
-        jclass cls = (*env)->GetObjectClass(env, g_bridge_instance);
-        jmethodID mid = (*env)->GetMethodID(env, cls, "nativeSecureGet", "(Ljava/lang/String;)Ljava/lang/String;");
-        
-        if (mid) {
-            jstring jkey = (*env)->NewStringUTF(env, key);
-            jstring jresult = (jstring)(*env)->CallObjectMethod(env, g_bridge_instance, mid, jkey);
-            
-            (*env)->DeleteLocalRef(env, jkey);
-            
-            if (jresult) {
-                const char* cstr = (*env)->GetStringUTFChars(env, jresult, NULL);
-                if (cstr) {
-                    LOGI("✅ Secure storage get completed, returning: %s", cstr);
-                    ZVAL_STRING(retval, cstr);
-                    (*env)->ReleaseStringUTFChars(env, jresult, cstr);
-                } else {
-                    LOGI("⚠️ Failed to get string UTF chars");
-                    ZVAL_NULL(retval);
-                }
-                (*env)->DeleteLocalRef(env, jresult);
-            } else {
-                LOGI("⚠️ No value returned from Kotlin (null)");
-                ZVAL_NULL(retval);
-            }
-            
-            (*env)->DeleteLocalRef(env, cls);
-        } else {
-            LOGE("❌ nativeSecureGet(String) method not found");
-            (*env)->DeleteLocalRef(env, cls);
-            ZVAL_NULL(retval);
-        }
+    zval *retval = (zval *) return_value;
+    native_result result;
+    if (native_bridge_call(NATIVE_ACTION_SECURE_GET, &result, key) == 0 && result.string) {
+        ZVAL_STRING(retval, result.string);
+        free(result.string);
     } else {
-        LOGE("❌ g_bridge_instance is NULL");
+        LOGI("⚠️ No value returned from Kotlin (null)");
         ZVAL_NULL(retval);
     }
 }
-
@@ -20,7 +20,40 @@ void NativePHPGetPushToken(void);
 void NativePHPSecureSet(const char *key, const char *value);
 void NativePHPSecureGet(const char *key, void *return_value);
 
-
+// === Dispatch to PHPBridge ===
+//
+// Every native action is a PHPBridge method taking String and long arguments
+// and returning void, boolean or String, listed once in native_bridge.c's table.
+// Actions with a result (camera, biometrics, alerts, push tokens) all go
+// through nativeBeginAction with a native_actions.h handle.
+// Method IDs are resolved once from JNI_OnLoad; a thread that isn't a Java
+// thread is attached on its first call and detached when it exits.
+
+typedef enum {
+    NATIVE_ACTION_VIBRATE,
+    NATIVE_ACTION_SHOW_TOAST,
+    NATIVE_ACTION_SHARE,
+    NATIVE_ACTION_TOGGLE_FLASHLIGHT,
+    NATIVE_ACTION_BEGIN,
+    NATIVE_ACTION_SECURE_SET,
+    NATIVE_ACTION_SECURE_GET,
+    NATIVE_ACTION_COUNT
+} native_action;
+
+typedef struct {
+    jboolean boolean;  // boolean methods
+    char *string;      // String methods, NULL for null; free() it
+} native_result;
+
+// From JNI_OnLoad, with the PHPBridge class. Returns the number of actions
+// that couldn't be resolved; those fail when called. Also makes
+// nativeBeginAction the launcher for native_actions_begin().
+int native_bridge_resolve(JNIEnv *env, jclass bridge_class);
+
+// Calls `action` on the registered PHPBridge instance with its arguments
+// after `result`, const char * for String and int64_t for long (NULL if the result isn't wanted).
+// Returns 0 if the call was made and didn't throw.
+int native_bridge_call(native_action action, native_result *result, ...);
 
 #ifdef __cplusplus
 }
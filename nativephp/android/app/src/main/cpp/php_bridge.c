@@ -2,7 +2,21 @@
 #include <android/log.h>
 #include "php_embed.h"
 #include "PHP.h"
+#include "bundle/bundle_archive.h"
+#include "bundle/bundle_delta.h"
+#include "bundle/bundle_extract.h"
+#include "bundle/bundle_meta.h"
+#include "bundle/bundle_stream.h"
+#include "native/native_actions.h"
+#include "native/native_bridge.h"
+#include "runtime/php_runtime.h"
+#include "trace/profiler.h"
+#include "trace/request_memory.h"
+#include "trace/request_timing.h"
+#include "trace/sampler.h"
+#include "trace/trace.h"
 #include <zend_exceptions.h>
+#include <pthread.h>
 
 // Define Android logging macros first
 #define LOG_TAG "PHP-Native"
@@ -13,273 +27,326 @@ JavaVM *g_jvm = NULL;
 jobject g_bridge_instance = NULL;
 
 // Global state
-static int php_initialized = 0;
 static jobject g_callback_obj = NULL;
 static jmethodID g_callback_method = NULL;
-static char *g_collected_output = NULL;
-static size_t g_collected_length = 0;
-static size_t g_collected_capacity = 0;
-
-#define BUFFER_CHUNK_SIZE (256 * 1024)  // 256KB increments
-#define MAX_BUFFER_SIZE (16 * 1024 * 1024)  // 16MB max buffer
 
 static void (*jni_output_callback_ptr)(const char *) = NULL;
 
-void clear_collected_output() {
-    if (g_collected_output) {
-        free(g_collected_output);
-        g_collected_output = NULL;
+void override_embed_module_output(void (*callback)(const char *)) {
+    jni_output_callback_ptr = callback;
+    php_embed_module.ub_write = capture_php_output;
+}
+
+void jni_output_callback(const char *output) {
+//    LOGI("PHP Output Debug - Callback called with: %s", output);
+
+    JNIEnv *env;
+    if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
+        LOGE("Failed to get JNI environment");
+        return;
     }
 
-    g_collected_capacity = BUFFER_CHUNK_SIZE;
-    g_collected_length = 0;
-    g_collected_output = (char *) malloc(g_collected_capacity);
-    if (g_collected_output) {
-        g_collected_output[0] = '\0';
+    if (g_callback_obj && g_callback_method) {
+        LOGI("WE MADE IT HERE");
+        jstring joutput = (*env)->NewStringUTF(env, output);
+        (*env)->CallVoidMethod(env, g_callback_obj, g_callback_method, joutput);
+        (*env)->DeleteLocalRef(env, joutput);
     }
+
 }
 
+JNIEXPORT void JNICALL native_initialize(JNIEnv *env, jobject thiz) {
+    if (php_runtime_is_started()) {
+        LOGI("PHP already initialized");
+        return;
+    }
 
-void pipe_php_output(const char *str) {
+    if (g_bridge_instance) {
+        LOGI("Deleting existing bridge instance");
+        (*env)->DeleteGlobalRef(env, g_bridge_instance);
+    }
+    g_bridge_instance = (*env)->NewGlobalRef(env, thiz);
+    LOGI("Set g_bridge_instance to %p", g_bridge_instance);
 
-//    LOGI("PIPE: Output received: %s", str);
+    php_runtime_start();
+}
 
-    // Safety check
-    if (!g_collected_output) {
-        clear_collected_output();
-        return;  // Failed to allocate
-    }
 
-    size_t length = strlen(str);
+JNIEXPORT jint JNICALL native_set_env(JNIEnv *env, jobject thiz,
+                                                            jstring name, jstring value,
+                                                            jint overwrite) {
 
-    // Check if we need more space
-    if (g_collected_length + length + 1 > g_collected_capacity) {
-        // Calculate new size in chunks
-        size_t needed_capacity = g_collected_capacity;
-        while (needed_capacity < g_collected_length + length + 1) {
-            needed_capacity += BUFFER_CHUNK_SIZE;
-        }
+    const char *nameStr = (*env)->GetStringUTFChars(env, name, NULL);
+    const char *valueStr = (*env)->GetStringUTFChars(env, value, NULL);
 
-        // Enforce maximum size limit
-        if (needed_capacity > MAX_BUFFER_SIZE) {
-            LOGE("Output buffer exceeded maximum size of %d MB", MAX_BUFFER_SIZE / (1024 * 1024));
-            // Just return and drop output beyond this point
-            return;
-        }
+    int result = setenv(nameStr, valueStr, overwrite);
 
-        // Reallocate with the new size
-        char *new_buffer = (char *) realloc(g_collected_output, needed_capacity);
-        if (new_buffer) {
-            g_collected_output = new_buffer;
-            g_collected_capacity = needed_capacity;
-        } else {
-            LOGE("Failed to reallocate output buffer to %zu bytes", needed_capacity);
-            return;  // Failed to reallocate
-        }
-    }
+    (*env)->ReleaseStringUTFChars(env, name, nameStr);
+    (*env)->ReleaseStringUTFChars(env, value, valueStr);
 
-    // Append the string
-    strcpy(g_collected_output + g_collected_length, str);
-    g_collected_length += length;
+    return result;
 }
 
-void cleanup_output_buffer() {
-    if (g_collected_output) {
-        g_collected_output[0] = '\0';
-        g_collected_length = 0;
+// Copies a Java String[] into a malloc'd array of C strings, freed with free_string_array()
+static char **copy_string_array(JNIEnv *env, jobjectArray array, int *count) {
+    *count = array ? (*env)->GetArrayLength(env, array) : 0;
+    if (*count == 0) return NULL;
+
+    char **strings = calloc(*count, sizeof(char *));
+    for (int i = 0; i < *count; i++) {
+        jstring item = (jstring) (*env)->GetObjectArrayElement(env, array, i);
+        const char *itemStr = (*env)->GetStringUTFChars(env, item, NULL);
+        strings[i] = strdup(itemStr);
+        (*env)->ReleaseStringUTFChars(env, item, itemStr);
+        (*env)->DeleteLocalRef(env, item);
     }
+    return strings;
 }
 
-size_t capture_php_output(const char *str, size_t str_length) {
-    // Log the raw output coming from PHP
-//    LOGI("PHP output captured: length=%zu", str_length);
-    if (str_length > 0) {
-        // Log a preview of the output (first 100 chars or so)
-        char preview[10001] = {0};
-        strncpy(preview, str, str_length > 10000 ? 10000 : str_length);
-        preview[10000] = '\0'; // Ensure null termination
-    } else {
-        LOGI("Empty output received");
+static void free_string_array(char **strings, int count) {
+    for (int i = 0; i < count; i++) {
+        free(strings[i]);
     }
+    free(strings);
+}
 
-    // Rest of your original code...
-    char *buffer = malloc(str_length + 1);
-    if (buffer) {
-        memcpy(buffer, str, str_length);
-        buffer[str_length] = '\0';
+// Extracts the Laravel bundle from an open descriptor (an APK asset or a downloaded
+// OTA zip). With use_manifest, files the installed manifest already vouches for are
+// left alone and files the new bundle dropped are deleted, except under keep_paths.
+// Returns the number of files written, or -1 so Kotlin can fall back.
+JNIEXPORT jint JNICALL native_extract_bundle(JNIEnv *env, jobject thiz,
+                                             jint fd, jlong offset, jlong length,
+                                             jstring destination, jint threads,
+                                             jboolean skip_unchanged, jobjectArray only_paths,
+                                             jboolean use_manifest, jobjectArray keep_paths) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+
+    const char *destStr = (*env)->GetStringUTFChars(env, destination, NULL);
+    int onlyCount = 0;
+    char **onlyPaths = copy_string_array(env, only_paths, &onlyCount);
+    int keepCount = 0;
+    char **keepPaths = copy_string_array(env, keep_paths, &keepCount);
+
+    bundle_extract_options options = {
+            .threads = threads,
+            .buffer_size = BUNDLE_EXTRACT_BUFFER_SIZE,
+            .skip_unchanged = skip_unchanged == JNI_TRUE,
+            .only_paths = (const char *const *) onlyPaths,
+            .only_path_count = onlyCount,
+            .use_manifest = use_manifest == JNI_TRUE,
+            .keep_paths = (const char *const *) keepPaths,
+            .keep_path_count = keepCount,
+    };
+    bundle_extract_stats stats;
+    trace_span span = trace_span_begin("bundle_extract", "bundle", 0);
+    int result = bundle_extract(path, offset, length, destStr, &options, &stats);
+    trace_span_end(&span);
 
-        pipe_php_output(buffer);
-        free(buffer);
-    }
+    (*env)->ReleaseStringUTFChars(env, destination, destStr);
+    free_string_array(onlyPaths, onlyCount);
+    free_string_array(keepPaths, keepCount);
 
-    return str_length;
+    return result == 0 ? stats.files_written : -1;
 }
 
-void override_embed_module_output(void (*callback)(const char *)) {
-    jni_output_callback_ptr = callback;
-    php_embed_module.ub_write = capture_php_output;
-}
+// Serves the Laravel tree to PHP from the bundle zip itself; only disk_paths are
+// read from and written to the real directory at root.
+JNIEXPORT jboolean JNICALL native_mount_bundle(JNIEnv *env, jobject thiz,
+                                               jint fd, jlong offset, jlong length,
+                                               jstring root, jobjectArray disk_paths) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
 
-void jni_output_callback(const char *output) {
-//    LOGI("PHP Output Debug - Callback called with: %s", output);
+    const char *rootStr = (*env)->GetStringUTFChars(env, root, NULL);
+    int diskCount = 0;
+    char **diskPaths = copy_string_array(env, disk_paths, &diskCount);
 
-    JNIEnv *env;
-    if ((*g_jvm)->GetEnv(g_jvm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
-        LOGE("Failed to get JNI environment");
-        return;
-    }
+    trace_span span = trace_span_begin("bundle_archive_mount", "bundle", 0);
+    int result = bundle_archive_mount(path, offset, length, rootStr,
+                                      (const char *const *) diskPaths, diskCount);
+    trace_span_end(&span);
 
-    if (g_callback_obj && g_callback_method) {
-        LOGI("WE MADE IT HERE");
-        jstring joutput = (*env)->NewStringUTF(env, output);
-        (*env)->CallVoidMethod(env, g_callback_obj, g_callback_method, joutput);
-        (*env)->DeleteLocalRef(env, joutput);
-    }
+    (*env)->ReleaseStringUTFChars(env, root, rootStr);
+    free_string_array(diskPaths, diskCount);
 
+    return result == 0 ? JNI_TRUE : JNI_FALSE;
 }
 
-int android_header_handler(sapi_header_struct *sapi_header, sapi_header_op_enum op, sapi_headers_struct *sapi_headers) {
-    LOGI("📤 SAPI header: %s", sapi_header->header);
-    // You can collect headers here if you want
-    return 0;
+// Metadata of the bundled zip, read once per process and shared by every
+// startup step and the OTA check
+static bundle_meta *g_bundle_meta = NULL;
+static pthread_mutex_t g_bundle_meta_lock = PTHREAD_MUTEX_INITIALIZER;
+
+JNIEXPORT jboolean JNICALL native_load_bundle_meta(JNIEnv *env, jobject thiz,
+                                                   jint fd, jlong offset, jlong length) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+
+    trace_span span = trace_span_begin("bundle_meta_read", "bundle", 0);
+    bundle_meta *meta = bundle_meta_read(path, offset, length);
+    trace_span_end(&span);
+    if (!meta) return JNI_FALSE;
+
+    pthread_mutex_lock(&g_bundle_meta_lock);
+    bundle_meta_free(g_bundle_meta);
+    g_bundle_meta = meta;
+    pthread_mutex_unlock(&g_bundle_meta_lock);
+    return JNI_TRUE;
 }
 
-char* run_php_script_once(const char* scriptPath, const char* method, const char* uri, const char* postData) {
-    clear_collected_output();
-
-    // 🔁 Reset in case PHP was already initialized
-    if (php_initialized) {
-        php_embed_shutdown();
-        php_initialized = 0;
-    }
+static jstring take_jstring(JNIEnv *env, char *value) {
+    jstring result = value ? (*env)->NewStringUTF(env, value) : NULL;
+    free(value);
+    return result;
+}
 
-    // 🧠 Get session path from environment (set by Kotlin)
-    const char* session_path = getenv("SESSION_SAVE_PATH");
-    if (!session_path) session_path = "/tmp"; // fallback
+JNIEXPORT jstring JNICALL native_bundle_env_value(JNIEnv *env, jobject thiz, jstring name) {
+    const char *nameStr = (*env)->GetStringUTFChars(env, name, NULL);
 
-    // ✅ Build ini entries per request
-    php_embed_module.ub_write = capture_php_output;
-    php_embed_module.phpinfo_as_text = 1;
-    php_embed_module.php_ini_ignore = 0;
-    php_embed_module.ini_entries = "output_buffering=4096\n"
-                                   "implicit_flush=0\n"
-                                   "display_errors=1\n"
-                                   "error_reporting=E_ALL\n";
-
-    php_embed_module.header_handler = android_header_handler;
-
-    // ✅ Start PHP
-    if (php_embed_init(0, NULL) != SUCCESS) {
-        return strdup("HTTP/1.1 500 Internal Server Error\r\nContent-Type: text/plain\r\n\r\nPHP init failed.");
-    }
-    sapi_module.header_handler = android_header_handler;
-    php_initialized = 1;
-
-    // ✅ Set Laravel-relevant env vars
-    setenv("REQUEST_URI", uri, 1);
-    setenv("REQUEST_METHOD", method, 1);
-    setenv("SCRIPT_FILENAME", scriptPath, 1);
-    setenv("PHP_SELF", "/native.php", 1);
-    setenv("HTTP_HOST", "127.0.0.1", 1);
-    setenv("APP_URL", "http://127.0.0.1", 1);
-    setenv("ASSET_URL", "http://127.0.0.1/_assets/", 1);
-    setenv("NATIVEPHP_RUNNING", "true", 1);
-
-    // ✅ Set QUERY_STRING and defer parsing
-    const char* query_string = "";
-    const char* query_start = strchr(uri, '?');
-    if (query_start && strlen(query_start + 1) > 0) {
-        query_string = query_start + 1;
-        setenv("QUERY_STRING", query_string, 1);
-        LOGI("✅ Set QUERY_STRING: %s", query_string);
-    } else {
-        unsetenv("QUERY_STRING");
-        LOGI("⚠️ No QUERY_STRING found in URI");
-    }
+    pthread_mutex_lock(&g_bundle_meta_lock);
+    char *value = g_bundle_meta ? bundle_meta_env_value(g_bundle_meta, nameStr) : NULL;
+    pthread_mutex_unlock(&g_bundle_meta_lock);
 
-    // ✅ Activate Zend and parse query data AFTER engine is live
-    zend_first_try {
-                zend_activate_modules();
+    (*env)->ReleaseStringUTFChars(env, name, nameStr);
+    return take_jstring(env, value);
+}
 
-                if (strlen(query_string) > 0) {
-                    zend_string *query = zend_string_init(query_string, strlen(query_string), 0);
-                    sapi_module.treat_data(PARSE_GET, query->val, NULL);
-                    zend_string_free(query);
-                    LOGI("✅ Parsed query string into $_GET");
-                }
+JNIEXPORT jstring JNICALL native_bundle_version(JNIEnv *env, jobject thiz) {
+    pthread_mutex_lock(&g_bundle_meta_lock);
+    char *version = g_bundle_meta ? bundle_meta_version(g_bundle_meta) : NULL;
+    pthread_mutex_unlock(&g_bundle_meta_lock);
 
-                // ✅ Set up POST data (if needed)
-                initialize_php_with_request(postData ?: "", method, uri);
+    return take_jstring(env, version);
+}
 
-                // ✅ Execute the PHP script
-                zend_file_handle fileHandle;
-                zend_stream_init_filename(&fileHandle, scriptPath);
-                php_execute_script(&fileHandle);
+JNIEXPORT jobjectArray JNICALL native_bundle_files(JNIEnv *env, jobject thiz) {
+    jobjectArray result = NULL;
+
+    pthread_mutex_lock(&g_bundle_meta_lock);
+    if (g_bundle_meta) {
+        jclass stringClass = (*env)->FindClass(env, "java/lang/String");
+        result = (*env)->NewObjectArray(env, (jsize) g_bundle_meta->file_count, stringClass, NULL);
+        for (size_t i = 0; result && i < g_bundle_meta->file_count; i++) {
+            jstring file = (*env)->NewStringUTF(env, g_bundle_meta->files[i]);
+            (*env)->SetObjectArrayElement(env, result, (jsize) i, file);
+            (*env)->DeleteLocalRef(env, file);
+        }
+    }
+    pthread_mutex_unlock(&g_bundle_meta_lock);
 
-                LOGI("✅ PHP script finished executing");
+    return result;
+}
 
-                if (strlen(query_string) > 0) {
-                    zend_string *query2 = zend_string_init(query_string, strlen(query_string), 0);
-                    sapi_module.treat_data(PARSE_GET, query2->val, NULL);
-                    zend_string_free(query2);
-                    LOGI("✅ Re-parsed query string after php_execute_script()");
-                }
+JNIEXPORT jint JNICALL native_apply_delta(JNIEnv *env, jobject thiz,
+                                          jstring patch_path, jstring destination) {
+    const char *patchStr = (*env)->GetStringUTFChars(env, patch_path, NULL);
+    const char *destStr = (*env)->GetStringUTFChars(env, destination, NULL);
 
-            } zend_end_try();
+    trace_span span = trace_span_begin("bundle_delta_apply", "bundle", 0);
+    int result = bundle_delta_apply(patchStr, destStr, NULL);
+    trace_span_end(&span);
 
-    // ✅ Copy output before shutdown
-    char *response = g_collected_output ? strdup(g_collected_output) : strdup("");
+    (*env)->ReleaseStringUTFChars(env, patch_path, patchStr);
+    (*env)->ReleaseStringUTFChars(env, destination, destStr);
 
-    php_embed_shutdown();
-    php_initialized = 0;
+    return result;
+}
 
-    return response;
+// What the Java side holds as its handle. Chunks are copied out of the Java
+// array rather than pinned: feeding inflates and writes to disk, which must
+// not happen inside a critical region. The copy buffer lives as long as the
+// stream.
+typedef struct {
+    bundle_stream *stream;
+    unsigned char *buffer;
+    size_t capacity;
+} stream_handle;
+
+static void free_stream_handle(stream_handle *handle) {
+    free(handle->buffer);
+    free(handle);
 }
 
-JNIEXPORT void JNICALL native_initialize(JNIEnv *env, jobject thiz) {
-    if (php_initialized) {
-        LOGI("PHP already initialized");
-        return;
-    }
+JNIEXPORT jlong JNICALL native_stream_open(JNIEnv *env, jobject thiz, jstring staging) {
+    stream_handle *handle = calloc(1, sizeof(*handle));
+    if (!handle) return 0;
 
-    LOGI("Initializing PHP");
+    const char *stagingStr = (*env)->GetStringUTFChars(env, staging, NULL);
+    handle->stream = bundle_stream_open(stagingStr);
+    (*env)->ReleaseStringUTFChars(env, staging, stagingStr);
 
-    if (g_bridge_instance) {
-        LOGI("Deleting existing bridge instance");
-        (*env)->DeleteGlobalRef(env, g_bridge_instance);
+    if (!handle->stream) {
+        free(handle);
+        return 0;
     }
-    g_bridge_instance = (*env)->NewGlobalRef(env, thiz);
-    LOGI("Set g_bridge_instance to %p", g_bridge_instance);
+    return (jlong) (intptr_t) handle;
+}
 
-    // Configure the embed SAPI
-    php_embed_module.ub_write = capture_php_output;
-    php_embed_module.phpinfo_as_text = 1;
-    php_embed_module.php_ini_ignore = 0;
-
-    // Initialize PHP
-    if (php_embed_init(0, NULL) == SUCCESS) {
-        php_initialized = 1;
-        sapi_module.header_handler = php_embed_module.header_handler;
-        LOGI("PHP initialized successfully");
-    } else {
-        LOGI("PHP initialization failed");
+JNIEXPORT jboolean JNICALL native_stream_feed(JNIEnv *env, jobject thiz,
+                                              jlong jhandle, jbyteArray buffer, jint length) {
+    stream_handle *handle = (stream_handle *) (intptr_t) jhandle;
+    if (length <= 0) return JNI_TRUE;
+
+    if ((size_t) length > handle->capacity) {
+        unsigned char *grown = realloc(handle->buffer, (size_t) length);
+        if (!grown) return JNI_FALSE;
+        handle->buffer = grown;
+        handle->capacity = (size_t) length;
     }
+
+    (*env)->GetByteArrayRegion(env, buffer, 0, length, (jbyte *) handle->buffer);
+    if ((*env)->ExceptionCheck(env)) return JNI_FALSE;
+
+    int result = bundle_stream_feed(handle->stream, handle->buffer, (size_t) length);
+    return result == 0 ? JNI_TRUE : JNI_FALSE;
 }
 
+JNIEXPORT jint JNICALL native_stream_finish(JNIEnv *env, jobject thiz, jlong jhandle) {
+    stream_handle *handle = (stream_handle *) (intptr_t) jhandle;
+    int files = bundle_stream_finish(handle->stream, NULL);
+    free_stream_handle(handle);
+    return files;
+}
 
-JNIEXPORT jint JNICALL native_set_env(JNIEnv *env, jobject thiz,
-                                                            jstring name, jstring value,
-                                                            jint overwrite) {
+JNIEXPORT void JNICALL native_stream_abort(JNIEnv *env, jobject thiz, jlong jhandle) {
+    stream_handle *handle = (stream_handle *) (intptr_t) jhandle;
+    bundle_stream_abort(handle->stream);
+    free_stream_handle(handle);
+}
 
-    const char *nameStr = (*env)->GetStringUTFChars(env, name, NULL);
-    const char *valueStr = (*env)->GetStringUTFChars(env, value, NULL);
+JNIEXPORT jboolean JNICALL native_stream_commit(JNIEnv *env, jobject thiz,
+                                                jstring staging, jstring destination,
+                                                jobjectArray keep_paths) {
+    const char *stagingStr = (*env)->GetStringUTFChars(env, staging, NULL);
+    const char *destStr = (*env)->GetStringUTFChars(env, destination, NULL);
+    int keepCount = 0;
+    char **keepPaths = copy_string_array(env, keep_paths, &keepCount);
 
-    int result = setenv(nameStr, valueStr, overwrite);
+    int result = bundle_stream_commit(stagingStr, destStr, (const char *const *) keepPaths, keepCount);
 
-    (*env)->ReleaseStringUTFChars(env, name, nameStr);
-    (*env)->ReleaseStringUTFChars(env, value, valueStr);
+    (*env)->ReleaseStringUTFChars(env, staging, stagingStr);
+    (*env)->ReleaseStringUTFChars(env, destination, destStr);
+    free_string_array(keepPaths, keepCount);
 
-    return result;
+    return result == 0 ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL native_stream_recover(JNIEnv *env, jobject thiz,
+                                                 jstring staging, jstring destination,
+                                                 jobjectArray keep_paths) {
+    const char *stagingStr = (*env)->GetStringUTFChars(env, staging, NULL);
+    const char *destStr = (*env)->GetStringUTFChars(env, destination, NULL);
+    int keepCount = 0;
+    char **keepPaths = copy_string_array(env, keep_paths, &keepCount);
+
+    int recovered = bundle_stream_recover(stagingStr, destStr, (const char *const *) keepPaths, keepCount);
+
+    (*env)->ReleaseStringUTFChars(env, staging, stagingStr);
+    (*env)->ReleaseStringUTFChars(env, destination, destStr);
+    free_string_array(keepPaths, keepCount);
+
+    return recovered ? JNI_TRUE : JNI_FALSE;
 }
 
 JNIEXPORT void JNICALL native_set_request_info(JNIEnv *env, jobject thiz,
@@ -299,79 +366,55 @@ JNIEXPORT void JNICALL native_set_request_info(JNIEnv *env, jobject thiz,
     }
 }
 
-JNIEXPORT jstring JNICALL native_run_artisan_command(JNIEnv *env, jobject thiz, jstring jcommand) {
-    const char *command = (*env)->GetStringUTFChars(env, jcommand, NULL);
-    LOGI("🛠️ runArtisanCommand: %s", command);
-
-    clear_collected_output();
-    php_embed_module.ub_write = capture_php_output;
-    php_embed_module.phpinfo_as_text = 1;
-    php_embed_module.php_ini_ignore = 0;
-    php_embed_module.ini_entries = "display_errors=1\nimplicit_flush=1\noutput_buffering=0\n";
-
-    // Get Laravel path
+// Initializes the runtime and puts the Laravel root, the parent of
+// getLaravelPublicPath(), in `base_path`. Returns -1 if it doesn't fit.
+static int prepare_laravel_root(JNIEnv *env, jobject thiz, char *base_path, size_t size) {
     jclass cls = (*env)->GetObjectClass(env, thiz);
     jmethodID method = (*env)->GetMethodID(env, cls, "getLaravelPublicPath", "()Ljava/lang/String;");
     jstring jLaravelPath = (jstring)(*env)->CallObjectMethod(env, thiz, method);
     const char *cLaravelPath = (*env)->GetStringUTFChars(env, jLaravelPath, NULL);
 
-    native_initialize(env, thiz);
+    int length = snprintf(base_path, size, "%s/..", cLaravelPath);
 
-    char artisanPath[1024];
-    snprintf(artisanPath, sizeof(artisanPath), "%s/../artisan.php", cLaravelPath);
-    char basePath[1024];
-    snprintf(basePath, sizeof(basePath), "%s/..", cLaravelPath);
-    chdir(basePath);
-    LOGI("✅ Changed CWD to Laravel base: %s", basePath);
-
-    // Tokenize command
-    char *argv[128];
-    int argc = 0;
-    argv[argc++] = "php";
-
-    char *commandCopy = strdup(command);
-    char *token = strtok(commandCopy, " ");
-    while (token && argc < 127) {
-        argv[argc++] = token;
-        token = strtok(NULL, " ");
-    }
-    argv[argc] = NULL;
+    (*env)->ReleaseStringUTFChars(env, jLaravelPath, cLaravelPath);
+    (*env)->DeleteLocalRef(env, jLaravelPath);
 
-    if (php_initialized) {
-        php_embed_shutdown();
-        php_initialized = 0;
+    if (length < 0 || (size_t) length >= size) {
+        LOGE("Laravel path too long");
+        return -1;
     }
 
-    setenv("APP_RUNNING_IN_CONSOLE", "true", 1);
-    setenv("PHP_SELF", "artisan.php", 1);
-    setenv("APP_ENV", "local", 1);
-    setenv("APP_DEBUG", "true", 1);
-
-    if (php_embed_init(argc, argv) == SUCCESS) {
-        php_initialized = 1;
-
-        // Force STDOUT/STDERR through php://output so Symfony StreamOutput works
-        zend_eval_string(
-                "if (!defined('STDOUT')) define('STDOUT', fopen('php://output', 'w')); "
-                "if (!defined('STDERR')) define('STDERR', fopen('php://output', 'w'));",
-                NULL, "patch_stdio"
-        );
-
-        zend_file_handle file_handle;
-        zend_stream_init_filename(&file_handle, artisanPath);
-        php_execute_script(&file_handle);
-        php_embed_shutdown();
-        php_initialized = 0;
-    } else {
-        LOGE("❌ Failed to initialize PHP runtime");
+    native_initialize(env, thiz);
+    return 0;
+}
+
+JNIEXPORT jstring JNICALL native_run_artisan_command(JNIEnv *env, jobject thiz, jstring jcommand) {
+    char basePath[1024];
+    if (prepare_laravel_root(env, thiz, basePath, sizeof(basePath)) != 0) {
+        return (*env)->NewStringUTF(env, "");
     }
 
+    const char *command = (*env)->GetStringUTFChars(env, jcommand, NULL);
+    char *output = php_runtime_run_artisan(basePath, command);
     (*env)->ReleaseStringUTFChars(env, jcommand, command);
-    (*env)->ReleaseStringUTFChars(env, jLaravelPath, cLaravelPath);
-    (*env)->DeleteLocalRef(env, jLaravelPath);
-    free(commandCopy);
 
-    return (*env)->NewStringUTF(env, g_collected_output ? g_collected_output : "");
+    jstring result = (*env)->NewStringUTF(env, output ? output : "");
+    bridge_free(output);
+    return result;
+}
+
+// Native action results queued since the last request, straight to Laravel's dispatcher
+JNIEXPORT jstring JNICALL native_dispatch_events(JNIEnv *env, jobject thiz) {
+    if (native_actions_completed() == 0) return NULL;
+
+    char basePath[1024];
+    if (prepare_laravel_root(env, thiz, basePath, sizeof(basePath)) != 0) return NULL;
+
+    char *output = php_runtime_dispatch_events(basePath);
+
+    jstring result = output ? (*env)->NewStringUTF(env, output) : NULL;
+    bridge_free(output);
+    return result;
 }
 
 JNIEXPORT jstring JNICALL native_get_laravel_root_path(JNIEnv *env, jobject thiz) {
@@ -420,10 +463,12 @@ JNIEXPORT jstring JNICALL native_handle_request_once(
 
     char *output = run_php_script_once(path, method, uri, post);
 
+    uint64_t convert_start = trace_now();
     jstring result = (*env)->NewStringUTF(env, output ? output : "");
+    request_timing_add(REQUEST_PHASE_OUTPUT, trace_now() - convert_start);
 
     // Clean up
-    free(output);
+    bridge_free(output);
     (*env)->ReleaseStringUTFChars(env, jMethod, method);
     (*env)->ReleaseStringUTFChars(env, jUri, uri);
     (*env)->ReleaseStringUTFChars(env, jScriptPath, path);
@@ -469,9 +514,8 @@ JNIEXPORT jstring JNICALL native_get_laravel_public_path(JNIEnv *env, jobject th
 }
 
 JNIEXPORT void JNICALL native_shutdown(JNIEnv *env, jobject thiz) {
-    if (php_initialized) {
-        php_embed_shutdown();
-        php_initialized = 0;
+    if (php_runtime_is_started()) {
+        php_runtime_stop();
 
         if (g_callback_obj) {
             (*env)->DeleteGlobalRef(env, g_callback_obj);
@@ -485,27 +529,160 @@ JNIEXPORT void JNICALL native_shutdown(JNIEnv *env, jobject thiz) {
         }
 
         // Free the collected output buffer
-        if (g_collected_output) {
-            free(g_collected_output);
-            g_collected_output = NULL;
-            g_collected_length = 0;
-            g_collected_capacity = 0;
-        }
+        php_runtime_free_output();
     }
 }
 
 JNIEXPORT jstring JNICALL native_execute_script(JNIEnv *env, jobject thiz, jstring filename) {
     const char *phpFilePath = (*env)->GetStringUTFChars(env, filename, NULL);
+    const char *output = php_runtime_execute(phpFilePath);
+    (*env)->ReleaseStringUTFChars(env, filename, phpFilePath);
 
-    zend_file_handle file_handle;
-    zend_stream_init_filename(&file_handle, phpFilePath);
+    // Return collected output
+    return (*env)->NewStringUTF(env, output);
+}
 
-    php_execute_script(&file_handle);
+JNIEXPORT jboolean JNICALL native_trace_start(JNIEnv *env, jobject thiz, jstring path) {
+    const char *pathStr = (*env)->GetStringUTFChars(env, path, NULL);
+    int result = trace_start(pathStr);
+    (*env)->ReleaseStringUTFChars(env, path, pathStr);
+    return result == 0 ? JNI_TRUE : JNI_FALSE;
+}
 
-    (*env)->ReleaseStringUTFChars(env, filename, phpFilePath);
+JNIEXPORT void JNICALL native_trace_stop(JNIEnv *env, jobject thiz) {
+    trace_stop();
+}
 
-    // Return collected output
-    return (*env)->NewStringUTF(env, g_collected_output ? g_collected_output : "");
+JNIEXPORT void JNICALL native_trace_flush(JNIEnv *env, jobject thiz) {
+    trace_flush();
+}
+
+JNIEXPORT void JNICALL native_trace_span(JNIEnv *env, jobject thiz, jstring name, jstring category,
+                                         jlong start_ns, jlong end_ns) {
+    if (!trace_enabled()) return;
+
+    const char *nameStr = (*env)->GetStringUTFChars(env, name, NULL);
+    // Categories are a handful of Kotlin literals; keep one copy of each
+    const char *categoryStr = (*env)->GetStringUTFChars(env, category, NULL);
+    const char *interned = trace_intern(categoryStr);
+    (*env)->ReleaseStringUTFChars(env, category, categoryStr);
+
+    trace_complete(nameStr, interned, (uint64_t) start_ns, (uint64_t) end_ns, 1);
+    (*env)->ReleaseStringUTFChars(env, name, nameStr);
+}
+
+// A native action finished, on whatever thread the platform finished it
+JNIEXPORT jboolean JNICALL native_action_complete(JNIEnv *env, jobject thiz, jlong handle, jstring event,
+                                                  jstring payload, jint code) {
+    const char *eventStr = (*env)->GetStringUTFChars(env, event, NULL);
+    const char *payloadStr = (*env)->GetStringUTFChars(env, payload, NULL);
+    int result = native_actions_complete((uint64_t) handle, eventStr, payloadStr, code);
+    (*env)->ReleaseStringUTFChars(env, payload, payloadStr);
+    (*env)->ReleaseStringUTFChars(env, event, eventStr);
+    return result == 0 ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL native_action_in_flight(JNIEnv *env, jobject thiz) {
+    return (jint) native_actions_in_flight();
+}
+
+JNIEXPORT jint JNICALL native_action_completed(JNIEnv *env, jobject thiz) {
+    return (jint) native_actions_completed();
+}
+
+JNIEXPORT void JNICALL native_action_coalesce(JNIEnv *env, jobject thiz, jstring event, jint mode, jint window_ms) {
+    const char *eventStr = (*env)->GetStringUTFChars(env, event, NULL);
+    native_actions_coalesce(eventStr, (native_coalesce_mode) mode, (unsigned) window_ms);
+    (*env)->ReleaseStringUTFChars(env, event, eventStr);
+}
+
+JNIEXPORT void JNICALL native_action_set_limit(JNIEnv *env, jobject thiz, jint limit) {
+    native_actions_set_limit((size_t) limit);
+}
+
+// In native_action_stats field order
+JNIEXPORT jlongArray JNICALL native_action_get_stats(JNIEnv *env, jobject thiz) {
+    native_action_stats stats;
+    native_actions_stats(&stats);
+    jlong out[] = {
+            (jlong) stats.completed, (jlong) stats.coalesced, (jlong) stats.dropped,
+            (jlong) stats.delivered, (jlong) stats.batches, (jlong) stats.queued,
+            (jlong) stats.queued_peak, (jlong) stats.wait_max_ns, (jlong) stats.wait_total_ns
+    };
+
+    jlongArray result = (*env)->NewLongArray(env, sizeof(out) / sizeof(out[0]));
+    if (result) (*env)->SetLongArrayRegion(env, result, 0, sizeof(out) / sizeof(out[0]), out);
+    return result;
+}
+
+// PHP-side phases of the request that just ran on this thread
+JNIEXPORT jlongArray JNICALL native_last_request_timings(JNIEnv *env, jobject thiz) {
+    uint64_t phases[REQUEST_PHASE_COUNT];
+    request_timing_get(phases);
+
+    jlong values[REQUEST_PHASE_COUNT];
+    for (int i = 0; i < REQUEST_PHASE_COUNT; i++) values[i] = (jlong) phases[i];
+
+    jlongArray result = (*env)->NewLongArray(env, REQUEST_PHASE_COUNT);
+    if (result) (*env)->SetLongArrayRegion(env, result, 0, REQUEST_PHASE_COUNT, values);
+    return result;
+}
+
+// Memory figures of the request that just ran on this thread, indexed by request_memory_field
+JNIEXPORT jlongArray JNICALL native_last_request_memory(JNIEnv *env, jobject thiz) {
+    int64_t values[REQUEST_MEMORY_COUNT];
+    request_memory_get(values);
+
+    jlong out[REQUEST_MEMORY_COUNT];
+    for (int i = 0; i < REQUEST_MEMORY_COUNT; i++) out[i] = (jlong) values[i];
+
+    jlongArray result = (*env)->NewLongArray(env, REQUEST_MEMORY_COUNT);
+    if (result) (*env)->SetLongArrayRegion(env, result, 0, REQUEST_MEMORY_COUNT, out);
+    return result;
+}
+
+JNIEXPORT void JNICALL native_record_request_timing(JNIEnv *env, jobject thiz,
+                                                    jstring method, jstring uri, jlongArray timings) {
+    if ((*env)->GetArrayLength(env, timings) != REQUEST_PHASE_COUNT) return;
+
+    jlong values[REQUEST_PHASE_COUNT];
+    (*env)->GetLongArrayRegion(env, timings, 0, REQUEST_PHASE_COUNT, values);
+    uint64_t phases[REQUEST_PHASE_COUNT];
+    for (int i = 0; i < REQUEST_PHASE_COUNT; i++) phases[i] = values[i] > 0 ? (uint64_t) values[i] : 0;
+
+    const char *methodStr = (*env)->GetStringUTFChars(env, method, NULL);
+    const char *uriStr = (*env)->GetStringUTFChars(env, uri, NULL);
+    char route[160];
+    request_route_key(methodStr, uriStr, route, sizeof(route));
+    (*env)->ReleaseStringUTFChars(env, method, methodStr);
+    (*env)->ReleaseStringUTFChars(env, uri, uriStr);
+
+    request_stats_record(route, phases);
+}
+
+JNIEXPORT jstring JNICALL native_request_metrics(JNIEnv *env, jobject thiz) {
+    char *json = request_stats_json();
+    jstring result = (*env)->NewStringUTF(env, json ? json : "{}");
+    free(json);
+    return result;
+}
+
+JNIEXPORT void JNICALL native_set_profiling(JNIEnv *env, jobject thiz, jboolean enabled, jstring directory) {
+    const char *dir = (*env)->GetStringUTFChars(env, directory, NULL);
+    profiler_set_enabled(enabled == JNI_TRUE, dir);
+    (*env)->ReleaseStringUTFChars(env, directory, dir);
+}
+
+JNIEXPORT void JNICALL native_set_sampling(JNIEnv *env, jobject thiz, jint hz, jint window_ms, jstring directory) {
+    const char *dir = (*env)->GetStringUTFChars(env, directory, NULL);
+    sampler_configure(hz, window_ms, dir);
+    (*env)->ReleaseStringUTFChars(env, directory, dir);
+}
+
+JNIEXPORT void JNICALL native_profile_next_request(JNIEnv *env, jobject thiz, jstring directory) {
+    const char *dir = (*env)->GetStringUTFChars(env, directory, NULL);
+    profiler_profile_next(dir);
+    (*env)->ReleaseStringUTFChars(env, directory, dir);
 }
 
 static JNINativeMethod gMethods[] = {
@@ -515,8 +692,16 @@ static JNINativeMethod gMethods[] = {
         {"shutdown", "()V", (void *) native_shutdown},
         {"setRequestInfo", "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;)V", (void *) native_set_request_info},
         {"runArtisanCommand", "(Ljava/lang/String;)Ljava/lang/String;", (void *) native_run_artisan_command},
+        {"nativeDispatchEvents", "()Ljava/lang/String;", (void *) native_dispatch_events},
         {"getLaravelPublicPath", "()Ljava/lang/String;", (void *) native_get_laravel_public_path},
         {"getLaravelRootPath", "()Ljava/lang/String;", (void *) native_get_laravel_root_path},
+        {"nativeLastRequestTimings", "()[J", (void *) native_last_request_timings},
+        {"nativeLastRequestMemory", "()[J", (void *) native_last_request_memory},
+        {"nativeRecordRequestTiming", "(Ljava/lang/String;Ljava/lang/String;[J)V", (void *) native_record_request_timing},
+        {"nativeRequestMetrics", "()Ljava/lang/String;", (void *) native_request_metrics},
+        {"nativeSetProfiling", "(ZLjava/lang/String;)V", (void *) native_set_profiling},
+        {"nativeProfileNextRequest", "(Ljava/lang/String;)V", (void *) native_profile_next_request},
+        {"nativeSetSampling", "(IILjava/lang/String;)V", (void *) native_set_sampling},
 
         // LaravelEnvironment
         {"nativeSetEnv", "(Ljava/lang/String;Ljava/lang/String;I)I", (void *) native_set_env},
@@ -524,7 +709,9 @@ static JNINativeMethod gMethods[] = {
 };
 
 JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+    TRACE_SCOPE("JNI_OnLoad", "jni");
     g_jvm = vm;
+    php_runtime_install();
 
     JNIEnv *env;
     if ((*vm)->GetEnv(vm, (void **) &env, JNI_VERSION_1_6) != JNI_OK) {
@@ -541,6 +728,12 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
         return JNI_ERR;
     }
 
+    // Resolve the PHPBridge methods the native actions call, once
+    int unresolved = native_bridge_resolve(env, phpBridgeClass);
+    if (unresolved > 0) {
+        LOGE("❌ %d native actions unavailable", unresolved);
+    }
+
     // Register native methods for LaravelEnvironment
     jclass laravelEnvClass = (*env)->FindClass(env, "com/shane/ota/bridge/LaravelEnvironment");
     if (laravelEnvClass == NULL) {
@@ -548,12 +741,61 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
     }
 
     static JNINativeMethod envMethods[] = {
-            {"nativeSetEnv", "(Ljava/lang/String;Ljava/lang/String;I)I", (void *) native_set_env}
+            {"nativeSetEnv", "(Ljava/lang/String;Ljava/lang/String;I)I", (void *) native_set_env},
+            {"nativeExtractBundle", "(IJJLjava/lang/String;IZ[Ljava/lang/String;Z[Ljava/lang/String;)I", (void *) native_extract_bundle},
+            {"nativeMountBundle", "(IJJLjava/lang/String;[Ljava/lang/String;)Z", (void *) native_mount_bundle},
+            {"nativeLoadBundleMeta", "(IJJ)Z", (void *) native_load_bundle_meta},
+            {"nativeBundleEnvValue", "(Ljava/lang/String;)Ljava/lang/String;", (void *) native_bundle_env_value},
+            {"nativeBundleVersion", "()Ljava/lang/String;", (void *) native_bundle_version},
+            {"nativeBundleFiles", "()[Ljava/lang/String;", (void *) native_bundle_files},
+            {"nativeApplyDelta", "(Ljava/lang/String;Ljava/lang/String;)I", (void *) native_apply_delta},
+            {"nativeStreamOpen", "(Ljava/lang/String;)J", (void *) native_stream_open},
+            {"nativeStreamFeed", "(J[BI)Z", (void *) native_stream_feed},
+            {"nativeStreamFinish", "(J)I", (void *) native_stream_finish},
+            {"nativeStreamAbort", "(J)V", (void *) native_stream_abort},
+            {"nativeStreamCommit", "(Ljava/lang/String;Ljava/lang/String;[Ljava/lang/String;)Z", (void *) native_stream_commit},
+            {"nativeStreamRecover", "(Ljava/lang/String;Ljava/lang/String;[Ljava/lang/String;)Z", (void *) native_stream_recover}
     };
 
     if ((*env)->RegisterNatives(env, laravelEnvClass, envMethods, sizeof(envMethods) / sizeof(envMethods[0])) != 0) {
         return JNI_ERR;
     }
 
+    // Register native methods for NativeTrace
+    jclass traceClass = (*env)->FindClass(env, "com/shane/ota/bridge/NativeTrace");
+    if (traceClass == NULL) {
+        return JNI_ERR;
+    }
+
+    static JNINativeMethod traceMethods[] = {
+            {"nativeStart", "(Ljava/lang/String;)Z", (void *) native_trace_start},
+            {"nativeStop", "()V", (void *) native_trace_stop},
+            {"nativeFlush", "()V", (void *) native_trace_flush},
+            {"nativeSpan", "(Ljava/lang/String;Ljava/lang/String;JJ)V", (void *) native_trace_span}
+    };
+
+    if ((*env)->RegisterNatives(env, traceClass, traceMethods, sizeof(traceMethods) / sizeof(traceMethods[0])) != 0) {
+        return JNI_ERR;
+    }
+
+    // Register native methods for NativeActionBus
+    jclass busClass = (*env)->FindClass(env, "com/shane/ota/bridge/NativeActionBus");
+    if (busClass == NULL) {
+        return JNI_ERR;
+    }
+
+    static JNINativeMethod busMethods[] = {
+            {"nativeComplete", "(JLjava/lang/String;Ljava/lang/String;I)Z", (void *) native_action_complete},
+            {"nativeInFlight", "()I", (void *) native_action_in_flight},
+            {"nativeCompleted", "()I", (void *) native_action_completed},
+            {"nativeCoalesce", "(Ljava/lang/String;II)V", (void *) native_action_coalesce},
+            {"nativeSetLimit", "(I)V", (void *) native_action_set_limit},
+            {"nativeStats", "()[J", (void *) native_action_get_stats}
+    };
+
+    if ((*env)->RegisterNatives(env, busClass, busMethods, sizeof(busMethods) / sizeof(busMethods[0])) != 0) {
+        return JNI_ERR;
+    }
+
     return JNI_VERSION_1_6;
 }
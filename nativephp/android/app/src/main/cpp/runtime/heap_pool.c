@@ -0,0 +1,134 @@
+#include "heap_pool.h"
+
+#include <php.h>
+#include <zend_alloc.h>
+#include <zend_virtual_cwd.h>
+#include <android/log.h>
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define LOG_TAG "HeapPool"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static void *g_pool[HEAP_POOL_RETAIN_CHUNKS];
+static size_t g_pooled = 0;
+static int g_warmed = 0;
+
+static void *map_aligned(size_t size, size_t alignment) {
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return NULL;
+    if (((uintptr_t) ptr & (alignment - 1)) == 0) return ptr;
+
+    // Over-allocate and trim to the alignment, as zend_alloc does itself
+    munmap(ptr, size);
+    ptr = mmap(NULL, size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return NULL;
+
+    size_t offset = alignment - ((uintptr_t) ptr & (alignment - 1));
+    if (offset == alignment) offset = 0;
+    if (offset) munmap(ptr, offset);
+    if (alignment - offset) munmap((char *) ptr + offset + size, alignment - offset);
+    return (char *) ptr + offset;
+}
+
+static void prefault(void *chunk) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < ZEND_MM_CHUNK_SIZE; i += page) {
+        ((volatile char *) chunk)[i] = 0;
+    }
+}
+
+static void warm(void) {
+    for (int i = 0; i < HEAP_POOL_WARM_CHUNKS && g_pooled < HEAP_POOL_RETAIN_CHUNKS; i++) {
+        void *chunk = map_aligned(ZEND_MM_CHUNK_SIZE, ZEND_MM_CHUNK_SIZE);
+        if (!chunk) break;
+        prefault(chunk);
+        g_pool[g_pooled++] = chunk;
+    }
+}
+
+static void *pool_chunk_alloc(zend_mm_storage *storage, size_t size, size_t alignment) {
+    (void) storage;
+    if (size == ZEND_MM_CHUNK_SIZE && alignment == ZEND_MM_CHUNK_SIZE) {
+        pthread_mutex_lock(&g_lock);
+        void *chunk = g_pooled ? g_pool[--g_pooled] : NULL;
+        pthread_mutex_unlock(&g_lock);
+        if (chunk) return chunk;
+    }
+    // Huge blocks are rarely the same size twice; map them directly
+    return map_aligned(size, alignment);
+}
+
+static void pool_chunk_free(zend_mm_storage *storage, void *chunk, size_t size) {
+    (void) storage;
+    if (size == ZEND_MM_CHUNK_SIZE) {
+        pthread_mutex_lock(&g_lock);
+        int kept = g_pooled < HEAP_POOL_RETAIN_CHUNKS;
+        if (kept) g_pool[g_pooled++] = chunk;
+        pthread_mutex_unlock(&g_lock);
+        if (kept) return;
+    }
+    munmap(chunk, size);
+}
+
+static bool pool_chunk_truncate(zend_mm_storage *storage, void *chunk, size_t old_size, size_t new_size) {
+    (void) storage;
+    return munmap((char *) chunk + new_size, old_size - new_size) == 0;
+}
+
+static bool pool_chunk_extend(zend_mm_storage *storage, void *chunk, size_t old_size, size_t new_size) {
+    (void) storage;
+    // Only if the pages right after are free; otherwise Zend moves the block
+    void *want = (char *) chunk + old_size;
+    size_t grow = new_size - old_size;
+    void *got = mmap(want, grow, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (got == MAP_FAILED) return false;
+    if (got != want) {
+        munmap(got, grow);
+        return false;
+    }
+    return true;
+}
+
+static const zend_mm_handlers g_handlers = {
+        pool_chunk_alloc,
+        pool_chunk_free,
+        pool_chunk_truncate,
+        pool_chunk_extend,
+};
+
+void heap_pool_attach(void) {
+    // USE_ZEND_ALLOC=0 or a debug heap: leave it alone
+    if (!is_zend_mm()) return;
+
+    pthread_mutex_lock(&g_lock);
+    if (!g_warmed) {
+        warm();
+        g_warmed = 1;
+        LOGI("Pre-faulted %zu heap chunks", g_pooled);
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    zend_mm_heap *heap = zend_mm_startup_ex(&g_handlers, NULL, 0);
+    if (!heap) {
+        LOGE("Cannot start a pooled heap, staying on the default one");
+        return;
+    }
+    zend_mm_heap *startup_heap = zend_mm_set_heap(heap);
+
+    // virtual_cwd_activate() copied the cwd into the startup heap after it was reset
+    if (CWDG(cwd).cwd) {
+        char *cwd = emalloc(CWDG(cwd).cwd_length + 1);
+        memcpy(cwd, CWDG(cwd).cwd, CWDG(cwd).cwd_length + 1);
+        CWDG(cwd).cwd = cwd;
+    }
+    zend_mm_shutdown(startup_heap, true, true);
+
+    // memory_limit was applied to the startup heap while INI was parsed
+    zend_set_memory_limit(PG(memory_limit));
+}
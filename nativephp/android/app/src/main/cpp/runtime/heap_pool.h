@@ -0,0 +1,31 @@
+#ifndef HEAP_POOL_H
+#define HEAP_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Warm chunk pool behind the Zend MM heap ===
+//
+// The engine is started and torn down for every request, and each time the
+// Zend heap maps fresh 2 MB chunks and faults their pages in again as the
+// request touches them. This keeps chunks the heap gives back in a pool
+// instead, pages still resident, and hands them out again on the next start.
+//
+// The pool holds at most HEAP_POOL_RETAIN_CHUNKS; anything given back above
+// that goes straight back to the OS, so the memory kept between requests is
+// bounded. The first engine start pre-faults HEAP_POOL_WARM_CHUNKS.
+
+#define HEAP_POOL_RETAIN_CHUNKS 8
+#define HEAP_POOL_WARM_CHUNKS 4
+
+// Right after php_module_startup(): moves the engine onto a heap whose chunks
+// come from the pool. Startup has just reset the heap, so the only block still
+// live in it (the cwd copy) is carried over.
+void heap_pool_attach(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HEAP_POOL_H
@@ -0,0 +1,98 @@
+#include "host_http.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+void host_cookie_jar_clear(host_cookie_jar *jar) {
+    for (int i = 0; i < jar->count; i++) free(jar->values[i]);
+    memset(jar, 0, sizeof(*jar));
+}
+
+static int find_cookie(const host_cookie_jar *jar, const char *name, size_t length) {
+    for (int i = 0; i < jar->count; i++) {
+        if (strlen(jar->names[i]) == length && strncmp(jar->names[i], name, length) == 0) return i;
+    }
+    return -1;
+}
+
+const char *host_cookie_jar_get(const host_cookie_jar *jar, const char *name) {
+    int slot = find_cookie(jar, name, strlen(name));
+    return slot < 0 ? NULL : jar->values[slot];
+}
+
+// "name=value; Path=/; HttpOnly", `length` bytes of it
+static void set_cookie(host_cookie_jar *jar, const char *line, size_t length) {
+    const char *equals = memchr(line, '=', length);
+    if (!equals || equals == line) return;
+    size_t name_length = (size_t) (equals - line);
+    if (name_length >= sizeof(jar->names[0])) return;
+    const char *value = equals + 1;
+    size_t rest = length - name_length - 1;
+    const char *end = memchr(value, ';', rest);
+    size_t value_length = end ? (size_t) (end - value) : rest;
+
+    int slot = find_cookie(jar, line, name_length);
+    if (slot < 0) {
+        if (jar->count == HOST_HTTP_MAX_COOKIES) return;
+        slot = jar->count++;
+        memcpy(jar->names[slot], line, name_length);
+        jar->names[slot][name_length] = '\0';
+    } else {
+        free(jar->values[slot]);
+    }
+    jar->values[slot] = strndup(value, value_length);
+}
+
+char *host_cookie_jar_header(const host_cookie_jar *jar) {
+    if (jar->count == 0) return NULL;
+
+    size_t size = 1;
+    for (int i = 0; i < jar->count; i++) size += strlen(jar->names[i]) + strlen(jar->values[i]) + 3;
+    char *header = malloc(size);
+    if (!header) return NULL;
+    size_t used = 0;
+    for (int i = 0; i < jar->count; i++) {
+        used += (size_t) snprintf(header + used, size - used, "%s%s=%s", i ? "; " : "", jar->names[i], jar->values[i]);
+    }
+    return header;
+}
+
+// "HTTP/1.1 200 OK\r\nName: value\r\n...\r\n\r\n<body>"
+void host_response_parse(host_response *response, host_cookie_jar *jar) {
+    const char *raw = response->raw ? response->raw : "";
+    response->status = 0;
+    response->body = raw;
+    if (strncmp(raw, "HTTP/", 5) != 0) return;
+
+    const char *space = strchr(raw, ' ');
+    if (space) response->status = atoi(space + 1);
+
+    const char *end = strstr(raw, "\r\n\r\n");
+    response->body = end ? end + 4 : raw + strlen(raw);
+    if (!jar) return;
+
+    for (const char *line = strstr(raw, "\r\n"); line && line + 2 < response->body; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, "Set-Cookie:", 11) == 0) {
+            const char *value = line + 11;
+            while (*value == ' ') value++;
+            const char *line_end = strstr(value, "\r\n");
+            set_cookie(jar, value, line_end ? (size_t) (line_end - value) : strlen(value));
+        }
+    }
+}
+
+void host_header_env_name(const char *name, size_t length, char *out, size_t size) {
+    size_t used = (size_t) snprintf(out, size, "HTTP_");
+    for (size_t i = 0; i < length && used + 1 < size; i++) {
+        out[used++] = name[i] == '-' ? '_' : (char) toupper((unsigned char) name[i]);
+    }
+    out[used] = '\0';
+}
+
+void host_set_env(const char *name, const char *value) {
+    if (value) setenv(name, value, 1); else unsetenv(name);
+}
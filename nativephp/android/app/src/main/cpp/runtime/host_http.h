@@ -0,0 +1,52 @@
+#ifndef HOST_HTTP_H
+#define HOST_HTTP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === What the host drivers keep between requests, as a browser would ===
+//
+// The cookies the app set, sent back as HTTP_COOKIE, and the raw responses
+// the runtime returns picked apart. Shared by php_runtime_cli,
+// php_runtime_bench and traffic_replay.
+
+#define HOST_HTTP_MAX_COOKIES 16
+
+typedef struct {
+    char names[HOST_HTTP_MAX_COOKIES][128];
+    char *values[HOST_HTTP_MAX_COOKIES];
+    int count;
+} host_cookie_jar;
+
+typedef struct {
+    int status;        // 0 if the output had no status line
+    char *raw;         // as the runtime returned it; bridge_free()
+    const char *body;  // into raw
+    uint64_t ns;
+} host_response;
+
+void host_cookie_jar_clear(host_cookie_jar *jar);
+// The cookie's value as set, still URL-encoded. NULL if it isn't set.
+const char *host_cookie_jar_get(const host_cookie_jar *jar, const char *name);
+// "a=1; b=2" to send back, NULL if the jar is empty. Caller frees.
+char *host_cookie_jar_header(const host_cookie_jar *jar);
+
+// Status and body from the raw output; Set-Cookie headers go into `jar` if given.
+void host_response_parse(host_response *response, host_cookie_jar *jar);
+
+// "X-Requested-With" (the first `length` bytes of `name`) to HTTP_X_REQUESTED_WITH,
+// the variable PHPBridge passes that header in
+void host_header_env_name(const char *name, size_t length, char *out, size_t size);
+
+// setenv(), or unsetenv() for a NULL value
+void host_set_env(const char *name, const char *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_HTTP_H
@@ -0,0 +1,73 @@
+#include "native_functions.h"
+#include "../native/native_actions.h"
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_nativephp_call, 0, 1, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO(0, action, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, args, IS_STRING, 0, "'{}'")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_nativephp_events, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+#define arginfo_nativephp_event_stats arginfo_nativephp_events
+
+PHP_FUNCTION(nativephp_call) {
+    zend_string *action;
+    zend_string *args = NULL;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_STR(action)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR(args)
+    ZEND_PARSE_PARAMETERS_END();
+
+    uint64_t handle = native_actions_begin(ZSTR_VAL(action), args ? ZSTR_VAL(args) : NULL, NULL);
+    RETURN_LONG((zend_long) handle);
+}
+
+PHP_FUNCTION(nativephp_events) {
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    size_t count;
+    native_action_result *results = native_actions_take(&count);
+    array_init_size(return_value, (uint32_t) count);
+
+    for (size_t i = 0; i < count; i++) {
+        zval entry;
+        array_init_size(&entry, 7);
+        add_assoc_long(&entry, "handle", (zend_long) results[i].handle);
+        add_assoc_string(&entry, "action", results[i].action);
+        add_assoc_string(&entry, "event", results[i].event);
+        add_assoc_string(&entry, "payload", results[i].payload);
+        add_assoc_long(&entry, "code", results[i].code);
+        add_assoc_long(&entry, "count", (zend_long) results[i].count);
+        add_assoc_bool(&entry, "batch", results[i].batch);
+        add_next_index_zval(return_value, &entry);
+    }
+    native_actions_free(results, count);
+}
+
+PHP_FUNCTION(nativephp_event_stats) {
+    ZEND_PARSE_PARAMETERS_NONE();
+
+    native_action_stats stats;
+    native_actions_stats(&stats);
+    array_init_size(return_value, 10);
+    add_assoc_long(return_value, "completed", (zend_long) stats.completed);
+    add_assoc_long(return_value, "coalesced", (zend_long) stats.coalesced);
+    add_assoc_long(return_value, "dropped", (zend_long) stats.dropped);
+    add_assoc_long(return_value, "delivered", (zend_long) stats.delivered);
+    add_assoc_long(return_value, "batches", (zend_long) stats.batches);
+    add_assoc_long(return_value, "queued", (zend_long) stats.queued);
+    add_assoc_long(return_value, "queued_peak", (zend_long) stats.queued_peak);
+    add_assoc_double(return_value, "wait_max_ms", stats.wait_max_ns / 1e6);
+    add_assoc_double(return_value, "wait_mean_ms",
+                     stats.delivered ? stats.wait_total_ns / 1e6 / (double) stats.delivered : 0.0);
+}
+
+const zend_function_entry native_php_functions[] = {
+        ZEND_FE(nativephp_call, arginfo_nativephp_call)
+        ZEND_FE(nativephp_events, arginfo_nativephp_events)
+        ZEND_FE(nativephp_event_stats, arginfo_nativephp_event_stats)
+        ZEND_FE_END
+};
@@ -0,0 +1,32 @@
+#ifndef NATIVE_FUNCTIONS_H
+#define NATIVE_FUNCTIONS_H
+
+#include <php.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === PHP functions the runtime adds to the engine ===
+//
+// Registered as the embed SAPI's additional functions, so they exist in every
+// request without an extension:
+//
+//     nativephp_call(string $action, string $args = '{}'): int
+//         starts a native action, returns its handle or 0 if it couldn't start
+//     nativephp_events(): array
+//         completed actions since the last call, oldest first, each
+//         ['handle' => int, 'action' => string, 'event' => string,
+//          'payload' => string (JSON), 'code' => int, 'count' => int]
+//         where count is how many coalesced events the result stands for
+//     nativephp_event_stats(): array
+//         the queue's backpressure figures: completed, coalesced, dropped,
+//         delivered, batches, queued, queued_peak, wait_max_ms, wait_mean_ms
+
+extern const zend_function_entry native_php_functions[];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NATIVE_FUNCTIONS_H
@@ -0,0 +1,522 @@
+#include "php_runtime.h"
+#include "heap_pool.h"
+#include "native_functions.h"
+#include "../PHP.h"
+#include "../bundle/bundle_archive.h"
+#include "../native/native_actions.h"
+#include "../trace/profiler.h"
+#include "../trace/request_memory.h"
+#include "../trace/request_timing.h"
+#include "../trace/sampler.h"
+#include "../trace/trace.h"
+
+#include <android/log.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOG_TAG "PHP-Native"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+static int php_initialized = 0;
+static char *g_collected_output = NULL;
+static size_t g_collected_length = 0;
+static size_t g_collected_capacity = 0;
+
+#define BUFFER_CHUNK_SIZE (256 * 1024)  // 256KB increments
+#define MAX_BUFFER_SIZE (16 * 1024 * 1024)  // 16MB max buffer
+
+void clear_collected_output() {
+    if (g_collected_output) {
+        bridge_free(g_collected_output);
+        g_collected_output = NULL;
+    }
+
+    g_collected_capacity = BUFFER_CHUNK_SIZE;
+    g_collected_length = 0;
+    g_collected_output = (char *) bridge_malloc(g_collected_capacity);
+    if (g_collected_output) {
+        g_collected_output[0] = '\0';
+    }
+}
+
+
+void pipe_php_output(const char *str) {
+
+//    LOGI("PIPE: Output received: %s", str);
+
+    // Safety check
+    if (!g_collected_output) {
+        clear_collected_output();
+        return;  // Failed to allocate
+    }
+
+    size_t length = strlen(str);
+
+    // Check if we need more space
+    if (g_collected_length + length + 1 > g_collected_capacity) {
+        // Calculate new size in chunks
+        size_t needed_capacity = g_collected_capacity;
+        while (needed_capacity < g_collected_length + length + 1) {
+            needed_capacity += BUFFER_CHUNK_SIZE;
+        }
+
+        // Enforce maximum size limit
+        if (needed_capacity > MAX_BUFFER_SIZE) {
+            LOGE("Output buffer exceeded maximum size of %d MB", MAX_BUFFER_SIZE / (1024 * 1024));
+            // Just return and drop output beyond this point
+            return;
+        }
+
+        // Reallocate with the new size
+        char *new_buffer = (char *) bridge_realloc(g_collected_output, needed_capacity);
+        if (new_buffer) {
+            g_collected_output = new_buffer;
+            g_collected_capacity = needed_capacity;
+        } else {
+            LOGE("Failed to reallocate output buffer to %zu bytes", needed_capacity);
+            return;  // Failed to reallocate
+        }
+    }
+
+    // Append the string
+    strcpy(g_collected_output + g_collected_length, str);
+    g_collected_length += length;
+}
+
+void cleanup_output_buffer() {
+    if (g_collected_output) {
+        g_collected_output[0] = '\0';
+        g_collected_length = 0;
+    }
+}
+
+size_t capture_php_output(const char *str, size_t str_length) {
+    uint64_t start = trace_now();
+
+    // Log the raw output coming from PHP
+//    LOGI("PHP output captured: length=%zu", str_length);
+    if (str_length > 0) {
+        // Log a preview of the output (first 100 chars or so)
+        char preview[10001] = {0};
+        strncpy(preview, str, str_length > 10000 ? 10000 : str_length);
+        preview[10000] = '\0'; // Ensure null termination
+    } else {
+        LOGI("Empty output received");
+    }
+
+    // Rest of your original code...
+    char *buffer = bridge_malloc(str_length + 1);
+    if (buffer) {
+        memcpy(buffer, str, str_length);
+        buffer[str_length] = '\0';
+
+        pipe_php_output(buffer);
+        bridge_free(buffer);
+    }
+
+    request_timing_add(REQUEST_PHASE_OUTPUT, trace_now() - start);
+    return str_length;
+}
+
+int android_header_handler(sapi_header_struct *sapi_header, sapi_header_op_enum op, sapi_headers_struct *sapi_headers) {
+    LOGI("📤 SAPI header: %s", sapi_header->header);
+    // You can collect headers here if you want
+    return 0;
+}
+
+// Replaces the embed SAPI's startup, which is php_module_startup() and nothing else
+static zend_result runtime_module_startup(sapi_module_struct *sapi) {
+    zend_result result = php_module_startup(sapi, profiler_startup_module());
+    if (result == SUCCESS) heap_pool_attach();
+    return result;
+}
+
+void php_runtime_install(void) {
+    php_embed_module.startup = runtime_module_startup;
+    // In requests and artisan runs alike
+    php_embed_module.additional_functions = native_php_functions;
+}
+
+// Laravel-relevant env vars for the request. Returns the query string, "" if none.
+static const char *set_request_env(const char *scriptPath, const char *method, const char *uri) {
+    setenv("REQUEST_URI", uri, 1);
+    setenv("REQUEST_METHOD", method, 1);
+    setenv("SCRIPT_FILENAME", scriptPath, 1);
+    setenv("PHP_SELF", "/native.php", 1);
+    setenv("HTTP_HOST", "127.0.0.1", 1);
+    setenv("APP_URL", "http://127.0.0.1", 1);
+    setenv("ASSET_URL", "http://127.0.0.1/_assets/", 1);
+    setenv("NATIVEPHP_RUNNING", "true", 1);
+
+    // ✅ Set QUERY_STRING and defer parsing
+    const char* query_start = strchr(uri, '?');
+    if (query_start && strlen(query_start + 1) > 0) {
+        setenv("QUERY_STRING", query_start + 1, 1);
+        LOGI("✅ Set QUERY_STRING: %s", query_start + 1);
+        return query_start + 1;
+    }
+    unsetenv("QUERY_STRING");
+    LOGI("⚠️ No QUERY_STRING found in URI");
+    return "";
+}
+
+static void parse_query_string(const char *query_string) {
+    if (strlen(query_string) == 0) return;
+    zend_string *query = zend_string_init(query_string, strlen(query_string), 0);
+    sapi_module.treat_data(PARSE_GET, query->val, NULL);
+    zend_string_free(query);
+}
+
+static void execute_request_script(const char *scriptPath) {
+    zend_file_handle fileHandle;
+    zend_stream_init_filename(&fileHandle, scriptPath);
+    // Actions completed since the last request report back before it runs
+    native_actions_run_callbacks();
+    trace_span execute_span = trace_span_begin("php_execute_script", "php", 0);
+    request_timing_execute_begin();
+    sampler_request_begin();
+    php_execute_script(&fileHandle);
+    sampler_request_end();
+    request_timing_execute_end();
+    trace_span_end(&execute_span);
+}
+
+static int g_prepend_sapi_headers = 0;
+
+void php_runtime_prepend_sapi_headers(int enabled) {
+    g_prepend_sapi_headers = enabled;
+}
+
+// The response as the host gets it. While the request is still open, since
+// the SAPI headers go with it.
+static char *copy_response(void) {
+    const char *output = g_collected_output ? g_collected_output : "";
+    if (!g_prepend_sapi_headers || strncmp(output, "HTTP/", 5) == 0) {
+        return bridge_strdup(output);
+    }
+
+    zend_llist *headers = &SG(sapi_headers).headers;
+    zend_llist_position position;
+    size_t size = strlen(output) + 32;
+    for (sapi_header_struct *header = zend_llist_get_first_ex(headers, &position); header;
+         header = zend_llist_get_next_ex(headers, &position)) {
+        size += header->header_len + 2;
+    }
+
+    char *response = bridge_malloc(size);
+    if (!response) return NULL;
+    int status = SG(sapi_headers).http_response_code ? SG(sapi_headers).http_response_code : 200;
+    size_t used = (size_t) snprintf(response, size, "HTTP/1.1 %d\r\n", status);
+    for (sapi_header_struct *header = zend_llist_get_first_ex(headers, &position); header;
+         header = zend_llist_get_next_ex(headers, &position)) {
+        memcpy(response + used, header->header, header->header_len);
+        used += header->header_len;
+        memcpy(response + used, "\r\n", 2);
+        used += 2;
+    }
+    memcpy(response + used, "\r\n", 2);
+    strcpy(response + used + 2, output);
+    return response;
+}
+
+static void configure_embed_module(void) {
+    php_embed_module.ub_write = capture_php_output;
+    php_embed_module.phpinfo_as_text = 1;
+    php_embed_module.php_ini_ignore = 0;
+    php_embed_module.ini_entries = "output_buffering=4096\n"
+                                   "implicit_flush=0\n"
+                                   "display_errors=1\n"
+                                   "error_reporting=E_ALL\n";
+
+    php_embed_module.header_handler = android_header_handler;
+}
+
+char* run_php_script_once(const char* scriptPath, const char* method, const char* uri, const char* postData) {
+    request_timing_reset();
+    clear_collected_output();
+
+    // 🔁 Reset in case PHP was already initialized
+    php_runtime_stop();
+
+    // ✅ Build ini entries per request
+    configure_embed_module();
+
+    // ✅ Start PHP, with the profiler's observer loaded if this request is profiled
+    request_memory_begin();
+    profiler_prepare_request();
+    uint64_t phase_start = trace_now();
+    trace_span init_span = trace_span_begin("php_embed_init", "php", 0);
+    int init_result = php_embed_init(0, NULL);
+    trace_span_end(&init_span);
+    request_timing_add(REQUEST_PHASE_STARTUP, trace_now() - phase_start);
+    if (init_result != SUCCESS) {
+        profiler_finish_request("init failed");
+        request_memory_end();
+        return bridge_strdup("HTTP/1.1 500 Internal Server Error\r\nContent-Type: text/plain\r\n\r\nPHP init failed.");
+    }
+    request_timing_hook_compile();
+    sapi_module.header_handler = android_header_handler;
+    php_initialized = 1;
+    bundle_archive_activate();
+
+    const char *query_string = set_request_env(scriptPath, method, uri);
+
+    // ✅ Activate Zend and parse query data AFTER engine is live
+    zend_first_try {
+                zend_activate_modules();
+
+                parse_query_string(query_string);
+
+                // ✅ Set up POST data (if needed)
+                phase_start = trace_now();
+                initialize_php_with_request(postData ?: "", method, uri);
+                request_timing_add(REQUEST_PHASE_STARTUP, trace_now() - phase_start);
+
+                // ✅ Execute the PHP script
+                execute_request_script(scriptPath);
+
+                LOGI("✅ PHP script finished executing");
+
+                parse_query_string(query_string);
+
+            } zend_end_try();
+
+    char profile_label[256];
+    snprintf(profile_label, sizeof(profile_label), "%s %s", method, uri);
+    profiler_finish_request(profile_label);
+    request_memory_sample_zend();
+
+    // ✅ Copy output before shutdown
+    phase_start = trace_now();
+    char *response = copy_response();
+    request_timing_add(REQUEST_PHASE_OUTPUT, trace_now() - phase_start);
+    finish_php_request();
+
+    phase_start = trace_now();
+    trace_span shutdown_span = trace_span_begin("php_embed_shutdown", "php", 0);
+    php_embed_shutdown();
+    trace_span_end(&shutdown_span);
+    request_timing_add(REQUEST_PHASE_SHUTDOWN, trace_now() - phase_start);
+    php_initialized = 0;
+    release_php_request();
+    request_memory_end();
+
+    return response;
+}
+
+// Set while the engine is kept between requests, when no request is open
+static int g_persistent = 0;
+
+char *run_php_script_persistent(const char *scriptPath, const char *method, const char *uri, const char *postData) {
+    request_timing_reset();
+    clear_collected_output();
+    request_memory_begin();
+
+    uint64_t phase_start = trace_now();
+    if (!g_persistent) {
+        php_runtime_stop();
+        configure_embed_module();
+
+        trace_span init_span = trace_span_begin("php_embed_init", "php", 0);
+        int init_result = php_embed_init(0, NULL);
+        trace_span_end(&init_span);
+        if (init_result != SUCCESS) {
+            request_memory_end();
+            return bridge_strdup("HTTP/1.1 500 Internal Server Error\r\nContent-Type: text/plain\r\n\r\nPHP init failed.");
+        }
+        request_timing_hook_compile();
+        sapi_module.header_handler = android_header_handler;
+
+        // php_embed_init() opened a request; every request opens its own below
+        php_request_shutdown(NULL);
+        php_initialized = 1;
+        g_persistent = 1;
+    }
+    request_timing_add(REQUEST_PHASE_STARTUP, trace_now() - phase_start);
+
+    const char *query_string = set_request_env(scriptPath, method, uri);
+
+    zend_first_try {
+                phase_start = trace_now();
+                initialize_php_with_request(postData ?: "", method, uri);
+                bundle_archive_activate();
+                parse_query_string(query_string);
+                request_timing_add(REQUEST_PHASE_STARTUP, trace_now() - phase_start);
+
+                execute_request_script(scriptPath);
+            } zend_end_try();
+
+    request_memory_sample_zend();
+
+    phase_start = trace_now();
+    char *response = copy_response();
+    request_timing_add(REQUEST_PHASE_OUTPUT, trace_now() - phase_start);
+    finish_php_request();
+
+    phase_start = trace_now();
+    trace_span shutdown_span = trace_span_begin("php_request_shutdown", "php", 0);
+    php_request_shutdown(NULL);
+    trace_span_end(&shutdown_span);
+    request_timing_add(REQUEST_PHASE_SHUTDOWN, trace_now() - phase_start);
+    release_php_request();
+    request_memory_end();
+
+    return response;
+}
+
+int php_runtime_start(void) {
+    // A kept engine has no request open to run scripts in
+    if (g_persistent) php_runtime_stop();
+    if (php_initialized) {
+        LOGI("PHP already initialized");
+        return 0;
+    }
+
+    LOGI("Initializing PHP");
+
+    // Configure the embed SAPI
+    php_embed_module.ub_write = capture_php_output;
+    php_embed_module.phpinfo_as_text = 1;
+    php_embed_module.php_ini_ignore = 0;
+
+    // Initialize PHP
+    if (php_embed_init(0, NULL) != SUCCESS) {
+        LOGI("PHP initialization failed");
+        return -1;
+    }
+    php_initialized = 1;
+    sapi_module.header_handler = php_embed_module.header_handler;
+    bundle_archive_activate();
+    LOGI("PHP initialized successfully");
+    return 0;
+}
+
+void php_runtime_stop(void) {
+    if (!php_initialized) return;
+    // php_embed_shutdown() ends the open request, and a kept engine has none
+    if (g_persistent) php_request_startup();
+    php_embed_shutdown();
+    php_initialized = 0;
+    g_persistent = 0;
+}
+
+int php_runtime_is_started(void) {
+    return php_initialized;
+}
+
+const char *php_runtime_execute(const char *path) {
+    zend_file_handle file_handle;
+    zend_stream_init_filename(&file_handle, path);
+
+    sampler_request_begin();
+    php_execute_script(&file_handle);
+    sampler_request_end();
+
+    return php_runtime_output();
+}
+
+char *php_runtime_run_artisan(const char *laravel_root, const char *command) {
+    LOGI("🛠️ runArtisanCommand: %s", command);
+
+    char spanName[256];
+    snprintf(spanName, sizeof(spanName), "artisan %s", command);
+    trace_span artisan_span = trace_span_begin(spanName, "artisan", 1);
+
+    clear_collected_output();
+    php_embed_module.ub_write = capture_php_output;
+    php_embed_module.phpinfo_as_text = 1;
+    php_embed_module.php_ini_ignore = 0;
+    php_embed_module.ini_entries = "display_errors=1\nimplicit_flush=1\noutput_buffering=0\n";
+
+    char artisanPath[1024];
+    snprintf(artisanPath, sizeof(artisanPath), "%s/artisan.php", laravel_root);
+    chdir(laravel_root);
+    LOGI("✅ Changed CWD to Laravel base: %s", laravel_root);
+
+    // config:cache runs through here before any request, and nativephp.running
+    // has to be true in the config it caches
+    setenv("NATIVEPHP_RUNNING", "true", 1);
+
+    // Tokenize command
+    char *argv[128];
+    int argc = 0;
+    argv[argc++] = "php";
+
+    char *commandCopy = strdup(command);
+    char *token = strtok(commandCopy, " ");
+    while (token && argc < 127) {
+        argv[argc++] = token;
+        token = strtok(NULL, " ");
+    }
+    argv[argc] = NULL;
+
+    php_runtime_stop();
+
+    setenv("APP_RUNNING_IN_CONSOLE", "true", 1);
+    setenv("PHP_SELF", "artisan.php", 1);
+    setenv("APP_ENV", "local", 1);
+    setenv("APP_DEBUG", "true", 1);
+
+    trace_span init_span = trace_span_begin("php_embed_init", "php", 0);
+    int init_result = php_embed_init(argc, argv);
+    trace_span_end(&init_span);
+
+    if (init_result == SUCCESS) {
+        php_initialized = 1;
+        bundle_archive_activate();
+        native_actions_run_callbacks();
+
+        // Force STDOUT/STDERR through php://output so Symfony StreamOutput works
+        zend_eval_string(
+                "if (!defined('STDOUT')) define('STDOUT', fopen('php://output', 'w')); "
+                "if (!defined('STDERR')) define('STDERR', fopen('php://output', 'w'));",
+                NULL, "patch_stdio"
+        );
+
+        zend_file_handle file_handle;
+        zend_stream_init_filename(&file_handle, artisanPath);
+        trace_span execute_span = trace_span_begin("php_execute_script", "php", 0);
+        sampler_request_begin();
+        php_execute_script(&file_handle);
+        sampler_request_end();
+        trace_span_end(&execute_span);
+
+        trace_span shutdown_span = trace_span_begin("php_embed_shutdown", "php", 0);
+        php_embed_shutdown();
+        trace_span_end(&shutdown_span);
+        php_initialized = 0;
+    } else {
+        LOGE("❌ Failed to initialize PHP runtime");
+    }
+    trace_span_end(&artisan_span);
+    free(commandCopy);
+
+    return bridge_strdup(g_collected_output ? g_collected_output : "");
+}
+
+char *php_runtime_dispatch_events(const char *laravel_root) {
+    // Whatever queued up while the PHP thread was busy goes in one run
+    size_t queued = native_actions_completed();
+    if (queued == 0) return NULL;
+
+    LOGI("📬 Dispatching %zu native events", queued);
+    char *output = php_runtime_run_artisan(laravel_root, "native:dispatch-events");
+    // Artisan leaves this set for the console; requests run as the web app
+    setenv("APP_RUNNING_IN_CONSOLE", "false", 1);
+    return output;
+}
+
+const char *php_runtime_output(void) {
+    return g_collected_output ? g_collected_output : "";
+}
+
+void php_runtime_free_output(void) {
+    if (g_collected_output) {
+        bridge_free(g_collected_output);
+        g_collected_output = NULL;
+        g_collected_length = 0;
+        g_collected_capacity = 0;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef PHP_RUNTIME_H
+#define PHP_RUNTIME_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === The embedded PHP engine, without JNI ===
+//
+// Starting and stopping the engine, running a request or an artisan command
+// through it and collecting what PHP writes. php_bridge.c wraps this for the
+// app; runtime/php_runtime_cli.c drives it directly on a Linux host.
+// Everything here runs on one thread at a time.
+
+// Once per process, before the engine is first started.
+void php_runtime_install(void);
+
+// One request on a freshly started engine, torn down again afterwards.
+// Returns the raw output, headers and body as PHP wrote them; bridge_free() it.
+char *run_php_script_once(const char *scriptPath, const char *method, const char *uri, const char *postData);
+
+// The same request on an engine kept up between requests, so only request
+// startup and shutdown run each time. The profiler's observer isn't loaded
+// in this lifecycle. php_runtime_stop() tears the engine down.
+char *run_php_script_persistent(const char *scriptPath, const char *method, const char *uri, const char *postData);
+
+// Put a status line and the headers PHP sent through SAPI in front of
+// responses that don't write their own, as public/index.php doesn't. Off by
+// default; NativePHP's native.php writes them itself.
+void php_runtime_prepend_sapi_headers(int enabled);
+
+// `php artisan <command>` in `laravel_root`. Returns the output; bridge_free() it.
+char *php_runtime_run_artisan(const char *laravel_root, const char *command);
+
+// Hands native action results queued since the last request to Laravel's
+// event dispatcher with `artisan native:dispatch-events`, so no HTTP request
+// or WebView is involved. Returns the command's output, NULL if nothing was
+// queued; bridge_free() it.
+char *php_runtime_dispatch_events(const char *laravel_root);
+
+// A long-lived engine for running scripts one after another
+int php_runtime_start(void);
+void php_runtime_stop(void);
+int php_runtime_is_started(void);
+// Output collected so far, owned by the runtime
+const char *php_runtime_execute(const char *path);
+
+// Output PHP has written since the last clear
+void clear_collected_output(void);
+void pipe_php_output(const char *str);
+const char *php_runtime_output(void);
+void php_runtime_free_output(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PHP_RUNTIME_H
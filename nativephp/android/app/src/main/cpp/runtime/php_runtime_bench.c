@@ -0,0 +1,677 @@
+// Benchmarks the runtime against the demo app on a Linux host: the cold
+// first request of a fresh process, then warm latency and sustained requests
+// per second for each scenario, for each engine lifecycle.
+//
+//     php_runtime_bench [options] <laravel-root> [scenario...]
+//
+//     -l, --lifecycle <name>       oneshot, persistent or both (default both)
+//     -c, --cold <n>               cold first requests, each in a new process (default 5)
+//     -w, --warmup <n>             unmeasured requests per scenario (default 5)
+//     -t, --seconds <s>            how long each scenario is measured (default 10)
+//     -n, --requests <n>           or stop after n measured requests
+//     -u, --user <email:password>  account for the auth scenarios (default the seeded one)
+//     -b, --bundle <zip>           serve the app from a bundle zip, as on device
+//     -s, --script <path>          front controller, default the NativePHP one
+//     -L, --label <text>           recorded with the results, e.g. the commit
+//     -o, --output <file>          JSON results, default stdout
+//
+// Scenarios: welcome (GET /), login (the Livewire login form posted with its
+// CSRF token), dashboard (GET /dashboard signed in) and livewire (a property
+// update on the profile settings component). All of them by default.
+//
+// Every lifecycle runs in its own child process, so each starts cold and
+// nothing carries over between them. "both" adds persistent/oneshot ratios.
+// The exit status is non-zero if a scenario couldn't run or a response
+// wasn't the expected one.
+
+#include "php_runtime.h"
+#include "host_http.h"
+#include "../bundle/bundle_archive.h"
+#include "../trace/request_memory.h"
+#include "../trace/request_timing.h"
+#include "../trace/trace.h"
+
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_SCENARIOS 4
+
+typedef char *(*request_runner)(const char *, const char *, const char *, const char *);
+
+typedef enum {
+    LIFECYCLE_ONESHOT,
+    LIFECYCLE_PERSISTENT,
+    LIFECYCLE_COUNT
+} lifecycle;
+
+static const char *const LIFECYCLE_NAMES[LIFECYCLE_COUNT] = {"oneshot", "persistent"};
+static const request_runner LIFECYCLE_RUNNERS[LIFECYCLE_COUNT] = {run_php_script_once, run_php_script_persistent};
+
+static struct {
+    const char *root;
+    const char *bundle;
+    char script[PATH_MAX + 64];
+    char email[256];
+    char password[256];
+    int cold_runs;
+    int warmup;
+    double seconds;
+    long max_requests;
+    request_runner run;
+} g_config = {
+        .cold_runs = 5,
+        .warmup = 5,
+        .seconds = 10,
+        .email = "test@example.com",
+        .password = "password",
+};
+
+// === One browser's worth of state ===
+
+typedef struct {
+    host_cookie_jar cookies;
+    char csrf[128];
+    char update_uri[128];
+    char *snapshot;  // JSON-escaped, ready to go between quotes
+} session;
+
+static void session_reset(session *s) {
+    host_cookie_jar_clear(&s->cookies);
+    free(s->snapshot);
+    memset(s, 0, sizeof(*s));
+    strcpy(s->update_uri, "/livewire/update");
+}
+
+// The headers go in as HTTP_* variables, the way PHPBridge passes them
+static host_response send_request(session *s, const char *method, const char *uri, const char *body, int livewire) {
+    char *cookies = host_cookie_jar_header(&s->cookies);
+    host_set_env("HTTP_COOKIE", cookies);
+    host_set_env("CONTENT_TYPE", livewire ? "application/json" : NULL);
+    host_set_env("HTTP_CONTENT_TYPE", livewire ? "application/json" : NULL);
+    host_set_env("HTTP_X_LIVEWIRE", livewire ? "true" : NULL);
+    host_set_env("HTTP_X_CSRF_TOKEN", livewire && s->csrf[0] ? s->csrf : NULL);
+
+    host_response r = {0};
+    uint64_t start = trace_now();
+    r.raw = g_config.run(g_config.script, method, uri, body ? body : "");
+    r.ns = trace_now() - start;
+    free(cookies);
+
+    host_response_parse(&r, &s->cookies);
+    return r;
+}
+
+// The value of `attribute="..."` after `from`, HTML entities left as they are
+static const char *find_attribute(const char *from, const char *attribute, size_t *length) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "%s=\"", attribute);
+    const char *start = strstr(from, pattern);
+    if (!start) return NULL;
+    start += strlen(pattern);
+    const char *end = strchr(start, '"');
+    if (!end) return NULL;
+    *length = (size_t) (end - start);
+    return start;
+}
+
+// HTML attribute text to the JSON it encodes, then escaped to sit inside a JSON string
+static char *attribute_to_json_string(const char *text, size_t length) {
+    static const struct {
+        const char *entity;
+        char c;
+    } entities[] = {{"&quot;", '"'}, {"&amp;", '&'}, {"&#039;", '\''}, {"&#39;", '\''},
+                    {"&lt;", '<'}, {"&gt;", '>'}};
+
+    char *out = malloc(length * 2 + 1);
+    size_t used = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (c == '&') {
+            for (size_t e = 0; e < sizeof(entities) / sizeof(entities[0]); e++) {
+                size_t entity_length = strlen(entities[e].entity);
+                if (i + entity_length <= length && strncmp(text + i, entities[e].entity, entity_length) == 0) {
+                    c = entities[e].c;
+                    i += entity_length - 1;
+                    break;
+                }
+            }
+        }
+        if (c == '"' || c == '\\') out[used++] = '\\';
+        out[used++] = c;
+    }
+    out[used] = '\0';
+    return out;
+}
+
+// Token, update endpoint and the named component's snapshot from a Livewire page
+static int read_livewire_page(session *s, const char *html, const char *component) {
+    size_t length;
+    const char *value = find_attribute(html, "data-csrf", &length);
+    if (!value) {
+        const char *meta = strstr(html, "name=\"csrf-token\"");
+        value = meta ? find_attribute(meta, "content", &length) : NULL;
+    }
+    if (!value || length >= sizeof(s->csrf)) return -1;
+    memcpy(s->csrf, value, length);
+    s->csrf[length] = '\0';
+
+    value = find_attribute(html, "data-update-uri", &length);
+    if (value && length < sizeof(s->update_uri)) {
+        memcpy(s->update_uri, value, length);
+        s->update_uri[length] = '\0';
+    }
+
+    char name[128];
+    snprintf(name, sizeof(name), "\\\"name\\\":\\\"%s\\\"", component);
+    for (const char *from = html; (value = find_attribute(from, "wire:snapshot", &length)); from = value + length) {
+        char *snapshot = attribute_to_json_string(value, length);
+        if (strstr(snapshot, name)) {
+            free(s->snapshot);
+            s->snapshot = snapshot;
+            return 0;
+        }
+        free(snapshot);
+    }
+    return -1;
+}
+
+// {"components":[{"snapshot":"<escaped>", ...}]}: keeps the snapshot escaped
+static int read_livewire_update(session *s, const char *body) {
+    const char *start = strstr(body, "\"snapshot\":\"");
+    if (!start) return -1;
+    start += 12;
+    const char *end = start;
+    while (*end && *end != '"') end += *end == '\\' && end[1] ? 2 : 1;
+    if (!*end) return -1;
+
+    free(s->snapshot);
+    s->snapshot = strndup(start, (size_t) (end - start));
+    return 0;
+}
+
+static host_response livewire_update(session *s, const char *updates, const char *calls) {
+    size_t size = strlen(s->snapshot) + strlen(updates) + strlen(calls) + sizeof(s->csrf) + 128;
+    char *body = malloc(size);
+    snprintf(body, size, "{\"_token\":\"%s\",\"components\":[{\"snapshot\":\"%s\",\"updates\":{%s},\"calls\":[%s]}]}",
+             s->csrf, s->snapshot, updates, calls);
+    host_response r = send_request(s, "POST", s->update_uri, body, 1);
+    free(body);
+    return r;
+}
+
+static int get_page(session *s, const char *uri, const char *component) {
+    host_response r = send_request(s, "GET", uri, NULL, 0);
+    int result = r.status == 200 && read_livewire_page(s, r.body, component) == 0 ? 0 : -1;
+    if (result != 0) fprintf(stderr, "GET %s answered %d without a %s component\n", uri, r.status, component);
+    bridge_free(r.raw);
+    return result;
+}
+
+// Posts the login form; a successful login answers with a redirect effect
+static host_response post_login(session *s) {
+    char updates[640];
+    snprintf(updates, sizeof(updates), "\"email\":\"%s\",\"password\":\"%s\"", g_config.email, g_config.password);
+    return livewire_update(s, updates, "{\"path\":\"\",\"method\":\"login\",\"params\":[]}");
+}
+
+static int sign_in(session *s) {
+    session_reset(s);
+    if (get_page(s, "/login", "auth.login") != 0) return -1;
+
+    host_response r = post_login(s);
+    int result = r.status == 200 && strstr(r.body, "\"redirect\"") ? 0 : -1;
+    if (result != 0) fprintf(stderr, "signing in as %s answered %d\n", g_config.email, r.status);
+    bridge_free(r.raw);
+    return result;
+}
+
+// === Scenarios ===
+//
+// run() sends one measured request, and whatever unmeasured ones it needs
+// first. It returns 0 when the response was the expected one.
+
+typedef struct {
+    const char *name;
+    int (*setup)(session *s);
+    int (*run)(session *s, uint64_t *ns);
+} scenario;
+
+static int finish(host_response r, int ok, uint64_t *ns) {
+    *ns = r.ns;
+    bridge_free(r.raw);
+    return ok ? 0 : -1;
+}
+
+static int run_welcome(session *s, uint64_t *ns) {
+    host_response r = send_request(s, "GET", "/", NULL, 0);
+    return finish(r, r.status == 200, ns);
+}
+
+static int run_login(session *s, uint64_t *ns) {
+    // Each login starts as a new guest, since signing in rotates the session and token
+    session_reset(s);
+    if (get_page(s, "/login", "auth.login") != 0) return -1;
+    host_response r = post_login(s);
+    return finish(r, r.status == 200 && strstr(r.body, "\"redirect\"") != NULL, ns);
+}
+
+static int run_dashboard(session *s, uint64_t *ns) {
+    host_response r = send_request(s, "GET", "/dashboard", NULL, 0);
+    return finish(r, r.status == 200, ns);
+}
+
+static int setup_livewire(session *s) {
+    if (sign_in(s) != 0) return -1;
+    return get_page(s, "/settings/profile", "settings.profile");
+}
+
+static int run_livewire(session *s, uint64_t *ns) {
+    host_response r = livewire_update(s, "\"name\":\"Test User\"", "");
+    int ok = r.status == 200 && read_livewire_update(s, r.body) == 0;
+    return finish(r, ok, ns);
+}
+
+static const scenario SCENARIOS[MAX_SCENARIOS] = {
+        {"welcome", NULL, run_welcome},
+        {"login", NULL, run_login},
+        {"dashboard", sign_in, run_dashboard},
+        {"livewire", setup_livewire, run_livewire},
+};
+
+// === Measuring ===
+
+typedef struct {
+    double mean, p50, p90, p99, min, max;
+} latency;
+
+typedef struct {
+    int ran;  // 0 if setup failed
+    long requests;
+    long errors;
+    double rps;
+    latency ms;
+    double phases[REQUEST_PHASE_COUNT];  // mean ms
+} scenario_result;
+
+typedef struct {
+    int status;
+    uint64_t ns;
+    uint64_t phases[REQUEST_PHASE_COUNT];
+} cold_result;
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+static latency summarize(uint64_t *samples, long count) {
+    latency l = {0};
+    if (count == 0) return l;
+    qsort(samples, (size_t) count, sizeof(uint64_t), compare_u64);
+    double total = 0;
+    for (long i = 0; i < count; i++) total += (double) samples[i];
+    l.mean = total / (double) count / 1e6;
+    l.p50 = (double) samples[(count - 1) * 50 / 100] / 1e6;
+    l.p90 = (double) samples[(count - 1) * 90 / 100] / 1e6;
+    l.p99 = (double) samples[(count - 1) * 99 / 100] / 1e6;
+    l.min = (double) samples[0] / 1e6;
+    l.max = (double) samples[count - 1] / 1e6;
+    return l;
+}
+
+static void start_process(void) {
+    if (g_config.bundle) {
+        const char *disk_paths[] = {"storage", "bootstrap/cache", "public", ".env"};
+        if (bundle_archive_mount(g_config.bundle, 0, 0, g_config.root, disk_paths, 4) != 0) {
+            fprintf(stderr, "cannot mount %s\n", g_config.bundle);
+            _exit(2);
+        }
+    }
+    php_runtime_install();
+    php_runtime_prepend_sapi_headers(1);
+    if (chdir(g_config.root) != 0) _exit(2);
+    setenv("NATIVEPHP_RUNNING", "true", 1);
+}
+
+static void run_cold(int fd) {
+    start_process();
+    session s = {0};
+    session_reset(&s);
+
+    cold_result result = {0};
+    host_response r = send_request(&s, "GET", "/", NULL, 0);
+    result.status = r.status;
+    result.ns = r.ns;
+    request_timing_get(result.phases);
+    bridge_free(r.raw);
+    session_reset(&s);
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result)) _exit(1);
+}
+
+static void run_scenario(const scenario *sc, scenario_result *result) {
+    session s = {0};
+    session_reset(&s);
+    memset(result, 0, sizeof(*result));
+
+    if (sc->setup && sc->setup(&s) != 0) {
+        fprintf(stderr, "%s: setup failed, skipped\n", sc->name);
+        session_reset(&s);
+        return;
+    }
+    result->ran = 1;
+
+    uint64_t ns;
+    for (int i = 0; i < g_config.warmup; i++) sc->run(&s, &ns);
+
+    size_t capacity = 1024;
+    uint64_t *samples = malloc(capacity * sizeof(uint64_t));
+    uint64_t measured = 0;
+    uint64_t phases[REQUEST_PHASE_COUNT];
+    double phase_totals[REQUEST_PHASE_COUNT] = {0};
+    uint64_t deadline = trace_now() + (uint64_t) (g_config.seconds * 1e9);
+
+    while (g_config.max_requests ? result->requests + result->errors < g_config.max_requests : trace_now() < deadline) {
+        ns = 0;
+        if (sc->run(&s, &ns) != 0) result->errors++;
+        // Nothing to count if it failed before the measured request
+        if (ns == 0) continue;
+        request_timing_get(phases);
+        for (int phase = 0; phase < REQUEST_PHASE_COUNT; phase++) phase_totals[phase] += (double) phases[phase];
+
+        if ((size_t) result->requests == capacity) {
+            capacity *= 2;
+            samples = realloc(samples, capacity * sizeof(uint64_t));
+        }
+        samples[result->requests++] = ns;
+        measured += ns;
+    }
+
+    // Back to back on the one PHP thread, so this is the measured requests over their own time
+    result->rps = measured ? (double) result->requests * 1e9 / (double) measured : 0;
+    result->ms = summarize(samples, result->requests);
+    for (int phase = 0; phase < REQUEST_PHASE_COUNT; phase++) {
+        result->phases[phase] = result->requests ? phase_totals[phase] / (double) result->requests / 1e6 : 0;
+    }
+    free(samples);
+    session_reset(&s);
+
+    fprintf(stderr, "%s: %ld requests, %ld errors, p50 %.2fms, p99 %.2fms, %.1f req/s\n", sc->name,
+            result->requests, result->errors, result->ms.p50, result->ms.p99, result->rps);
+}
+
+static void run_scenarios(int fd, const int *selected, int count) {
+    start_process();
+    for (int i = 0; i < count; i++) {
+        scenario_result result;
+        run_scenario(&SCENARIOS[selected[i]], &result);
+        if (write(fd, &result, sizeof(result)) != sizeof(result)) _exit(1);
+    }
+    php_runtime_stop();
+}
+
+// Runs `work` in a child process and reads back `size` bytes it writes
+static int in_child(void (*work)(int fd, const int *selected, int count), const int *selected, int count,
+                    void *out, size_t size) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+    fflush(NULL);
+
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        close(fds[0]);
+        work(fds[1], selected, count);
+        close(fds[1]);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    size_t got = 0;
+    ssize_t n;
+    while (got < size && (n = read(fds[0], (char *) out + got, size - got)) > 0) got += (size_t) n;
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    return got == size ? 0 : -1;
+}
+
+static void cold_work(int fd, const int *selected, int count) {
+    (void) selected;
+    (void) count;
+    run_cold(fd);
+}
+
+// === Results ===
+
+typedef struct {
+    int ran;
+    int cold_runs;
+    cold_result cold[64];
+    scenario_result scenarios[MAX_SCENARIOS];
+} lifecycle_result;
+
+static void print_latency(FILE *out, const latency *l) {
+    fprintf(out, "{\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"min\": %.3f, \"max\": %.3f}",
+            l->mean, l->p50, l->p90, l->p99, l->min, l->max);
+}
+
+static void print_phases(FILE *out, const double *phases) {
+    fputc('{', out);
+    for (int phase = REQUEST_PHASE_STARTUP; phase <= REQUEST_PHASE_SHUTDOWN; phase++) {
+        fprintf(out, "%s\"%s\": %.3f", phase > REQUEST_PHASE_STARTUP ? ", " : "",
+                request_phase_name((request_phase) phase), phases[phase]);
+    }
+    fputc('}', out);
+}
+
+static latency cold_latency(const lifecycle_result *lr, double *phases) {
+    uint64_t samples[64];
+    long count = 0;
+    memset(phases, 0, sizeof(double) * REQUEST_PHASE_COUNT);
+    for (int i = 0; i < lr->cold_runs; i++) {
+        samples[count++] = lr->cold[i].ns;
+        for (int phase = 0; phase < REQUEST_PHASE_COUNT; phase++) {
+            phases[phase] += (double) lr->cold[i].phases[phase] / lr->cold_runs / 1e6;
+        }
+    }
+    return summarize(samples, count);
+}
+
+static void print_results(FILE *out, const char *label, const lifecycle_result *results,
+                          const int *selected, int count) {
+    fprintf(out, "{\n  \"label\": \"%s\",\n  \"timestamp\": %ld,\n", label ? label : "", (long) time(NULL));
+    fprintf(out, "  \"config\": {\"cold_runs\": %d, \"warmup\": %d, \"seconds\": %.1f, \"max_requests\": %ld, "
+                 "\"bundle\": %s},\n",
+            g_config.cold_runs, g_config.warmup, g_config.seconds, g_config.max_requests,
+            g_config.bundle ? "true" : "false");
+    fprintf(out, "  \"lifecycles\": {");
+
+    int first = 1;
+    latency colds[LIFECYCLE_COUNT];
+    for (int lc = 0; lc < LIFECYCLE_COUNT; lc++) {
+        const lifecycle_result *lr = &results[lc];
+        if (!lr->ran) continue;
+        fprintf(out, "%s\n    \"%s\": {\n", first ? "" : ",", LIFECYCLE_NAMES[lc]);
+        first = 0;
+
+        double phases[REQUEST_PHASE_COUNT];
+        colds[lc] = cold_latency(lr, phases);
+        fprintf(out, "      \"cold\": {\"runs\": %d, \"ms\": ", lr->cold_runs);
+        print_latency(out, &colds[lc]);
+        fprintf(out, ", \"phases\": ");
+        print_phases(out, phases);
+        fprintf(out, "},\n      \"scenarios\": {");
+
+        for (int i = 0; i < count; i++) {
+            const scenario_result *sr = &lr->scenarios[i];
+            fprintf(out, "%s\n        \"%s\": ", i ? "," : "", SCENARIOS[selected[i]].name);
+            if (!sr->ran) {
+                fprintf(out, "{\"error\": \"setup failed\"}");
+                continue;
+            }
+            fprintf(out, "{\"requests\": %ld, \"errors\": %ld, \"rps\": %.2f, \"ms\": ", sr->requests, sr->errors,
+                    sr->rps);
+            print_latency(out, &sr->ms);
+            fprintf(out, ", \"phases\": ");
+            print_phases(out, sr->phases);
+            fputc('}', out);
+        }
+        fprintf(out, "\n      }\n    }");
+    }
+    fprintf(out, "\n  }");
+
+    // How much keeping the engine up buys: > 1 means persistent is faster
+    if (results[LIFECYCLE_ONESHOT].ran && results[LIFECYCLE_PERSISTENT].ran) {
+        const lifecycle_result *once = &results[LIFECYCLE_ONESHOT], *kept = &results[LIFECYCLE_PERSISTENT];
+        fprintf(out, ",\n  \"persistent_vs_oneshot\": {\n    \"cold_p50\": %.3f",
+                colds[LIFECYCLE_PERSISTENT].p50 > 0 ? colds[LIFECYCLE_ONESHOT].p50 / colds[LIFECYCLE_PERSISTENT].p50 : 0);
+        for (int i = 0; i < count; i++) {
+            const scenario_result *a = &once->scenarios[i], *b = &kept->scenarios[i];
+            if (!a->ran || !b->ran || b->ms.p50 <= 0 || a->rps <= 0) continue;
+            fprintf(out, ",\n    \"%s\": {\"p50\": %.3f, \"rps\": %.3f}", SCENARIOS[selected[i]].name,
+                    a->ms.p50 / b->ms.p50, b->rps / a->rps);
+        }
+        fprintf(out, "\n  }");
+    }
+    fprintf(out, "\n}\n");
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-l oneshot|persistent|both] [-c cold-runs] [-w warmup] [-t seconds] [-n requests]\n"
+                    "          [-u email:password] [-b bundle.zip] [-s script] [-L label] [-o out.json]\n"
+                    "          <laravel-root> [welcome|login|dashboard|livewire]...\n", name);
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+            {"lifecycle", required_argument, NULL, 'l'},
+            {"cold", required_argument, NULL, 'c'},
+            {"warmup", required_argument, NULL, 'w'},
+            {"seconds", required_argument, NULL, 't'},
+            {"requests", required_argument, NULL, 'n'},
+            {"user", required_argument, NULL, 'u'},
+            {"bundle", required_argument, NULL, 'b'},
+            {"script", required_argument, NULL, 's'},
+            {"label", required_argument, NULL, 'L'},
+            {"output", required_argument, NULL, 'o'},
+            {NULL, 0, NULL, 0},
+    };
+
+    int lifecycles[LIFECYCLE_COUNT] = {1, 1};
+    const char *label = NULL, *output = NULL, *script_arg = NULL;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "l:c:w:t:n:u:b:s:L:o:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'l':
+                lifecycles[LIFECYCLE_ONESHOT] = strcmp(optarg, "persistent") != 0;
+                lifecycles[LIFECYCLE_PERSISTENT] = strcmp(optarg, "oneshot") != 0;
+                break;
+            case 'c': g_config.cold_runs = atoi(optarg); break;
+            case 'w': g_config.warmup = atoi(optarg); break;
+            case 't': g_config.seconds = atof(optarg); break;
+            case 'n': g_config.max_requests = atol(optarg); break;
+            case 'u': {
+                const char *colon = strchr(optarg, ':');
+                if (!colon || (size_t) (colon - optarg) >= sizeof(g_config.email)) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                snprintf(g_config.email, sizeof(g_config.email), "%.*s", (int) (colon - optarg), optarg);
+                snprintf(g_config.password, sizeof(g_config.password), "%s", colon + 1);
+                break;
+            }
+            case 'b': g_config.bundle = optarg; break;
+            case 's': script_arg = optarg; break;
+            case 'L': label = optarg; break;
+            case 'o': output = optarg; break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind >= argc || g_config.cold_runs < 0 || g_config.cold_runs > 64) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    static char root[PATH_MAX];
+    if (!realpath(argv[optind], root)) {
+        fprintf(stderr, "cannot find %s\n", argv[optind]);
+        return 2;
+    }
+    g_config.root = root;
+
+    if (script_arg) {
+        snprintf(g_config.script, sizeof(g_config.script), "%s", script_arg);
+    } else {
+        snprintf(g_config.script, sizeof(g_config.script), "%s/vendor/nativephp/mobile/bootstrap/android/native.php", root);
+        if (!g_config.bundle && access(g_config.script, R_OK) != 0) {
+            snprintf(g_config.script, sizeof(g_config.script), "%s/public/index.php", root);
+        }
+    }
+
+    int selected[MAX_SCENARIOS];
+    int count = 0;
+    for (int i = optind + 1; i < argc; i++) {
+        int found = -1;
+        for (int sc = 0; sc < MAX_SCENARIOS; sc++) {
+            if (strcmp(argv[i], SCENARIOS[sc].name) == 0) found = sc;
+        }
+        if (found < 0 || count == MAX_SCENARIOS) {
+            usage(argv[0]);
+            return 2;
+        }
+        selected[count++] = found;
+    }
+    if (count == 0) {
+        for (int sc = 0; sc < MAX_SCENARIOS; sc++) selected[count++] = sc;
+    }
+
+    static lifecycle_result results[LIFECYCLE_COUNT];
+    int failed = 0;
+    for (int lc = 0; lc < LIFECYCLE_COUNT; lc++) {
+        if (!lifecycles[lc]) continue;
+        lifecycle_result *lr = &results[lc];
+        g_config.run = LIFECYCLE_RUNNERS[lc];
+        fprintf(stderr, "== %s\n", LIFECYCLE_NAMES[lc]);
+
+        for (int i = 0; i < g_config.cold_runs; i++) {
+            if (in_child(cold_work, NULL, 0, &lr->cold[lr->cold_runs], sizeof(cold_result)) != 0) {
+                fprintf(stderr, "cold run %d died\n", i + 1);
+                failed = 1;
+                continue;
+            }
+            if (lr->cold[lr->cold_runs].status != 200) failed = 1;
+            fprintf(stderr, "cold: %d in %.2fms\n", lr->cold[lr->cold_runs].status,
+                    lr->cold[lr->cold_runs].ns / 1e6);
+            lr->cold_runs++;
+        }
+
+        if (in_child(run_scenarios, selected, count, lr->scenarios, sizeof(scenario_result) * count) != 0) {
+            fprintf(stderr, "%s scenarios died\n", LIFECYCLE_NAMES[lc]);
+            failed = 1;
+            continue;
+        }
+        for (int i = 0; i < count; i++) {
+            if (!lr->scenarios[i].ran || lr->scenarios[i].errors) failed = 1;
+        }
+        lr->ran = 1;
+    }
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", output);
+        return 2;
+    }
+    print_results(out, label, results, selected, count);
+    if (out != stdout) fclose(out);
+    return failed;
+}
@@ -0,0 +1,280 @@
+// Host driver for the runtime: sends requests to a Laravel app through the
+// same engine lifecycle the app uses and prints responses and timings.
+//
+//     php_runtime_cli [options] <laravel-root> [METHOD URI]
+//
+//     -H, --header 'Name: value'   request header, repeatable
+//     -d, --data <body|@file>      request body
+//     -n, --repeat <n>             send the request n times
+//     -r, --requests <file>        one request per line: METHOD URI [BODY]
+//     -a, --artisan <command>      run an artisan command before the requests
+//     -e, --event 'Name {json}'    queue a native event, repeatable; all are
+//                                  dispatched in one run before the requests
+//     -b, --bundle <zip>           serve the app from a bundle zip, as on device
+//     -s, --script <path>          front controller, default the NativePHP one
+//     -p, --persistent             keep the engine up between requests
+//     -q, --quiet                  don't print responses
+//
+// Timings go to stderr, one line per request, then per-route percentiles
+// when more than one request ran. Set NATIVEPHP_VERBOSE=1 for the bridge log.
+
+#include "php_runtime.h"
+#include "host_http.h"
+#include "../bundle/bundle_archive.h"
+#include "../native/native_actions.h"
+#include "../trace/request_memory.h"
+#include "../trace/request_timing.h"
+#include "../trace/trace.h"
+
+#include <limits.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_HEADERS 64
+#define MAX_EVENTS 64
+
+static const char *g_headers[MAX_HEADERS];
+static int g_header_count = 0;
+static const char *g_events[MAX_EVENTS];
+static int g_event_count = 0;
+static int g_quiet = 0;
+static int g_requests_run = 0;
+static char *(*g_run)(const char *, const char *, const char *, const char *) = run_php_script_once;
+
+static char *read_file(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *data = malloc(size + 1);
+    if (data && fread(data, 1, size, file) != (size_t) size) {
+        free(data);
+        data = NULL;
+    }
+    if (data) data[size] = '\0';
+    fclose(file);
+    return data;
+}
+
+// "X-Requested-With: foo" goes in as HTTP_X_REQUESTED_WITH=foo
+static void set_headers(int set) {
+    for (int i = 0; i < g_header_count; i++) {
+        const char *colon = strchr(g_headers[i], ':');
+        char name[256];
+        host_header_env_name(g_headers[i], colon ? (size_t) (colon - g_headers[i]) : strlen(g_headers[i]),
+                             name, sizeof(name));
+
+        const char *value = colon ? colon + 1 : "";
+        while (*value == ' ') value++;
+
+        host_set_env(name, set ? value : NULL);
+        // PHP.c picks the body's content type up from CONTENT_TYPE
+        if (strcmp(name, "HTTP_CONTENT_TYPE") == 0) host_set_env("CONTENT_TYPE", set ? value : NULL);
+    }
+}
+
+static void run_request(const char *script, const char *method, const char *uri, const char *body) {
+    set_headers(1);
+    uint64_t start = trace_now();
+    char *response = g_run(script, method, uri, body ? body : "");
+    uint64_t total = trace_now() - start;
+    set_headers(0);
+
+    uint64_t phases[REQUEST_PHASE_COUNT];
+    request_timing_get(phases);
+    int64_t memory[REQUEST_MEMORY_COUNT];
+    request_memory_get(memory);
+
+    char route[160];
+    request_route_key(method, uri, route, sizeof(route));
+    request_stats_record(route, phases);
+    g_requests_run++;
+
+    if (!g_quiet) {
+        fputs(response ? response : "", stdout);
+        fputc('\n', stdout);
+        fflush(stdout);
+    }
+
+    host_response parsed = {.raw = response};
+    host_response_parse(&parsed, NULL);
+    char status[8] = "-";
+    if (parsed.status) snprintf(status, sizeof(status), "%d", parsed.status);
+    fprintf(stderr, "%s %s  %s  %.2fms |", method, uri, status, total / 1e6);
+    for (int phase = REQUEST_PHASE_STARTUP; phase <= REQUEST_PHASE_SHUTDOWN; phase++) {
+        fprintf(stderr, " %s %.2f", request_phase_name((request_phase) phase), phases[phase] / 1e6);
+    }
+    fprintf(stderr, " | zend peak %lldKB, rss %+lldKB, %lld faults\n",
+            (long long) memory[REQUEST_MEMORY_ZEND_PEAK] / 1024,
+            (long long) (memory[REQUEST_MEMORY_RSS_AFTER] - memory[REQUEST_MEMORY_RSS_BEFORE]) / 1024,
+            (long long) memory[REQUEST_MEMORY_MINOR_FAULTS]);
+
+    bridge_free(response);
+}
+
+static int run_request_file(const char *script, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+
+    char line[8192];
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') continue;
+
+        char *method = strtok(line, " ");
+        char *uri = strtok(NULL, " ");
+        char *body = strtok(NULL, "");
+        if (!method || !uri) continue;
+        run_request(script, method, uri, body);
+    }
+    fclose(file);
+    return 0;
+}
+
+// As the platform would complete them: no handle, "Name" or "Name {json}"
+static void dispatch_events(const char *root) {
+    for (int i = 0; i < g_event_count; i++) {
+        char name[256];
+        const char *space = strchr(g_events[i], ' ');
+        size_t length = space ? (size_t) (space - g_events[i]) : strlen(g_events[i]);
+        snprintf(name, sizeof(name), "%.*s", (int) length, g_events[i]);
+        native_actions_complete(0, name, space ? space + 1 : "{}", 0);
+    }
+
+    char *output = php_runtime_dispatch_events(root);
+    fputs(output ? output : "", stderr);
+    bridge_free(output);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-H header]... [-d body|@file] [-n repeat] [-r requests-file] [-a artisan-command]\n"
+                    "          [-e 'event {json}']... [-b bundle.zip] [-s script] [-p] [-q] <laravel-root> [METHOD URI]\n", name);
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+            {"header", required_argument, NULL, 'H'},
+            {"data", required_argument, NULL, 'd'},
+            {"repeat", required_argument, NULL, 'n'},
+            {"requests", required_argument, NULL, 'r'},
+            {"artisan", required_argument, NULL, 'a'},
+            {"event", required_argument, NULL, 'e'},
+            {"bundle", required_argument, NULL, 'b'},
+            {"script", required_argument, NULL, 's'},
+            {"persistent", no_argument, NULL, 'p'},
+            {"quiet", no_argument, NULL, 'q'},
+            {NULL, 0, NULL, 0},
+    };
+
+    const char *body = NULL, *requests = NULL, *artisan = NULL, *bundle = NULL, *script_arg = NULL;
+    char *body_file = NULL;
+    int repeat = 1;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "H:d:n:r:a:e:b:s:pq", options, NULL)) != -1) {
+        switch (opt) {
+            case 'H':
+                if (g_header_count < MAX_HEADERS) g_headers[g_header_count++] = optarg;
+                break;
+            case 'd':
+                if (optarg[0] == '@') {
+                    body = body_file = read_file(optarg + 1);
+                    if (!body) {
+                        fprintf(stderr, "cannot read %s\n", optarg + 1);
+                        return 2;
+                    }
+                } else {
+                    body = optarg;
+                }
+                break;
+            case 'n': repeat = atoi(optarg); break;
+            case 'r': requests = optarg; break;
+            case 'a': artisan = optarg; break;
+            case 'e':
+                if (g_event_count < MAX_EVENTS) g_events[g_event_count++] = optarg;
+                break;
+            case 'b': bundle = optarg; break;
+            case 's': script_arg = optarg; break;
+            case 'p': g_run = run_php_script_persistent; break;
+            case 'q': g_quiet = 1; break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    int remaining = argc - optind;
+    if (remaining != 1 && remaining != 3) {
+        usage(argv[0]);
+        return 2;
+    }
+    char root[4096];
+    if (!realpath(argv[optind], root)) {
+        fprintf(stderr, "cannot find %s\n", argv[optind]);
+        return 2;
+    }
+    const char *method = remaining == 3 ? argv[optind + 1] : NULL;
+    const char *uri = remaining == 3 ? argv[optind + 2] : NULL;
+    if (!method && !requests && !artisan && g_event_count == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    char script[PATH_MAX + 64];
+    if (script_arg) {
+        snprintf(script, sizeof(script), "%s", script_arg);
+    } else {
+        snprintf(script, sizeof(script), "%s/vendor/nativephp/mobile/bootstrap/android/native.php", root);
+        if (access(script, R_OK) != 0) snprintf(script, sizeof(script), "%s/public/index.php", root);
+    }
+
+    if (bundle) {
+        const char *disk_paths[] = {"storage", "bootstrap/cache", "public", ".env"};
+        if (bundle_archive_mount(bundle, 0, 0, root, disk_paths, 4) != 0) {
+            fprintf(stderr, "cannot mount %s\n", bundle);
+            return 1;
+        }
+    }
+
+    php_runtime_install();
+    php_runtime_prepend_sapi_headers(1);
+    if (chdir(root) != 0) {
+        fprintf(stderr, "cannot enter %s\n", root);
+        return 1;
+    }
+    setenv("NATIVEPHP_RUNNING", "true", 1);
+
+    if (artisan) {
+        char *output = php_runtime_run_artisan(root, artisan);
+        if (!g_quiet) fputs(output ? output : "", stdout);
+        bridge_free(output);
+        // Artisan leaves these set for the console; requests run as the web app
+        setenv("APP_RUNNING_IN_CONSOLE", "false", 1);
+    }
+
+    if (g_event_count > 0) dispatch_events(root);
+
+    int result = 0;
+    if (requests) result = run_request_file(script, requests);
+    for (int i = 0; method && i < repeat; i++) run_request(script, method, uri, body);
+
+    if (g_requests_run > 1) {
+        char *stats = request_stats_json();
+        fprintf(stderr, "%s\n", stats ? stats : "{}");
+        free(stats);
+    }
+
+    php_runtime_stop();
+    php_runtime_free_output();
+    if (bundle) bundle_archive_unmount();
+    free(body_file);
+    return result;
+}
@@ -0,0 +1,452 @@
+// Replays a session recorded by TrafficRecorder against the runtime on a
+// Linux host, and reports tail latency and how long requests queued for the
+// PHP thread.
+//
+//     traffic_replay [options] <laravel-root> <session.nptr>
+//
+//     -x, --speed <f>              1 replays at the recorded pace (default), 2 twice
+//                                  as fast; 0 sends each client's next request as soon
+//                                  as its last one is answered
+//     -c, --clients <n>            replay the session as n clients at once (default 1)
+//     -p, --persistent             keep the engine up between requests
+//     -b, --bundle <zip>           serve the app from a bundle zip, as on device
+//     -s, --script <path>          front controller, default the NativePHP one
+//     -o, --output <file>          JSON results, default stdout
+//
+// Like the app, every request runs on the one PHP thread in arrival order,
+// so a request that arrives while another runs waits in the queue. Each
+// client has its own cookie jar and sends its XSRF-TOKEN cookie back as
+// X-XSRF-TOKEN, in place of the tokens the recorder redacted. Livewire
+// snapshots are checksummed with APP_KEY, so replay against the recording
+// app's key for Livewire updates to be accepted.
+
+#include "php_runtime.h"
+#include "host_http.h"
+#include "../bundle/bundle_archive.h"
+#include "../trace/request_memory.h"
+#include "../trace/request_timing.h"
+#include "../trace/trace.h"
+
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TRAFFIC_MAGIC "NPTR"
+#define TRAFFIC_VERSION 1
+#define MAX_ROUTES 256
+
+// === The recorded session ===
+
+typedef struct {
+    uint64_t arrival_ns;  // since the recording started
+    char *method;
+    char *uri;
+    int header_count;
+    char **header_names;
+    char **header_values;
+    char *body;
+    int status;
+    uint64_t recorded_ns;  // PHP phases as measured on device, queue wait not included
+} traffic_record;
+
+typedef struct {
+    const unsigned char *data;
+    size_t length;
+    size_t offset;
+    int error;
+} reader;
+
+static uint64_t read_varint(reader *r) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (r->offset >= r->length) {
+            r->error = 1;
+            return 0;
+        }
+        unsigned char byte = r->data[r->offset++];
+        value |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    r->error = 1;
+    return 0;
+}
+
+static char *read_string(reader *r) {
+    uint64_t length = read_varint(r);
+    if (r->error || length > r->length - r->offset) {
+        r->error = 1;
+        return NULL;
+    }
+    char *value = strndup((const char *) r->data + r->offset, (size_t) length);
+    r->offset += (size_t) length;
+    return value;
+}
+
+static int read_record(reader *r, traffic_record *record) {
+    memset(record, 0, sizeof(*record));
+    record->arrival_ns = read_varint(r) * 1000;
+    record->method = read_string(r);
+    record->uri = read_string(r);
+    uint64_t headers = read_varint(r);
+    if (r->error || headers > 256) return -1;
+
+    record->header_count = (int) headers;
+    record->header_names = calloc(headers + 1, sizeof(char *));
+    record->header_values = calloc(headers + 1, sizeof(char *));
+    for (uint64_t i = 0; i < headers && !r->error; i++) {
+        record->header_names[i] = read_string(r);
+        record->header_values[i] = read_string(r);
+    }
+    record->body = read_string(r);
+    record->status = (int) read_varint(r);
+
+    uint64_t phases = read_varint(r);
+    for (uint64_t phase = 0; phase < phases && !r->error; phase++) {
+        uint64_t us = read_varint(r);
+        if (phase != REQUEST_PHASE_QUEUE && phase != REQUEST_PHASE_CONVERT) record->recorded_ns += us * 1000;
+    }
+    return r->error ? -1 : 0;
+}
+
+static void free_record(traffic_record *record) {
+    for (int i = 0; i < record->header_count; i++) {
+        free(record->header_names[i]);
+        free(record->header_values[i]);
+    }
+    free(record->header_names);
+    free(record->header_values);
+    free(record->method);
+    free(record->uri);
+    free(record->body);
+}
+
+static int compare_arrival(const void *a, const void *b) {
+    const traffic_record *x = a, *y = b;
+    return x->arrival_ns < y->arrival_ns ? -1 : x->arrival_ns > y->arrival_ns;
+}
+
+// Records are written as requests finish, so they're sorted back into arrival order
+static traffic_record *load_session(const char *path, int *count) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *data = malloc(size > 0 ? (size_t) size : 1);
+    size_t got = data ? fread(data, 1, (size_t) size, file) : 0;
+    fclose(file);
+    if (got != (size_t) size || size < 5 || memcmp(data, TRAFFIC_MAGIC, 4) != 0 || data[4] != TRAFFIC_VERSION) {
+        fprintf(stderr, "%s is not a version %d traffic log\n", path, TRAFFIC_VERSION);
+        free(data);
+        return NULL;
+    }
+
+    reader r = {data, (size_t) size, 5, 0};
+    read_varint(&r);  // recording start, wall clock
+
+    int capacity = 256;
+    traffic_record *records = malloc(sizeof(traffic_record) * capacity);
+    *count = 0;
+    while (r.offset < r.length) {
+        if (*count == capacity) {
+            capacity *= 2;
+            records = realloc(records, sizeof(traffic_record) * capacity);
+        }
+        if (read_record(&r, &records[*count]) != 0) {
+            // A log cut off mid-record by the app being killed: keep what's whole
+            fprintf(stderr, "%s: truncated after %d requests\n", path, *count);
+            free_record(&records[*count]);
+            break;
+        }
+        (*count)++;
+    }
+    free(data);
+
+    qsort(records, (size_t) *count, sizeof(traffic_record), compare_arrival);
+    return records;
+}
+
+// === Statistics ===
+
+typedef struct {
+    uint64_t *values;
+    size_t count;
+    size_t capacity;
+} samples;
+
+static void samples_add(samples *s, uint64_t value) {
+    if (s->count == s->capacity) {
+        s->capacity = s->capacity ? s->capacity * 2 : 64;
+        s->values = realloc(s->values, s->capacity * sizeof(uint64_t));
+    }
+    s->values[s->count++] = value;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile_ms(samples *s, int percentile) {
+    if (s->count == 0) return 0;
+    return (double) s->values[(s->count - 1) * (size_t) percentile / 100] / 1e6;
+}
+
+typedef struct {
+    char route[160];
+    long errors;
+    samples queue;
+    samples service;
+    samples latency;   // queue + service
+    samples recorded;  // service time on device
+} route_stats;
+
+static route_stats g_routes[MAX_ROUTES + 1];  // the last one is every request
+static int g_route_count = 0;
+
+static route_stats *route_for(const char *method, const char *uri) {
+    char key[160];
+    request_route_key(method, uri, key, sizeof(key));
+    for (int i = 0; i < g_route_count; i++) {
+        if (strcmp(g_routes[i].route, key) == 0) return &g_routes[i];
+    }
+    if (g_route_count == MAX_ROUTES) return NULL;
+    snprintf(g_routes[g_route_count].route, sizeof(g_routes[0].route), "%s", key);
+    return &g_routes[g_route_count++];
+}
+
+static void print_stats(FILE *out, route_stats *stats) {
+    samples *series[] = {&stats->queue, &stats->service, &stats->latency, &stats->recorded};
+    const char *names[] = {"queue", "service", "latency", "recorded"};
+
+    fprintf(out, "{\"requests\": %zu, \"errors\": %ld", stats->service.count, stats->errors);
+    for (int i = 0; i < 4; i++) {
+        qsort(series[i]->values, series[i]->count, sizeof(uint64_t), compare_u64);
+        fprintf(out, ", \"%s\": {\"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f}", names[i],
+                percentile_ms(series[i], 50), percentile_ms(series[i], 95), percentile_ms(series[i], 99),
+                percentile_ms(series[i], 100));
+    }
+    fputc('}', out);
+}
+
+// === Replay ===
+
+typedef struct {
+    host_cookie_jar cookies;
+    int next;             // index into the session
+    uint64_t arrival_ns;  // when its next request is due, absolute
+} client;
+
+static void sleep_until(uint64_t when) {
+    uint64_t now = trace_now();
+    if (when <= now) return;
+    uint64_t wait = when - now;
+    struct timespec ts = {(time_t) (wait / 1000000000ULL), (long) (wait % 1000000000ULL)};
+    nanosleep(&ts, NULL);
+}
+
+// Recorded headers go in as HTTP_* variables like PHPBridge passes them, with
+// the client's own cookies and XSRF token in place of the redacted ones
+static void set_request_env(const traffic_record *record, const client *c, int set) {
+    char name[256];
+    for (int i = 0; i < record->header_count; i++) {
+        host_header_env_name(record->header_names[i], strlen(record->header_names[i]), name, sizeof(name));
+        host_set_env(name, set ? record->header_values[i] : NULL);
+        if (strcmp(name, "HTTP_CONTENT_TYPE") == 0) host_set_env("CONTENT_TYPE", set ? record->header_values[i] : NULL);
+    }
+
+    char *cookies = set ? host_cookie_jar_header(&c->cookies) : NULL;
+    host_set_env("HTTP_COOKIE", cookies);
+    free(cookies);
+
+    // The cookie is URL-encoded; the header carries it decoded, as axios sends it
+    const char *xsrf = set ? host_cookie_jar_get(&c->cookies, "XSRF-TOKEN") : NULL;
+    char decoded[1024];
+    if (xsrf) {
+        size_t used = 0;
+        for (const char *p = xsrf; *p && used + 1 < sizeof(decoded); p++) {
+            unsigned int byte;
+            if (p[0] == '%' && p[1] && p[2] && sscanf(p + 1, "%2x", &byte) == 1) {
+                decoded[used++] = (char) byte;
+                p += 2;
+            } else {
+                decoded[used++] = *p;
+            }
+        }
+        decoded[used] = '\0';
+    }
+    host_set_env("HTTP_X_XSRF_TOKEN", xsrf ? decoded : NULL);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-x speed] [-c clients] [-p] [-b bundle.zip] [-s script] [-o out.json]\n"
+                    "          <laravel-root> <session.nptr>\n", name);
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+            {"speed", required_argument, NULL, 'x'},
+            {"clients", required_argument, NULL, 'c'},
+            {"persistent", no_argument, NULL, 'p'},
+            {"bundle", required_argument, NULL, 'b'},
+            {"script", required_argument, NULL, 's'},
+            {"output", required_argument, NULL, 'o'},
+            {NULL, 0, NULL, 0},
+    };
+
+    double speed = 1;
+    int client_count = 1;
+    const char *bundle = NULL, *script_arg = NULL, *output = NULL;
+    char *(*run)(const char *, const char *, const char *, const char *) = run_php_script_once;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "x:c:pb:s:o:", options, NULL)) != -1) {
+        switch (opt) {
+            case 'x': speed = atof(optarg); break;
+            case 'c': client_count = atoi(optarg); break;
+            case 'p': run = run_php_script_persistent; break;
+            case 'b': bundle = optarg; break;
+            case 's': script_arg = optarg; break;
+            case 'o': output = optarg; break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+    if (argc - optind != 2 || speed < 0 || client_count < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    char root[PATH_MAX];
+    if (!realpath(argv[optind], root)) {
+        fprintf(stderr, "cannot find %s\n", argv[optind]);
+        return 2;
+    }
+
+    int record_count = 0;
+    traffic_record *records = load_session(argv[optind + 1], &record_count);
+    if (!records) return 2;
+    if (record_count == 0) {
+        fprintf(stderr, "no requests in %s\n", argv[optind + 1]);
+        return 2;
+    }
+
+    char script[PATH_MAX + 64];
+    if (script_arg) {
+        snprintf(script, sizeof(script), "%s", script_arg);
+    } else {
+        snprintf(script, sizeof(script), "%s/vendor/nativephp/mobile/bootstrap/android/native.php", root);
+        if (!bundle && access(script, R_OK) != 0) snprintf(script, sizeof(script), "%s/public/index.php", root);
+    }
+
+    if (bundle) {
+        const char *disk_paths[] = {"storage", "bootstrap/cache", "public", ".env"};
+        if (bundle_archive_mount(bundle, 0, 0, root, disk_paths, 4) != 0) {
+            fprintf(stderr, "cannot mount %s\n", bundle);
+            return 1;
+        }
+    }
+    php_runtime_install();
+    php_runtime_prepend_sapi_headers(1);
+    if (chdir(root) != 0) {
+        fprintf(stderr, "cannot enter %s\n", root);
+        return 1;
+    }
+    setenv("NATIVEPHP_RUNNING", "true", 1);
+
+    client *clients = calloc((size_t) client_count, sizeof(client));
+    route_stats *all = &g_routes[MAX_ROUTES];
+    snprintf(all->route, sizeof(all->route), "all");
+    size_t max_depth = 0;
+    double depth_total = 0;
+
+    // Every client starts with the session's first request, now
+    uint64_t first = records[0].arrival_ns;
+    uint64_t start = trace_now();
+    for (int i = 0; i < client_count; i++) clients[i].arrival_ns = start;
+
+    for (;;) {
+        // The PHP thread takes whichever request arrived first
+        client *c = NULL;
+        for (int i = 0; i < client_count; i++) {
+            if (clients[i].next < record_count && (!c || clients[i].arrival_ns < c->arrival_ns)) c = &clients[i];
+        }
+        if (!c) break;
+
+        sleep_until(c->arrival_ns);
+        uint64_t began = trace_now();
+
+        size_t depth = 0;
+        for (int i = 0; i < client_count; i++) {
+            if (clients[i].next < record_count && clients[i].arrival_ns <= began) depth++;
+        }
+        if (depth > max_depth) max_depth = depth;
+        depth_total += (double) depth;
+
+        const traffic_record *record = &records[c->next];
+        set_request_env(record, c, 1);
+        host_response response = {.raw = run(script, record->method, record->uri, record->body)};
+        uint64_t finished = trace_now();
+        set_request_env(record, c, 0);
+        host_response_parse(&response, &c->cookies);
+
+        route_stats *stats[] = {route_for(record->method, record->uri), all};
+        for (int i = 0; i < 2; i++) {
+            if (!stats[i]) continue;
+            if (response.status != record->status) stats[i]->errors++;
+            samples_add(&stats[i]->queue, began - c->arrival_ns);
+            samples_add(&stats[i]->service, finished - began);
+            samples_add(&stats[i]->latency, finished - c->arrival_ns);
+            samples_add(&stats[i]->recorded, record->recorded_ns);
+        }
+        if (response.status != record->status) {
+            fprintf(stderr, "%s %s answered %d, recorded %d\n", record->method, record->uri, response.status,
+                    record->status);
+        }
+        bridge_free(response.raw);
+
+        c->next++;
+        if (c->next < record_count) {
+            c->arrival_ns = speed > 0 ? start + (uint64_t) ((double) (records[c->next].arrival_ns - first) / speed)
+                                      : finished;
+        }
+    }
+    double elapsed = (double) (trace_now() - start) / 1e9;
+    php_runtime_stop();
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", output);
+        return 2;
+    }
+    fprintf(out, "{\n  \"session\": \"%s\",\n  \"speed\": %.2f,\n  \"clients\": %d,\n  \"persistent\": %s,\n",
+            argv[optind + 1], speed, client_count, run == run_php_script_persistent ? "true" : "false");
+    fprintf(out, "  \"elapsed_s\": %.3f,\n  \"rps\": %.2f,\n  \"queue_depth\": {\"mean\": %.2f, \"max\": %zu},\n",
+            elapsed, (double) all->service.count / elapsed, depth_total / (double) all->service.count, max_depth);
+    fprintf(out, "  \"all\": ");
+    print_stats(out, all);
+    fprintf(out, ",\n  \"routes\": {");
+    for (int i = 0; i < g_route_count; i++) {
+        fprintf(out, "%s\n    \"%s\": ", i ? "," : "", g_routes[i].route);
+        print_stats(out, &g_routes[i]);
+    }
+    fprintf(out, "\n  }\n}\n");
+    if (out != stdout) fclose(out);
+
+    fprintf(stderr, "%zu requests in %.1fs, latency p50 %.2fms p99 %.2fms, queued p99 %.2fms, %ld errors\n",
+            all->service.count, elapsed, percentile_ms(&all->latency, 50), percentile_ms(&all->latency, 99),
+            percentile_ms(&all->queue, 99), all->errors);
+
+    for (int i = 0; i < client_count; i++) host_cookie_jar_clear(&clients[i].cookies);
+    free(clients);
+    for (int i = 0; i < record_count; i++) free_record(&records[i]);
+    free(records);
+    if (bundle) bundle_archive_unmount();
+    php_runtime_free_output();
+    return all->errors ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+// Host driver for the bundle archive mount: boots PHP with the archive mounted
+// and runs one request through public/index.php, checking the body.
+//
+//     bundle_archive_test <bundle.zip> <laravel-root> <uri> <expected-text>
+
+#include "../bundle/bundle_archive.h"
+
+#include <sapi/embed/php_embed.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *output = NULL;
+static size_t output_length = 0;
+
+static size_t collect_output(const char *str, size_t length) {
+    char *grown = realloc(output, output_length + length + 1);
+    if (!grown) return 0;
+    output = grown;
+    memcpy(output + output_length, str, length);
+    output_length += length;
+    output[output_length] = '\0';
+    return length;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 5) {
+        fprintf(stderr, "usage: %s <bundle.zip> <laravel-root> <uri> <expected-text>\n", argv[0]);
+        return 2;
+    }
+
+    const char *disk_paths[] = {"storage", "bootstrap/cache", "public", ".env"};
+    if (bundle_archive_mount(argv[1], 0, 0, argv[2], disk_paths, 4) != 0) {
+        fprintf(stderr, "mount failed\n");
+        return 1;
+    }
+
+    char script[4096];
+    snprintf(script, sizeof(script), "%s/public/index.php", argv[2]);
+
+    setenv("REQUEST_URI", argv[3], 1);
+    setenv("REQUEST_METHOD", "GET", 1);
+    setenv("SCRIPT_FILENAME", script, 1);
+    setenv("SCRIPT_NAME", "/index.php", 1);
+    setenv("HTTP_HOST", "127.0.0.1", 1);
+    setenv("NATIVEPHP_RUNNING", "true", 1);
+
+    php_embed_module.ub_write = collect_output;
+    if (php_embed_init(0, NULL) != SUCCESS) {
+        fprintf(stderr, "php_embed_init failed\n");
+        return 1;
+    }
+    bundle_archive_activate();
+
+    zend_first_try {
+        zend_file_handle handle;
+        zend_stream_init_filename(&handle, script);
+        php_execute_script(&handle);
+        zend_destroy_file_handle(&handle);
+    } zend_end_try();
+
+    php_embed_shutdown();
+    bundle_archive_unmount();
+
+    if (!output || !strstr(output, argv[4])) {
+        fprintf(stderr, "expected \"%s\" in response:\n%s\n", argv[4], output ? output : "");
+        return 1;
+    }
+
+    printf("ok: %s served from archive (%zu bytes)\n", argv[3], output_length);
+    return 0;
+}
@@ -0,0 +1,71 @@
+// Host driver for the streaming installer: feeds a zip in uneven chunks the
+// way a network read would, optionally cutting it short, then commits it over
+// an installed tree keeping storage/app.
+//
+//     bundle_stream_test <bundle.zip> <staging> <destination> [stop-after-bytes]
+//     bundle_stream_test recover <staging> <destination>
+
+#include "../bundle/bundle_stream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s <bundle.zip> <staging> <destination> [stop-after-bytes]\n", argv[0]);
+        return 2;
+    }
+
+    long stop_after = argc > 4 ? atol(argv[4]) : -1;
+    const char *keep_paths[] = {"storage/app"};
+
+    if (strcmp(argv[1], "recover") == 0) {
+        int recovered = bundle_stream_recover(argv[2], argv[3], keep_paths, 1);
+        printf("%s\n", recovered ? "recovered a commit" : "nothing to recover");
+        return 0;
+    }
+
+    // Anything left behind by a previous run is resolved first, as on app start
+    bundle_stream_recover(argv[2], argv[3], keep_paths, 1);
+
+    FILE *fp = fopen(argv[1], "rb");
+    if (!fp) {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 2;
+    }
+
+    bundle_stream *stream = bundle_stream_open(argv[2]);
+    if (!stream) return 1;
+
+    static unsigned char buffer[65536];
+    long total = 0;
+    srand(1);
+
+    for (;;) {
+        // Mostly large reads with some tiny ones, so headers get split across calls
+        size_t want = rand() % 4 == 0 ? 1 + rand() % 40 : 1 + rand() % sizeof(buffer);
+        if (stop_after >= 0 && total + (long) want > stop_after) want = (size_t) (stop_after - total);
+
+        size_t n = want > 0 ? fread(buffer, 1, want, fp) : 0;
+        if (n == 0) break;
+        total += (long) n;
+
+        if (bundle_stream_feed(stream, buffer, n) != 0) {
+            bundle_stream_abort(stream);
+            fclose(fp);
+            return 1;
+        }
+    }
+    fclose(fp);
+
+    bundle_stream_stats stats;
+    int files = bundle_stream_finish(stream, &stats);
+    if (files < 0) return 1;
+
+    if (bundle_stream_commit(argv[2], argv[3], keep_paths, 1) != 0) return 1;
+
+    printf("installed %d files from %llu bytes in %.1f ms\n", files,
+           (unsigned long long) stats.bytes_received, stats.elapsed_ms);
+    return 0;
+}
@@ -0,0 +1,261 @@
+// Host checks for the native action bus: handles, completions from other
+// threads, callbacks on the "PHP thread", the order results come out in,
+// coalescing of high-rate events and the queue limit.
+//
+//     native_actions_test
+
+#include "../native/native_actions.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define COMPLETERS 8
+#define PER_COMPLETER 500
+
+static int g_failures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+        g_failures++; \
+    } \
+} while (0)
+
+static uint64_t g_launched[COMPLETERS * PER_COMPLETER + 16];
+static int g_launch_count = 0;
+static int g_fail_launch = 0;
+
+static int record_launch(uint64_t handle, const char *action, const char *args) {
+    if (g_fail_launch) return -1;
+    g_launched[g_launch_count++] = handle;
+    return 0;
+}
+
+// Completes synchronously, before native_actions_begin() has returned
+static int complete_on_launch(uint64_t handle, const char *action, const char *args) {
+    return native_actions_complete(handle, "Immediate", args, 7);
+}
+
+static int g_callback_code = -100;
+static int g_callback_calls = 0;
+
+static void alert_callback(int code) {
+    g_callback_code = code;
+    g_callback_calls++;
+}
+
+// Takes everything queued and checks it against `expected`, "event payload count" per result
+static void expect_results(const char **expected, size_t expected_count) {
+    size_t count;
+    native_action_result *results = native_actions_take(&count);
+    CHECK(count == expected_count);
+    for (size_t i = 0; i < count && i < expected_count; i++) {
+        char actual[512];
+        snprintf(actual, sizeof(actual), "%s %s %u", results[i].event, results[i].payload, results[i].count);
+        if (strcmp(actual, expected[i]) != 0) {
+            fprintf(stderr, "result %zu: expected '%s', got '%s'\n", i, expected[i], actual);
+            g_failures++;
+        }
+    }
+    native_actions_free(results, count);
+}
+
+static void coalescing(void) {
+    native_actions_reset();
+    native_actions_set_launcher(record_launch);
+    native_actions_coalesce("Location", NATIVE_COALESCE_LAST, 60000);
+    native_actions_coalesce("Tick", NATIVE_COALESCE_COUNT, 60000);
+    native_actions_coalesce("Files", NATIVE_COALESCE_LIST, 60000);
+    native_actions_coalesce("Sensor", NATIVE_COALESCE_LAST, 1);
+
+    native_actions_complete(0, "Location", "{\"lat\":1}", 0);
+    native_actions_complete(0, "Tick", "{\"n\":1}", 0);
+    native_actions_complete(0, "Location", "{\"lat\":2}", 0);
+    native_actions_complete(0, "Files", "{\"a\":1}", 0);
+    native_actions_complete(0, "Tick", "{ \"n\":2}", 0);
+    native_actions_complete(0, "Files", "{\"a\":2}", 0);
+    native_actions_complete(0, "Location", "{\"lat\":3}", 0);
+    native_actions_complete(0, "Tick", NULL, 0);
+
+    // A result someone waits on is never merged, even with a rule for its event
+    uint64_t handle = native_actions_begin("location", NULL, NULL);
+    native_actions_complete(handle, "Location", "{\"lat\":4}", 0);
+
+    // Past the window a new result starts
+    native_actions_complete(0, "Sensor", "{\"x\":1}", 0);
+    nanosleep(&(struct timespec) {.tv_nsec = 5000000}, NULL);
+    native_actions_complete(0, "Sensor", "{\"x\":2}", 0);
+    native_actions_complete(0, "Sensor", "{\"x\":3}", 0);
+
+    CHECK(native_actions_completed() == 6);
+    const char *expected[] = {
+            "Location {\"lat\":3} 3",
+            "Tick {} 3",
+            "Files [{\"a\":1},{\"a\":2}] 2",
+            "Location {\"lat\":4} 1",
+            "Sensor {\"x\":1} 1",
+            "Sensor {\"x\":3} 2",
+    };
+    expect_results(expected, 6);
+
+    // Once taken, the next event starts over
+    native_actions_complete(0, "Tick", "{ \"n\":5}", 0);
+    native_actions_coalesce("Tick", NATIVE_COALESCE_NONE, 0);
+    native_actions_complete(0, "Tick", "{\"n\":6}", 0);
+    const char *after[] = {"Tick { \"n\":5} 1", "Tick {\"n\":6} 1"};
+    expect_results(after, 2);
+
+    native_action_stats stats;
+    native_actions_stats(&stats);
+    CHECK(stats.completed == 14 && stats.coalesced == 6 && stats.dropped == 0);
+    CHECK(stats.delivered == 8 && stats.batches == 2 && stats.queued == 0 && stats.queued_peak == 6);
+    CHECK(stats.wait_max_ns >= 5000000 && stats.wait_total_ns >= stats.wait_max_ns);
+
+    // Payloads reach PHP as completed, whatever their JSON type, and only a
+    // LIST result is a batch, even holding a single payload
+    native_actions_coalesce("Steps", NATIVE_COALESCE_COUNT, 60000);
+    native_actions_complete(0, "Steps", "[1,2]", 0);
+    native_actions_complete(0, "Steps", "42", 0);
+    native_actions_complete(0, "Files", "[3]", 0);
+    size_t count;
+    native_action_result *results = native_actions_take(&count);
+    CHECK(count == 2);
+    if (count == 2) {
+        CHECK(strcmp(results[0].payload, "42") == 0 && results[0].count == 2 && !results[0].batch);
+        CHECK(strcmp(results[1].payload, "[[3]]") == 0 && results[1].count == 1 && results[1].batch);
+    }
+    native_actions_free(results, count);
+}
+
+static void queue_limit(void) {
+    native_actions_reset();
+    native_actions_set_launcher(record_launch);
+    native_actions_set_limit(3);
+
+    uint64_t first = native_actions_begin("camera", NULL, NULL);
+    uint64_t alert = native_actions_begin("alert", NULL, alert_callback);
+    native_actions_complete(0, "Drop", "{\"n\":1}", 0);
+    native_actions_complete(first, "Camera", NULL, 0);
+    native_actions_complete(0, "Drop", "{\"n\":2}", 0);
+    native_actions_complete(alert, "", NULL, 0);
+    native_actions_complete(0, "Drop", "{\"n\":3}", 0);
+
+    // Only unsolicited results are dropped, oldest first
+    native_action_stats stats;
+    native_actions_stats(&stats);
+    CHECK(stats.dropped == 2 && stats.queued == 3 && stats.queued_peak == 3);
+    const char *expected[] = {"Camera {} 1", " {} 1", "Drop {\"n\":3} 1"};
+    expect_results(expected, 3);
+
+    native_actions_set_limit(1024);
+    native_actions_reset();
+}
+
+static void *complete_range(void *arg) {
+    int first = *(int *) arg;
+    for (int i = first; i < first + PER_COMPLETER; i++) {
+        native_actions_complete(g_launched[i], "Threaded", "{}", i);
+    }
+    return NULL;
+}
+
+int main(void) {
+    // No launcher: nothing starts
+    CHECK(native_actions_begin("camera", NULL, NULL) == 0);
+    CHECK(native_actions_in_flight() == 0);
+
+    native_actions_set_launcher(record_launch);
+    uint64_t camera = native_actions_begin("camera", NULL, NULL);
+    uint64_t alert = native_actions_begin("alert", "{\"title\":\"Hi\"}", alert_callback);
+    CHECK(camera != 0 && alert != 0 && camera != alert);
+    CHECK(native_actions_in_flight() == 2);
+
+    g_fail_launch = 1;
+    CHECK(native_actions_begin("biometric", NULL, NULL) == 0);
+    CHECK(native_actions_in_flight() == 2);
+    g_fail_launch = 0;
+
+    // Completion order, not start order; unsolicited events use handle 0
+    CHECK(native_actions_complete(alert, "", NULL, 1) == 0);
+    CHECK(native_actions_complete(0, "Push\\Received", "{\"id\":3}", 0) == 0);
+    CHECK(native_actions_complete(camera, "Camera\\PhotoTaken", "{\"path\":\"/x.jpg\"}", 0) == 0);
+    CHECK(native_actions_complete(camera, "Camera\\PhotoTaken", NULL, 0) == -1);
+    CHECK(native_actions_in_flight() == 0);
+    CHECK(native_actions_completed() == 3);
+
+    native_actions_run_callbacks();
+    native_actions_run_callbacks();
+    CHECK(g_callback_calls == 1 && g_callback_code == 1);
+
+    size_t count;
+    native_action_result *results = native_actions_take(&count);
+    CHECK(count == 3);
+    if (count == 3) {
+        CHECK(results[0].handle == alert && strcmp(results[0].action, "alert") == 0);
+        CHECK(strcmp(results[0].event, "") == 0 && strcmp(results[0].payload, "{}") == 0);
+        CHECK(results[1].handle == 0 && strcmp(results[1].event, "Push\\Received") == 0);
+        CHECK(strcmp(results[2].payload, "{\"path\":\"/x.jpg\"}") == 0);
+    }
+    native_actions_free(results, count);
+    CHECK(native_actions_take(&count) == NULL && count == 0);
+
+    // Completed between run_callbacks and take: take still runs the callback
+    alert = native_actions_begin("alert", NULL, alert_callback);
+    native_actions_run_callbacks();
+    CHECK(native_actions_complete(alert, "", NULL, 2) == 0);
+    results = native_actions_take(&count);
+    CHECK(count == 1 && g_callback_calls == 2 && g_callback_code == 2);
+    native_actions_free(results, count);
+
+    // A platform that completes before the launch returns
+    native_actions_set_launcher(complete_on_launch);
+    uint64_t immediate = native_actions_begin("toast", "{\"m\":1}", NULL);
+    CHECK(immediate != 0 && native_actions_in_flight() == 0 && native_actions_completed() == 1);
+    native_actions_reset();
+    CHECK(native_actions_completed() == 0);
+
+    coalescing();
+    queue_limit();
+
+    // Many completers at once, each result delivered exactly once
+    native_actions_set_launcher(record_launch);
+    g_launch_count = 0;
+    for (int i = 0; i < COMPLETERS * PER_COMPLETER; i++) native_actions_begin("location", NULL, NULL);
+    CHECK(g_launch_count == COMPLETERS * PER_COMPLETER);
+
+    pthread_t threads[COMPLETERS];
+    int firsts[COMPLETERS];
+    for (int t = 0; t < COMPLETERS; t++) {
+        firsts[t] = t * PER_COMPLETER;
+        pthread_create(&threads[t], NULL, complete_range, &firsts[t]);
+    }
+    size_t taken = 0;
+    static int seen[COMPLETERS * PER_COMPLETER];
+    for (int t = 0; t < COMPLETERS; t++) {
+        // Drain while the completers are still running
+        results = native_actions_take(&count);
+        for (size_t i = 0; i < count; i++) seen[results[i].code]++;
+        taken += count;
+        native_actions_free(results, count);
+        pthread_join(threads[t], NULL);
+    }
+    results = native_actions_take(&count);
+    for (size_t i = 0; i < count; i++) seen[results[i].code]++;
+    taken += count;
+    native_actions_free(results, count);
+
+    CHECK(taken == COMPLETERS * PER_COMPLETER);
+    int duplicates = 0;
+    for (int i = 0; i < COMPLETERS * PER_COMPLETER; i++) duplicates += seen[i] != 1;
+    CHECK(duplicates == 0);
+    CHECK(native_actions_in_flight() == 0);
+
+    if (g_failures) {
+        fprintf(stderr, "%d checks failed\n", g_failures);
+        return 1;
+    }
+    printf("native actions: ok\n");
+    return 0;
+}
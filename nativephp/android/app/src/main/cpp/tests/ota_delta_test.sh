@@ -0,0 +1,126 @@
+#!/bin/sh
+# Runs a delta update end to end against the stand-in update server: installs
+# 1.0.0, asks the server for an update, applies the patch it hands out and
+# compares the result with a clean 1.1.0. Then checks a tampered install
+# rejects the patch without being modified, that a full install after a delta
+# into a hard-linked slot leaves the running slot alone, and that a download
+# the server keeps cutting off can be resumed to the advertised SHA-256.
+#
+#     ota_delta_test.sh <bundle_delta_tool> <ota-fixture-dir>
+set -e
+
+TOOL=$1
+FIXTURE=$2
+
+if ! command -v php >/dev/null 2>&1 || ! php -r 'exit(class_exists("ZipArchive") ? 0 : 1);'; then
+    echo "php with the zip extension is needed for the update server"
+    exit 77
+fi
+
+WORK=$(mktemp -d)
+SERVER=
+trap '[ -n "$SERVER" ] && kill $SERVER; rm -rf "$WORK"' EXIT
+
+# Two releases: one file edited in the middle, one added, one removed, .env bumped
+mkdir -p "$WORK/v1/app/Http" "$WORK/v1/config" "$WORK/releases"
+head -c 200000 /dev/urandom | base64 > "$WORK/v1/app/Http/Kernel.php"
+echo "<?php return ['name' => 'demo'];" > "$WORK/v1/config/app.php"
+echo "old" > "$WORK/v1/config/removed.php"
+echo "NATIVEPHP_APP_VERSION=1.0.0" > "$WORK/v1/.env"
+
+cp -R "$WORK/v1" "$WORK/v2"
+rm "$WORK/v2/config/removed.php"
+echo "<?php return [];" > "$WORK/v2/config/added.php"
+echo "NATIVEPHP_APP_VERSION=1.1.0" > "$WORK/v2/.env"
+php -r '$f = $argv[1]; $s = file_get_contents($f); file_put_contents($f, substr($s, 0, 100000)."// changed\n".substr($s, 100000));' \
+    "$WORK/v2/app/Http/Kernel.php"
+
+(cd "$WORK/v1" && zip -qr "$WORK/releases/1.0.0.zip" .)
+(cd "$WORK/v2" && zip -qr "$WORK/releases/1.1.0.zip" .)
+echo "1.1.0" > "$WORK/releases/latest"
+
+install_v1() {
+    rm -rf "$1" && mkdir -p "$1"
+    (cd "$1" && unzip -q "$WORK/releases/1.0.0.zip")
+    "$TOOL" manifest "$WORK/releases/1.0.0.zip" "$1"
+}
+
+PORT=$(php -r '$s = stream_socket_server("tcp://127.0.0.1:0"); echo explode(":", stream_socket_get_name($s, false))[1];')
+OTA_RELEASES="$WORK/releases" php -S "127.0.0.1:$PORT" "$FIXTURE/router.php" >"$WORK/server.log" 2>&1 &
+SERVER=$!
+
+fetch() {
+    php -r 'for ($i = 0; $i < 50; $i++) { $body = @file_get_contents($argv[1]); if ($body !== false) { echo $body; exit(0); } usleep(100000); } exit(1);' "$1"
+}
+
+INFO=$(fetch "http://127.0.0.1:$PORT/api/apps/demo/ota?installed=1.0.0")
+PATCH_URL=$(echo "$INFO" | php -r '$r = json_decode(stream_get_contents(STDIN), true); echo $r["patch_from"] === "1.0.0" ? $r["patch_url"] : "";')
+if [ -z "$PATCH_URL" ]; then
+    echo "server offered no patch: $INFO"
+    exit 1
+fi
+fetch "$PATCH_URL" > "$WORK/patch.zip"
+
+FULL=$(wc -c < "$WORK/releases/1.1.0.zip")
+DELTA=$(wc -c < "$WORK/patch.zip")
+echo "full bundle $FULL bytes, patch $DELTA bytes"
+[ "$DELTA" -lt "$FULL" ]
+
+install_v1 "$WORK/installed"
+"$TOOL" apply "$WORK/patch.zip" "$WORK/installed"
+diff -r -x .bundle_manifest "$WORK/v2" "$WORK/installed"
+
+# A file that no longer matches what the patch was made against must fail the
+# hash check and leave the install untouched
+install_v1 "$WORK/tampered"
+php -r '$f = $argv[1]; $s = file_get_contents($f); $s[5] = $s[5] === "A" ? "B" : "A"; file_put_contents($f, $s);' \
+    "$WORK/tampered/app/Http/Kernel.php"
+cp -R "$WORK/tampered" "$WORK/tampered.before"
+
+if "$TOOL" apply "$WORK/patch.zip" "$WORK/tampered"; then
+    echo "patch applied over a modified file"
+    exit 1
+fi
+diff -r "$WORK/tampered.before" "$WORK/tampered"
+
+# The app clones the running slot with hard links before applying a delta, and
+# a later full update lands in that same slot. Files the delta didn't touch are
+# still shared with the running slot, so the install must replace them rather
+# than write through the links. Needs the tool built against libzip.
+if ! "$TOOL" install "$WORK/none.zip" "$WORK/none" 2>&1 | grep -q "unknown command"; then
+    mkdir -p "$WORK/v3"
+    cp -R "$WORK/v2/." "$WORK/v3"
+    echo "<?php return ['name' => 'demo', 'debug' => false];" > "$WORK/v3/config/app.php"
+    echo "NATIVEPHP_APP_VERSION=1.2.0" > "$WORK/v3/.env"
+    (cd "$WORK/v3" && zip -qr "$WORK/releases/1.2.0.zip" .)
+
+    install_v1 "$WORK/slot_a"
+    mkdir "$WORK/slot_b"
+    (cd "$WORK/slot_a" && find . -type d -exec mkdir -p "$WORK/slot_b/{}" \; \
+        && find . -type f -exec ln {} "$WORK/slot_b/{}" \;)
+    cp -R "$WORK/slot_a" "$WORK/slot_a.before"
+
+    "$TOOL" apply "$WORK/patch.zip" "$WORK/slot_b"
+    "$TOOL" install "$WORK/releases/1.2.0.zip" "$WORK/slot_b"
+    diff -r -x .bundle_manifest "$WORK/v3" "$WORK/slot_b"
+    diff -r "$WORK/slot_a.before" "$WORK/slot_a"
+fi
+
+# A server that hangs up every 64 KB must still deliver the full bundle to a
+# client that resumes with Range requests, matching the advertised SHA-256
+if command -v curl >/dev/null 2>&1; then
+    kill $SERVER
+    OTA_DROP_AFTER=65536 OTA_RELEASES="$WORK/releases" php -S "127.0.0.1:$PORT" "$FIXTURE/router.php" >>"$WORK/server.log" 2>&1 &
+    SERVER=$!
+
+    INFO=$(fetch "http://127.0.0.1:$PORT/api/apps/demo/ota?installed=1.0.0")
+    EXPECTED=$(echo "$INFO" | php -r 'echo json_decode(stream_get_contents(STDIN), true)["download_sha256"];')
+
+    rm -f "$WORK/resumed.zip"
+    for attempt in $(seq 1 100); do
+        if curl -sf -C - -o "$WORK/resumed.zip" "http://127.0.0.1:$PORT/releases/1.1.0.zip"; then
+            break
+        fi
+    done
+    [ "$(php -r 'echo hash_file("sha256", $argv[1]);' "$WORK/resumed.zip")" = "$EXPECTED" ]
+fi
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Zips the demo app the way it ships in the APK, extracts only the disk paths
+# and serves /up with PHP reading everything else from the zip.
+#
+#     run_from_archive.sh <bundle_archive_test> <laravel-app-root>
+set -e
+
+DRIVER=$1
+APP=$2
+
+if [ ! -f "$APP/vendor/autoload.php" ]; then
+    echo "vendor/ is missing, run composer install in $APP first"
+    exit 77
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Stored entries so PHP sources are served from the mapping without inflating
+(cd "$APP" && zip -qr -0 "$WORK/laravel_bundle.zip" . \
+    -x '.git/*' 'node_modules/*' 'nativephp/*' 'storage/*' '.env')
+
+mkdir -p "$WORK/laravel"
+cd "$WORK/laravel"
+unzip -q ../laravel_bundle.zip 'public/*' 'bootstrap/cache/*' || [ $? -eq 11 ]
+mkdir -p bootstrap/cache storage/framework/cache storage/framework/sessions storage/framework/views storage/logs
+
+cat > .env <<ENV
+APP_KEY=base64:$(head -c 32 /dev/urandom | base64)
+APP_ENV=local
+APP_DEBUG=true
+SESSION_DRIVER=array
+CACHE_STORE=array
+LOG_CHANNEL=stderr
+ENV
+
+"$DRIVER" "$WORK/laravel_bundle.zip" "$WORK/laravel" /up "Application up"
+
+if [ -d vendor ] || [ -d app ]; then
+    echo "application code was extracted to disk"
+    exit 1
+fi
@@ -0,0 +1,57 @@
+#!/bin/sh
+# Benchmarks the demo app through php_runtime_bench, served from its bundle zip
+# as on device, against a fresh SQLite database seeded with the test user.
+# Options after the app root go to php_runtime_bench; the JSON goes to stdout
+# unless one of them is -o.
+#
+#     runtime_bench.sh <php_runtime_bench> <php_runtime_cli> <laravel-app-root> [options] [scenario...]
+set -e
+
+BENCH=$1
+CLI=$2
+APP=$3
+shift 3
+
+if [ ! -f "$APP/vendor/autoload.php" ]; then
+    echo "vendor/ is missing, run composer install in $APP first"
+    exit 77
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+(cd "$APP" && zip -qr -0 "$WORK/laravel_bundle.zip" . \
+    -x '.git/*' 'node_modules/*' 'nativephp/*' 'storage/*' '.env' 'database/*.sqlite')
+
+# The runtime runs artisan from artisan.php, which the app bundle ships
+if ! unzip -l "$WORK/laravel_bundle.zip" artisan.php > /dev/null 2>&1; then
+    mkdir "$WORK/stage"
+    sed 1d "$APP/artisan" > "$WORK/stage/artisan.php"
+    (cd "$WORK/stage" && zip -q -0 ../laravel_bundle.zip artisan.php)
+fi
+
+mkdir -p "$WORK/laravel"
+cd "$WORK/laravel"
+unzip -q ../laravel_bundle.zip 'public/*' 'bootstrap/cache/*' || [ $? -eq 11 ]
+mkdir -p bootstrap/cache storage/framework/cache storage/framework/sessions storage/framework/views storage/logs
+touch "$WORK/database.sqlite"
+
+cat > .env <<ENV
+APP_KEY=base64:$(head -c 32 /dev/urandom | base64)
+APP_ENV=local
+APP_DEBUG=false
+DB_CONNECTION=sqlite
+DB_DATABASE=$WORK/database.sqlite
+SESSION_DRIVER=database
+CACHE_STORE=database
+LOG_CHANNEL=stderr
+LOG_LEVEL=error
+ENV
+
+"$CLI" -q -b "$WORK/laravel_bundle.zip" -a "migrate:fresh --seed --force" "$WORK/laravel"
+
+SCRIPT="$WORK/laravel/vendor/nativephp/mobile/bootstrap/android/native.php"
+[ -f "$APP/vendor/nativephp/mobile/bootstrap/android/native.php" ] || SCRIPT="$WORK/laravel/public/index.php"
+
+LABEL=$(git -C "$APP" rev-parse --short HEAD 2>/dev/null || echo "")
+"$BENCH" -b "$WORK/laravel_bundle.zip" -s "$SCRIPT" -L "$LABEL" "$WORK/laravel" "$@"
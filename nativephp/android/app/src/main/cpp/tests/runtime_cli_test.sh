@@ -0,0 +1,55 @@
+#!/bin/sh
+# Serves /up from the demo app a few times through php_runtime_cli, running
+# from the bundle zip as on device, and checks every request answered 200.
+# Two native events queued beforehand must reach Laravel in one dispatch.
+#
+#     runtime_cli_test.sh <php_runtime_cli> <laravel-app-root>
+set -e
+
+CLI=$1
+APP=$2
+
+if [ ! -f "$APP/vendor/autoload.php" ]; then
+    echo "vendor/ is missing, run composer install in $APP first"
+    exit 77
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+(cd "$APP" && zip -qr -0 "$WORK/laravel_bundle.zip" . \
+    -x '.git/*' 'node_modules/*' 'nativephp/*' 'storage/*' '.env')
+
+# The runtime runs artisan from artisan.php, which the app bundle ships
+if ! unzip -l "$WORK/laravel_bundle.zip" artisan.php > /dev/null 2>&1; then
+    mkdir "$WORK/stage"
+    sed 1d "$APP/artisan" > "$WORK/stage/artisan.php"
+    (cd "$WORK/stage" && zip -q -0 ../laravel_bundle.zip artisan.php)
+fi
+
+mkdir -p "$WORK/laravel"
+cd "$WORK/laravel"
+unzip -q ../laravel_bundle.zip 'public/*' 'bootstrap/cache/*' || [ $? -eq 11 ]
+mkdir -p bootstrap/cache storage/framework/cache storage/framework/sessions storage/framework/views storage/logs
+
+cat > .env <<ENV
+APP_KEY=base64:$(head -c 32 /dev/urandom | base64)
+APP_ENV=local
+APP_DEBUG=true
+SESSION_DRIVER=array
+CACHE_STORE=array
+LOG_CHANNEL=stderr
+ENV
+
+"$CLI" -q -n 3 -e 'native.test {"step":1}' -e 'native.test {"step":2}' -b "$WORK/laravel_bundle.zip" -s "$WORK/laravel/public/index.php" "$WORK/laravel" GET /up 2> "$WORK/timings"
+cat "$WORK/timings"
+
+if [ "$(grep -c '^GET /up  200 ' "$WORK/timings")" -ne 3 ]; then
+    echo "expected three 200 responses"
+    exit 1
+fi
+
+if ! grep -q '^Dispatched 2 native events' "$WORK/timings"; then
+    echo "expected both native events dispatched in one run"
+    exit 1
+fi
@@ -0,0 +1,68 @@
+#!/bin/sh
+# Streams a bundle into an installed tree and checks the result matches the
+# bundle, user data under storage/app survives, a download cut short leaves
+# the installed version untouched and an interrupted commit is finished.
+#
+#     stream_install_test.sh <bundle_stream_test>
+set -e
+
+DRIVER=$1
+
+if ! command -v zip >/dev/null 2>&1; then
+    echo "zip is needed to build the test bundle"
+    exit 77
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+mkdir -p "$WORK/v1/app/Models" "$WORK/v2/app/Models" "$WORK/v2/config" "$WORK/v2/storage/app"
+echo "NATIVEPHP_APP_VERSION=1.0.0" > "$WORK/v1/.env"
+echo "<?php // old" > "$WORK/v1/app/Models/User.php"
+echo "NATIVEPHP_APP_VERSION=1.1.0" > "$WORK/v2/.env"
+head -c 300000 /dev/urandom > "$WORK/v2/app/Models/User.php"
+seq 1 50000 > "$WORK/v2/config/app.php"
+: > "$WORK/v2/config/empty.php"
+: > "$WORK/v2/storage/app/.gitignore"
+(cd "$WORK/v2" && zip -qr "$WORK/v2.zip" .)
+
+# The installed tree has user data the update must carry over
+cp -R "$WORK/v1" "$WORK/installed"
+mkdir -p "$WORK/installed/storage/app"
+echo "user upload" > "$WORK/installed/storage/app/photo.jpg"
+cp -R "$WORK/installed" "$WORK/installed.before"
+
+# A download cut off half way must not touch the install
+HALF=$(( $(wc -c < "$WORK/v2.zip") / 2 ))
+if "$DRIVER" "$WORK/v2.zip" "$WORK/staging" "$WORK/installed" "$HALF"; then
+    echo "a truncated bundle was committed"
+    exit 1
+fi
+diff -r "$WORK/installed.before" "$WORK/installed"
+
+# A complete one replaces the tree, keeping storage/app from the old install
+"$DRIVER" "$WORK/v2.zip" "$WORK/staging" "$WORK/installed"
+rm "$WORK/v2/storage/app/.gitignore"
+cp "$WORK/installed.before/storage/app/photo.jpg" "$WORK/v2/storage/app/"
+diff -r -x .bundle_manifest "$WORK/v2" "$WORK/installed"
+test ! -e "$WORK/staging"
+test ! -e "$WORK/installed.old"
+
+# A commit cut short after its marker went down is finished at the next start,
+# and reported so the caller can stage the version it never got to
+rm -rf "$WORK/installed" "$WORK/staging"
+cp -R "$WORK/installed.before" "$WORK/installed"
+cp -R "$WORK/v2" "$WORK/staging"
+rm "$WORK/staging/storage/app/photo.jpg"
+: > "$WORK/staging/.commit_pending"
+[ "$("$DRIVER" recover "$WORK/staging" "$WORK/installed")" = "recovered a commit" ]
+diff -r "$WORK/v2" "$WORK/installed"
+[ "$("$DRIVER" recover "$WORK/staging" "$WORK/installed")" = "nothing to recover" ]
+
+# Likewise a crash after the swap, before the old tree was cleaned up
+mv "$WORK/installed" "$WORK/installed.old"
+cp -R "$WORK/v2" "$WORK/installed"
+: > "$WORK/installed/.commit_pending"
+[ "$("$DRIVER" recover "$WORK/staging" "$WORK/installed")" = "recovered a commit" ]
+diff -r "$WORK/v2" "$WORK/installed"
+test ! -e "$WORK/installed.old"
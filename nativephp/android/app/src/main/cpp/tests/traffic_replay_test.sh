@@ -0,0 +1,50 @@
+#!/bin/sh
+# Replays a hand-written traffic log of three GET /up requests, 50ms apart,
+# as two clients against the demo app served from its bundle zip, and checks
+# every request got the recorded 200.
+#
+#     traffic_replay_test.sh <traffic_replay> <laravel-app-root>
+set -e
+
+REPLAY=$1
+APP=$2
+
+if [ ! -f "$APP/vendor/autoload.php" ]; then
+    echo "vendor/ is missing, run composer install in $APP first"
+    exit 77
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+(cd "$APP" && zip -qr -0 "$WORK/laravel_bundle.zip" . \
+    -x '.git/*' 'node_modules/*' 'nativephp/*' 'storage/*' '.env')
+
+mkdir -p "$WORK/laravel"
+cd "$WORK/laravel"
+unzip -q ../laravel_bundle.zip 'public/*' 'bootstrap/cache/*' || [ $? -eq 11 ]
+mkdir -p bootstrap/cache storage/framework/cache storage/framework/sessions storage/framework/views storage/logs
+
+cat > .env <<ENV
+APP_KEY=base64:$(head -c 32 /dev/urandom | base64)
+APP_ENV=local
+APP_DEBUG=true
+SESSION_DRIVER=array
+CACHE_STORE=array
+LOG_CHANNEL=stderr
+ENV
+
+# Header, then per request: arrival µs, "GET", "/up", no headers, no body,
+# status 200, no phases. Varints: 50000 is \320\206\003, 100000 \240\215\006.
+{
+    printf 'NPTR\001\000'
+    printf '\000\003GET\003/up\000\000\310\001\000'
+    printf '\320\206\003\003GET\003/up\000\000\310\001\000'
+    printf '\240\215\006\003GET\003/up\000\000\310\001\000'
+} > "$WORK/session.nptr"
+
+"$REPLAY" -c 2 -b "$WORK/laravel_bundle.zip" -s "$WORK/laravel/public/index.php" -o "$WORK/replay.json" \
+    "$WORK/laravel" "$WORK/session.nptr"
+cat "$WORK/replay.json"
+
+grep -q '"all": {"requests": 6, "errors": 0' "$WORK/replay.json"
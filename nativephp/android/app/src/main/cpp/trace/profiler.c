@@ -0,0 +1,406 @@
+#include "profiler.h"
+#include "trace.h"
+
+#include <php.h>
+#include <zend_observer.h>
+#include <android/log.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define LOG_TAG "Profiler"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+#define PROFILER_MAX_DEPTH 1024
+#define PROFILER_ROOT 0
+
+typedef struct {
+    const void *key;
+    char *name;
+    char *file;
+    uint32_t line;
+    uint64_t calls;
+    uint64_t self_ns;
+    int64_t self_mem;
+} prof_function;
+
+typedef struct {
+    uint32_t caller;
+    uint32_t callee;
+    uint64_t calls;
+    uint64_t ns;
+    int64_t mem;
+} prof_edge;
+
+typedef struct {
+    uint32_t function;
+    uint64_t start;
+    int64_t start_mem;
+    uint64_t child_ns;
+    int64_t child_mem;
+} prof_frame;
+
+// Open-addressing table of indexes into a growable array
+typedef struct {
+    uint32_t *slots;        // index + 1, 0 is empty
+    size_t capacity;
+} prof_table;
+
+// Settings, written from the UI thread
+static pthread_mutex_t g_settings_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_enabled = 0;
+static int g_next = 0;
+static char g_directory[512];
+
+// Per request, only touched on the PHP thread
+static int g_active = 0;
+static char g_active_directory[512];
+
+static prof_function *g_functions = NULL;
+static size_t g_function_count = 0, g_function_capacity = 0;
+static prof_table g_function_table;
+
+static prof_edge *g_edges = NULL;
+static size_t g_edge_count = 0, g_edge_capacity = 0;
+static prof_table g_edge_table;
+
+static prof_frame g_stack[PROFILER_MAX_DEPTH];
+static size_t g_depth = 0;
+static uint64_t g_request_start = 0;
+
+static uint64_t hash_u64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static uint64_t edge_key(uint32_t caller, uint32_t callee) {
+    return ((uint64_t) caller << 32) | callee;
+}
+
+static uint64_t function_key(uint32_t index) {
+    return (uint64_t) (uintptr_t) g_functions[index].key;
+}
+
+static uint64_t edge_key_at(uint32_t index) {
+    return edge_key(g_edges[index].caller, g_edges[index].callee);
+}
+
+// Finds `key` or the empty slot for it, growing the table first if it's getting full
+static uint32_t *table_slot(prof_table *table, size_t count, uint64_t key, uint64_t (*key_at)(uint32_t)) {
+    if ((count + 1) * 10 >= table->capacity * 7) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 1024;
+        uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+        if (!slots) return NULL;
+        for (size_t i = 0; i < table->capacity; i++) {
+            uint32_t entry = table->slots[i];
+            if (!entry) continue;
+            size_t pos = hash_u64(key_at(entry - 1)) & (capacity - 1);
+            while (slots[pos]) pos = (pos + 1) & (capacity - 1);
+            slots[pos] = entry;
+        }
+        free(table->slots);
+        table->slots = slots;
+        table->capacity = capacity;
+    }
+
+    size_t pos = hash_u64(key) & (table->capacity - 1);
+    while (table->slots[pos] && key_at(table->slots[pos] - 1) != key) {
+        pos = (pos + 1) & (table->capacity - 1);
+    }
+    return &table->slots[pos];
+}
+
+static int grow(void **array, size_t *capacity, size_t element_size) {
+    size_t next = *capacity ? *capacity * 2 : 256;
+    void *grown = realloc(*array, next * element_size);
+    if (!grown) return -1;
+    *array = grown;
+    *capacity = next;
+    return 0;
+}
+
+static int64_t memory_now(void) {
+    return (int64_t) zend_memory_usage(false);
+}
+
+// Closures are copied per object but share their opcodes, so key user code by those.
+// A file's op_array is freed once it has run and its memory reused by the next
+// include; its filename is kept until shutdown, so files are keyed by that.
+static const void *key_of(zend_function *func) {
+    if (!func) return NULL;
+    if (func->type != ZEND_USER_FUNCTION) return func;
+    if (!func->common.function_name && func->op_array.filename) return func->op_array.filename;
+    return func->op_array.opcodes;
+}
+
+// File op_arrays are freed as soon as they've run, so names are copied while the function is live
+static void describe(prof_function *entry, zend_function *func) {
+    const char *file = "[internal]";
+    char name[512];
+
+    if (!func) {
+        file = "[request]";
+        snprintf(name, sizeof(name), "{request}");
+    } else {
+        if (func->type == ZEND_USER_FUNCTION && func->op_array.filename) {
+            file = ZSTR_VAL(func->op_array.filename);
+            entry->line = func->op_array.line_start;
+        }
+        if (!func->common.function_name) {
+            snprintf(name, sizeof(name), "{main} %s", file);
+        } else if (func->common.scope) {
+            snprintf(name, sizeof(name), "%s::%s", ZSTR_VAL(func->common.scope->name),
+                     ZSTR_VAL(func->common.function_name));
+        } else {
+            snprintf(name, sizeof(name), "%s", ZSTR_VAL(func->common.function_name));
+        }
+    }
+    entry->name = strdup(name);
+    entry->file = strdup(file);
+}
+
+static uint32_t intern_function(zend_function *func) {
+    const void *key = key_of(func);
+    uint32_t *slot = table_slot(&g_function_table, g_function_count, (uint64_t) (uintptr_t) key, function_key);
+    if (!slot) return PROFILER_ROOT;
+    if (*slot) return *slot - 1;
+
+    if (g_function_count == g_function_capacity &&
+        grow((void **) &g_functions, &g_function_capacity, sizeof(prof_function)) != 0) {
+        return PROFILER_ROOT;
+    }
+    prof_function *entry = &g_functions[g_function_count];
+    memset(entry, 0, sizeof(*entry));
+    entry->key = key;
+    describe(entry, func);
+    *slot = (uint32_t) ++g_function_count;
+    return (uint32_t) (g_function_count - 1);
+}
+
+static prof_edge *intern_edge(uint32_t caller, uint32_t callee) {
+    uint32_t *slot = table_slot(&g_edge_table, g_edge_count, edge_key(caller, callee), edge_key_at);
+    if (!slot) return NULL;
+    if (*slot) return &g_edges[*slot - 1];
+
+    if (g_edge_count == g_edge_capacity &&
+        grow((void **) &g_edges, &g_edge_capacity, sizeof(prof_edge)) != 0) {
+        return NULL;
+    }
+    prof_edge *edge = &g_edges[g_edge_count];
+    memset(edge, 0, sizeof(*edge));
+    edge->caller = caller;
+    edge->callee = callee;
+    *slot = (uint32_t) ++g_edge_count;
+    return edge;
+}
+
+static void reset_profile(void) {
+    for (size_t i = 0; i < g_function_count; i++) {
+        free(g_functions[i].name);
+        free(g_functions[i].file);
+    }
+    free(g_functions);
+    free(g_edges);
+    free(g_function_table.slots);
+    free(g_edge_table.slots);
+    g_functions = NULL;
+    g_edges = NULL;
+    g_function_count = g_function_capacity = 0;
+    g_edge_count = g_edge_capacity = 0;
+    memset(&g_function_table, 0, sizeof(g_function_table));
+    memset(&g_edge_table, 0, sizeof(g_edge_table));
+    g_depth = 0;
+}
+
+static void observer_begin(zend_execute_data *execute_data) {
+    if (g_depth++ >= PROFILER_MAX_DEPTH) return;
+
+    prof_frame *frame = &g_stack[g_depth - 1];
+    frame->function = intern_function(execute_data->func);
+    frame->child_ns = 0;
+    frame->child_mem = 0;
+    frame->start_mem = memory_now();
+    frame->start = trace_now();
+}
+
+static void observer_end(zend_execute_data *execute_data, zval *retval) {
+    uint64_t now = trace_now();
+    if (g_depth == 0) return;
+    if (--g_depth >= PROFILER_MAX_DEPTH) return;
+
+    prof_frame *frame = &g_stack[g_depth];
+    uint64_t inclusive = now - frame->start;
+    int64_t memory = memory_now() - frame->start_mem;
+
+    prof_function *function = &g_functions[frame->function];
+    function->calls++;
+    function->self_ns += inclusive > frame->child_ns ? inclusive - frame->child_ns : 0;
+    function->self_mem += memory - frame->child_mem;
+
+    uint32_t caller = PROFILER_ROOT;
+    if (g_depth > 0) {
+        prof_frame *parent = &g_stack[g_depth - 1];
+        parent->child_ns += inclusive;
+        parent->child_mem += memory;
+        caller = parent->function;
+    }
+
+    prof_edge *edge = intern_edge(caller, frame->function);
+    if (edge) {
+        edge->calls++;
+        edge->ns += inclusive;
+        edge->mem += memory;
+    }
+}
+
+static zend_observer_fcall_handlers observer_init(zend_execute_data *execute_data) {
+    zend_observer_fcall_handlers handlers = {NULL, NULL};
+    if (g_active) {
+        handlers.begin = observer_begin;
+        handlers.end = observer_end;
+    }
+    return handlers;
+}
+
+static PHP_MINIT_FUNCTION(nativephp_profiler) {
+    zend_observer_fcall_register(observer_init);
+    return SUCCESS;
+}
+
+static zend_module_entry g_profiler_module = {
+        STANDARD_MODULE_HEADER,
+        "nativephp_profiler",
+        NULL,
+        PHP_MINIT(nativephp_profiler),
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        "1.0",
+        STANDARD_MODULE_PROPERTIES
+};
+
+struct _zend_module_entry *profiler_startup_module(void) {
+    return g_active ? &g_profiler_module : NULL;
+}
+
+void profiler_set_enabled(int enabled, const char *directory) {
+    pthread_mutex_lock(&g_settings_lock);
+    g_enabled = enabled;
+    if (directory) snprintf(g_directory, sizeof(g_directory), "%s", directory);
+    pthread_mutex_unlock(&g_settings_lock);
+}
+
+void profiler_profile_next(const char *directory) {
+    pthread_mutex_lock(&g_settings_lock);
+    g_next = 1;
+    if (directory) snprintf(g_directory, sizeof(g_directory), "%s", directory);
+    pthread_mutex_unlock(&g_settings_lock);
+}
+
+int profiler_prepare_request(void) {
+    pthread_mutex_lock(&g_settings_lock);
+    g_active = (g_enabled || g_next) && g_directory[0];
+    g_next = 0;
+    memcpy(g_active_directory, g_directory, sizeof(g_directory));
+    pthread_mutex_unlock(&g_settings_lock);
+
+    if (!g_active) return 0;
+
+    reset_profile();
+    // Index 0 stands for whatever called into the first observed frame
+    intern_function(NULL);
+    g_request_start = trace_now();
+    return 1;
+}
+
+static void write_function(FILE *out, const char *kind, uint32_t index, unsigned char *named) {
+    const prof_function *function = &g_functions[index];
+    fprintf(out, "%sfl=%s\n", kind, function->file ? function->file : "");
+
+    // Callgrind name compression: the name is spelled out once, then only its id
+    if (named[index]) {
+        fprintf(out, "%sfn=(%u)\n", kind, index);
+    } else {
+        named[index] = 1;
+        fprintf(out, "%sfn=(%u) %s\n", kind, index, function->name ? function->name : "?");
+    }
+}
+
+static int compare_edges(const void *a, const void *b) {
+    const prof_edge *x = a, *y = b;
+    if (x->caller != y->caller) return x->caller < y->caller ? -1 : 1;
+    return x->callee < y->callee ? -1 : x->callee > y->callee;
+}
+
+static void sanitize(const char *label, char *out, size_t size) {
+    size_t used = 0;
+    for (const char *c = label; *c && used + 1 < size; c++) {
+        out[used++] = (isalnum((unsigned char) *c) || *c == '-') ? *c : '_';
+    }
+    out[used] = '\0';
+}
+
+static void write_callgrind(FILE *out, const char *label) {
+    uint64_t total = trace_now() - g_request_start;
+
+    fprintf(out, "# callgrind format\nversion: 1\ncreator: nativephp-profiler\ncmd: %s\n", label);
+    fputs("positions: line\nevents: Wall_ns Memory_bytes\n", out);
+    fprintf(out, "summary: %llu 0\n\n", (unsigned long long) total);
+
+    qsort(g_edges, g_edge_count, sizeof(prof_edge), compare_edges);
+    unsigned char *named = calloc(g_function_count ? g_function_count : 1, 1);
+    if (!named) return;
+
+    size_t e = 0;
+    for (uint32_t f = 0; f < g_function_count; f++) {
+        const prof_function *function = &g_functions[f];
+        write_function(out, "", f, named);
+        // Callgrind costs can't go negative; a function that freed more than it kept counts as 0
+        fprintf(out, "%u %llu %lld\n", function->line, (unsigned long long) function->self_ns,
+                (long long) (function->self_mem > 0 ? function->self_mem : 0));
+
+        while (e < g_edge_count && g_edges[e].caller < f) e++;
+        for (; e < g_edge_count && g_edges[e].caller == f; e++) {
+            const prof_edge *edge = &g_edges[e];
+            write_function(out, "c", edge->callee, named);
+            fprintf(out, "calls=%llu %u\n", (unsigned long long) edge->calls, g_functions[edge->callee].line);
+            fprintf(out, "%u %llu %lld\n", function->line, (unsigned long long) edge->ns,
+                    (long long) (edge->mem > 0 ? edge->mem : 0));
+        }
+        fputc('\n', out);
+    }
+    free(named);
+}
+
+void profiler_finish_request(const char *label) {
+    if (!g_active) return;
+    g_active = 0;
+
+    char name[96];
+    sanitize(label, name, sizeof(name));
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    char path[768];
+    snprintf(path, sizeof(path), "%s/callgrind.%lld.%s.out", g_active_directory,
+             (long long) tv.tv_sec * 1000 + tv.tv_usec / 1000, name);
+
+    FILE *out = fopen(path, "we");
+    if (out) {
+        write_callgrind(out, label);
+        fclose(out);
+        LOGI("Wrote profile of %s (%zu functions) to %s", label, g_function_count - 1, path);
+    } else {
+        LOGE("Cannot write profile %s: %s", path, strerror(errno));
+    }
+    reset_profile();
+}
@@ -0,0 +1,45 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Function-level profiler on the zend_observer fcall API ===
+//
+// Records call counts, inclusive and exclusive wall time and Zend MM
+// allocation deltas per function and per caller/callee pair, and writes
+// one callgrind file per profiled request (open it in KCachegrind or
+// QCachegrind).
+//
+// The observer is only registered by a small module loaded at engine startup
+// when the coming request is to be profiled. The engine is started per
+// request, so unprofiled requests run with no observer at all.
+
+struct _zend_module_entry;
+
+// Profile every request until switched off, writing into `directory`.
+void profiler_set_enabled(int enabled, const char *directory);
+
+// Profile only the next request, writing into `directory`.
+void profiler_profile_next(const char *directory);
+
+// Before php_embed_init: decides whether this request is profiled.
+// Returns 1 if it is.
+int profiler_prepare_request(void);
+
+// Extra module to pass to php_module_startup, NULL unless this request is profiled.
+struct _zend_module_entry *profiler_startup_module(void);
+
+// After the script ran and before engine shutdown, while the functions the
+// profile points at are still alive. Writes the callgrind file for `label`
+// (e.g. "GET /users") and resets.
+void profiler_finish_request(const char *label);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PROFILER_H
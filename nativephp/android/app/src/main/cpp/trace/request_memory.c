@@ -0,0 +1,99 @@
+#include "request_memory.h"
+
+#include <php.h>
+
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+static atomic_llong g_bridge_live = 0;
+static atomic_llong g_bridge_allocs = 0;
+
+// Per request, only touched on the PHP thread
+static int64_t g_values[REQUEST_MEMORY_COUNT];
+static int64_t g_native_before = 0;
+static int64_t g_allocs_before = 0;
+static int64_t g_faults_before = 0;
+
+static int64_t rss_bytes(void) {
+    FILE *statm = fopen("/proc/self/statm", "re");
+    if (!statm) return 0;
+
+    long long size = 0, resident = 0;
+    int matched = fscanf(statm, "%lld %lld", &size, &resident);
+    fclose(statm);
+    return matched == 2 ? (int64_t) resident * sysconf(_SC_PAGESIZE) : 0;
+}
+
+static int64_t thread_minor_faults(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_THREAD, &usage) == 0 ? (int64_t) usage.ru_minflt : 0;
+}
+
+static int64_t native_heap_bytes(void) {
+    struct mallinfo info = mallinfo();
+    return (int64_t) (size_t) info.uordblks;
+}
+
+void request_memory_begin(void) {
+    memset(g_values, 0, sizeof(g_values));
+    g_values[REQUEST_MEMORY_RSS_BEFORE] = rss_bytes();
+    g_native_before = native_heap_bytes();
+    g_allocs_before = atomic_load(&g_bridge_allocs);
+    g_faults_before = thread_minor_faults();
+}
+
+void request_memory_sample_zend(void) {
+    g_values[REQUEST_MEMORY_ZEND_USAGE] = (int64_t) zend_memory_usage(false);
+    g_values[REQUEST_MEMORY_ZEND_PEAK] = (int64_t) zend_memory_peak_usage(false);
+    g_values[REQUEST_MEMORY_ZEND_REAL_PEAK] = (int64_t) zend_memory_peak_usage(true);
+}
+
+void request_memory_end(void) {
+    g_values[REQUEST_MEMORY_RSS_AFTER] = rss_bytes();
+    g_values[REQUEST_MEMORY_NATIVE_DELTA] = native_heap_bytes() - g_native_before;
+    g_values[REQUEST_MEMORY_BRIDGE_LIVE] = atomic_load(&g_bridge_live);
+    g_values[REQUEST_MEMORY_BRIDGE_ALLOCS] = atomic_load(&g_bridge_allocs) - g_allocs_before;
+    g_values[REQUEST_MEMORY_MINOR_FAULTS] = thread_minor_faults() - g_faults_before;
+}
+
+void request_memory_get(int64_t values[REQUEST_MEMORY_COUNT]) {
+    memcpy(values, g_values, sizeof(g_values));
+}
+
+// Usable size rather than the requested one, so frees balance without callers passing sizes
+void *bridge_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (ptr) {
+        atomic_fetch_add(&g_bridge_live, (long long) malloc_usable_size(ptr));
+        atomic_fetch_add(&g_bridge_allocs, 1);
+    }
+    return ptr;
+}
+
+void *bridge_realloc(void *ptr, size_t size) {
+    size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+    void *grown = realloc(ptr, size);
+    if (grown) {
+        atomic_fetch_add(&g_bridge_live, (long long) malloc_usable_size(grown) - (long long) old_size);
+        atomic_fetch_add(&g_bridge_allocs, 1);
+    }
+    return grown;
+}
+
+char *bridge_strdup(const char *str) {
+    size_t length = strlen(str) + 1;
+    char *copy = bridge_malloc(length);
+    if (copy) memcpy(copy, str, length);
+    return copy;
+}
+
+void bridge_free(void *ptr) {
+    if (!ptr) return;
+    atomic_fetch_sub(&g_bridge_live, (long long) malloc_usable_size(ptr));
+    free(ptr);
+}
@@ -0,0 +1,48 @@
+#ifndef REQUEST_MEMORY_H
+#define REQUEST_MEMORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Memory used by each request ===
+//
+// Zend MM figures are read just before the engine shuts down; RSS and the
+// native heap are compared across the whole request, engine start to engine
+// teardown. The bridge's own heap buffers go through bridge_malloc() and
+// friends so that what it still holds between requests is visible on its own:
+// that number should come back to the same value after every request.
+
+typedef enum {
+    REQUEST_MEMORY_ZEND_USAGE,      // Zend MM bytes in use at the end of the script
+    REQUEST_MEMORY_ZEND_PEAK,       // peak Zend MM bytes requested
+    REQUEST_MEMORY_ZEND_REAL_PEAK,  // peak Zend MM bytes taken from the system
+    REQUEST_MEMORY_RSS_BEFORE,
+    REQUEST_MEMORY_RSS_AFTER,
+    REQUEST_MEMORY_NATIVE_DELTA,    // change in malloc'd bytes across the request, whole process
+    REQUEST_MEMORY_BRIDGE_LIVE,     // bytes the bridge holds once the request is over
+    REQUEST_MEMORY_BRIDGE_ALLOCS,   // bridge allocations made during the request
+    REQUEST_MEMORY_MINOR_FAULTS,    // page faults taken by the PHP thread
+    REQUEST_MEMORY_COUNT
+} request_memory_field;
+
+// Per request, on the PHP thread
+void request_memory_begin(void);        // before engine startup
+void request_memory_sample_zend(void);  // after the script, before engine shutdown
+void request_memory_end(void);          // after engine shutdown
+void request_memory_get(int64_t values[REQUEST_MEMORY_COUNT]);
+
+// Counted allocations for the bridge's own buffers
+void *bridge_malloc(size_t size);
+void *bridge_realloc(void *ptr, size_t size);
+char *bridge_strdup(const char *str);
+void bridge_free(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REQUEST_MEMORY_H
@@ -0,0 +1,218 @@
+#include "request_timing.h"
+#include "trace.h"
+
+#include <php.h>
+#include <android/log.h>
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_TAG "RequestTiming"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+#define REQUEST_STATS_ROUTES 64
+#define REQUEST_STATS_SAMPLES 128
+#define REQUEST_ROUTE_MAX 160
+
+static const char *const g_phase_names[REQUEST_PHASE_COUNT] = {
+        "queue", "startup", "compile", "execute", "output", "shutdown", "convert",
+};
+
+typedef struct {
+    char route[REQUEST_ROUTE_MAX];
+    uint64_t count;
+    // Ring of the last REQUEST_STATS_SAMPLES requests; slot REQUEST_PHASE_COUNT is the total
+    uint64_t samples[REQUEST_STATS_SAMPLES][REQUEST_PHASE_COUNT + 1];
+} route_stats;
+
+// Only ever touched from the PHP thread
+static uint64_t g_current[REQUEST_PHASE_COUNT];
+static uint64_t g_execute_start;
+static uint64_t g_execute_nested;
+
+static route_stats *g_routes[REQUEST_STATS_ROUTES];
+static size_t g_route_count = 0;
+static pthread_mutex_t g_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static zend_op_array *(*g_original_compile_file)(zend_file_handle *file_handle, int type) = NULL;
+
+const char *request_phase_name(request_phase phase) {
+    return phase < REQUEST_PHASE_COUNT ? g_phase_names[phase] : "unknown";
+}
+
+void request_timing_reset(void) {
+    memset(g_current, 0, sizeof(g_current));
+}
+
+void request_timing_add(request_phase phase, uint64_t ns) {
+    g_current[phase] += ns;
+}
+
+void request_timing_execute_begin(void) {
+    g_execute_nested = g_current[REQUEST_PHASE_COMPILE] + g_current[REQUEST_PHASE_OUTPUT];
+    g_execute_start = trace_now();
+}
+
+void request_timing_execute_end(void) {
+    uint64_t elapsed = trace_now() - g_execute_start;
+    uint64_t nested = g_current[REQUEST_PHASE_COMPILE] + g_current[REQUEST_PHASE_OUTPUT] - g_execute_nested;
+    g_current[REQUEST_PHASE_EXECUTE] += elapsed > nested ? elapsed - nested : 0;
+}
+
+void request_timing_get(uint64_t phases[REQUEST_PHASE_COUNT]) {
+    memcpy(phases, g_current, sizeof(g_current));
+}
+
+static zend_op_array *timed_compile_file(zend_file_handle *file_handle, int type) {
+    uint64_t start = trace_now();
+    zend_op_array *op_array = g_original_compile_file(file_handle, type);
+    g_current[REQUEST_PHASE_COMPILE] += trace_now() - start;
+    return op_array;
+}
+
+void request_timing_hook_compile(void) {
+    // Engine startup resets zend_compile_file (and opcache wraps it), so hook what's there now
+    if (zend_compile_file == timed_compile_file) return;
+
+    g_original_compile_file = zend_compile_file;
+    zend_compile_file = timed_compile_file;
+}
+
+static int is_id_segment(const char *segment, size_t length) {
+    if (length == 0) return 0;
+
+    int digits = 1, hex = 1;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char) segment[i];
+        if (!isdigit(c)) digits = 0;
+        if (!isxdigit(c) && c != '-') hex = 0;
+    }
+    // Plain numbers, and hashes or UUIDs
+    return digits || (hex && length >= 16);
+}
+
+void request_route_key(const char *method, const char *uri, char *out, size_t out_size) {
+    size_t used = (size_t) snprintf(out, out_size, "%s ", method);
+    if (used >= out_size) return;
+
+    const char *end = uri + strcspn(uri, "?#");
+    const char *p = uri;
+    while (p < end && used + 1 < out_size) {
+        if (*p == '/') {
+            out[used++] = *p++;
+            continue;
+        }
+
+        const char *segment_end = memchr(p, '/', (size_t) (end - p));
+        if (!segment_end) segment_end = end;
+
+        size_t length = (size_t) (segment_end - p);
+        const char *text = p;
+        if (is_id_segment(p, length)) {
+            text = "{id}";
+            length = 4;
+        }
+        if (used + length >= out_size) length = out_size - used - 1;
+        memcpy(out + used, text, length);
+        used += length;
+        p = segment_end;
+    }
+    out[used] = '\0';
+}
+
+static route_stats *find_route_locked(const char *route) {
+    for (size_t i = 0; i < g_route_count; i++) {
+        if (strcmp(g_routes[i]->route, route) == 0) return g_routes[i];
+    }
+    if (g_route_count == REQUEST_STATS_ROUTES) {
+        // Full: everything new is counted under one catch-all route
+        route = "other";
+        for (size_t i = 0; i < g_route_count; i++) {
+            if (strcmp(g_routes[i]->route, route) == 0) return g_routes[i];
+        }
+        // Give up the last slot to it
+        g_route_count--;
+        free(g_routes[g_route_count]);
+    }
+
+    route_stats *stats = calloc(1, sizeof(route_stats));
+    if (!stats) return NULL;
+    snprintf(stats->route, sizeof(stats->route), "%s", route);
+    g_routes[g_route_count++] = stats;
+    return stats;
+}
+
+void request_stats_record(const char *route, const uint64_t phases[REQUEST_PHASE_COUNT]) {
+    pthread_mutex_lock(&g_stats_lock);
+    route_stats *stats = find_route_locked(route);
+    if (stats) {
+        uint64_t *sample = stats->samples[stats->count % REQUEST_STATS_SAMPLES];
+        uint64_t total = 0;
+        for (int i = 0; i < REQUEST_PHASE_COUNT; i++) {
+            sample[i] = phases[i];
+            total += phases[i];
+        }
+        sample[REQUEST_PHASE_COUNT] = total;
+        stats->count++;
+    }
+    pthread_mutex_unlock(&g_stats_lock);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentile over a sorted series
+static double percentile_ms(const uint64_t *sorted, size_t n, int pct) {
+    size_t rank = (n * (size_t) pct + 99) / 100;
+    return sorted[rank ? rank - 1 : 0] / 1e6;
+}
+
+static void write_percentiles(FILE *out, const route_stats *stats, size_t n, int column) {
+    uint64_t series[REQUEST_STATS_SAMPLES];
+    for (size_t i = 0; i < n; i++) series[i] = stats->samples[i][column];
+    qsort(series, n, sizeof(uint64_t), compare_u64);
+
+    fprintf(out, "{\"p50\":%.3f,\"p95\":%.3f,\"p99\":%.3f}",
+            percentile_ms(series, n, 50), percentile_ms(series, n, 95), percentile_ms(series, n, 99));
+}
+
+char *request_stats_json(void) {
+    char *json = NULL;
+    size_t length = 0;
+    FILE *out = open_memstream(&json, &length);
+    if (!out) return NULL;
+
+    pthread_mutex_lock(&g_stats_lock);
+    fputc('{', out);
+    for (size_t r = 0; r < g_route_count; r++) {
+        const route_stats *stats = g_routes[r];
+        size_t n = stats->count < REQUEST_STATS_SAMPLES ? (size_t) stats->count : REQUEST_STATS_SAMPLES;
+
+        // Routes come from URIs, so escape what JSON can't hold as-is
+        fputs(r ? ",\"" : "\"", out);
+        for (const char *c = stats->route; *c; c++) {
+            if (*c == '"' || *c == '\\') fputc('\\', out);
+            if ((unsigned char) *c >= 0x20) fputc(*c, out);
+        }
+        fprintf(out, "\":{\"count\":%llu,\"total\":", (unsigned long long) stats->count);
+        write_percentiles(out, stats, n, REQUEST_PHASE_COUNT);
+
+        fputs(",\"phases\":{", out);
+        for (int i = 0; i < REQUEST_PHASE_COUNT; i++) {
+            fprintf(out, "%s\"%s\":", i ? "," : "", g_phase_names[i]);
+            write_percentiles(out, stats, n, i);
+        }
+        fputs("}}", out);
+    }
+    fputc('}', out);
+    pthread_mutex_unlock(&g_stats_lock);
+
+    fclose(out);
+    return json;
+}
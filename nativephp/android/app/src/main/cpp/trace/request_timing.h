@@ -0,0 +1,54 @@
+#ifndef REQUEST_TIMING_H
+#define REQUEST_TIMING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Where each request's time goes, and rolling percentiles per route ===
+//
+// The PHP phases are measured here around the engine calls; queue wait and
+// the host's response conversion are filled in by Kotlin, which then records
+// the finished request with request_stats_record().
+
+typedef enum {
+    REQUEST_PHASE_QUEUE,        // waiting for the PHP thread
+    REQUEST_PHASE_STARTUP,      // engine init and php_request_startup
+    REQUEST_PHASE_COMPILE,      // zend_compile_file, summed over every include
+    REQUEST_PHASE_EXECUTE,      // php_execute_script less compile and output
+    REQUEST_PHASE_OUTPUT,       // ub_write and copying the response out
+    REQUEST_PHASE_SHUTDOWN,     // php_request_shutdown and engine teardown
+    REQUEST_PHASE_CONVERT,      // host turning the raw output into a response
+    REQUEST_PHASE_COUNT
+} request_phase;
+
+const char *request_phase_name(request_phase phase);
+
+// Per request, on the PHP thread
+void request_timing_reset(void);
+void request_timing_add(request_phase phase, uint64_t ns);
+void request_timing_execute_begin(void);
+void request_timing_execute_end(void);
+void request_timing_get(uint64_t phases[REQUEST_PHASE_COUNT]);
+
+// Wraps zend_compile_file so compile time is counted apart from execution.
+// Call after every engine startup; it's a no-op if already installed.
+void request_timing_hook_compile(void);
+
+// "GET /users/{id}": query dropped, numeric and id-like segments folded
+void request_route_key(const char *method, const char *uri, char *out, size_t out_size);
+
+void request_stats_record(const char *route, const uint64_t phases[REQUEST_PHASE_COUNT]);
+
+// {"<route>": {"count": n, "total": {"p50": ms, "p95": ms, "p99": ms}, "phases": {...}}}
+// over the most recent requests of each route. Caller frees.
+char *request_stats_json(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REQUEST_TIMING_H
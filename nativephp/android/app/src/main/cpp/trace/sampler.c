@@ -0,0 +1,283 @@
+#include "sampler.h"
+#include "trace.h"
+
+#include <php.h>
+#include <zend_atomic.h>
+#include <android/log.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#define LOG_TAG "Sampler"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+#define SAMPLER_MAX_DEPTH 128
+#define SAMPLER_MAX_STACKS 4096
+#define SAMPLER_STACK_BYTES 4096
+
+typedef struct {
+    uint64_t hash;
+    char *stack;
+    uint64_t count;
+} sample_entry;
+
+typedef struct {
+    sample_entry *entries;  // SAMPLER_MAX_STACKS * 2 slots, open addressing
+    size_t used;
+    uint64_t samples;
+    uint64_t dropped;       // distinct stacks past SAMPLER_MAX_STACKS
+    uint64_t started;
+} sample_window;
+
+// Settings and the window being filled; the PHP thread only ever trylocks this
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_hz = 0;
+static int g_window_ms = 10000;
+static char g_directory[512];
+static int g_thread_running = 0;
+static sample_window g_window;
+
+static atomic_int g_in_request = 0;
+static atomic_int g_pending = 0;
+
+// Only touched on the PHP thread
+static int g_hooked = 0;
+static void (*g_previous_interrupt)(zend_execute_data *execute_data) = NULL;
+
+static uint64_t hash_bytes(const char *data, size_t length) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static size_t append(char *buffer, size_t used, const char *text, size_t length) {
+    if (used + length >= SAMPLER_STACK_BYTES) length = SAMPLER_STACK_BYTES - 1 - used;
+    memcpy(buffer + used, text, length);
+    return used + length;
+}
+
+// Folded frame name: Class::method, function, or the file for top-level code
+static size_t append_frame(char *buffer, size_t used, zend_function *func) {
+    if (!func->common.function_name) {
+        if (func->type == ZEND_USER_FUNCTION && func->op_array.filename) {
+            return append(buffer, used, ZSTR_VAL(func->op_array.filename), ZSTR_LEN(func->op_array.filename));
+        }
+        return append(buffer, used, "{main}", 6);
+    }
+    if (func->common.scope) {
+        used = append(buffer, used, ZSTR_VAL(func->common.scope->name), ZSTR_LEN(func->common.scope->name));
+        used = append(buffer, used, "::", 2);
+    }
+    return append(buffer, used, ZSTR_VAL(func->common.function_name), ZSTR_LEN(func->common.function_name));
+}
+
+static void window_add(sample_window *window, const char *stack, size_t length) {
+    if (!window->entries) {
+        window->entries = calloc(SAMPLER_MAX_STACKS * 2, sizeof(sample_entry));
+        if (!window->entries) return;
+    }
+    window->samples++;
+
+    uint64_t hash = hash_bytes(stack, length);
+    size_t mask = SAMPLER_MAX_STACKS * 2 - 1;
+    size_t pos = hash & mask;
+    while (window->entries[pos].stack) {
+        sample_entry *entry = &window->entries[pos];
+        if (entry->hash == hash && strcmp(entry->stack, stack) == 0) {
+            entry->count++;
+            return;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    if (window->used >= SAMPLER_MAX_STACKS) {
+        window->dropped++;
+        return;
+    }
+    char *copy = malloc(length + 1);
+    if (!copy) return;
+    memcpy(copy, stack, length + 1);
+    window->entries[pos] = (sample_entry) {hash, copy, 1};
+    window->used++;
+}
+
+static void window_free(sample_window *window) {
+    if (window->entries) {
+        for (size_t i = 0; i < SAMPLER_MAX_STACKS * 2; i++) free(window->entries[i].stack);
+        free(window->entries);
+    }
+    memset(window, 0, sizeof(*window));
+}
+
+static void record_sample(void) {
+    zend_function *frames[SAMPLER_MAX_DEPTH];
+    int depth = 0;
+    int truncated = 0;
+
+    for (zend_execute_data *frame = EG(current_execute_data); frame; frame = frame->prev_execute_data) {
+        if (!frame->func) continue;
+        if (depth == SAMPLER_MAX_DEPTH) {
+            truncated = 1;
+            break;
+        }
+        frames[depth++] = frame->func;
+    }
+    if (depth == 0) return;
+
+    // Folded stacks run from the root to the leaf
+    char stack[SAMPLER_STACK_BYTES];
+    size_t used = 0;
+    if (truncated) used = append(stack, used, "[truncated];", 12);
+    for (int i = depth - 1; i >= 0; i--) {
+        used = append_frame(stack, used, frames[i]);
+        if (i > 0) used = append(stack, used, ";", 1);
+    }
+    stack[used] = '\0';
+    // The count follows the last space, so a frame can't contain one
+    for (size_t i = 0; i < used; i++) {
+        if (stack[i] == ' ') stack[i] = '_';
+    }
+
+    // Never make PHP wait on the writer; losing a sample is fine
+    if (pthread_mutex_trylock(&g_lock) != 0) return;
+    window_add(&g_window, stack, used);
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void sampler_interrupt(zend_execute_data *execute_data) {
+    // Other interrupts (timeouts, other extensions) pass through uncounted
+    if (atomic_exchange(&g_pending, 0)) record_sample();
+    if (g_previous_interrupt) g_previous_interrupt(execute_data);
+}
+
+static void write_window(sample_window *window, const char *directory) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    long long now_ms = (long long) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    long long started_ms = now_ms - (long long) ((trace_now() - window->started) / 1000000);
+
+    char path[640];
+    snprintf(path, sizeof(path), "%s/samples.%lld.folded", directory, started_ms);
+    FILE *out = fopen(path, "we");
+    if (!out) {
+        LOGE("Cannot write samples %s: %s", path, strerror(errno));
+        return;
+    }
+
+    for (size_t i = 0; i < SAMPLER_MAX_STACKS * 2; i++) {
+        const sample_entry *entry = &window->entries[i];
+        if (entry->stack) fprintf(out, "%s %llu\n", entry->stack, (unsigned long long) entry->count);
+    }
+    if (window->dropped) fprintf(out, "[other] %llu\n", (unsigned long long) window->dropped);
+    fclose(out);
+
+    LOGI("Wrote %llu samples (%zu stacks) to %s", (unsigned long long) window->samples, window->used, path);
+}
+
+static void flush_window(void) {
+    char directory[sizeof(g_directory)];
+
+    pthread_mutex_lock(&g_lock);
+    sample_window full = g_window;
+    memset(&g_window, 0, sizeof(g_window));
+    g_window.started = trace_now();
+    memcpy(directory, g_directory, sizeof(directory));
+    pthread_mutex_unlock(&g_lock);
+
+    if (full.samples > 0 && directory[0]) write_window(&full, directory);
+    window_free(&full);
+}
+
+static void *watcher_main(void *arg) {
+    (void) arg;
+
+    for (;;) {
+        pthread_mutex_lock(&g_lock);
+        int hz = g_hz;
+        uint64_t window_ns = (uint64_t) g_window_ms * 1000000;
+        uint64_t started = g_window.started;
+        if (hz == 0) g_thread_running = 0;
+        pthread_mutex_unlock(&g_lock);
+
+        if (hz == 0) break;
+
+        struct timespec period = {0, 1000000000L / hz};
+        if (hz == 1) period = (struct timespec) {1, 0};
+        nanosleep(&period, NULL);
+
+        // Only poke the VM while a script runs; the engine is torn down between requests
+        if (atomic_load(&g_in_request)) {
+            atomic_store(&g_pending, 1);
+            zend_atomic_bool_store(&EG(vm_interrupt), true);
+        }
+
+        if (trace_now() - started >= window_ns) flush_window();
+    }
+
+    flush_window();
+    return NULL;
+}
+
+void sampler_configure(int hz, int window_ms, const char *directory) {
+    if (hz < 0) hz = 0;
+    if (hz > 1000) hz = 1000;
+
+    pthread_mutex_lock(&g_lock);
+    g_hz = hz;
+    if (window_ms > 0) g_window_ms = window_ms;
+    if (directory) snprintf(g_directory, sizeof(g_directory), "%s", directory);
+
+    int start = hz > 0 && !g_thread_running;
+    if (start) {
+        g_thread_running = 1;
+        g_window.started = trace_now();
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (!start) return;
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, watcher_main, NULL) != 0) {
+        LOGE("Cannot start the sampler thread");
+        pthread_mutex_lock(&g_lock);
+        g_thread_running = 0;
+        g_hz = 0;
+        pthread_mutex_unlock(&g_lock);
+    } else {
+        LOGI("Sampling PHP stacks at %d Hz", hz);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+void sampler_request_begin(void) {
+    pthread_mutex_lock(&g_lock);
+    int hz = g_hz;
+    pthread_mutex_unlock(&g_lock);
+    if (hz == 0) return;
+
+    // zend_interrupt_function is a process global that survives engine restarts
+    if (!g_hooked) {
+        g_previous_interrupt = zend_interrupt_function;
+        zend_interrupt_function = sampler_interrupt;
+        g_hooked = 1;
+    }
+    atomic_store(&g_pending, 0);
+    atomic_store(&g_in_request, 1);
+}
+
+void sampler_request_end(void) {
+    atomic_store(&g_in_request, 0);
+}
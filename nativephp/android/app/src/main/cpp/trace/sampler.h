@@ -0,0 +1,33 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Sampling profiler for PHP stacks ===
+//
+// A watcher thread raises EG(vm_interrupt) at the configured rate. The VM
+// notices it at its next safe point (loop header, function entry, return
+// from an internal call) and calls our zend_interrupt_function on the PHP
+// thread, which walks EG(current_execute_data) there and counts the stack.
+// Nothing reads engine state from another thread and PHP is never stopped.
+//
+// Stacks are aggregated in Brendan Gregg's folded format and written once per
+// window to <directory>/samples.<start ms>.folded, ready for flamegraph.pl,
+// speedscope or Perfetto.
+
+// Sample at `hz` (1-1000), writing a file every `window_ms`. 0 turns it off
+// and writes out what the current window has collected.
+void sampler_configure(int hz, int window_ms, const char *directory);
+
+// Around each script run on the PHP thread, with the engine started. Samples
+// are only requested in between, so idle time and engine startup cost nothing.
+void sampler_request_begin(void);
+void sampler_request_end(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SAMPLER_H
@@ -0,0 +1,198 @@
+#include "trace.h"
+
+#include <php.h>
+#include <zend_hrtime.h>
+#include <android/log.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOG_TAG "Trace"
+#define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__))
+#define LOGE(...) ((void)__android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__))
+
+// Enough for a cold start without a flush; later events are written out as it fills
+#define TRACE_BUFFER_EVENTS 4096
+#define TRACE_MAX_INTERNED 32
+
+enum {
+    TRACE_ARMED,    // buffering until Kotlin decides
+    TRACE_ON,
+    TRACE_OFF,
+};
+
+typedef struct {
+    const char *name;
+    const char *category;
+    char *owned_name;
+    char phase;
+    int tid;
+    uint64_t start;
+    uint64_t duration;
+} trace_event;
+
+static trace_event g_events[TRACE_BUFFER_EVENTS];
+static size_t g_event_count = 0;
+static size_t g_dropped = 0;
+static volatile int g_state = TRACE_ARMED;
+static FILE *g_out = NULL;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static char *g_interned[TRACE_MAX_INTERNED];
+
+uint64_t trace_now(void) {
+    return zend_hrtime();
+}
+
+int trace_enabled(void) {
+    return g_state != TRACE_OFF;
+}
+
+static void write_json_string(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char) *s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void clear_events_locked(void) {
+    for (size_t i = 0; i < g_event_count; i++) {
+        free(g_events[i].owned_name);
+    }
+    g_event_count = 0;
+}
+
+static void flush_locked(void) {
+    if (!g_out) return;
+
+    pid_t pid = getpid();
+    for (size_t i = 0; i < g_event_count; i++) {
+        const trace_event *event = &g_events[i];
+        fputs("{\"name\":", g_out);
+        write_json_string(g_out, event->name);
+        fputs(",\"cat\":", g_out);
+        write_json_string(g_out, event->category);
+        // Chrome wants microseconds; keep the nanoseconds as decimals
+        fprintf(g_out, ",\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%llu.%03u",
+                event->phase, pid, event->tid,
+                (unsigned long long) (event->start / 1000), (unsigned) (event->start % 1000));
+        if (event->phase == 'X') {
+            fprintf(g_out, ",\"dur\":%llu.%03u",
+                    (unsigned long long) (event->duration / 1000), (unsigned) (event->duration % 1000));
+        } else {
+            fputs(",\"s\":\"t\"", g_out);
+        }
+        fputs("},\n", g_out);
+    }
+    fflush(g_out);
+    clear_events_locked();
+}
+
+static void record(const char *name, const char *category, char phase,
+                   uint64_t start, uint64_t duration, int copy_name) {
+    if (g_state == TRACE_OFF) return;
+
+    pthread_mutex_lock(&g_lock);
+    if (g_state != TRACE_OFF) {
+        if (g_event_count == TRACE_BUFFER_EVENTS) flush_locked();
+
+        if (g_event_count < TRACE_BUFFER_EVENTS) {
+            trace_event *event = &g_events[g_event_count++];
+            event->owned_name = copy_name ? strdup(name) : NULL;
+            event->name = event->owned_name ? event->owned_name : name;
+            event->category = category;
+            event->phase = phase;
+            event->tid = gettid();
+            event->start = start;
+            event->duration = duration;
+        } else {
+            g_dropped++;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void trace_complete(const char *name, const char *category, uint64_t start_ns, uint64_t end_ns, int copy_name) {
+    record(name, category, 'X', start_ns, end_ns > start_ns ? end_ns - start_ns : 0, copy_name);
+}
+
+void trace_instant(const char *name, const char *category) {
+    record(name, category, 'i', trace_now(), 0, 0);
+}
+
+const char *trace_intern(const char *s) {
+    const char *result = "other";
+
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < TRACE_MAX_INTERNED; i++) {
+        if (!g_interned[i]) {
+            g_interned[i] = strdup(s);
+            if (g_interned[i]) result = g_interned[i];
+            break;
+        }
+        if (strcmp(g_interned[i], s) == 0) {
+            result = g_interned[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return result;
+}
+
+int trace_start(const char *path) {
+    pthread_mutex_lock(&g_lock);
+    if (g_out) fclose(g_out);
+
+    g_out = fopen(path, "we");
+    if (!g_out) {
+        LOGE("Cannot open trace file %s: %s", path, strerror(errno));
+        g_state = TRACE_OFF;
+        clear_events_locked();
+        pthread_mutex_unlock(&g_lock);
+        return -1;
+    }
+
+    fputs("[\n", g_out);
+    g_state = TRACE_ON;
+    // Whatever was buffered since load goes out first
+    flush_locked();
+    pthread_mutex_unlock(&g_lock);
+
+    LOGI("Tracing to %s", path);
+    return 0;
+}
+
+void trace_stop(void) {
+    pthread_mutex_lock(&g_lock);
+    flush_locked();
+    if (g_out) {
+        fclose(g_out);
+        g_out = NULL;
+    }
+    if (g_dropped) {
+        LOGE("Dropped %zu trace events", g_dropped);
+    }
+    g_state = TRACE_OFF;
+    clear_events_locked();
+    pthread_mutex_unlock(&g_lock);
+}
+
+void trace_flush(void) {
+    if (g_state != TRACE_ON) return;
+
+    pthread_mutex_lock(&g_lock);
+    flush_locked();
+    pthread_mutex_unlock(&g_lock);
+}
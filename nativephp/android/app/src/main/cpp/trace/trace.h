@@ -0,0 +1,86 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Boot and request tracing in Chrome trace-event format ===
+//
+// Spans are recorded from the moment the library loads, so the loader
+// constructors are caught too. Once Kotlin has read the runtime flag it
+// either calls trace_start() with an output file, after which spans are
+// appended to it as JSON on every trace_flush(), or trace_stop() to drop
+// what was buffered and make every later span a no-op.
+//
+// The file is a JSON array left open at the end, which chrome://tracing and
+// Perfetto both accept, so it is readable at any point without a shutdown.
+
+// Monotonic nanoseconds from zend_hrtime(), the same clock as System.nanoTime()
+uint64_t trace_now(void);
+
+int trace_enabled(void);
+int trace_start(const char *path);
+void trace_stop(void);
+void trace_flush(void);
+
+// A finished span. `name` is copied when `copy_name` is set, otherwise it
+// must be a string literal.
+void trace_complete(const char *name, const char *category, uint64_t start_ns, uint64_t end_ns, int copy_name);
+void trace_instant(const char *name, const char *category);
+
+// A copy of `s` that lives as long as the process, for the few category
+// names that arrive as Java strings.
+const char *trace_intern(const char *s);
+
+typedef struct {
+    const char *name;
+    const char *category;
+    uint64_t start;
+    int copy_name;
+} trace_span;
+
+static inline trace_span trace_span_begin(const char *name, const char *category, int copy_name) {
+    trace_span span = {name, category, trace_enabled() ? trace_now() : 0, copy_name};
+    return span;
+}
+
+static inline void trace_span_end(trace_span *span) {
+    if (span->start) {
+        trace_complete(span->name, span->category, span->start, trace_now(), span->copy_name);
+    }
+}
+
+#ifdef __cplusplus
+}
+
+// RAII span for C++ code
+class TraceScope {
+public:
+    TraceScope(const char *name, const char *category) : span_(trace_span_begin(name, category, 0)) {}
+    ~TraceScope() { trace_span_end(&span_); }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    trace_span span_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name, category)
+
+#else
+
+// Ends when the enclosing block exits, on any path out of it
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name, category) \
+    trace_span TRACE_CONCAT(trace_scope_, __LINE__) __attribute__((cleanup(trace_span_end))) = \
+        trace_span_begin(name, category, 0)
+
+#endif
+
+#endif // TRACE_H
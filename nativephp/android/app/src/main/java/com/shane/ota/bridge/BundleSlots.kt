@@ -0,0 +1,199 @@
+package com.shane.ota.bridge
+
+import android.system.ErrnoException
+import android.system.Os
+import android.util.Log
+import java.io.File
+import java.nio.file.Files
+import java.nio.file.Paths
+import java.nio.file.StandardCopyOption
+
+/**
+ * Two install slots for the Laravel tree, `laravel_a` and `laravel_b`.
+ * `laravel` is a symlink to the active one, so everything that reads the tree
+ * keeps using the same path while an update is installed into the other slot
+ * in the background. The switch happens at the next launch with one rename
+ * of the symlink, before PHP has opened anything.
+ *
+ * A freshly switched slot is on trial until [confirmHealthy]. If the app dies
+ * before that, the following launch rolls back to the previous slot and
+ * remembers the version so it isn't installed again.
+ */
+class BundleSlots(private val storageDir: File) {
+    companion object {
+        private const val TAG = "BundleSlots"
+        private val SLOTS = listOf("a", "b")
+
+        // Written with plain writes after an install, so a link would change the active slot too
+        private val rewrittenInPlace = setOf(".env", ".ota_applied")
+    }
+
+    val link = File(storageDir, "laravel")
+    private val stateDir = File(storageDir, "slots")
+    private val pendingFile = File(stateDir, "pending")
+    private val trialFile = File(stateDir, "trial")
+    private val rejectedFile = File(stateDir, "rejected")
+
+    fun slotDir(slot: String) = File(storageDir, "laravel_$slot")
+
+    val activeSlot: String
+        get() = Files.readSymbolicLink(link.toPath()).fileName.toString().removePrefix("laravel_")
+
+    val inactiveSlot: String
+        get() = SLOTS.first { it != activeSlot }
+
+    val isOnTrial: Boolean
+        get() = trialFile.exists()
+
+    /** Version installed in the inactive slot and waiting for the next launch, if any. */
+    val pendingVersion: String?
+        get() = pendingFile.takeIf { it.exists() }?.readText()?.lines()?.getOrNull(1)
+
+    /** Version that failed its boot check last time it was switched to, if any. */
+    val rejectedVersion: String?
+        get() = rejectedFile.takeIf { it.exists() }?.readText()?.trim()
+
+    /**
+     * Run first thing at launch. Turns a plain `laravel` directory from before
+     * slots existed into slot a, then either rolls back a slot that never
+     * passed its health check or switches to one an update staged last run.
+     * [keepPaths] (user data inside the tree) move across with the switch.
+     */
+    fun prepare(keepPaths: List<String>) {
+        stateDir.mkdirs()
+        migrate()
+
+        if (trialFile.exists()) {
+            val (failed, previous, version) = readTrial()
+            Log.w(TAG, "⏪ Slot $failed (version $version) never came up healthy, rolling back to $previous")
+            moveKeepPaths(slotDir(failed), slotDir(previous), keepPaths)
+            point(previous)
+            writeAtomically(rejectedFile, version)
+            trialFile.delete()
+            return
+        }
+
+        if (pendingFile.exists()) {
+            val (slot, version) = pendingFile.readText().lines()
+            val previous = activeSlot
+            if (slot == previous || !File(slotDir(slot), ".env").exists()) {
+                pendingFile.delete()
+                return
+            }
+
+            Log.d(TAG, "🔀 Switching to slot $slot (version $version)")
+            writeAtomically(trialFile, "$slot\n$previous\n$version")
+            moveKeepPaths(slotDir(previous), slotDir(slot), keepPaths)
+            point(slot)
+            pendingFile.delete()
+        }
+    }
+
+    /** The active slot booted and answered; it stops being on trial. */
+    fun confirmHealthy() {
+        if (trialFile.delete()) {
+            rejectedFile.delete()
+            Log.d(TAG, "✅ Slot $activeSlot confirmed healthy")
+        }
+    }
+
+    /** Roll back right away, for a health check that failed without crashing. */
+    fun rollBack(keepPaths: List<String>) {
+        if (trialFile.exists()) prepare(keepPaths)
+    }
+
+    /** Start filling the inactive slot; forgets any switch staged for it. */
+    fun beginUpdate(): File {
+        pendingFile.delete()
+        return slotDir(inactiveSlot).also { it.mkdirs() }
+    }
+
+    /** The inactive slot now holds [version] and is switched to at next launch. */
+    fun stageUpdate(version: String) {
+        writeAtomically(pendingFile, "$inactiveSlot\n$version")
+        Log.d(TAG, "📌 Version $version staged in slot $inactiveSlot for next launch")
+    }
+
+    /**
+     * Make the inactive slot a copy of the active one to apply a delta on.
+     * Files are hard links, so everything that installs into a slot has to
+     * replace files rather than write into them: the delta applier renames new
+     * ones into place and the full installers unlink before writing. The links
+     * outlive the delta, so this holds for later non-delta installs as well.
+     */
+    fun cloneActiveIntoInactive(exclude: List<String>): File {
+        val source = slotDir(activeSlot)
+        val target = beginUpdate()
+        target.deleteRecursively()
+
+        source.walkTopDown()
+            .onEnter { dir -> exclude.none { dir.relativeTo(source).path == it } }
+            .forEach { file ->
+                val copy = File(target, file.relativeTo(source).path)
+                if (file.isDirectory) {
+                    copy.mkdirs()
+                } else if (file.parentFile == source && file.name in rewrittenInPlace) {
+                    file.copyTo(copy, overwrite = true)
+                } else {
+                    try {
+                        Os.link(file.absolutePath, copy.absolutePath)
+                    } catch (e: ErrnoException) {
+                        file.copyTo(copy, overwrite = true)
+                    }
+                }
+            }
+        return target
+    }
+
+    private fun migrate() {
+        val path = link.toPath()
+        if (Files.isSymbolicLink(path)) return
+
+        val slotA = slotDir("a")
+        if (link.isDirectory) {
+            Log.d(TAG, "📦 Moving the installed tree into slot a")
+            slotA.deleteRecursively()
+            if (!link.renameTo(slotA)) {
+                throw IllegalStateException("Cannot move ${link.path} into ${slotA.path}")
+            }
+        } else {
+            slotA.mkdirs()
+        }
+        point("a")
+    }
+
+    /** Repoint `laravel` at [slot] with a rename, so it's never missing or half-written. */
+    private fun point(slot: String) {
+        val temp = File(storageDir, "laravel.link")
+        temp.delete()
+        Files.createSymbolicLink(temp.toPath(), Paths.get(slotDir(slot).name))
+        Files.move(temp.toPath(), link.toPath(), StandardCopyOption.ATOMIC_MOVE, StandardCopyOption.REPLACE_EXISTING)
+    }
+
+    private fun moveKeepPaths(from: File, to: File, keepPaths: List<String>) {
+        for (path in keepPaths) {
+            val source = File(from, path)
+            if (!source.exists()) continue
+
+            val target = File(to, path)
+            target.deleteRecursively()
+            target.parentFile?.mkdirs()
+            if (!source.renameTo(target)) {
+                Log.w(TAG, "⚠️ Couldn't carry $path over to ${to.name}")
+            }
+        }
+    }
+
+    private fun readTrial(): Triple<String, String, String> {
+        val lines = trialFile.readText().lines()
+        return Triple(lines[0], lines[1], lines.getOrElse(2) { "" })
+    }
+
+    private fun writeAtomically(file: File, content: String) {
+        val temp = File(file.path + ".tmp")
+        temp.writeText(content)
+        if (!temp.renameTo(file)) {
+            throw IllegalStateException("Cannot write ${file.path}")
+        }
+    }
+}
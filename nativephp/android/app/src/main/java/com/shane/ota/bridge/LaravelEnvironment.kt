@@ -2,8 +2,13 @@ package com.shane.ota.bridge
 
 import android.annotation.SuppressLint
 import android.content.Context
+import android.content.res.AssetFileDescriptor
+import android.os.ParcelFileDescriptor
+import android.os.Process
 import android.util.Log
 import com.google.firebase.messaging.FirebaseMessaging
+import com.shane.ota.network.AssetLookupCache
+import com.shane.ota.network.ResumableDownloader
 import java.io.File
 import java.io.FileOutputStream
 import java.io.FileInputStream
@@ -12,15 +17,49 @@ import java.util.zip.ZipEntry
 import java.util.zip.ZipInputStream
 import java.net.HttpURLConnection
 import java.net.URL
+import java.security.MessageDigest
+import java.security.SecureRandom
+import java.util.Base64
+import java.util.concurrent.atomic.AtomicBoolean
 import org.json.JSONObject
 
 class LaravelEnvironment<InputStream>(private val context: Context) {
     private val appStorageDir = context.getDir("storage", Context.MODE_PRIVATE)
     private val phpBridge = PHPBridge(context)
+    private val slots = BundleSlots(appStorageDir)
     var cachedFcmToken: String? = null
 
 
     private external fun nativeSetEnv(name: String, value: String, overwrite: Int): Int
+    private external fun nativeExtractBundle(
+        fd: Int,
+        offset: Long,
+        length: Long,
+        destination: String,
+        threads: Int,
+        skipUnchanged: Boolean,
+        onlyPaths: Array<String>?,
+        useManifest: Boolean,
+        keepPaths: Array<String>?
+    ): Int
+    private external fun nativeLoadBundleMeta(fd: Int, offset: Long, length: Long): Boolean
+    private external fun nativeBundleEnvValue(name: String): String?
+    private external fun nativeBundleVersion(): String?
+    private external fun nativeBundleFiles(): Array<String>?
+    private external fun nativeApplyDelta(patchPath: String, destination: String): Int
+    private external fun nativeStreamOpen(staging: String): Long
+    private external fun nativeStreamFeed(handle: Long, buffer: ByteArray, length: Int): Boolean
+    private external fun nativeStreamFinish(handle: Long): Int
+    private external fun nativeStreamAbort(handle: Long)
+    private external fun nativeStreamCommit(staging: String, destination: String, keepPaths: Array<String>): Boolean
+    private external fun nativeStreamRecover(staging: String, destination: String, keepPaths: Array<String>): Boolean
+    private external fun nativeMountBundle(
+        fd: Int,
+        offset: Long,
+        length: Long,
+        root: String,
+        diskPaths: Array<String>
+    ): Boolean
     private val preservePaths = listOf(
         "storage/app",
         "storage/logs",
@@ -29,34 +68,150 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
         "storage/framework/views",
     )
 
+    // When running from the bundle archive, only these paths are extracted to disk.
+    // Everything else is read by PHP straight out of laravel_bundle.zip.
+    private val bundleDiskPaths = listOf(
+        "storage",
+        "bootstrap/cache",
+        "public",
+        ".env",
+    )
+
+    // Several startup steps and the OTA check ask about the bundled zip, so its
+    // central directory is indexed natively once and answered from memory after
+    private val bundleMetaLoaded: Boolean by lazy { loadBundleMeta() }
+
+    // Only used when the asset can't be opened by descriptor
+    private val bundledEnvContent: String? by lazy { readBundledEnv() }
+
     companion object {
         private const val TAG = "LaravelEnvironment"
+        private const val DEFAULT_OTA_URL = "https://bifrost.nativephp.com"
+        private const val STAGING_DIR = "laravel.staging"
+        private const val STREAM_BUFFER_SIZE = 64 * 1024
+
+        // Once per process, however often initialize() runs
+        private val launchPrepared = AtomicBoolean(false)
+        private val updateStarted = AtomicBoolean(false)
 
         init {
             System.loadLibrary("php_wrapper")
         }
     }
 
+    /**
+     * Runs the launch steps as a [StartupGraph] and returns as soon as Laravel
+     * can take its first request. Steps that only touch files overlap; PHP
+     * isn't thread safe, so everything that boots it stays on one chain.
+     * setenv() isn't either, so the environment is set before anything runs
+     * alongside it.
+     */
     fun initialize() {
+        val graph = StartupGraph()
         try {
-            setupDirectories()
-            
-            // Check for OTA updates first (reads BIFROST_APP_ID from bundled .env)
-            if (checkAndApplyOTAUpdate()) {
-                Log.d(TAG, "✅ OTA update applied successfully")
+            val directories = graph.step("directories") { setupDirectories() }
+            val environment = graph.step("environment", directories) { setupEnvironment() }
+            graph.await(environment)
+
+            val caBundle = graph.step("ca-bundle") { installCaBundle() }
+            val bundledEnv = graph.step("bundle-meta") { bundleMetaLoaded }
+            val slotsReady = graph.step("slots") { prepareSlots() }
+
+            val database = graph.step("database", directories) { createDatabaseFile() }
+
+            // Nothing reads the tree until the slots have settled
+            graph.await(slotsReady)
+            val onTrial = slots.isOnTrial
+
+            val extract = graph.step("extract", bundledEnv) { extractLaravelBundle() }
+            val mount = graph.step("mount", extract) { mountBundleArchive() }
+            val artisan = graph.step("artisan", mount, environment, database, caBundle) {
+                runBaseArtisanCommands()
+                prepareAssetLookupCache()
+            }
+            val ready = if (onTrial) {
+                graph.step("health-check", artisan) { checkSlotHealth() }
             } else {
-                // No OTA update - extract bundled version if needed
-                extractLaravelBundle()
+                artisan
             }
-            
-            setupEnvironment()
-            runBaseArtisanCommands()
+
+            // OTA updates download and install into the other slot while the app
+            // runs. A slot on trial may still roll back, so wait for its verdict.
+            graph.step("ota-check", if (onTrial) ready else extract) { startBackgroundUpdate() }
+
+            graph.finish(ready)
         } catch (e: Exception) {
             Log.e(TAG, "Error initializing Laravel environment", e)
             throw RuntimeException("Failed to initialize Laravel environment", e)
         }
     }
 
+    private fun prepareSlots() {
+        // Slots only ever switch at process start, never under a running app
+        if (!launchPrepared.compareAndSet(false, true)) {
+            return
+        }
+
+        // Switch to an update staged last run, or roll back one that never came up
+        slots.prepare(preservePaths)
+
+        // Finish or discard a streamed OTA that was interrupted last run. A
+        // finished one is staged as streamAndApplyUpdate would have; its
+        // version came across with the tree, in the .ota_applied marker.
+        val slotDir = slots.slotDir(slots.inactiveSlot)
+        val recovered = nativeStreamRecover(
+            File(appStorageDir, STAGING_DIR).absolutePath,
+            slotDir.absolutePath,
+            emptyArray()
+        )
+        val version = File(slotDir, ".ota_applied").takeIf { recovered && it.exists() }?.readText()?.trim()
+        if (!version.isNullOrEmpty()) {
+            Log.d(TAG, "♻️ Recovered streamed update $version")
+            slots.stageUpdate(version)
+        }
+    }
+
+    /** Boots whichever slot is active, one step after the other. */
+    private fun bootActiveSlot() {
+        // Only the bundled version can need installing here; OTA slots arrive complete
+        extractLaravelBundle()
+        mountBundleArchive()
+
+        createDatabaseFile()
+        runBaseArtisanCommands()
+        prepareAssetLookupCache()
+    }
+
+    /**
+     * First boot of a newly switched slot: if Laravel can't even answer
+     * `artisan --version`, go back to the previous slot right away instead
+     * of leaving the app broken until the next launch.
+     */
+    private fun checkSlotHealth() {
+        val output = phpBridge.runArtisanCommand("--version")
+        if (output.contains("Laravel")) {
+            slots.confirmHealthy()
+            return
+        }
+
+        Log.e(TAG, "❌ Updated slot failed its health check: $output")
+        slots.rollBack(preservePaths)
+        bootActiveSlot()
+    }
+
+    private fun startBackgroundUpdate() {
+        if (!updateStarted.compareAndSet(false, true)) {
+            return
+        }
+
+        Thread({
+            Process.setThreadPriority(Process.THREAD_PRIORITY_BACKGROUND)
+            if (checkAndApplyOTAUpdate()) {
+                Log.d(TAG, "✅ OTA update installed, it goes live on next launch")
+            }
+        }, "ota-update").start()
+    }
+
     private fun extractLaravelBundle() {
         val laravelDir = File(appStorageDir, "laravel")
         val otaMarkerFile = File(laravelDir, ".ota_applied")
@@ -68,7 +223,7 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
             return
         }
 
-        val embeddedVersion = getVersionFromBundledEnv() ?: readVersionFromZip("laravel_bundle.zip")
+        val embeddedVersion = getBundledVersion()
         if (embeddedVersion == null) {
             Log.e(TAG, "❌ Couldn't read version from laravel_bundle.zip")
             return
@@ -94,18 +249,12 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
             return
         }
 
-        Log.d(TAG, "📦 Extracting Laravel bundle (new version: $embeddedVersion)")
+        Log.d(TAG, "📦 Installing Laravel bundle (new version: $embeddedVersion)")
         Log.d(TAG, "📦 Current: $currentVersion, Embedded: $embeddedVersion")
 
-        if (laravelDir.exists()) {
-            deleteDirectoryContentsExcept(laravelDir, preservePaths)
-        } else {
-            laravelDir.mkdirs()
-        }
-
         try {
-            val zipStream = context.assets.open("laravel_bundle.zip")
-            unzip(zipStream, laravelDir)
+            val onlyPaths = if (isRunFromBundleEnabled()) bundleDiskPaths else null
+            installBundleAsset("laravel_bundle.zip", laravelDir, onlyPaths)
 
             // Remove OTA marker if it exists (we're back to bundled version)
             if (otaMarkerFile.exists()) {
@@ -173,11 +322,40 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
             if (updateInfo != null && !updateInfo.optBoolean("upToDate", true)) {
                 val newVersion = updateInfo.optString("current_version", "")
                 val downloadUrl = updateInfo.optString("download_url", "")
+                val downloadSha256 = updateInfo.optString("download_sha256", "").ifEmpty { null }
                 
                 Log.d(TAG, "📥 Update available: $currentVersion → $newVersion")
+
+                if (newVersion == slots.pendingVersion) {
+                    Log.d(TAG, "ℹ️ Version $newVersion is already installed and waiting for next launch")
+                    return false
+                }
+                if (newVersion == slots.rejectedVersion) {
+                    Log.w(TAG, "⚠️ Version $newVersion failed its health check before, not installing it again")
+                    return false
+                }
                 
+                // A patch is only usable against exactly the version we have installed
+                val patchUrl = updateInfo.optString("patch_url", "")
+                val patchFrom = updateInfo.optString("patch_from", "")
+                val patchSha256 = updateInfo.optString("patch_sha256", "").ifEmpty { null }
+                if (patchUrl.isNotEmpty() && patchFrom == currentVersion && newVersion != currentVersion) {
+                    if (downloadAndApplyPatch(patchUrl, newVersion, patchSha256)) {
+                        return true
+                    }
+                    Log.w(TAG, "⚠️ Delta update failed, falling back to the full bundle")
+                }
+
                 if (downloadUrl.isNotEmpty() && newVersion != currentVersion) {
-                    return downloadAndApplyUpdate(downloadUrl, newVersion)
+                    // A partial download from an earlier launch is worth more than a fresh stream
+                    val partial = ResumableDownloader.hasProgress(otaDownloadFile(newVersion))
+                    if (!partial && streamAndApplyUpdate(downloadUrl, newVersion, downloadSha256)) {
+                        return true
+                    }
+                    if (!partial) {
+                        Log.w(TAG, "⚠️ Streaming install failed, retrying as a resumable download")
+                    }
+                    return downloadAndApplyUpdate(downloadUrl, newVersion, downloadSha256)
                 }
             } else {
                 Log.d(TAG, "✅ App is up to date")
@@ -200,57 +378,32 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
         }
     }
     
-    private fun getVersionFromBundledEnv(): String? {
-        try {
-            val zis = ZipInputStream(context.assets.open("laravel_bundle.zip") as java.io.InputStream)
-            var entry: ZipEntry?
-            
-            while (zis.nextEntry.also { entry = it } != null) {
-                if (entry?.name == ".env") {
-                    val envContent = zis.bufferedReader().readText()
-                    val versionMatch = Regex("NATIVEPHP_APP_VERSION=(.+)").find(envContent)
-                    zis.close()
-                    return versionMatch?.groupValues?.get(1)?.trim()
-                }
-            }
-            zis.close()
-        } catch (e: Exception) {
-            Log.e(TAG, "Failed to read version from bundled .env", e)
-        }
-        return null
-    }
-    
+    private fun getVersionFromBundledEnv(): String? =
+        getBundledEnvValue("NATIVEPHP_APP_VERSION")?.takeIf { it.isNotEmpty() }
+
+    /** NATIVEPHP_APP_VERSION from the bundled .env, else its .version file. */
+    private fun getBundledVersion(): String? =
+        if (bundleMetaLoaded) nativeBundleVersion() else getVersionFromBundledEnv() ?: readVersionFromZip("laravel_bundle.zip")
+
+    /** Every file in laravel_bundle.zip, from the cached index. */
+    fun bundledFiles(): List<String> =
+        (if (bundleMetaLoaded) nativeBundleFiles() else null)?.toList() ?: emptyList()
+
     private fun getBifrostAppId(): String? {
-        // Read from .env file in the laravel_bundle.zip
-        try {
-            val zis = ZipInputStream(context.assets.open("laravel_bundle.zip") as java.io.InputStream)
-            var entry: ZipEntry?
-            
-            while (zis.nextEntry.also { entry = it } != null) {
-                if (entry?.name == ".env") {
-                    val envContent = zis.bufferedReader().readText()
-                    val bifrostIdMatch = Regex("BIFROST_APP_ID=(.+)").find(envContent)
-                    val bifrostId = bifrostIdMatch?.groupValues?.get(1)?.trim()
-                    
-                    if (!bifrostId.isNullOrEmpty()) {
-                        Log.d(TAG, "Found BIFROST_APP_ID in bundled .env: $bifrostId")
-                        return bifrostId
-                    }
-                    break
-                }
-            }
-            zis.close()
-        } catch (e: Exception) {
-            Log.e(TAG, "Failed to read .env from bundle", e)
+        val bifrostId = getBundledEnvValue("BIFROST_APP_ID")
+        if (bifrostId.isNullOrEmpty()) {
+            Log.d(TAG, "No BIFROST_APP_ID found in bundled .env")
+            return null
         }
-        
-        Log.d(TAG, "No BIFROST_APP_ID found in bundled .env")
-        return null
+
+        Log.d(TAG, "Found BIFROST_APP_ID in bundled .env: $bifrostId")
+        return bifrostId
     }
-    
+
     private fun checkForUpdate(appId: String, currentVersion: String): JSONObject? {
         return try {
-            val url = URL("https://bifrost.nativephp.com/api/apps/$appId/ota?installed=$currentVersion")
+            val baseUrl = getBundledEnvValue("NATIVEPHP_OTA_URL")?.trimEnd('/') ?: DEFAULT_OTA_URL
+            val url = URL("$baseUrl/api/apps/$appId/ota?installed=$currentVersion")
             val connection = url.openConnection() as HttpURLConnection
             
             connection.requestMethod = "GET"
@@ -273,76 +426,29 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
         }
     }
     
-    private fun downloadAndApplyUpdate(downloadUrl: String, newVersion: String): Boolean {
-        val tempFile = File(context.cacheDir, "ota_update_$newVersion.zip")
+    private fun otaDownloadFile(version: String) = File(context.cacheDir, "ota_update_$version.zip")
+
+    private fun downloadAndApplyUpdate(downloadUrl: String, newVersion: String, sha256: String? = null): Boolean {
+        val tempFile = otaDownloadFile(newVersion)
+
+        // Partial downloads of versions that are no longer current will never be resumed
+        context.cacheDir.listFiles { file -> file.name.startsWith("ota_update_") && !file.name.startsWith(tempFile.name) }
+            ?.forEach { it.delete() }
         
         return try {
-            // Download the update
+            // Download the update; an interrupted download resumes from its journal next time
             Log.d(TAG, "📥 Downloading update from: $downloadUrl")
-            val url = URL(downloadUrl)
-            val connection = url.openConnection() as HttpURLConnection
-            connection.connectTimeout = 30000
-            connection.readTimeout = 30000
-            
-            connection.inputStream.use { input ->
-                FileOutputStream(tempFile).use { output ->
-                    val buffer = ByteArray(8192)
-                    var bytesRead: Int
-                    var totalBytes = 0L
-                    
-                    while (input.read(buffer).also { bytesRead = it } != -1) {
-                        output.write(buffer, 0, bytesRead)
-                        totalBytes += bytesRead
-                        
-                        // Log progress every 1MB
-                        if (totalBytes % (1024 * 1024) == 0L) {
-                            Log.d(TAG, "📥 Downloaded ${totalBytes / (1024 * 1024)}MB...")
-                        }
-                    }
-                    
-                    Log.d(TAG, "✅ Download complete: ${totalBytes / 1024}KB")
-                }
-            }
-            
-            // Apply the update
-            val laravelDir = File(appStorageDir, "laravel")
-            
-            // Clean directory but preserve user data
-            if (laravelDir.exists()) {
-                deleteDirectoryContentsExcept(laravelDir, preservePaths)
-            } else {
-                laravelDir.mkdirs()
-            }
+            download(downloadUrl, tempFile, sha256, otaDownloadSegments())
             
-            // Extract the update
-            Log.d(TAG, "📦 Extracting OTA update...")
-            FileInputStream(tempFile).use { fileInput ->
-                unzip(fileInput, laravelDir)
-            }
+            // Apply the update to the inactive slot
+            val slotDir = slots.beginUpdate()
             
-            // Update the NATIVEPHP_APP_VERSION in .env file
-            val envFile = File(laravelDir, ".env")
-            if (envFile.exists()) {
-                var envContent = envFile.readText()
-                
-                // Update or add NATIVEPHP_APP_VERSION
-                if (envContent.contains(Regex("NATIVEPHP_APP_VERSION=.*"))) {
-                    envContent = envContent.replace(
-                        Regex("NATIVEPHP_APP_VERSION=.*"),
-                        "NATIVEPHP_APP_VERSION=$newVersion"
-                    )
-                } else {
-                    // Add it if not present
-                    envContent += "\nNATIVEPHP_APP_VERSION=$newVersion"
-                }
-                
-                envFile.writeText(envContent)
-                Log.d(TAG, "✅ Updated NATIVEPHP_APP_VERSION to $newVersion in .env")
-            }
+            // Only files that differ from what the slot last held are rewritten
+            Log.d(TAG, "📦 Installing OTA update into slot ${slots.inactiveSlot}...")
+            installBundleFile(tempFile, slotDir)
             
-            // Write version marker file to prevent re-extraction of old bundle
-            val otaMarkerFile = File(laravelDir, ".ota_applied")
-            otaMarkerFile.writeText(newVersion)
+            markOtaApplied(slotDir, newVersion)
+            slots.stageUpdate(newVersion)
             
             // Clean up
             tempFile.delete()
@@ -353,7 +459,9 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
         } catch (e: Exception) {
             Log.e(TAG, "❌ Failed to download or apply OTA update", e)
             
-            // Clean up on failure
+            // A finished download that failed to install is fetched again. An
+            // interrupted one lives in its .part and .journal files, which
+            // stay for the next attempt to resume.
             if (tempFile.exists()) {
                 tempFile.delete()
             }
@@ -362,6 +470,305 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
         }
     }
 
+    /**
+     * Install the update while it downloads: every chunk read from the network
+     * goes straight to the native inflater, which writes entries into a staging
+     * directory and checks each one's CRC as it ends. Only a complete, verified
+     * tree is swapped in, so no temp zip is written and an interrupted download
+     * leaves the installed version alone.
+     */
+    private fun streamAndApplyUpdate(downloadUrl: String, newVersion: String, sha256: String? = null): Boolean {
+        val slotDir = slots.beginUpdate()
+        val stagingDir = File(appStorageDir, STAGING_DIR)
+
+        val handle = nativeStreamOpen(stagingDir.absolutePath)
+        if (handle == 0L) {
+            return false
+        }
+
+        val start = System.currentTimeMillis()
+        var finished = false
+
+        return try {
+            Log.d(TAG, "📥 Streaming update from: $downloadUrl")
+            val connection = URL(downloadUrl).openConnection() as HttpURLConnection
+            connection.connectTimeout = 30000
+            connection.readTimeout = 30000
+
+            var totalBytes = 0L
+            val digest = MessageDigest.getInstance("SHA-256")
+            connection.inputStream.use { input ->
+                val buffer = ByteArray(STREAM_BUFFER_SIZE)
+                var bytesRead: Int
+
+                while (input.read(buffer).also { bytesRead = it } != -1) {
+                    if (!nativeStreamFeed(handle, buffer, bytesRead)) {
+                        throw java.io.IOException("Update archive rejected after $totalBytes bytes")
+                    }
+                    digest.update(buffer, 0, bytesRead)
+                    totalBytes += bytesRead
+                }
+            }
+
+            // Entries were CRC checked as they landed; the whole-file hash is checked before commit
+            val actualSha256 = digest.digest().joinToString("") { "%02x".format(it) }
+            if (sha256 != null && !actualSha256.equals(sha256, ignoreCase = true)) {
+                finished = true
+                nativeStreamAbort(handle)
+                Log.e(TAG, "❌ Streamed update failed its SHA-256 check")
+                return false
+            }
+
+            finished = true
+            val files = nativeStreamFinish(handle)
+            if (files < 0) {
+                Log.e(TAG, "❌ Streamed update is incomplete or corrupt")
+                return false
+            }
+
+            // Version bump and marker go in before the swap so they land atomically with the tree
+            markOtaApplied(stagingDir, newVersion)
+
+            // User data moves across when the slot is switched to, so nothing is kept here
+            if (!nativeStreamCommit(stagingDir.absolutePath, slotDir.absolutePath, emptyArray())) {
+                Log.e(TAG, "❌ Failed to commit streamed update")
+                return false
+            }
+            slots.stageUpdate(newVersion)
+
+            Log.d(TAG, "✅ Streamed ${totalBytes / 1024}KB and installed $files files in ${System.currentTimeMillis() - start}ms")
+            true
+        } catch (e: Exception) {
+            Log.e(TAG, "❌ Failed to stream OTA update", e)
+            false
+        } finally {
+            if (!finished) {
+                nativeStreamAbort(handle)
+            }
+        }
+    }
+
+    /**
+     * Apply a delta from the installed version: only added and changed files
+     * are downloaded, changed files as binary patches. The native applier
+     * verifies every result before touching the install, so on failure the
+     * caller can still fall back to the full bundle.
+     */
+    private fun downloadAndApplyPatch(patchUrl: String, newVersion: String, sha256: String? = null): Boolean {
+        val tempFile = File(context.cacheDir, "ota_patch_$newVersion.zip")
+
+        return try {
+            if (!File(slots.slotDir(slots.activeSlot), ".bundle_manifest").exists()) {
+                Log.d(TAG, "ℹ️ No install manifest, a delta can't be applied")
+                return false
+            }
+
+            Log.d(TAG, "📥 Downloading patch from: $patchUrl")
+            download(patchUrl, tempFile, sha256)
+
+            // The patch was made against the active version, so apply it to a copy of that
+            val slotDir = slots.cloneActiveIntoInactive(preservePaths)
+            val result = nativeApplyDelta(tempFile.absolutePath, slotDir.absolutePath)
+            if (result != 0) {
+                Log.e(TAG, "❌ Native delta apply failed")
+                return false
+            }
+
+            markOtaApplied(slotDir, newVersion)
+            slots.stageUpdate(newVersion)
+            Log.d(TAG, "✅ Delta update applied successfully to version $newVersion")
+            true
+        } catch (e: Exception) {
+            Log.e(TAG, "❌ Failed to download or apply delta update", e)
+            false
+        } finally {
+            tempFile.delete()
+        }
+    }
+
+    private fun download(downloadUrl: String, destination: File, sha256: String? = null, segments: Int = 1) {
+        ResumableDownloader(downloadUrl, destination, sha256, segments).download()
+    }
+
+    private fun otaDownloadSegments(): Int =
+        getBundledEnvValue("NATIVEPHP_OTA_SEGMENTS")?.toIntOrNull()?.coerceIn(1, 8) ?: 1
+
+    private fun markOtaApplied(laravelDir: File, newVersion: String) {
+        // Update the NATIVEPHP_APP_VERSION in .env file
+        val envFile = File(laravelDir, ".env")
+        if (envFile.exists()) {
+            var envContent = envFile.readText()
+            
+            // Update or add NATIVEPHP_APP_VERSION
+            if (envContent.contains(Regex("NATIVEPHP_APP_VERSION=.*"))) {
+                envContent = envContent.replace(
+                    Regex("NATIVEPHP_APP_VERSION=.*"),
+                    "NATIVEPHP_APP_VERSION=$newVersion"
+                )
+            } else {
+                // Add it if not present
+                envContent += "\nNATIVEPHP_APP_VERSION=$newVersion"
+            }
+            
+            envFile.writeText(envContent)
+            Log.d(TAG, "✅ Updated NATIVEPHP_APP_VERSION to $newVersion in .env")
+        }
+        
+        // Write version marker file to prevent re-extraction of old bundle
+        val otaMarkerFile = File(laravelDir, ".ota_applied")
+        otaMarkerFile.writeText(newVersion)
+    }
+
+    /**
+     * Install a bundled zip asset incrementally: the native installer reads it
+     * straight out of the APK by descriptor, writes only files whose CRC or size
+     * differ from the installed `.bundle_manifest` and deletes files the bundle
+     * dropped. Falls back to wipe-and-unzip if that isn't possible.
+     */
+    private fun installBundleAsset(assetName: String, destinationDir: File, onlyPaths: List<String>? = null) {
+        prepareIncrementalInstall(destinationDir)
+
+        val installed = try {
+            context.assets.openFd(assetName).use { afd: AssetFileDescriptor ->
+                extractNatively(afd.parcelFileDescriptor.fd, afd.startOffset, afd.length, destinationDir, onlyPaths)
+            }
+        } catch (e: Exception) {
+            Log.w(TAG, "⚠️ $assetName can't be opened by descriptor, using stream extraction", e)
+            false
+        }
+
+        if (!installed) {
+            deleteDirectoryContentsExcept(destinationDir, preservePaths)
+            unzip(context.assets.open(assetName), destinationDir)
+        }
+    }
+
+    private fun installBundleFile(zipFile: File, destinationDir: File) {
+        prepareIncrementalInstall(destinationDir)
+
+        val installed = ParcelFileDescriptor.open(zipFile, ParcelFileDescriptor.MODE_READ_ONLY).use { pfd ->
+            extractNatively(pfd.fd, 0L, zipFile.length(), destinationDir)
+        }
+
+        if (!installed) {
+            deleteDirectoryContentsExcept(destinationDir, preservePaths)
+            FileInputStream(zipFile).use { fileInput ->
+                unzip(fileInput, destinationDir)
+            }
+        }
+    }
+
+    /**
+     * Without a manifest we can't tell bundle files from leftovers (an install
+     * from before manifests existed, or one that was interrupted), so start
+     * from a clean tree once, the way every install used to.
+     */
+    private fun prepareIncrementalInstall(destinationDir: File) {
+        if (!destinationDir.exists()) {
+            destinationDir.mkdirs()
+            return
+        }
+
+        if (!File(destinationDir, ".bundle_manifest").exists()) {
+            Log.d(TAG, "🧹 No install manifest, clearing ${destinationDir.name} before install")
+            deleteDirectoryContentsExcept(destinationDir, preservePaths)
+        }
+    }
+
+    private fun extractNatively(
+        fd: Int,
+        offset: Long,
+        length: Long,
+        destinationDir: File,
+        onlyPaths: List<String>? = null
+    ): Boolean {
+        val start = System.currentTimeMillis()
+        val written = nativeExtractBundle(
+            fd, offset, length, destinationDir.absolutePath, 0, true, onlyPaths?.toTypedArray(),
+            true, preservePaths.toTypedArray()
+        )
+        if (written < 0) {
+            Log.e(TAG, "❌ Native install failed, falling back to ZipInputStream")
+            return false
+        }
+
+        Log.d(TAG, "⚡ Native install wrote $written files in ${System.currentTimeMillis() - start}ms")
+        return true
+    }
+
+    /**
+     * Let PHP read the app straight out of laravel_bundle.zip instead of the
+     * extracted tree. Opt-in with NATIVEPHP_RUN_FROM_BUNDLE=true in the bundled
+     * .env. OTA installs are always fully extracted, so they're never mounted.
+     */
+    private fun mountBundleArchive() {
+        val laravelDir = File(appStorageDir, "laravel")
+        if (File(laravelDir, ".ota_applied").exists() || !isRunFromBundleEnabled()) {
+            return
+        }
+
+        val mounted = try {
+            context.assets.openFd("laravel_bundle.zip").use { afd ->
+                nativeMountBundle(
+                    afd.parcelFileDescriptor.fd,
+                    afd.startOffset,
+                    afd.length,
+                    laravelDir.absolutePath,
+                    bundleDiskPaths.toTypedArray()
+                )
+            }
+        } catch (e: Exception) {
+            Log.e(TAG, "❌ Failed to open laravel_bundle.zip for mounting", e)
+            false
+        }
+
+        if (mounted) {
+            Log.d(TAG, "📦 Running Laravel from the bundle archive")
+        } else {
+            // Without the mount only the disk paths exist, so finish the extraction
+            Log.w(TAG, "⚠️ Bundle mount failed, extracting the full tree instead")
+            installBundleAsset("laravel_bundle.zip", laravelDir)
+        }
+    }
+
+    private fun isRunFromBundleEnabled(): Boolean =
+        getBundledEnvValue("NATIVEPHP_RUN_FROM_BUNDLE")?.lowercase() == "true"
+
+    private fun getBundledEnvValue(name: String): String? {
+        if (bundleMetaLoaded) {
+            return nativeBundleEnvValue(name)
+        }
+
+        val envContent = bundledEnvContent ?: return null
+        return Regex("(?m)^$name=(.*)$").find(envContent)?.groupValues?.get(1)?.trim()
+    }
+
+    private fun loadBundleMeta(): Boolean =
+        try {
+            context.assets.openFd("laravel_bundle.zip").use { afd ->
+                nativeLoadBundleMeta(afd.parcelFileDescriptor.fd, afd.startOffset, afd.length)
+            }
+        } catch (e: Exception) {
+            Log.w(TAG, "⚠️ laravel_bundle.zip can't be opened by descriptor, reading its .env with ZipInputStream", e)
+            false
+        }
+
+    private fun readBundledEnv(): String? {
+        try {
+            ZipInputStream(context.assets.open("laravel_bundle.zip")).use { zis ->
+                var entry: ZipEntry?
+                while (zis.nextEntry.also { entry = it } != null) {
+                    if (entry?.name == ".env") {
+                        return zis.bufferedReader().readText()
+                    }
+                }
+            }
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to read .env from bundle", e)
+        }
+        return null
+    }
+
     private fun unzip(inputStream: java.io.InputStream, destinationDir: File) {
         val buffer = ByteArray(4096)
         val zis = ZipInputStream(BufferedInputStream(inputStream))
@@ -375,6 +782,8 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
                 file.mkdirs()
             } else {
                 file.parentFile?.mkdirs()
+                // Replace rather than truncate: the file may be a hard link into the active slot
+                file.delete()
                 FileOutputStream(file).use { fos ->
                     var count: Int
                     while (zis.read(buffer).also { count = it } != -1) {
@@ -446,7 +855,7 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
         }
     }
 
-    private fun runBaseArtisanCommands() {
+    private fun createDatabaseFile() {
         val dbFile = File(appStorageDir, "persisted_data/database/database.sqlite")
         if (!dbFile.exists()) {
             Log.d(TAG, "📄 Creating empty SQLite file: ${dbFile.absolutePath}")
@@ -454,7 +863,9 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
         } else {
             Log.d(TAG, "✅ SQLite file already exists: ${dbFile.absolutePath}")
         }
+    }
 
+    private fun runBaseArtisanCommands() {
         phpBridge.runArtisanCommand("config:clear")
         phpBridge.runArtisanCommand("clear-compiled")
         phpBridge.runArtisanCommand("optimize:clear")
@@ -466,6 +877,24 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
         Log.d(TAG, "✅ Migration result: $migrate")
     }
 
+    private fun prepareAssetLookupCache() {
+        val laravelDir = File(appStorageDir, "laravel")
+        val otaMarkerFile = File(laravelDir, ".ota_applied")
+        val installedVersion = if (otaMarkerFile.exists()) {
+            otaMarkerFile.readText().trim()
+        } else {
+            File(laravelDir, ".env").takeIf { it.exists() }?.let { getVersionFromEnvFile(it) }
+        } ?: "DEBUG"
+
+        AssetLookupCache.init(File(appStorageDir, "persisted_data"), installedVersion)
+
+        // Only pay for route:list once per installed version
+        if (AssetLookupCache.needsRouteManifest()) {
+            val routes = phpBridge.runArtisanCommand("route:list --json")
+            AssetLookupCache.storeRouteManifest(routes)
+        }
+    }
+
     @SuppressLint("SetWorldReadable", "SetWorldWritable")
     private fun setupDirectories() {
         try {
@@ -566,30 +995,29 @@ class LaravelEnvironment<InputStream>(private val context: Context) {
             setEnvironmentVariable("SESSION_SAVE_PATH", phpSessionDir.absolutePath)
             Log.d(TAG, "PHP session path set to: ${phpSessionDir.absolutePath}")
 
-            try {
-                copyAssetToInternalStorage("cacert.pem", "cacert.pem")
-                val phpIni = """
+        } catch (e: Exception) {
+            Log.e(TAG, "Failed to setup environment", e)
+            throw e
+        }
+    }
+
+    private fun installCaBundle() {
+        try {
+            copyAssetToInternalStorage("cacert.pem", "cacert.pem")
+            val phpIni = """
 curl.cainfo="${context.filesDir.absolutePath}/cacert.pem"
 openssl.cafile="${context.filesDir.absolutePath}/cacert.pem"
 """
-                File(context.filesDir, "php.ini").writeText(phpIni)
-            } catch (e: Exception) {
-                Log.e(TAG, "❌ Failed to copy or set CURL_CA_BUNDLE", e)
-            }
-
+            File(context.filesDir, "php.ini").writeText(phpIni)
         } catch (e: Exception) {
-            Log.e(TAG, "Failed to setup environment", e)
-            throw e
+            Log.e(TAG, "❌ Failed to copy or set CURL_CA_BUNDLE", e)
         }
     }
 
     private fun generateAndSaveAppKey(file: File): String {
-        val result = phpBridge.runArtisanCommand("key:generate --show")
-        val generatedKey = result.trim()
-
-        if (!generatedKey.startsWith("base64:")) {
-            throw RuntimeException("Failed to generate APP_KEY, got: '$generatedKey'")
-        }
+        // Same format as `artisan key:generate --show`, without booting PHP for it
+        val bytes = ByteArray(32).also { SecureRandom().nextBytes(it) }
+        val generatedKey = "base64:" + Base64.getEncoder().encodeToString(bytes)
 
         file.parentFile?.mkdirs()
         file.writeText(generatedKey)
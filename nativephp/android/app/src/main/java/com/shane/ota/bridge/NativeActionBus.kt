@@ -0,0 +1,120 @@
+package com.shane.ota.bridge
+
+import android.util.Log
+
+/**
+ * Kotlin side of native/native_actions.c. PHP starts an action through
+ * `nativephp_call()` (or one of the NativePHP* functions) and gets a handle;
+ * PHPBridge.nativeBeginAction launches it and whoever finishes it calls
+ * [complete] with that handle, from any thread. Results wait natively until
+ * PHPBridge dispatches them on the PHP thread, or a request that runs first
+ * takes them with `nativephp_events()`; either way nothing has to go back
+ * through the WebView to reach Laravel.
+ *
+ * Handle 0 is for events nothing asked for, such as a chosen file. High-rate
+ * ones can be [coalesce]d so PHP gets one result per window rather than one
+ * per event; [stats] shows whether the queue keeps up.
+ */
+object NativeActionBus {
+    private const val TAG = "NativeActionBus"
+
+    /** Code for an action the user backed out of, or that couldn't run. */
+    const val CANCELLED = -1
+
+    // Only true once libphp_wrapper is loaded, so plain JVM tests never reach the natives
+    @Volatile var attached = false
+        private set
+
+    /** Called after each queued completion; PHPBridge uses it to schedule a dispatch. */
+    @Volatile var onCompleted: (() -> Unit)? = null
+
+    private external fun nativeComplete(handle: Long, event: String, payload: String, code: Int): Boolean
+    private external fun nativeInFlight(): Int
+    private external fun nativeCompleted(): Int
+    private external fun nativeCoalesce(event: String, mode: Int, windowMs: Int)
+    private external fun nativeSetLimit(limit: Int)
+    private external fun nativeStats(): LongArray
+
+    /** How queued handle 0 events of one name merge; ordinal matches native_coalesce_mode. */
+    enum class Coalesce {
+        /** Every event is delivered. */
+        NONE,
+        /** Only the latest payload. */
+        LAST,
+        /** The latest payload, with how many were merged in the result's count. */
+        COUNT,
+        /** A batch: a JSON array of every payload, oldest first, dispatched one by one. */
+        LIST
+    }
+
+    /** Queue backpressure since start, from native_action_stats in native/native_actions.h. */
+    data class Stats(
+        val completed: Long,
+        val coalesced: Long,
+        val dropped: Long,
+        val delivered: Long,
+        val batches: Long,
+        val queued: Long,
+        val queuedPeak: Long,
+        val waitMaxNs: Long,
+        val waitTotalNs: Long
+    ) {
+        companion object {
+            fun fromNative(values: LongArray) = Stats(
+                values[0], values[1], values[2], values[3], values[4], values[5], values[6], values[7], values[8]
+            )
+        }
+
+        val waitMeanNs: Long
+            get() = if (delivered > 0) waitTotalNs / delivered else 0
+
+        override fun toString() =
+            "$completed completed, $coalesced coalesced, $dropped dropped, $delivered delivered in $batches batches, " +
+                "$queued queued (peak $queuedPeak), wait mean ${waitMeanNs / 1_000_000}ms max ${waitMaxNs / 1_000_000}ms"
+    }
+
+    fun attach() {
+        attached = true
+    }
+
+    /**
+     * Finishes [handle] with the Laravel [event] to dispatch ("" for none) and
+     * its JSON [payload]. [code] is action specific: the alert button pressed,
+     * or [CANCELLED].
+     */
+    fun complete(handle: Long, event: String, payload: String = "{}", code: Int = 0): Boolean {
+        if (!attached) return false
+
+        val queued = nativeComplete(handle, event, payload, code)
+        Log.d(TAG, "📬 #$handle ${event.ifEmpty { "(no event)" }} code=$code queued=$queued")
+        if (queued) onCompleted?.invoke()
+        return queued
+    }
+
+    /**
+     * Finishes [handle] as cancelled. Actions started without a handle (0)
+     * have nothing waiting on them, so there is nothing to queue for PHP.
+     */
+    fun cancel(handle: Long): Boolean = handle != 0L && complete(handle, "", "{}", CANCELLED)
+
+    /**
+     * Merge [event]s that complete within [windowMs] of the first one still
+     * waiting for PHP. Results for a handle are never merged.
+     */
+    fun coalesce(event: String, mode: Coalesce, windowMs: Int = 1000) {
+        if (attached) nativeCoalesce(event, mode.ordinal, windowMs)
+    }
+
+    /** Most results kept waiting; past it the oldest handle 0 ones are dropped. */
+    fun setLimit(limit: Int) {
+        if (attached) nativeSetLimit(limit)
+    }
+
+    fun stats(): Stats? = if (attached) Stats.fromNative(nativeStats()) else null
+
+    val inFlight: Int
+        get() = if (attached) nativeInFlight() else 0
+
+    val completed: Int
+        get() = if (attached) nativeCompleted() else 0
+}
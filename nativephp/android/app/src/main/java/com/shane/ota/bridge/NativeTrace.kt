@@ -0,0 +1,78 @@
+package com.shane.ota.bridge
+
+import android.content.Context
+import android.util.Log
+import java.io.File
+
+/**
+ * Kotlin side of the native tracer in trace/trace.c. Spans recorded here end
+ * up in the same Chrome trace file as the native ones: System.nanoTime() and
+ * zend_hrtime() both read CLOCK_MONOTONIC, so they line up on one timeline.
+ *
+ * Off unless the flag file exists, which can be toggled without a rebuild:
+ *
+ *     adb shell run-as com.shane.ota touch files/trace.enabled
+ *
+ * Traces are written to files/traces/ and open in chrome://tracing or Perfetto.
+ */
+object NativeTrace {
+    private const val TAG = "NativeTrace"
+    private const val FLAG_FILE = "trace.enabled"
+    private const val TRACE_DIR = "traces"
+    private const val MAX_TRACES = 5
+
+    // Only true once libphp_wrapper is loaded, so plain JVM tests never reach the natives
+    @Volatile var enabled = false
+        private set
+
+    private external fun nativeStart(path: String): Boolean
+    private external fun nativeStop()
+    private external fun nativeFlush()
+    private external fun nativeSpan(name: String, category: String, startNs: Long, endNs: Long)
+
+    /** libphp_wrapper is loaded and buffering spans until [configure] decides. */
+    fun attach() {
+        enabled = true
+    }
+
+    /** Read the runtime flag: start writing a trace file, or drop what was buffered. */
+    fun configure(context: Context) {
+        if (!enabled) return
+
+        if (!File(context.filesDir, FLAG_FILE).exists()) {
+            nativeStop()
+            enabled = false
+            return
+        }
+
+        val dir = File(context.filesDir, TRACE_DIR).apply { mkdirs() }
+        dir.listFiles()?.sortedByDescending { it.lastModified() }?.drop(MAX_TRACES - 1)?.forEach { it.delete() }
+
+        val file = File(dir, "trace-${System.currentTimeMillis()}.json")
+        if (nativeStart(file.absolutePath)) {
+            Log.d(TAG, "🧵 Tracing to ${file.absolutePath}")
+        } else {
+            enabled = false
+        }
+    }
+
+    fun record(name: String, category: String, startNs: Long, endNs: Long) {
+        if (enabled) nativeSpan(name, category, startNs, endNs)
+    }
+
+    inline fun <T> span(name: String, category: String = "kotlin", block: () -> T): T {
+        if (!enabled) return block()
+
+        val start = System.nanoTime()
+        try {
+            return block()
+        } finally {
+            record(name, category, start, System.nanoTime())
+        }
+    }
+
+    /** Write buffered spans out; cheap enough to call after every request. */
+    fun flush() {
+        if (enabled) nativeFlush()
+    }
+}
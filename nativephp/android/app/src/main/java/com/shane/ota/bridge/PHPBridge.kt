@@ -9,10 +9,14 @@ import android.webkit.CookieManager
 import androidx.annotation.RequiresApi
 import androidx.core.app.ActivityCompat
 import org.json.JSONObject
+import java.io.File
 import java.util.concurrent.ConcurrentHashMap
+import java.util.concurrent.atomic.AtomicBoolean
 import android.Manifest
 import androidx.core.content.ContextCompat
 import com.shane.ota.network.PHPRequest
+import com.shane.ota.network.RequestMemory
+import com.shane.ota.network.RequestTiming
 import com.shane.ota.security.LaravelCookieStore
 import com.shane.ota.utils.NativeActions
 import android.os.Handler
@@ -25,7 +29,6 @@ import androidx.security.crypto.MasterKey
 class PHPBridge(private val context: Context) {
     private var lastPostData: String? = null
     private val requestDataMap = ConcurrentHashMap<String, String>()
-    private val phpExecutor = java.util.concurrent.Executors.newSingleThreadExecutor()
     var pendingPhotoPath: String? = null
 
     private val nativePhpScript: String
@@ -34,6 +37,7 @@ class PHPBridge(private val context: Context) {
     external fun nativeExecuteScript(filename: String): String
     external fun nativeSetEnv(name: String, value: String, overwrite: Int): Int
     external fun runArtisanCommand(command: String): String
+    private external fun nativeDispatchEvents(): String?
     external fun initialize()
     external fun setRequestInfo(method: String, uri: String, postData: String?)
     external fun getLaravelPublicPath(): String
@@ -45,21 +49,57 @@ class PHPBridge(private val context: Context) {
         postData: String?,
         scriptPath: String
     ): String
+    private external fun nativeLastRequestTimings(): LongArray
+    private external fun nativeLastRequestMemory(): LongArray
+    private external fun nativeRecordRequestTiming(method: String, uri: String, timings: LongArray)
+    private external fun nativeRequestMetrics(): String
+    private external fun nativeSetProfiling(enabled: Boolean, directory: String)
+    private external fun nativeProfileNextRequest(directory: String)
+    private external fun nativeSetSampling(hz: Int, windowMs: Int, directory: String)
 
 
     companion object {
         private const val TAG = "PHPBridge"
         private const val MAX_REQUEST_AGE = 5 * 60 * 1000L
 
+        /** How long a burst of native events is collected before it goes to PHP in one run. */
+        @Volatile var eventBatchMs = 50L
+
+        // The engine isn't thread-safe, so every bridge runs PHP on this one thread
+        private val phpExecutor = java.util.concurrent.Executors.newSingleThreadExecutor()
+        private val eventDispatchScheduled = AtomicBoolean(false)
+
+        /** Any request carrying this header gets a callgrind profile written for it. */
+        const val PROFILE_HEADER = "X-NativePHP-Profile"
+
         init {
+            val start = System.nanoTime()
             System.loadLibrary("compat")
+            val compatLoaded = System.nanoTime()
             System.loadLibrary("php")
+            val phpLoaded = System.nanoTime()
             System.loadLibrary("php_wrapper")
+
+            // The tracer lives in php_wrapper, so these can only be reported now
+            NativeTrace.attach()
+            NativeActionBus.attach()
+            NativeTrace.record("loadLibrary compat", "loader", start, compatLoaded)
+            NativeTrace.record("loadLibrary php", "loader", compatLoaded, phpLoaded)
+            NativeTrace.record("loadLibrary php_wrapper", "loader", phpLoaded, System.nanoTime())
         }
     }
 
-    fun handleLaravelRequest(request: PHPRequest): String {
+    /**
+     * Runs [request] on the PHP thread. When [timing] is given it receives the
+     * queue wait, the natively measured PHP phases and the raw response
+     * conversion; the caller adds its own conversion time and calls [recordTiming].
+     */
+    fun handleLaravelRequest(request: PHPRequest, timing: RequestTiming? = null): String {
+        val submitted = System.nanoTime()
         val future = phpExecutor.submit<String> {
+            val start = System.nanoTime()
+            timing?.phases?.set(RequestTiming.QUEUE, start - submitted)
+
             request.headers.forEach { (key, value) ->
                 val envKey = "HTTP_" + key.replace("-", "_").uppercase()
                 nativeSetEnv(envKey, value, 1)
@@ -72,6 +112,10 @@ class PHPBridge(private val context: Context) {
 
             initialize()
 
+            if (request.headers.keys.any { it.equals(PROFILE_HEADER, ignoreCase = true) }) {
+                nativeProfileNextRequest(profileDir().absolutePath)
+            }
+
             val output = nativeHandleRequestOnce(
                 request.method,
                 request.uri,
@@ -79,13 +123,89 @@ class PHPBridge(private val context: Context) {
                 nativePhpScript
             )
 
+            timing?.let {
+                nativeLastRequestTimings().copyInto(it.phases, RequestTiming.STARTUP, RequestTiming.STARTUP, RequestTiming.SHUTDOWN + 1)
+            }
+
+            val convertStart = System.nanoTime()
             val processedOutput = processRawPHPResponse(output)
+            timing?.phases?.let { it[RequestTiming.CONVERT] += System.nanoTime() - convertStart }
+            Log.d(TAG, "🧮 ${request.method} ${request.uri}: ${lastRequestMemory()}")
+            NativeTrace.record("${request.method} ${request.uri}", "request", start, System.nanoTime())
+            NativeTrace.flush()
             processedOutput
         }
 
         return future.get()
     }
 
+    /**
+     * Makes this the bridge that hands native events to Laravel. Only the one
+     * serving WebView requests should call it; there is a single hook.
+     */
+    fun registerEventDispatch() {
+        NativeActionBus.onCompleted = { scheduleEventDispatch() }
+    }
+
+    /**
+     * Hands queued native events to Laravel's dispatcher on the PHP thread,
+     * [eventBatchMs] after the first one, so a burst and anything that
+     * finished while a request was running go in a single artisan run. A
+     * request that gets to the PHP thread first takes them itself, through
+     * the app's DispatchNativeEvents middleware, and this finds nothing to do.
+     */
+    fun scheduleEventDispatch() {
+        if (!eventDispatchScheduled.compareAndSet(false, true)) return
+
+        Handler(Looper.getMainLooper()).postDelayed({
+            phpExecutor.submit {
+                // Events completing from here on need a run of their own
+                eventDispatchScheduled.set(false)
+                val output = NativeTrace.span("dispatch native events", "php") { nativeDispatchEvents() }
+                    ?: return@submit
+                Log.d(TAG, "📬 ${output.trim()}: ${NativeActionBus.stats()}")
+            }
+        }, eventBatchMs)
+    }
+
+    /** Zend MM, RSS and native heap figures of the last request handled. */
+    fun lastRequestMemory(): RequestMemory = RequestMemory.fromNative(nativeLastRequestMemory())
+
+    /** Adds a finished request to the rolling per-route percentiles. */
+    fun recordTiming(timing: RequestTiming) {
+        nativeRecordRequestTiming(timing.method, timing.uri, timing.phases)
+    }
+
+    /**
+     * p50/p95/p99 in milliseconds per route ("GET /users/{id}"), overall and
+     * per phase, over each route's most recent requests.
+     */
+    fun requestMetrics(): JSONObject = JSONObject(nativeRequestMetrics())
+
+    /**
+     * Profile every PHP request until switched off. Each one leaves a
+     * callgrind file in files/profiles/ for KCachegrind or QCachegrind:
+     *
+     *     adb shell run-as com.shane.ota ls files/profiles
+     */
+    fun setProfiling(enabled: Boolean) {
+        nativeSetProfiling(enabled, profileDir().absolutePath)
+        Log.d(TAG, if (enabled) "🔬 Profiling PHP requests into ${profileDir()}" else "🔬 PHP profiling off")
+    }
+
+    /**
+     * Sample PHP stacks [hz] times a second (0 stops) while scripts run. Cheap
+     * enough to leave on in the field; every [windowMs] the folded stacks go to
+     * files/samples/ for flamegraph.pl or speedscope.
+     */
+    fun setSampling(hz: Int, windowMs: Int = 10_000) {
+        val dir = File(context.filesDir, "samples").apply { mkdirs() }
+        nativeSetSampling(hz, windowMs, dir.absolutePath)
+        Log.d(TAG, if (hz > 0) "📈 Sampling PHP stacks at ${hz}Hz into $dir" else "📈 PHP sampling off")
+    }
+
+    private fun profileDir() = File(context.filesDir, "profiles").apply { mkdirs() }
+
     // New function to store request data with a key
     fun storeRequestData(key: String, data: String) {
         requestDataMap[key] = data
@@ -222,10 +342,6 @@ class PHPBridge(private val context: Context) {
         NativeActions.showToast(context, message)
     }
 
-    fun nativeShowAlert(title: String, message: String) {
-        NativeActions.showAlert(context, title, message)
-    }
-
     fun nativeShare(title: String, message: String) {
         NativeActions.share(context, title, message)
     }
@@ -234,35 +350,70 @@ class PHPBridge(private val context: Context) {
         NativeActions.toggleFlashlight(context)
     }
 
-    fun nativeOpenCamera() {
+    /**
+     * Launches an action started from PHP with [handle]; it finishes through
+     * NativeActionBus.complete(), here or in NativeActionCoordinator.
+     * [args] is a JSON object.
+     */
+    fun nativeBeginAction(handle: Long, action: String, args: String) {
+        Log.d(TAG, "🚀 Action #$handle $action $args")
+        val params = try {
+            JSONObject(args)
+        } catch (e: Exception) {
+            JSONObject()
+        }
+
+        when (action) {
+            "alert" -> {
+                val buttons = params.optJSONArray("buttons")
+                val titles = (0 until (buttons?.length() ?: 0)).map { buttons!!.optString(it) }
+                NativeActions.showAlert(context, params.optString("title"), params.optString("message"), titles) { index ->
+                    val payload = JSONObject().apply {
+                        put("index", index)
+                        put("label", titles.getOrNull(index) ?: "")
+                    }
+                    NativeActionBus.complete(handle, "Native\\Mobile\\Events\\Alert\\ButtonPressed", payload.toString(), index)
+                }
+            }
+            "camera" -> openCamera(handle)
+            "biometric" -> startBiometric(handle)
+            "push-token" -> getPushToken(handle)
+            else -> {
+                Log.e(TAG, "❌ Unknown action $action")
+                NativeActionBus.cancel(handle)
+            }
+        }
+    }
+
+    private fun openCamera(handle: Long) {
 
         // Launch camera on UI thread without blocking
         Handler(Looper.getMainLooper()).post {
-            val activity = context as? Activity
+            val activity = context as? FragmentActivity
             if (activity == null) {
                 Log.e("PHPBridge", "❌ Context is not an Activity!")
+                NativeActionBus.cancel(handle)
                 return@post
             }
 
             val permissionCheck = ContextCompat.checkSelfPermission(activity, Manifest.permission.CAMERA)
             if (permissionCheck == PackageManager.PERMISSION_GRANTED) {
-                val activity = context as? FragmentActivity ?: return@post
-                val coord = NativeActionCoordinator.install(activity)
-                coord.launchCamera()
+                NativeActionCoordinator.install(activity).launchCamera(handle)
             } else {
                 ActivityCompat.requestPermissions(activity, arrayOf(Manifest.permission.CAMERA), 1001)
+                NativeActionBus.cancel(handle)
             }
         }
     }
 
-    fun nativeStartBiometric() {
-            Handler(Looper.getMainLooper()).post {
-                NativeActionCoordinator.install(context as FragmentActivity)
-                    .launchBiometricPrompt()
-            }
+    private fun startBiometric(handle: Long) {
+        Handler(Looper.getMainLooper()).post {
+            NativeActionCoordinator.install(context as FragmentActivity)
+                .launchBiometricPrompt(handle)
         }
+    }
 
-    fun nativeGetPushToken() {
+    private fun getPushToken(handle: Long) {
         if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
             if (ContextCompat.checkSelfPermission(context, Manifest.permission.POST_NOTIFICATIONS)
                 != PackageManager.PERMISSION_GRANTED
@@ -272,12 +423,13 @@ class PHPBridge(private val context: Context) {
                     arrayOf(Manifest.permission.POST_NOTIFICATIONS),
                     1002 // use your own request code
                 )
-                return // wait for result before continuing
+                NativeActionBus.cancel(handle)
+                return // PHP asks again once it's granted
             }
         }
 
         Handler(Looper.getMainLooper()).post {
-            NativeActionCoordinator.install(context as FragmentActivity).launchPushTokenDispatch()
+            NativeActionCoordinator.install(context as FragmentActivity).launchPushTokenDispatch(handle)
         }
     }
 
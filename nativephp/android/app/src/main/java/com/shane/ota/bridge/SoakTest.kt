@@ -0,0 +1,85 @@
+package com.shane.ota.bridge
+
+import android.util.Log
+import com.shane.ota.network.RequestMemory
+import java.util.Locale
+
+/**
+ * Replays a request many times and fails if memory keeps growing with it.
+ * Growth is the least-squares slope over the requests after [warmup], so
+ * one-off caches filling up early don't count and a steady leak does
+ * however noisy RSS is.
+ *
+ * The bridge's own heap is counted exactly, so any growth there fails the
+ * run; RSS and Zend peak may grow by up to [maxGrowthPerRequest] bytes per
+ * request.
+ *
+ *     adb shell am start -n com.shane.ota/.ui.MainActivity --ei soak 500 --es soakPath /
+ */
+class SoakTest(
+    private val iterations: Int = 200,
+    private val warmup: Int = 20,
+    private val maxGrowthPerRequest: Long = 4 * 1024
+) {
+    companion object {
+        private const val TAG = "SoakTest"
+
+        /** Bytes per request a series grows by: its least-squares slope against the request index. */
+        fun slope(values: List<Long>): Double {
+            if (values.size < 2) return 0.0
+            val meanX = (values.size - 1) / 2.0
+            val meanY = values.average()
+            var covariance = 0.0
+            var variance = 0.0
+            values.forEachIndexed { x, y ->
+                covariance += (x - meanX) * (y - meanY)
+                variance += (x - meanX) * (x - meanX)
+            }
+            return covariance / variance
+        }
+    }
+
+    data class Result(
+        val requests: Int,
+        val rssGrowthPerRequest: Double,
+        val zendPeakGrowthPerRequest: Double,
+        val bridgeGrowthPerRequest: Double,
+        val maxGrowthPerRequest: Long,
+        val last: RequestMemory?
+    ) {
+        val passed: Boolean
+            get() = rssGrowthPerRequest <= maxGrowthPerRequest &&
+                zendPeakGrowthPerRequest <= maxGrowthPerRequest &&
+                bridgeGrowthPerRequest < 1.0
+
+        override fun toString() = String.format(
+            Locale.US,
+            "%s after %d requests: rss %+.0f B/req, zend peak %+.0f B/req, bridge %+.1f B/req (limit %d B/req)",
+            if (passed) "passed" else "FAILED", requests, rssGrowthPerRequest,
+            zendPeakGrowthPerRequest, bridgeGrowthPerRequest, maxGrowthPerRequest
+        )
+    }
+
+    /** Calls [runOnce] [iterations] times; it runs one request and returns that request's memory. */
+    fun run(runOnce: () -> RequestMemory): Result {
+        val measured = mutableListOf<RequestMemory>()
+        Log.d(TAG, "🧪 Soaking $iterations requests ($warmup warm-up)")
+
+        repeat(iterations) { i ->
+            val memory = runOnce()
+            if (i >= warmup) measured.add(memory)
+            if ((i + 1) % 50 == 0) Log.d(TAG, "🧪 ${i + 1}/$iterations: $memory")
+        }
+
+        val result = Result(
+            requests = iterations,
+            rssGrowthPerRequest = slope(measured.map { it.rssAfter }),
+            zendPeakGrowthPerRequest = slope(measured.map { it.zendPeak }),
+            bridgeGrowthPerRequest = slope(measured.map { it.bridgeLive }),
+            maxGrowthPerRequest = maxGrowthPerRequest,
+            last = measured.lastOrNull()
+        )
+        if (result.passed) Log.d(TAG, "✅ Soak $result") else Log.e(TAG, "❌ Soak $result")
+        return result
+    }
+}
@@ -0,0 +1,95 @@
+package com.shane.ota.bridge
+
+import android.util.Log
+import java.util.concurrent.CompletableFuture
+import java.util.concurrent.CompletionException
+import java.util.concurrent.ExecutorService
+import java.util.concurrent.Executors
+import java.util.concurrent.atomic.AtomicInteger
+
+/**
+ * Launch work as a dependency graph. Each step runs on a small pool as soon as
+ * the steps it depends on have finished, so independent file and network work
+ * overlaps instead of queueing behind whatever happened to be written first.
+ * Every step is timed so slow phases show up in logcat.
+ *
+ * A step that fails skips everything depending on it; [await] rethrows the
+ * original exception.
+ */
+class StartupGraph(threads: Int = 3) {
+    companion object {
+        private const val TAG = "StartupGraph"
+    }
+
+    class Step internal constructor(val name: String) {
+        internal lateinit var future: CompletableFuture<Void>
+
+        @Volatile var startedAtMs = -1L
+            internal set
+        @Volatile var elapsedMs = -1L
+            internal set
+    }
+
+    private val origin = System.nanoTime()
+    private val steps = mutableListOf<Step>()
+    private val threadCount = AtomicInteger()
+    private val pool: ExecutorService = Executors.newFixedThreadPool(threads) { runnable ->
+        Thread(runnable, "startup-${threadCount.incrementAndGet()}")
+    }
+
+    /** Adds [name], to run once everything in [after] has finished. */
+    fun step(name: String, vararg after: Step, action: () -> Unit): Step {
+        val step = Step(name)
+        val ready = if (after.isEmpty()) {
+            CompletableFuture.completedFuture(null)
+        } else {
+            CompletableFuture.allOf(*after.map { it.future }.toTypedArray())
+        }
+
+        step.future = ready.thenRunAsync({ run(step, action) }, pool)
+        synchronized(steps) { steps.add(step) }
+        return step
+    }
+
+    /** Blocks until [step] has finished, rethrowing whatever stopped it. */
+    fun await(step: Step) {
+        try {
+            step.future.join()
+        } catch (e: CompletionException) {
+            throw e.cause ?: e
+        }
+    }
+
+    /**
+     * Waits for [ready] and returns, leaving steps that don't lead to it running
+     * in the background. The pool shuts down once the last of them is done.
+     */
+    fun finish(ready: Step) {
+        val all = synchronized(steps) { steps.map { it.future }.toTypedArray() }
+        CompletableFuture.allOf(*all).whenComplete { _, _ ->
+            pool.shutdown()
+            Log.d(TAG, "🏁 All startup steps done after ${sinceStart()}ms")
+        }
+
+        await(ready)
+        Log.d(TAG, "🚀 ${ready.name} reached after ${sinceStart()}ms")
+    }
+
+    private fun run(step: Step, action: () -> Unit) {
+        step.startedAtMs = sinceStart()
+        val start = System.nanoTime()
+        try {
+            action()
+        } catch (e: Throwable) {
+            Log.e(TAG, "❌ Startup step ${step.name} failed", e)
+            throw e
+        } finally {
+            val end = System.nanoTime()
+            NativeTrace.record(step.name, "startup", start, end)
+            step.elapsedMs = (end - start) / 1_000_000
+            Log.d(TAG, "⏱️ ${step.name}: ${step.elapsedMs}ms (started at +${step.startedAtMs}ms)")
+        }
+    }
+
+    private fun sinceStart() = (System.nanoTime() - origin) / 1_000_000
+}
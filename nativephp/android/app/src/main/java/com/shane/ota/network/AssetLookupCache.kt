@@ -0,0 +1,166 @@
+package com.shane.ota.network
+
+import android.util.Log
+import org.json.JSONArray
+import org.json.JSONObject
+import java.io.File
+
+/**
+ * Remembers static asset paths that PHP already answered with a 404, and
+ * keeps a manifest of the app's route URIs so a missing asset can be
+ * rejected without booting Laravel at all.
+ *
+ * The manifest is stamped with the installed bundle version and discarded
+ * as soon as the bundle or an OTA update changes that version. Misses are
+ * only kept in memory, for files no request can create, since anything
+ * else may well exist by the next launch.
+ */
+object AssetLookupCache {
+    private const val TAG = "AssetLookupCache"
+    // Written by earlier versions, which persisted every miss
+    private const val MISSING_FILE = "asset_404_cache.txt"
+    private const val MANIFEST_FILE = "route_manifest.json"
+    private const val MAX_MISSING_ENTRIES = 512
+
+    // Only the build produces these: source maps, icons, scripts, styles and fonts
+    private val staticExtensions = setOf("map", "ico", "js", "css", "woff", "woff2", "ttf", "otf", "eot")
+
+    private val missingPaths = mutableSetOf<String>()
+    private var routePatterns: List<Regex>? = null
+    private var cacheDir: File? = null
+    private var version: String? = null
+
+    /**
+     * Load the persisted route manifest for [bundleVersion], dropping it if
+     * it was written for a different version. DEBUG builds never trust the
+     * cache because the Laravel tree changes underneath us on hot reload.
+     */
+    @Synchronized
+    fun init(directory: File, bundleVersion: String) {
+        cacheDir = directory
+        version = bundleVersion
+        missingPaths.clear()
+        routePatterns = null
+        File(directory, MISSING_FILE).delete()
+
+        if (bundleVersion == "DEBUG") {
+            Log.d(TAG, "ℹ️ DEBUG bundle, asset lookup cache disabled")
+            File(directory, MANIFEST_FILE).delete()
+            return
+        }
+
+        val manifestFile = File(directory, MANIFEST_FILE)
+        if (manifestFile.exists()) {
+            try {
+                val manifest = JSONObject(manifestFile.readText())
+                if (manifest.optString("version") == bundleVersion) {
+                    routePatterns = compileRoutes(manifest.getJSONArray("routes"))
+                    Log.d(TAG, "✅ Loaded route manifest with ${routePatterns?.size} routes")
+                } else {
+                    manifestFile.delete()
+                }
+            } catch (e: Exception) {
+                Log.e(TAG, "⚠️ Ignoring unreadable route manifest", e)
+                manifestFile.delete()
+            }
+        }
+    }
+
+    /** True when a route manifest for the current version still has to be generated. */
+    @Synchronized
+    fun needsRouteManifest(): Boolean = version != "DEBUG" && routePatterns == null
+
+    /**
+     * Store the route manifest from the JSON printed by `route:list --json`.
+     */
+    @Synchronized
+    fun storeRouteManifest(routeListJson: String) {
+        val dir = cacheDir ?: return
+        val bundleVersion = version ?: return
+
+        try {
+            val start = routeListJson.indexOf('[')
+            val end = routeListJson.lastIndexOf(']')
+            if (start < 0 || end < start) {
+                Log.w(TAG, "⚠️ route:list did not return JSON, skipping manifest")
+                return
+            }
+
+            val uris = JSONArray()
+            val routes = JSONArray(routeListJson.substring(start, end + 1))
+            for (i in 0 until routes.length()) {
+                val uri = routes.getJSONObject(i).optString("uri")
+                if (uri.isNotEmpty()) uris.put(uri)
+            }
+
+            val manifest = JSONObject().apply {
+                put("version", bundleVersion)
+                put("routes", uris)
+            }
+            File(dir, MANIFEST_FILE).writeText(manifest.toString())
+            routePatterns = compileRoutes(uris)
+            Log.d(TAG, "✅ Stored route manifest with ${uris.length()} routes")
+        } catch (e: Exception) {
+            Log.e(TAG, "❌ Failed to build route manifest", e)
+        }
+    }
+
+    @Synchronized
+    fun isKnownMissing(path: String): Boolean = missingPaths.contains(normalize(path))
+
+    /**
+     * Whether some PHP route could possibly answer [path]. Without a manifest
+     * we can't tell, so every path may match.
+     */
+    @Synchronized
+    fun routeMayMatch(path: String): Boolean {
+        val patterns = routePatterns ?: return true
+        val normalized = normalize(path)
+        return patterns.any { it.matches(normalized) }
+    }
+
+    /** Remember a 404 for [path] until the next launch, if it's a static asset. */
+    @Synchronized
+    fun rememberMissing(path: String) {
+        val bundleVersion = version ?: return
+        if (bundleVersion == "DEBUG" || missingPaths.size >= MAX_MISSING_ENTRIES) return
+
+        val normalized = normalize(path)
+        if (normalized.substringAfterLast('/').substringAfterLast('.', "").lowercase() !in staticExtensions) return
+
+        if (missingPaths.add(normalized)) {
+            Log.d(TAG, "🚫 Remembering missing asset: $normalized")
+        }
+    }
+
+    private fun normalize(path: String): String = path.substringBefore('?').trim('/')
+
+    /**
+     * Turn Laravel route URIs into regexes. A trailing parameter may swallow
+     * slashes (fallback routes are registered with `where('.*')`), inner ones
+     * only match a single segment.
+     */
+    private fun compileRoutes(uris: JSONArray): List<Regex> {
+        val patterns = mutableListOf<Regex>()
+        for (i in 0 until uris.length()) {
+            val segments = uris.getString(i).trim('/').split('/')
+            val pattern = StringBuilder()
+            segments.forEachIndexed { index, segment ->
+                val last = index == segments.size - 1
+                val separator = if (index == 0) "" else "/"
+                when {
+                    segment.startsWith("{") && segment.endsWith("?}") ->
+                        pattern.append("(").append(separator).append(if (last) ".*" else "[^/]*").append(")?")
+                    segment.startsWith("{") && segment.endsWith("}") ->
+                        pattern.append(separator).append(if (last) ".+" else "[^/]+")
+                    else ->
+                        pattern.append(separator).append(
+                            segment.split(Regex("\\{[^}]*\\}")).joinToString("[^/]*") { Regex.escape(it) }
+                        )
+                }
+            }
+            patterns.add(Regex(pattern.toString()))
+        }
+        return patterns
+    }
+}
@@ -23,7 +23,7 @@ class PHPWebViewClient(
         private const val TAG = "PHPRequestHandler"
     }
 
-    fun handleAssetRequest(url: String): WebResourceResponse {
+    fun handleAssetRequest(url: String, requestHeaders: Map<String, String> = emptyMap()): WebResourceResponse {
         val path = when {
             url.contains("/_assets/") -> {
                 url.substring(url.indexOf("_assets/") + 8)
@@ -71,7 +71,6 @@ class PHPWebViewClient(
                 val responseHeaders = mutableMapOf<String, String>()
                 responseHeaders["Content-Type"] = mimeType
                 responseHeaders["Cache-Control"] = "max-age=86400, public" // 1 day cache
-                responseHeaders["Content-Length"] = "${assetFile.length()}"
 
                 // Special handling for different file types
                 when {
@@ -96,14 +95,11 @@ class PHPWebViewClient(
 
                 Log.d(TAG, "📋 Serving with MIME type: ${responseHeaders["Content-Type"]}")
 
-                WebResourceResponse(
-                    responseHeaders["Content-Type"] ?: "application/octet-stream",
-                    "UTF-8",
-                    200,
-                    "OK",
-                    responseHeaders,
-                    assetFile.inputStream()
-                )
+                fileResponse(assetFile, responseHeaders, rangeHeader(requestHeaders))
+            } else if (AssetLookupCache.isKnownMissing(cleanPath) || !AssetLookupCache.routeMayMatch(cleanPath)) {
+                // PHP already said 404 for this static asset, or no route could answer it
+                Log.d(TAG, "🚫 Asset known to be missing, skipping PHP: $cleanPath")
+                errorResponse(404, "Asset not found: $path")
             } else {
                 // If static file not found, try handling via PHP
                 Log.d(TAG, "🔄 Asset not found in filesystem, trying PHP handler")
@@ -113,15 +109,24 @@ class PHPWebViewClient(
                     url = "/$path",
                     method = "GET",
                     body = "",
-                    headers = mapOf("Accept" to "*/*"),
+                    headers = mapOf("Accept" to "*/*", "X-Sendfile-Type" to "X-Sendfile"),
                     getParameters = emptyMap()
                 )
 
-                val response = phpBridge.handleLaravelRequest(phpRequest)
-                val (responseHeaders, body, statusCode) = parseResponse(response)
+                val timing = RequestTiming(phpRequest.method, phpRequest.url)
+                val arrived = System.nanoTime()
+                val response = phpBridge.handleLaravelRequest(phpRequest, timing)
+                val (parsedHeaders, body, statusCode) = timing.measure(RequestTiming.CONVERT) { parseResponse(response) }
+                val responseHeaders = parsedHeaders + ("Server-Timing" to timing.serverTimingHeader())
+                phpBridge.recordTiming(timing)
+                TrafficRecorder.record(phpRequest, arrived, statusCode, timing)
                 Log.d(TAG, "RESPONSE HEADERS: ${responseHeaders}")
 
-                if (statusCode == 200) {
+                val sendfile = sendfileTarget(responseHeaders)
+                if (statusCode == 200 && sendfile != null) {
+                    Log.d(TAG, "📤 Asset served via X-Sendfile: ${sendfile.absolutePath}")
+                    fileResponse(sendfile, responseHeaders, rangeHeader(requestHeaders))
+                } else if (statusCode == 200) {
                     Log.d(TAG, "✅ Asset served via PHP: ${responseHeaders["Content-Type"]}")
                     WebResourceResponse(
                         responseHeaders["Content-Type"] ?: guessMimeType(cleanPath),
@@ -132,6 +137,9 @@ class PHPWebViewClient(
                         body.byteInputStream()
                     )
                 } else {
+                    if (statusCode == 404) {
+                        AssetLookupCache.rememberMissing(cleanPath)
+                    }
                     Log.d(TAG, "❌ Asset not found via PHP: $path (Status: $statusCode)")
                     errorResponse(404, "Asset not found: $path")
                 }
@@ -147,6 +155,7 @@ class PHPWebViewClient(
         postData: String?,
         redirectCount: Int = 0
     ): WebResourceResponse {
+        val arrived = System.nanoTime()
         val path = request.url.path ?: "/"
 
         if (redirectCount > 10) {
@@ -156,6 +165,9 @@ class PHPWebViewClient(
 
         val headers = HashMap<String, String>(request.requestHeaders)
 
+        // ✅ Let BinaryFileResponse hand us the file path instead of the bytes
+        headers["X-Sendfile-Type"] = "X-Sendfile"
+
         // ✅ Apply CSRF token and cookies
         LaravelSecurity.applyToHeaders(headers)
         headers["Cookie"] = LaravelCookieStore.asCookieHeader()
@@ -179,8 +191,12 @@ class PHPWebViewClient(
             } ?: emptyMap()
         )
 
-        val response = phpBridge.handleLaravelRequest(phpRequest)
-        val (responseHeaders, body, statusCode) = parseResponse(response)
+        val timing = RequestTiming(phpRequest.method.uppercase(), phpRequest.url)
+        val response = phpBridge.handleLaravelRequest(phpRequest, timing)
+        val (parsedHeaders, body, statusCode) = timing.measure(RequestTiming.CONVERT) { parseResponse(response) }
+        val responseHeaders = parsedHeaders + ("Server-Timing" to timing.serverTimingHeader())
+        phpBridge.recordTiming(timing)
+        TrafficRecorder.record(phpRequest, arrived, statusCode, timing)
 
         // ✅ Handle Set-Cookie headers
         responseHeaders.entries
@@ -221,6 +237,13 @@ class PHPWebViewClient(
             }
         }
 
+        // ✅ File responses are streamed from disk, honouring Range
+        val sendfile = sendfileTarget(responseHeaders)
+        if (statusCode == 200 && sendfile != null) {
+            Log.d(TAG, "📤 Serving X-Sendfile: ${sendfile.absolutePath}")
+            return fileResponse(sendfile, responseHeaders, rangeHeader(request.requestHeaders))
+        }
+
         // ✅ Normal response
         return WebResourceResponse(
             responseHeaders["Content-Type"] ?: "text/html",
@@ -291,6 +314,108 @@ class PHPWebViewClient(
 
 
 
+    private fun rangeHeader(headers: Map<String, String>): String? =
+        headers.entries.firstOrNull { it.key.equals("Range", ignoreCase = true) }?.value
+
+    private fun sendfileTarget(headers: Map<String, String>): File? {
+        val path = headers.entries.firstOrNull { it.key.equals("X-Sendfile", ignoreCase = true) }?.value
+        return path?.let { File(it) }?.takeIf { it.isFile }
+    }
+
+    /**
+     * Serve [file] either whole or, for a single `bytes=` range, as a 206 that
+     * only reads the requested bytes from disk. Multi-range requests are
+     * rejected with a 416 rather than assembled into multipart bodies.
+     */
+    private fun fileResponse(
+        file: File,
+        baseHeaders: Map<String, String>,
+        rangeHeader: String?
+    ): WebResourceResponse {
+        val length = file.length()
+        val mimeType = baseHeaders["Content-Type"] ?: guessMimeType(file.name)
+        val headers = baseHeaders.filterKeys {
+            !it.equals("X-Sendfile", ignoreCase = true) && !it.equals("Content-Length", ignoreCase = true)
+        }.toMutableMap()
+        headers["Content-Type"] = mimeType
+        headers["Accept-Ranges"] = "bytes"
+
+        if (rangeHeader == null) {
+            headers["Content-Length"] = "$length"
+            return WebResourceResponse(mimeType, "UTF-8", 200, "OK", headers, file.inputStream())
+        }
+
+        val range = parseRange(rangeHeader, length)
+        if (range == null) {
+            Log.d(TAG, "⚠️ Unsatisfiable range '$rangeHeader' for ${file.name} ($length bytes)")
+            headers["Content-Range"] = "bytes */$length"
+            headers["Content-Length"] = "0"
+            return WebResourceResponse(mimeType, "UTF-8", 416, "Range Not Satisfiable", headers, ByteArrayInputStream(ByteArray(0)))
+        }
+
+        val (start, end) = range
+        val input = file.inputStream()
+        input.channel.position(start)
+
+        headers["Content-Range"] = "bytes $start-$end/$length"
+        headers["Content-Length"] = "${end - start + 1}"
+        Log.d(TAG, "📼 Serving bytes $start-$end/$length of ${file.name}")
+
+        return WebResourceResponse(mimeType, "UTF-8", 206, "Partial Content", headers, BoundedInputStream(input, end - start + 1))
+    }
+
+    /** Parse a single `bytes=` range into inclusive offsets, or null if it can't be served. */
+    private fun parseRange(header: String, length: Long): Pair<Long, Long>? {
+        val spec = header.trim()
+        if (!spec.startsWith("bytes=", ignoreCase = true) || length == 0L) return null
+
+        val ranges = spec.substring(6).trim()
+        if (ranges.contains(",")) return null
+
+        val dash = ranges.indexOf('-')
+        if (dash < 0) return null
+
+        val first = ranges.substring(0, dash).trim()
+        val last = ranges.substring(dash + 1).trim()
+
+        return try {
+            if (first.isEmpty()) {
+                // Suffix range: the last N bytes
+                val suffix = last.toLong()
+                if (suffix <= 0) null else Pair(maxOf(0L, length - suffix), length - 1)
+            } else {
+                val start = first.toLong()
+                val end = if (last.isEmpty()) length - 1 else minOf(last.toLong(), length - 1)
+                if (start >= length || end < start) null else Pair(start, end)
+            }
+        } catch (e: NumberFormatException) {
+            null
+        }
+    }
+
+    private class BoundedInputStream(
+        private val input: java.io.InputStream,
+        private var remaining: Long
+    ) : java.io.InputStream() {
+        override fun read(): Int {
+            if (remaining <= 0) return -1
+            val byte = input.read()
+            if (byte >= 0) remaining--
+            return byte
+        }
+
+        override fun read(buffer: ByteArray, offset: Int, length: Int): Int {
+            if (remaining <= 0) return -1
+            val count = input.read(buffer, offset, minOf(length.toLong(), remaining).toInt())
+            if (count > 0) remaining -= count
+            return count
+        }
+
+        override fun available(): Int = minOf(input.available().toLong(), remaining).toInt()
+
+        override fun close() = input.close()
+    }
+
     private fun errorResponse(code: Int, message: String): WebResourceResponse {
         return WebResourceResponse(
             "text/html",
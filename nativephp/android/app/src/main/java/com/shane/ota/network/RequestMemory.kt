@@ -0,0 +1,34 @@
+package com.shane.ota.network
+
+/**
+ * Memory figures of one PHP request, in bytes, as measured in
+ * trace/request_memory.c. [bridgeLive] is what the native bridge still holds
+ * after the request; it should settle at the same value request after request.
+ */
+data class RequestMemory(
+    val zendUsage: Long,
+    val zendPeak: Long,
+    val zendRealPeak: Long,
+    val rssBefore: Long,
+    val rssAfter: Long,
+    val nativeHeapDelta: Long,
+    val bridgeLive: Long,
+    val bridgeAllocations: Long,
+    val minorFaults: Long
+) {
+    companion object {
+        /** Order matches request_memory_field in trace/request_memory.h. */
+        fun fromNative(values: LongArray) = RequestMemory(
+            values[0], values[1], values[2], values[3], values[4], values[5], values[6], values[7], values[8]
+        )
+    }
+
+    val rssDelta: Long
+        get() = rssAfter - rssBefore
+
+    override fun toString() =
+        "zend ${zendUsage / 1024}KB (peak ${zendPeak / 1024}KB, real ${zendRealPeak / 1024}KB), " +
+            "rss ${rssAfter / 1024}KB (${if (rssDelta >= 0) "+" else ""}${rssDelta / 1024}KB), " +
+            "native heap ${nativeHeapDelta / 1024}KB, bridge ${bridgeLive / 1024}KB in $bridgeAllocations allocs, " +
+            "$minorFaults page faults"
+}
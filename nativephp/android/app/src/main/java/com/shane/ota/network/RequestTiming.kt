@@ -0,0 +1,36 @@
+package com.shane.ota.network
+
+import java.util.Locale
+
+/**
+ * Phase durations of one request, in nanoseconds. PHPBridge fills in the PHP
+ * phases measured natively and the queue wait; the WebView client adds the
+ * time spent turning the raw output into a response. Indices match
+ * request_phase in trace/request_timing.h.
+ */
+class RequestTiming(val method: String, val uri: String) {
+    companion object {
+        const val QUEUE = 0
+        const val STARTUP = 1
+        const val SHUTDOWN = 5
+        const val CONVERT = 6
+
+        val PHASES = listOf("queue", "startup", "compile", "execute", "output", "shutdown", "convert")
+    }
+
+    val phases = LongArray(PHASES.size)
+
+    inline fun <T> measure(phase: Int, block: () -> T): T {
+        val start = System.nanoTime()
+        try {
+            return block()
+        } finally {
+            phases[phase] += System.nanoTime() - start
+        }
+    }
+
+    /** `Server-Timing` value, so the breakdown shows up in WebView devtools. */
+    fun serverTimingHeader(): String =
+        (PHASES.indices.map { PHASES[it] to phases[it] } + ("total" to phases.sum()))
+            .joinToString(", ") { (name, ns) -> String.format(Locale.US, "%s;dur=%.2f", name, ns / 1e6) }
+}
@@ -0,0 +1,318 @@
+package com.shane.ota.network
+
+import android.util.Log
+import java.io.File
+import java.io.FileInputStream
+import java.io.FileOutputStream
+import java.io.IOException
+import java.io.RandomAccessFile
+import java.net.HttpURLConnection
+import java.net.URL
+import java.nio.ByteBuffer
+import java.nio.channels.FileChannel
+import java.security.MessageDigest
+import java.util.Properties
+import java.util.concurrent.Callable
+import java.util.concurrent.ExecutionException
+import java.util.concurrent.Executors
+
+/**
+ * Downloads [url] to [destination] so that a dropped connection only costs
+ * the bytes in flight. Data goes to `<destination>.part` and progress is
+ * journaled next to it, so a download cut off by a bad link or the app being
+ * killed picks up where it stopped at the next attempt, even after a restart.
+ *
+ * When the server honours Range requests and the file is large enough, it is
+ * split into [segments] fetched over parallel connections. If [expectedSha256]
+ * is given the finished file must match it before it is handed back.
+ */
+class ResumableDownloader(
+    private val url: String,
+    private val destination: File,
+    private val expectedSha256: String? = null,
+    private val segments: Int = 1,
+    private val connectTimeoutMs: Int = 15000,
+    private val readTimeoutMs: Int = 20000,
+    private val retryDelayMs: Long = 1000,
+    private val maxStalledAttempts: Int = 6,
+    private val minSegmentSize: Long = 4L * 1024 * 1024,
+) {
+    companion object {
+        private const val TAG = "ResumableDownloader"
+        private const val BUFFER_SIZE = 64 * 1024
+        private const val JOURNAL_INTERVAL = 1024L * 1024
+
+        fun partFile(destination: File) = File(destination.path + ".part")
+        fun journalFile(destination: File) = File(destination.path + ".journal")
+
+        /** True if an earlier attempt left progress behind for [destination]. */
+        fun hasProgress(destination: File) =
+            journalFile(destination).exists() && partFile(destination).exists()
+
+        /** Forget any partial download of [destination]. */
+        fun discard(destination: File) {
+            partFile(destination).delete()
+            journalFile(destination).delete()
+        }
+    }
+
+    private class Probe(val length: Long, val etag: String?, val ranges: Boolean)
+
+    private class Segment(val start: Long, val end: Long, @Volatile var next: Long) {
+        val done get() = next > end
+    }
+
+    private val partFile = partFile(destination)
+    private val journalFile = journalFile(destination)
+    private var etag: String? = null
+    private var length = -1L
+    private var ranged = false
+    private var plan = listOf<Segment>()
+
+    fun download(): File {
+        val start = System.currentTimeMillis()
+        val probe = probe()
+        etag = probe.etag
+        length = probe.length
+        ranged = probe.ranges && probe.length > 0
+
+        if (!ranged || !resumeFromJournal()) {
+            discard(destination)
+            plan = planSegments()
+        }
+
+        val resumedAt = plan.sumOf { it.next - it.start }
+        if (resumedAt > 0) {
+            Log.d(TAG, "⏯️ Resuming ${destination.name} at ${resumedAt / 1024}KB of ${length / 1024}KB")
+        }
+        saveJournal()
+
+        RandomAccessFile(partFile, "rw").use { raf ->
+            if (ranged) raf.setLength(length)
+            val channel = raf.channel
+
+            if (plan.size == 1) {
+                fetchSegment(plan[0], channel)
+            } else {
+                val pool = Executors.newFixedThreadPool(plan.size)
+                try {
+                    pool.invokeAll(plan.map { segment -> Callable { fetchSegment(segment, channel) } })
+                        .forEach { it.get() }
+                } catch (e: ExecutionException) {
+                    throw e.cause as? IOException ?: IOException(e.cause)
+                } finally {
+                    pool.shutdownNow()
+                }
+            }
+            if (!ranged) raf.setLength(plan[0].next)
+            channel.force(false)
+        }
+
+        if (expectedSha256 != null) {
+            val actual = sha256(partFile)
+            if (!actual.equals(expectedSha256, ignoreCase = true)) {
+                discard(destination)
+                throw IOException("SHA-256 mismatch for ${destination.name}: expected $expectedSha256, got $actual")
+            }
+        }
+
+        destination.delete()
+        if (!partFile.renameTo(destination)) {
+            throw IOException("Cannot move ${partFile.name} into place")
+        }
+        journalFile.delete()
+
+        val size = destination.length()
+        Log.d(TAG, "✅ Downloaded ${size / 1024}KB in ${System.currentTimeMillis() - start}ms over ${plan.size} connection(s)")
+        return destination
+    }
+
+    private fun open(rangeStart: Long, rangeEnd: Long?): HttpURLConnection {
+        val connection = URL(url).openConnection() as HttpURLConnection
+        connection.connectTimeout = connectTimeoutMs
+        connection.readTimeout = readTimeoutMs
+        // Ranges are byte offsets into the stored file, so no transparent gzip
+        connection.setRequestProperty("Accept-Encoding", "identity")
+        if (rangeEnd != null) {
+            connection.setRequestProperty("Range", "bytes=$rangeStart-$rangeEnd")
+            etag?.let { connection.setRequestProperty("If-Range", it) }
+        }
+        return connection
+    }
+
+    /** One-byte range request: tells us the size, the ETag and whether ranges work at all. */
+    private fun probe(): Probe {
+        var attempt = 0
+        while (true) {
+            val connection = open(0, 0)
+            try {
+                val code = connection.responseCode
+                val etag = connection.getHeaderField("ETag")
+                return when (code) {
+                    HttpURLConnection.HTTP_PARTIAL -> {
+                        val total = connection.getHeaderField("Content-Range")
+                            ?.substringAfter('/')?.trim()?.toLongOrNull() ?: -1L
+                        Probe(total, etag, total > 0)
+                    }
+                    HttpURLConnection.HTTP_OK -> Probe(connection.contentLengthLong, etag, false)
+                    else -> throw IOException("HTTP $code from $url")
+                }
+            } catch (e: IOException) {
+                if (++attempt >= maxStalledAttempts) throw e
+                Log.w(TAG, "⚠️ Probe failed (${e.message}), retrying")
+                backoff(attempt)
+            } finally {
+                connection.disconnect()
+            }
+        }
+    }
+
+    private fun planSegments(): List<Segment> {
+        if (!ranged) {
+            return listOf(Segment(0, Long.MAX_VALUE, 0))
+        }
+
+        val count = segments.coerceIn(1, maxOf(1, (length / minSegmentSize).toInt()))
+        val size = (length + count - 1) / count
+        return (0 until count).map { i ->
+            val start = i * size
+            Segment(start, minOf(length, start + size) - 1, start)
+        }
+    }
+
+    private fun fetchSegment(segment: Segment, channel: FileChannel) {
+        val buffer = ByteArray(BUFFER_SIZE)
+        var stalled = 0
+        var sinceJournal = 0L
+
+        while (!segment.done) {
+            val before = segment.next
+            // Without ranges a retry can only start over
+            if (!ranged) segment.next = 0
+
+            val connection = open(segment.next, if (ranged) segment.end else null)
+            try {
+                val code = connection.responseCode
+                if (ranged && code == HttpURLConnection.HTTP_OK) {
+                    // If-Range failed or the server stopped honouring ranges: the file changed under us
+                    discard(destination)
+                    throw IOException("Expected 206 for ${destination.name}, got HTTP $code")
+                }
+                if (code != (if (ranged) HttpURLConnection.HTTP_PARTIAL else HttpURLConnection.HTTP_OK)) {
+                    throw IOException("HTTP $code from $url")
+                }
+
+                connection.inputStream.use { input ->
+                    while (!segment.done) {
+                        val remaining = segment.end - segment.next
+                        val wanted = if (remaining >= buffer.size) buffer.size else (remaining + 1).toInt()
+                        val read = input.read(buffer, 0, wanted)
+                        if (read == -1) break
+
+                        var written = 0
+                        while (written < read) {
+                            written += channel.write(ByteBuffer.wrap(buffer, written, read - written), segment.next + written)
+                        }
+                        segment.next += read
+
+                        sinceJournal += read
+                        if (sinceJournal >= JOURNAL_INTERVAL) {
+                            sinceJournal = 0
+                            channel.force(false)
+                            saveJournal()
+                        }
+                    }
+                }
+
+                if (!ranged) {
+                    // A plain GET is complete when the body ends at its declared length
+                    if (length >= 0 && segment.next != length) {
+                        throw IOException("Connection closed at ${segment.next} of $length bytes")
+                    }
+                    return
+                }
+                if (!segment.done) {
+                    throw IOException("Connection closed at ${segment.next} of ${segment.end + 1} bytes")
+                }
+            } catch (e: IOException) {
+                if (!partFile.exists()) throw e
+
+                stalled = if (segment.next > before) 0 else stalled + 1
+                if (stalled >= maxStalledAttempts) {
+                    channel.force(false)
+                    saveJournal()
+                    throw e
+                }
+                Log.w(TAG, "⚠️ Download interrupted at ${segment.next} (${e.message}), retrying")
+                backoff(stalled)
+            } finally {
+                connection.disconnect()
+            }
+        }
+    }
+
+    private fun backoff(attempt: Int) {
+        Thread.sleep(retryDelayMs * (1L shl minOf(attempt, 5)))
+    }
+
+    private fun resumeFromJournal(): Boolean {
+        if (!journalFile.exists() || !partFile.exists()) return false
+
+        val journal = Properties()
+        try {
+            FileInputStream(journalFile).use { journal.load(it) }
+        } catch (e: IOException) {
+            return false
+        }
+
+        // Only resume bytes of the very same file
+        if (journal.getProperty("url") != url ||
+            journal.getProperty("length")?.toLongOrNull() != length ||
+            journal.getProperty("etag") != (etag ?: "")
+        ) {
+            Log.d(TAG, "🔄 Remote file changed since the last attempt, starting over")
+            return false
+        }
+
+        val count = journal.getProperty("segments")?.toIntOrNull() ?: return false
+        plan = (0 until count).map { i ->
+            val fields = journal.getProperty("segment.$i")?.split(',')?.mapNotNull { it.toLongOrNull() }
+            if (fields == null || fields.size != 3) return false
+            Segment(fields[0], fields[1], fields[2])
+        }
+        return true
+    }
+
+    @Synchronized
+    private fun saveJournal() {
+        if (!ranged) return
+
+        val journal = Properties()
+        journal.setProperty("url", url)
+        journal.setProperty("length", length.toString())
+        journal.setProperty("etag", etag ?: "")
+        journal.setProperty("segments", plan.size.toString())
+        plan.forEachIndexed { i, segment ->
+            journal.setProperty("segment.$i", "${segment.start},${segment.end},${segment.next}")
+        }
+
+        val temp = File(journalFile.path + ".tmp")
+        FileOutputStream(temp).use {
+            journal.store(it, null)
+            it.fd.sync()
+        }
+        temp.renameTo(journalFile)
+    }
+
+    private fun sha256(file: File): String {
+        val digest = MessageDigest.getInstance("SHA-256")
+        FileInputStream(file).use { input ->
+            val buffer = ByteArray(BUFFER_SIZE)
+            var read: Int
+            while (input.read(buffer).also { read = it } != -1) {
+                digest.update(buffer, 0, read)
+            }
+        }
+        return digest.digest().joinToString("") { "%02x".format(it) }
+    }
+}
@@ -0,0 +1,149 @@
+package com.shane.ota.network
+
+import android.util.Log
+import java.io.BufferedOutputStream
+import java.io.DataOutputStream
+import java.io.File
+import java.io.FileOutputStream
+import java.io.OutputStream
+
+/**
+ * Records the requests the WebView sends to PHP, with their timings, so real
+ * sessions can be replayed against the host build by runtime/traffic_replay.
+ * Credentials are redacted before anything is written: cookie, auth and
+ * CSRF headers are dropped, `_token` is blanked (replay sends the jar's
+ * XSRF-TOKEN instead) and password-like fields in bodies and query strings
+ * are replaced.
+ *
+ * The log is compact binary. Integers are unsigned LEB128 varints and
+ * strings are a varint byte length followed by UTF-8:
+ *
+ *     file:    "NPTR", version byte, recording start (epoch ms)
+ *     record:  arrival (µs since start), method, uri, header count,
+ *              name and value per header, body, status, phase count,
+ *              µs per phase in RequestTiming.PHASES order
+ *
+ *     adb shell am start -n com.shane.ota/.ui.MainActivity --ez recordTraffic true
+ *     adb exec-out run-as com.shane.ota cat files/traffic/<start>.nptr > session.nptr
+ */
+object TrafficRecorder {
+    private const val TAG = "TrafficRecorder"
+    private const val VERSION = 1
+    private const val REDACTED = "redacted"
+
+    private val DROPPED_HEADERS = setOf("cookie", "authorization", "proxy-authorization", "x-csrf-token", "x-xsrf-token")
+    private val BLANKED_FIELDS = listOf("_token")
+    private val REDACTED_FIELDS = listOf("password", "password_confirmation", "current_password", "token", "secret", "signature")
+
+    private var out: DataOutputStream? = null
+    private var startNanos = 0L
+
+    val isRecording: Boolean
+        @Synchronized get() = out != null
+
+    /** Starts a new log in [dir], closing any open one. */
+    @Synchronized
+    fun start(dir: File): File {
+        stop()
+        dir.mkdirs()
+        val startMillis = System.currentTimeMillis()
+        val file = File(dir, "$startMillis.nptr")
+        out = DataOutputStream(BufferedOutputStream(FileOutputStream(file))).also {
+            writeHeader(it, startMillis)
+            it.flush()
+        }
+        startNanos = System.nanoTime()
+        Log.d(TAG, "🎙️ Recording traffic to $file")
+        return file
+    }
+
+    @Synchronized
+    fun stop() {
+        out?.let {
+            it.close()
+            Log.d(TAG, "🎙️ Traffic recording stopped")
+        }
+        out = null
+    }
+
+    /**
+     * Logs one request. [arrived] is System.nanoTime() when the WebView
+     * handed it over; [timing] holds the phases PHPBridge measured.
+     */
+    @Synchronized
+    fun record(request: PHPRequest, arrived: Long, status: Int, timing: RequestTiming) {
+        val stream = out ?: return
+        try {
+            writeRecord(stream, request, (arrived - startNanos).coerceAtLeast(0) / 1000, status, timing.phases)
+            // A killed app keeps everything up to its last request
+            stream.flush()
+        } catch (e: Exception) {
+            Log.e(TAG, "⚠️ Failed to record ${request.method} ${request.url}, stopping", e)
+            stop()
+        }
+    }
+
+    fun redactHeaders(headers: Map<String, String>): Map<String, String> =
+        headers.filterKeys { it.lowercase() !in DROPPED_HEADERS }
+
+    /** Redacts `application/x-www-form-urlencoded` and JSON bodies, and query strings. */
+    fun redactBody(body: String): String {
+        var result = body
+        BLANKED_FIELDS.forEach { result = replaceField(result, it, "") }
+        REDACTED_FIELDS.forEach { result = replaceField(result, it, REDACTED) }
+        return result
+    }
+
+    fun redactUri(uri: String): String {
+        val query = uri.indexOf('?')
+        return if (query < 0) uri else uri.substring(0, query + 1) + redactBody(uri.substring(query + 1))
+    }
+
+    private fun replaceField(text: String, field: String, value: String): String {
+        val name = Regex.escape(field)
+        return text
+            // "field":"value", as in a JSON body or Livewire's updates
+            .replace(Regex("\"$name\"\\s*:\\s*\"(?:[^\"\\\\]|\\\\.)*\""), "\"$field\":\"$value\"")
+            // \"field\":\"value\", as in a snapshot embedded in JSON
+            .replace(Regex("\\\\\"$name\\\\\":\\\\\".*?\\\\\""), "\\\\\"$field\\\\\":\\\\\"$value\\\\\"")
+            // field=value in a form body or query string
+            .replace(Regex("(^|&)$name=[^&]*"), "$1$field=$value")
+    }
+
+    internal fun writeHeader(stream: DataOutputStream, startMillis: Long) {
+        stream.write("NPTR".toByteArray(Charsets.US_ASCII))
+        stream.writeByte(VERSION)
+        writeVarint(stream, startMillis)
+    }
+
+    internal fun writeRecord(stream: DataOutputStream, request: PHPRequest, arrivalMicros: Long, status: Int, phases: LongArray) {
+        val headers = redactHeaders(request.headers)
+        writeVarint(stream, arrivalMicros)
+        writeString(stream, request.method.uppercase())
+        writeString(stream, redactUri(request.uri))
+        writeVarint(stream, headers.size.toLong())
+        headers.forEach { (name, value) ->
+            writeString(stream, name)
+            writeString(stream, value)
+        }
+        writeString(stream, redactBody(request.body))
+        writeVarint(stream, status.toLong())
+        writeVarint(stream, phases.size.toLong())
+        phases.forEach { writeVarint(stream, it / 1000) }
+    }
+
+    internal fun writeVarint(stream: OutputStream, value: Long) {
+        var remaining = value
+        while ((remaining and 0x7fL.inv()) != 0L) {
+            stream.write(((remaining and 0x7f) or 0x80).toInt())
+            remaining = remaining ushr 7
+        }
+        stream.write(remaining.toInt())
+    }
+
+    private fun writeString(stream: OutputStream, value: String) {
+        val bytes = value.toByteArray(Charsets.UTF_8)
+        writeVarint(stream, bytes.size.toLong())
+        stream.write(bytes)
+    }
+}
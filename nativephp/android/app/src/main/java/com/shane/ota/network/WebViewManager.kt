@@ -181,7 +181,7 @@ class WebViewManager(
                             url.contains("/fonts/") ||
                             url.contains("/images/") -> {
                         Log.d(TAG, "🖼️ Handling asset request")
-                        phpHandler.handleAssetRequest(url)
+                        phpHandler.handleAssetRequest(url, request.requestHeaders)
                     }
                     // Regular PHP requests
                     url.contains("127.0.0.1") -> {
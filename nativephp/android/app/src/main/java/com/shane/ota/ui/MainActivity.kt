@@ -14,7 +14,11 @@ import androidx.annotation.RequiresApi
 import androidx.appcompat.app.AppCompatActivity
 import com.shane.ota.bridge.PHPBridge
 import com.shane.ota.bridge.LaravelEnvironment
+import com.shane.ota.bridge.NativeTrace
+import com.shane.ota.bridge.SoakTest
 import com.shane.ota.databinding.ActivityMainBinding
+import com.shane.ota.network.PHPRequest
+import com.shane.ota.network.TrafficRecorder
 import com.shane.ota.network.WebViewManager
 import android.webkit.WebView
 import androidx.activity.addCallback
@@ -39,6 +43,8 @@ class MainActivity : AppCompatActivity(), WebViewProvider {
     @RequiresApi(Build.VERSION_CODES.S)
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
+        NativeTrace.configure(this)
+        phpBridge.registerEventDispatch()
         binding = ActivityMainBinding.inflate(layoutInflater)
         setContentView(binding.root)
         supportActionBar?.hide()
@@ -49,6 +55,8 @@ class MainActivity : AppCompatActivity(), WebViewProvider {
 
         handleDeepLinkIntent(intent)
         startHotReloadWatcher()
+        // The WebView doesn't need Laravel until it loads a page, so set it up
+        // on the main thread while the environment starts in the background
         initializeEnvironmentAsync {
             binding.splashOverlay.animate()
                 .alpha(0f)
@@ -58,16 +66,14 @@ class MainActivity : AppCompatActivity(), WebViewProvider {
                 }
                 .start()
 
-            webViewManager = WebViewManager(this, binding.webView, phpBridge)
-            webViewManager.setup()
-            coord = NativeActionCoordinator.install(this)
-
             val target = pendingDeepLink ?: "/"
             val fullUrl = "http://127.0.0.1$target"
             Log.d("DeepLink", "🚀 Loading final URL: $fullUrl")
             binding.webView.loadUrl(fullUrl)
 
             pendingDeepLink = null
+            startSoakTestIfRequested()
+            startTrafficRecordingIfRequested()
         }
 
         onBackPressedDispatcher.addCallback(this) {
@@ -90,7 +96,10 @@ class MainActivity : AppCompatActivity(), WebViewProvider {
         Thread {
             Log.d("LaravelInit", "📦 Starting async Laravel extraction...")
             laravelEnv = LaravelEnvironment(this)
-            laravelEnv.initialize()
+            NativeTrace.span("LaravelEnvironment.initialize", "startup") {
+                laravelEnv.initialize()
+            }
+            NativeTrace.flush()
 
             Log.d("LaravelInit", "✅ Laravel environment ready — continuing")
 
@@ -98,6 +107,10 @@ class MainActivity : AppCompatActivity(), WebViewProvider {
                 onReady()
             }
         }.start()
+
+        webViewManager = WebViewManager(this, binding.webView, phpBridge)
+        webViewManager.setup()
+        coord = NativeActionCoordinator.install(this)
     }
 
     override fun onNewIntent(intent: Intent?) {
@@ -124,6 +137,28 @@ class MainActivity : AppCompatActivity(), WebViewProvider {
     }
 
 
+    /** `--ei soak <requests> [--es soakPath <uri>]`: replay a request and check memory stays flat. */
+    private fun startSoakTestIfRequested() {
+        val requests = intent?.getIntExtra("soak", 0) ?: 0
+        if (requests <= 0) return
+        val path = intent?.getStringExtra("soakPath") ?: "/"
+
+        Thread {
+            val result = SoakTest(iterations = requests).run {
+                phpBridge.handleLaravelRequest(PHPRequest(url = path))
+                phpBridge.lastRequestMemory()
+            }
+            File(filesDir, "soak-result.txt").writeText("$result\n")
+        }.start()
+    }
+
+    /** `--ez recordTraffic true`: log every request to files/traffic/ for traffic_replay. */
+    private fun startTrafficRecordingIfRequested() {
+        if (intent?.getBooleanExtra("recordTraffic", false) == true) {
+            TrafficRecorder.start(File(filesDir, "traffic"))
+        }
+    }
+
     private fun initializeEnvironment() {
         clearAllCookies()
         laravelEnv = LaravelEnvironment(this)
@@ -140,6 +175,7 @@ class MainActivity : AppCompatActivity(), WebViewProvider {
 
     override fun onDestroy() {
         super.onDestroy()
+        TrafficRecorder.stop()
         laravelEnv.cleanup()
         phpBridge.shutdown()
     }
@@ -12,6 +12,7 @@ import androidx.core.content.ContextCompat
 import androidx.fragment.app.Fragment
 import androidx.fragment.app.FragmentActivity
 import com.google.firebase.messaging.FirebaseMessaging
+import com.shane.ota.bridge.NativeActionBus
 import org.json.JSONObject
 import java.io.File
 
@@ -23,6 +24,8 @@ interface WebViewProvider {
 class NativeActionCoordinator : Fragment() {
 
     private var pendingCameraUri: Uri? = null
+    private var pendingCameraHandle = 0L
+    private var pendingFileHandle = 0L
 
     // Camera launcher
     private val cameraLauncher =
@@ -42,15 +45,15 @@ class NativeActionCoordinator : Fragment() {
                     put("path", dst.absolutePath)
                 }
 
-                dispatch("Native\\Mobile\\Events\\Camera\\PhotoTaken", payload.toString())
+                dispatch(pendingCameraHandle, "Native\\Mobile\\Events\\Camera\\PhotoTaken", payload.toString())
 
             }else{
                 Log.e("NativeActionCoordinator", "❌ Camera capture failed or was canceled")
-
+                NativeActionBus.cancel(pendingCameraHandle)
             }
         }
 
-        fun launchBiometricPrompt() {
+        fun launchBiometricPrompt(handle: Long = 0) {
             val context = requireContext()
             val activity = requireActivity()
 
@@ -73,7 +76,8 @@ class NativeActionCoordinator : Fragment() {
                 }
 
                 NativeActions.showToast(context, message)
-                dispatch("Native\\Mobile\\Events\\Biometric\\Completed", """{"success": false}""")
+                dispatch(handle, "Native\\Mobile\\Events\\Biometric\\Completed", """{"success": false}""")
+                return
             }
 
             val executor = ContextCompat.getMainExecutor(context)
@@ -84,19 +88,19 @@ class NativeActionCoordinator : Fragment() {
                     override fun onAuthenticationSucceeded(result: BiometricPrompt.AuthenticationResult) {
                         super.onAuthenticationSucceeded(result)
                         Log.d("Biometric", "✅ Auth succeeded")
-                        dispatch("Native\\Mobile\\Events\\Biometric\\Completed", """{"success": true}""")
+                        dispatch(handle, "Native\\Mobile\\Events\\Biometric\\Completed", """{"success": true}""")
                     }
 
                     override fun onAuthenticationFailed() {
                         super.onAuthenticationFailed()
+                        // The prompt stays up for another attempt; only success or an error finishes it
                         Log.w("Biometric", "❌ Auth failed")
-                        dispatch("Native\\Mobile\\Events\\Biometric\\Completed", """{"success": false}""")
                     }
 
                     override fun onAuthenticationError(code: Int, msg: CharSequence) {
                         super.onAuthenticationError(code, msg)
                         Log.e("Biometric", "❌ Auth error: $msg")
-                        dispatch("Native\\Mobile\\Events\\Biometric\\Completed", """{"success": false}""")
+                        dispatch(handle, "Native\\Mobile\\Events\\Biometric\\Completed", """{"success": false}""")
                     }
                 }
             )
@@ -110,25 +114,31 @@ class NativeActionCoordinator : Fragment() {
             biometricPrompt.authenticate(promptInfo)
         }
 
-    fun launchPushTokenDispatch() {
+    fun launchPushTokenDispatch(handle: Long = 0) {
         try{
             FirebaseMessaging.getInstance().token.addOnCompleteListener { task ->
                 if (!task.isSuccessful) {
                     Log.e("PushToken", "❌ Failed to fetch token", task.exception)
+                    NativeActionBus.cancel(handle)
                     return@addOnCompleteListener
                 }
 
-                val token = task.result ?: return@addOnCompleteListener
+                val token = task.result
+                if (token == null) {
+                    NativeActionBus.cancel(handle)
+                    return@addOnCompleteListener
+                }
                 Log.d("PushToken", "✅ Got FCM token: $token")
 
                 val payload = JSONObject().apply {
                     put("token", token)
                 }
-                dispatch("Native\\Mobile\\Events\\PushNotification\\TokenGenerated", payload.toString())
+                dispatch(handle, "Native\\Mobile\\Events\\PushNotification\\TokenGenerated", payload.toString())
             }
         } catch (e: Exception) {
             val context = requireContext()
             Log.e("TOKEN ERROR", "❌ FCM init error: ${e.localizedMessage}")
+            NativeActionBus.cancel(handle)
             NativeActions.showToast(context, "Failed to initialize push notifications.")
         }
     }
@@ -136,14 +146,17 @@ class NativeActionCoordinator : Fragment() {
     // File picker launcher
     private val filePicker =
         registerForActivityResult(ActivityResultContracts.OpenDocument()) { uri ->
-            uri ?: return@registerForActivityResult
+            if (uri == null) {
+                NativeActionBus.cancel(pendingFileHandle)
+                return@registerForActivityResult
+            }
             val payload = JSONObject().apply {
                 put("uri", uri.toString())
             }
-            dispatch("file:chosen", payload.toString())
+            dispatch(pendingFileHandle, "file:chosen", payload.toString())
         }
 
-    fun launchCamera() {
+    fun launchCamera(handle: Long = 0) {
         val context = requireContext()
         val resolver = context.contentResolver
 
@@ -153,20 +166,34 @@ class NativeActionCoordinator : Fragment() {
                 put(MediaStore.Images.Media.TITLE, "NativePHP_${System.currentTimeMillis()}")
                 put(MediaStore.Images.Media.MIME_TYPE, "image/jpeg")
             }
-        ) ?: return
+        )
+        if (photoUri == null) {
+            NativeActionBus.cancel(handle)
+            return
+        }
 
         pendingCameraUri = photoUri
+        pendingCameraHandle = handle
         Log.d("CAMERAFILE", pendingCameraUri.toString());
         cameraLauncher.launch(photoUri)
     }
 
-    fun launchFilePicker(mime: String = "*/*") {
+    fun launchFilePicker(mime: String = "*/*", handle: Long = 0) {
+        pendingFileHandle = handle
         filePicker.launch(arrayOf(mime))
     }
 
-    private fun dispatch(event: String, payloadJson: String) {
+    /**
+     * Finishes [handle] on the native action bus, which gets the event to
+     * Laravel on the PHP thread. The page is told too when [notifyWebView]
+     * is on, for Livewire components listening for `native:` events.
+     */
+    private fun dispatch(handle: Long, event: String, payloadJson: String) {
         Log.d("JSFUNC", "native:$event");
         Log.d("JSFUNC", "$payloadJson");
+        NativeActionBus.complete(handle, event, payloadJson)
+        if (!notifyWebView) return
+
         val eventForJs = event.replace("\\", "\\\\")
         val js = """
             (function () {
@@ -176,19 +203,6 @@ class NativeActionCoordinator : Fragment() {
                 if (window.Livewire && typeof window.Livewire.dispatch === 'function') {
                     window.Livewire.dispatch("native:$eventForJs", payload);
                 }
-                fetch('/_native/api/events', {
-                    method: 'POST',
-                    headers: {
-                        'Content-Type': 'application/json',
-                        'X-Requested-With': 'XMLHttpRequest'
-                    },
-                    body: JSON.stringify({
-                        event: "$eventForJs",
-                        payload: payload
-                    })
-                }).then(response => response.json())
-                  .then(data => console.log("API Event Dispatch Success:", JSON.stringify(data, null, 2)))
-                  .catch(error => console.error("API Event Dispatch Error:", error));
             })();
         """.trimIndent()
 
@@ -198,6 +212,9 @@ class NativeActionCoordinator : Fragment() {
     }
 
     companion object {
+        /** Also fire `native-event` and Livewire's `native:` event in the page. */
+        @Volatile var notifyWebView = true
+
         fun install(activity: FragmentActivity): NativeActionCoordinator =
             activity.supportFragmentManager.findFragmentByTag("NativeActionCoordinator") as? NativeActionCoordinator
                 ?: NativeActionCoordinator().also {
@@ -61,17 +61,34 @@ object NativeActions {
         }
     }
 
-    fun showAlert(context: Context, title: String, message: String) {
+    /**
+     * Shows up to three [buttons], first one as the positive button, and
+     * reports the index pressed, or -1 if the dialog couldn't be shown.
+     */
+    fun showAlert(
+        context: Context,
+        title: String,
+        message: String,
+        buttons: List<String> = listOf("OK"),
+        onButton: (Int) -> Unit = {}
+    ) {
+        val labels = buttons.ifEmpty { listOf("OK") }
+        if (labels.size > 3) Log.w(TAG, "⚠️ Alert has ${labels.size} buttons, showing the first 3")
+
         Handler(Looper.getMainLooper()).post {
             try {
-                AlertDialog.Builder(context)
+                val builder = AlertDialog.Builder(context)
                     .setTitle(title)
                     .setMessage(message)
-                    .setPositiveButton("OK") { dialog, _ -> dialog.dismiss() }
-                    .show()
+                    .setCancelable(false)
+                    .setPositiveButton(labels[0]) { _, _ -> onButton(0) }
+                labels.getOrNull(1)?.let { builder.setNegativeButton(it) { _, _ -> onButton(1) } }
+                labels.getOrNull(2)?.let { builder.setNeutralButton(it) { _, _ -> onButton(2) } }
+                builder.show()
                 Log.d(TAG, "✅ Alert displayed")
             } catch (e: Exception) {
                 Log.e(TAG, "❌ Error showing alert: ${e.message}", e)
+                onButton(-1)
             }
         }
     }
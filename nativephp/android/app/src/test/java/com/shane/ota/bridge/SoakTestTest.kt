@@ -0,0 +1,56 @@
+package com.shane.ota.bridge
+
+import com.shane.ota.network.RequestMemory
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertTrue
+import org.junit.Test
+
+class SoakTestTest {
+    private fun memory(rss: Long, zendPeak: Long = 2_000_000, bridge: Long = 262_144) =
+        RequestMemory(1_000_000, zendPeak, 2_097_152, rss, rss, 0, bridge, 3, 120)
+
+    @Test
+    fun slopeIsGrowthPerRequest() {
+        assertEquals(0.0, SoakTest.slope(listOf(5, 5, 5, 5)), 1e-9)
+        assertEquals(100.0, SoakTest.slope((0 until 10).map { 1_000L + it * 100 }), 1e-9)
+        assertEquals(0.0, SoakTest.slope(listOf(7)), 1e-9)
+    }
+
+    @Test
+    fun noisyButFlatMemoryPasses() {
+        var i = 0
+        val result = SoakTest(iterations = 100, warmup = 10).run {
+            memory(rss = 50_000_000L + (if (i++ % 2 == 0) 40_000 else -40_000))
+        }
+        assertTrue(result.toString(), result.passed)
+    }
+
+    @Test
+    fun steadyRssGrowthFails() {
+        var i = 0
+        val result = SoakTest(iterations = 100, warmup = 10, maxGrowthPerRequest = 4096).run {
+            memory(rss = 50_000_000L + i++ * 8192L)
+        }
+        assertFalse(result.passed)
+        assertEquals(8192.0, result.rssGrowthPerRequest, 1e-6)
+    }
+
+    @Test
+    fun anyBridgeGrowthFails() {
+        var i = 0
+        val result = SoakTest(iterations = 60, warmup = 10).run {
+            memory(rss = 50_000_000L, bridge = 262_144L + i++ * 32L)
+        }
+        assertFalse(result.passed)
+    }
+
+    @Test
+    fun warmupIsIgnored() {
+        var i = 0
+        val result = SoakTest(iterations = 60, warmup = 20).run {
+            memory(rss = if (i++ < 20) 40_000_000L + i * 500_000L else 60_000_000L)
+        }
+        assertTrue(result.toString(), result.passed)
+    }
+}
@@ -0,0 +1,69 @@
+package com.shane.ota.bridge
+
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertTrue
+import org.junit.Assert.fail
+import org.junit.Test
+import java.io.IOException
+import java.util.Collections
+import java.util.concurrent.CountDownLatch
+import java.util.concurrent.TimeUnit
+
+class StartupGraphTest {
+    @Test
+    fun runsStepsAfterTheirDependencies() {
+        val order = Collections.synchronizedList(mutableListOf<String>())
+        val graph = StartupGraph()
+
+        val a = graph.step("a") { Thread.sleep(30); order.add("a") }
+        val b = graph.step("b") { order.add("b") }
+        val c = graph.step("c", a, b) { order.add("c") }
+        val d = graph.step("d", c) { order.add("d") }
+        graph.finish(d)
+
+        assertEquals(listOf("c", "d"), order.takeLast(2))
+        assertTrue(d.startedAtMs >= c.startedAtMs + c.elapsedMs)
+    }
+
+    @Test
+    fun overlapsIndependentSteps() {
+        // Both steps must be running at once to get past the latch
+        val bothRunning = CountDownLatch(2)
+        val graph = StartupGraph(threads = 2)
+
+        val a = graph.step("a") { bothRunning.countDown(); assertTrue(bothRunning.await(5, TimeUnit.SECONDS)) }
+        val b = graph.step("b") { bothRunning.countDown(); assertTrue(bothRunning.await(5, TimeUnit.SECONDS)) }
+        graph.finish(graph.step("done", a, b) {})
+    }
+
+    @Test
+    fun returnsBeforeStepsThatReadyDoesNotNeed() {
+        val release = CountDownLatch(1)
+        val graph = StartupGraph()
+
+        val ready = graph.step("ready") {}
+        val background = graph.step("background") { release.await(5, TimeUnit.SECONDS) }
+        graph.finish(ready)
+
+        assertEquals(-1L, background.elapsedMs)
+        release.countDown()
+    }
+
+    @Test
+    fun failureSkipsDependentsAndIsRethrown() {
+        var ranDependent = false
+        val graph = StartupGraph()
+
+        val broken = graph.step("broken") { throw IOException("disk full") }
+        val after = graph.step("after", broken) { ranDependent = true }
+
+        try {
+            graph.finish(after)
+            fail("failure should propagate")
+        } catch (e: IOException) {
+            assertEquals("disk full", e.message)
+        }
+        assertFalse(ranDependent)
+    }
+}
@@ -0,0 +1,162 @@
+package com.shane.ota.network
+
+import com.sun.net.httpserver.HttpExchange
+import com.sun.net.httpserver.HttpServer
+import org.junit.After
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertTrue
+import org.junit.Assert.fail
+import org.junit.Before
+import org.junit.Rule
+import org.junit.Test
+import org.junit.rules.TemporaryFolder
+import java.io.File
+import java.io.IOException
+import java.net.InetSocketAddress
+import java.security.MessageDigest
+import java.util.Collections
+import java.util.Random
+
+/**
+ * Runs the downloader against a local stand-in for the update server that
+ * cuts every response off after [dropAfter] bytes, like a flaky mobile link.
+ */
+class ResumableDownloaderTest {
+    @get:Rule
+    val temp = TemporaryFolder()
+
+    private val body = ByteArray(3 * 1024 * 1024).also { Random(42).nextBytes(it) }
+    private val sha256 = MessageDigest.getInstance("SHA-256").digest(body).joinToString("") { "%02x".format(it) }
+    private val rangeStarts: MutableList<Long> = Collections.synchronizedList(mutableListOf())
+
+    @Volatile private var dropAfter = Int.MAX_VALUE
+    @Volatile private var supportRanges = true
+    @Volatile private var requestsUntilOutage = Int.MAX_VALUE
+    private lateinit var server: HttpServer
+    private lateinit var url: String
+
+    @Before
+    fun startServer() {
+        server = HttpServer.create(InetSocketAddress("127.0.0.1", 0), 0)
+        server.createContext("/bundle.zip") { exchange -> serve(exchange) }
+        server.executor = java.util.concurrent.Executors.newCachedThreadPool()
+        server.start()
+        url = "http://127.0.0.1:${server.address.port}/bundle.zip"
+    }
+
+    @After
+    fun stopServer() {
+        server.stop(0)
+    }
+
+    private fun serve(exchange: HttpExchange) {
+        var start = 0
+        var end = body.size - 1
+        val range = exchange.requestHeaders.getFirst("Range")
+
+        if (requestsUntilOutage-- <= 0) {
+            exchange.sendResponseHeaders(503, -1)
+            exchange.close()
+            return
+        }
+
+        exchange.responseHeaders.add("ETag", "\"v1\"")
+        if (supportRanges && range != null) {
+            val (from, to) = range.removePrefix("bytes=").split('-')
+            start = from.toInt()
+            end = if (to.isEmpty()) end else minOf(end, to.toInt())
+            rangeStarts.add(start.toLong())
+            exchange.responseHeaders.add("Content-Range", "bytes $start-$end/${body.size}")
+            exchange.sendResponseHeaders(206, (end - start + 1).toLong())
+        } else {
+            exchange.sendResponseHeaders(200, body.size.toLong())
+        }
+
+        // Declare the full length but hang up early
+        val count = minOf(end - start + 1, dropAfter)
+        try {
+            exchange.responseBody.write(body, start, count)
+            exchange.responseBody.flush()
+            exchange.close()
+        } catch (e: IOException) {
+            // Short body or the client went away; either way the connection is dropped
+        }
+    }
+
+    private fun downloader(destination: File, segments: Int = 1, sha: String? = sha256, attempts: Int = 50) =
+        ResumableDownloader(
+            url, destination, sha, segments,
+            connectTimeoutMs = 2000,
+            readTimeoutMs = 2000,
+            retryDelayMs = 1,
+            maxStalledAttempts = attempts,
+            minSegmentSize = 256 * 1024,
+        )
+
+    @Test
+    fun completesAcrossDroppedConnections() {
+        dropAfter = 200 * 1024
+        val file = downloader(File(temp.root, "ota.zip")).download()
+
+        assertArrayEquals(body, file.readBytes())
+        assertTrue("should have resumed mid-file", rangeStarts.any { it > 0 })
+        assertFalse(ResumableDownloader.hasProgress(file))
+    }
+
+    @Test
+    fun fetchesSegmentsInParallel() {
+        dropAfter = 300 * 1024
+        val file = downloader(File(temp.root, "ota.zip"), segments = 4).download()
+
+        assertArrayEquals(body, file.readBytes())
+        assertTrue("segments start past the first", rangeStarts.count { it >= body.size / 2 } >= 1)
+    }
+
+    @Test
+    fun resumesFromJournalAfterRestart() {
+        val destination = File(temp.root, "ota.zip")
+
+        // First run loses the server part way through and gives up, as if the
+        // app had been killed mid-download
+        dropAfter = 1536 * 1024
+        requestsUntilOutage = 2
+        try {
+            downloader(destination, attempts = 1).download()
+            fail("download should not have completed")
+        } catch (e: IOException) {
+            // expected
+        }
+        assertTrue(ResumableDownloader.hasProgress(destination))
+
+        rangeStarts.clear()
+        dropAfter = Int.MAX_VALUE
+        requestsUntilOutage = Int.MAX_VALUE
+        downloader(destination).download()
+
+        assertArrayEquals(body, destination.readBytes())
+        assertTrue("second run should not start from zero", rangeStarts.filter { it > 0 }.any { it >= 1024 * 1024 })
+    }
+
+    @Test
+    fun rejectsHashMismatch() {
+        val destination = File(temp.root, "ota.zip")
+        try {
+            downloader(destination, sha = "0".repeat(64)).download()
+            fail("hash mismatch should fail")
+        } catch (e: IOException) {
+            // expected
+        }
+
+        assertFalse(destination.exists())
+        assertFalse(ResumableDownloader.hasProgress(destination))
+    }
+
+    @Test
+    fun fallsBackToPlainGetWithoutRanges() {
+        supportRanges = false
+        val file = downloader(File(temp.root, "ota.zip")).download()
+
+        assertArrayEquals(body, file.readBytes())
+    }
+}
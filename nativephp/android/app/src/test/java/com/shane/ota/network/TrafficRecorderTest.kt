@@ -0,0 +1,65 @@
+package com.shane.ota.network
+
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertEquals
+import org.junit.Test
+import java.io.ByteArrayOutputStream
+import java.io.DataOutputStream
+
+class TrafficRecorderTest {
+    @Test
+    fun credentialHeadersAreDropped() {
+        val headers = TrafficRecorder.redactHeaders(
+            mapOf("Cookie" to "laravel_session=abc", "X-XSRF-TOKEN" to "xyz", "Accept" to "text/html")
+        )
+        assertEquals(mapOf("Accept" to "text/html"), headers)
+    }
+
+    @Test
+    fun formFieldsAreRedacted() {
+        assertEquals(
+            "_token=&email=a%40b.c&password=redacted&remember=on",
+            TrafficRecorder.redactBody("_token=s3cr3t&email=a%40b.c&password=hunter2&remember=on")
+        )
+    }
+
+    @Test
+    fun jsonAndEmbeddedSnapshotFieldsAreRedacted() {
+        val body = """{"_token":"s3cr3t","components":[{"snapshot":"{\"data\":{\"password\":\"hunter2\"}}",""" +
+            """"updates":{"password":"hun\"ter2","email":"a@b.c"}}]}"""
+        assertEquals(
+            """{"_token":"","components":[{"snapshot":"{\"data\":{\"password\":\"redacted\"}}",""" +
+                """"updates":{"password":"redacted","email":"a@b.c"}}]}""",
+            TrafficRecorder.redactBody(body)
+        )
+    }
+
+    @Test
+    fun queryStringsAreRedactedButPathsKept() {
+        assertEquals(
+            "/verify-email/1/abc?expires=1700000000&signature=redacted",
+            TrafficRecorder.redactUri("/verify-email/1/abc?expires=1700000000&signature=0123abcd")
+        )
+        assertEquals("/dashboard", TrafficRecorder.redactUri("/dashboard"))
+    }
+
+    @Test
+    fun recordsAreVarintEncoded() {
+        val bytes = ByteArrayOutputStream()
+        val request = PHPRequest(url = "/", method = "get", headers = mapOf("Cookie" to "a=b", "Accept" to "*/*"))
+        TrafficRecorder.writeRecord(DataOutputStream(bytes), request, 300, 200, longArrayOf(0, 1_500_000))
+
+        val expected = byteArrayOf(
+            0xac.toByte(), 0x02,                     // arrival 300µs
+            3, 'G'.code.toByte(), 'E'.code.toByte(), 'T'.code.toByte(),
+            1, '/'.code.toByte(),
+            1,                                       // one header left after redaction
+            6, 'A'.code.toByte(), 'c'.code.toByte(), 'c'.code.toByte(), 'e'.code.toByte(), 'p'.code.toByte(), 't'.code.toByte(),
+            3, '*'.code.toByte(), '/'.code.toByte(), '*'.code.toByte(),
+            0,                                       // empty body
+            0xc8.toByte(), 0x01,                     // status 200
+            2, 0, 0xdc.toByte(), 0x0b                // phases in µs: 0, 1500
+        )
+        assertArrayEquals(expected, bytes.toByteArray())
+    }
+}
@@ -29,7 +29,7 @@ class AppDelegate: NSObject, UIApplicationDelegate {
     func messaging(_ messaging: Messaging, didReceiveRegistrationToken fcmToken: String?) {
         guard let fcmToken = fcmToken else { return }
 
-        LaravelBridge.shared.send?(
+        LaravelBridge.shared.send(
             "Native\\Mobile\\Events\\PushNotification\\TokenGenerated",
             ["token": fcmToken]
         )
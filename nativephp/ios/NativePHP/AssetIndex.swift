@@ -0,0 +1,133 @@
+import Foundation
+import UniformTypeIdentifiers
+
+/// Index of every file under the bundled `app/public`, built once so `_assets`
+/// lookups are a dictionary hit instead of a bundle scan per request.
+final class AssetIndex {
+    static let shared = AssetIndex()
+
+    /// Size of each slice handed to `didReceive`, so large files never need
+    /// to be copied into a single buffer.
+    static let chunkSize = 256 * 1024
+
+    private let lock = NSLock()
+    private var paths: [String: String]?
+
+    /// Build the index off the main thread so the first asset request doesn't pay for it.
+    func warm() {
+        DispatchQueue.global(qos: .userInitiated).async {
+            _ = self.path(for: "")
+        }
+    }
+
+    func path(for relativePath: String) -> String? {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if paths == nil {
+            paths = buildIndex()
+        }
+
+        return paths?[relativePath]
+    }
+
+    private func buildIndex() -> [String: String] {
+        var index: [String: String] = [:]
+
+        guard let root = Bundle.main.resourceURL?
+            .appendingPathComponent("app/public", isDirectory: true)
+            .resolvingSymlinksInPath() else {
+            return index
+        }
+
+        let rootPath = root.path(percentEncoded: false)
+        let prefixLength = rootPath.hasSuffix("/") ? rootPath.count : rootPath.count + 1
+
+        guard let enumerator = FileManager.default.enumerator(
+            at: root,
+            includingPropertiesForKeys: [.isRegularFileKey],
+            options: []
+        ) else {
+            return index
+        }
+
+        for case let fileURL as URL in enumerator {
+            guard (try? fileURL.resourceValues(forKeys: [.isRegularFileKey]))?.isRegularFile == true else {
+                continue
+            }
+
+            let fullPath = fileURL.resolvingSymlinksInPath().path(percentEncoded: false)
+            guard fullPath.count > prefixLength else {
+                continue
+            }
+
+            index[String(fullPath.dropFirst(prefixLength))] = fullPath
+        }
+
+        print("Indexed \(index.count) bundled assets")
+
+        return index
+    }
+
+    static func mimeType(for fileName: String) -> String {
+        let pathExtension = (fileName as NSString).pathExtension.lowercased()
+
+        if let mimeType = mimeTypes[pathExtension] {
+            return mimeType
+        }
+
+        if let mimeType = UTType(filenameExtension: pathExtension)?.preferredMIMEType {
+            return mimeType
+        }
+
+        return "application/octet-stream"
+    }
+
+    private static let mimeTypes: [String: String] = [
+        // Documents
+        "html": "text/html",
+        "htm": "text/html",
+        "css": "text/css",
+        "js": "application/javascript",
+        "mjs": "application/javascript",
+        "json": "application/json",
+        "map": "application/json",
+        "webmanifest": "application/manifest+json",
+        "xml": "application/xml",
+        "txt": "text/plain",
+        "csv": "text/csv",
+        "pdf": "application/pdf",
+        "wasm": "application/wasm",
+
+        // Images
+        "png": "image/png",
+        "jpg": "image/jpeg",
+        "jpeg": "image/jpeg",
+        "gif": "image/gif",
+        "svg": "image/svg+xml",
+        "webp": "image/webp",
+        "avif": "image/avif",
+        "ico": "image/x-icon",
+        "bmp": "image/bmp",
+
+        // Fonts
+        "woff": "font/woff",
+        "woff2": "font/woff2",
+        "ttf": "font/ttf",
+        "otf": "font/otf",
+        "eot": "application/vnd.ms-fontobject",
+
+        // Media
+        "mp3": "audio/mpeg",
+        "m4a": "audio/mp4",
+        "aac": "audio/aac",
+        "wav": "audio/wav",
+        "ogg": "audio/ogg",
+        "oga": "audio/ogg",
+        "mp4": "video/mp4",
+        "m4v": "video/mp4",
+        "mov": "video/quicktime",
+        "webm": "video/webm",
+        "ogv": "video/ogg",
+    ]
+}
@@ -6,7 +6,15 @@ import AVFoundation
 final class LaravelBridge {
     static let shared = LaravelBridge()
 
-    var send: ((_ event: String, _ payload: [String: Any]) -> Void)?
+    /// Fires a `native-event` DOM event in the page; set while a WebView is up.
+    var notifyPage: ((_ event: String, _ payload: [String: Any]) -> Void)?
+
+    /// Queues `event` for Laravel's dispatcher, which gets it on the PHP
+    /// queue without a request, and tells the page.
+    func send(_ event: String, _ payload: [String: Any]) {
+        NativeEventQueue.shared.enqueue(event, payload)
+        notifyPage?(event, payload)
+    }
 }
 
 // MARK: - Share sheet
@@ -111,7 +119,7 @@ public func NativePHPShowAlert(_ cTitle: UnsafePointer<CChar>?,
             alert.addAction(UIAlertAction(title: label,
                                           style: .default) { _ in
                 // JS / Laravel event
-                LaravelBridge.shared.send?(
+                LaravelBridge.shared.send(
                     "Native\\Mobile\\Events\\Alert\\ButtonPressed",
                     ["index": index, "title": label]
                 )
@@ -233,7 +241,7 @@ final class MyCameraDelegate: NSObject,
                 resourceValues.isExcludedFromBackup = true
                 try fileURL.setResourceValues(resourceValues)
 
-                LaravelBridge.shared.send?(
+                LaravelBridge.shared.send(
                     "Native\\Mobile\\Events\\Camera\\PhotoTaken",
                     ["path": fileURL.path(percentEncoded: false)]
                 )
@@ -269,7 +277,7 @@ public func NativePHPLocalAuthChallenge() {
 
         // Check availability
         guard context.canEvaluatePolicy(.deviceOwnerAuthentication, error: &error) else {
-            LaravelBridge.shared.send?(
+            LaravelBridge.shared.send(
                 "Native\\Mobile\\Events\\Biometric\\Completed",
                 ["success": false]
             )
@@ -284,12 +292,12 @@ public func NativePHPLocalAuthChallenge() {
                            localizedReason: "Authenticate") { success, error in
             DispatchQueue.main.async {
                 if success {
-                    LaravelBridge.shared.send?(
+                    LaravelBridge.shared.send(
                         "Native\\Mobile\\Events\\Biometric\\Completed",
                         ["success": true]
                     )
                 } else {
-                    LaravelBridge.shared.send?(
+                    LaravelBridge.shared.send(
                         "Native\\Mobile\\Events\\Biometric\\Completed",
                         ["success": false]
                     )
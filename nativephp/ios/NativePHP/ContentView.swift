@@ -35,7 +35,7 @@ struct WebView: UIViewRepresentable {
     }
     
     static func dismantleUIView(_ uiView: WKWebView, coordinator: Coordinator) {
-        LaravelBridge.shared.send = nil
+        LaravelBridge.shared.notifyPage = nil
     }
 
     class Coordinator: NSObject, WKNavigationDelegate {
@@ -64,8 +64,10 @@ struct WebView: UIViewRepresentable {
             }
         }
         
+        /// Laravel already has the event through NativeEventQueue; this only
+        /// lets scripts in the page react to it.
         @MainActor
-        func notifyLaravel(
+        func notifyPage(
             event: String,
             payload: [String: Any]
         ) {
@@ -77,7 +79,6 @@ struct WebView: UIViewRepresentable {
                 return literal
             }()
             
-            // 1. Inject JS event into the current web page
             if let jsonData = try? JSONSerialization.data(withJSONObject: payload, options: []),
                let jsonString = String(data: jsonData, encoding: .utf8) {
 
@@ -93,20 +94,6 @@ struct WebView: UIViewRepresentable {
                         }
                     );
                     document.dispatchEvent(event);
-
-                    fetch('/_native/api/events', {
-                        method: 'POST',
-                        headers: {
-                            'Content-Type': 'application/json',
-                            'X-Requested-With': 'XMLHttpRequest'
-                        },
-                        body: JSON.stringify({
-                            event: \(event),
-                            payload: \(jsonString),
-                        })
-                    }).then(response => response.json())
-                      .then(data => console.log("API Event Dispatch Success:", JSON.stringify(data, null, 2)))
-                      .catch(error => console.error("API Event Dispatch Error:", error));
                 })();
                 """
 
@@ -117,18 +104,6 @@ struct WebView: UIViewRepresentable {
                         print("JavaScript event '\(event)' dispatched.")
                     }
                 }
-
-                // FUTURE: Send a request to Laravel backend directly
-//                let request = RequestData(
-//                    method: "POST",
-//                    uri: "php://127.0.0.1/_native/api/events",
-//                    data: jsonString,
-//                    headers: [
-//                        "Content-Type": "application/json"
-//                    ])
-//
-//                _ = NativePHPApp.laravel(request: request)
-                
             }
         }
         
@@ -173,9 +148,9 @@ struct WebView: UIViewRepresentable {
     func makeUIView(context: Context) -> WKWebView {
         let coordinator = context.coordinator
         
-        LaravelBridge.shared.send = { [weak coordinator] event, payload in
+        LaravelBridge.shared.notifyPage = { [weak coordinator] event, payload in
             Task { @MainActor in
-                coordinator?.notifyLaravel(event: event, payload: payload)
+                coordinator?.notifyPage(event: event, payload: payload)
             }
         }
         
@@ -0,0 +1,80 @@
+import Foundation
+
+/// Native events waiting for Laravel, the iOS side of native_actions.c and
+/// PHPBridge.scheduleEventDispatch on Android. Events queue from whatever
+/// thread they happen on and go to Laravel's dispatcher on the PHP queue,
+/// `batchDelay` after the first one, so a burst and anything that finished
+/// while a request was running cost one artisan run instead of a WebView
+/// fetch and a full request each.
+final class NativeEventQueue {
+    static let shared = NativeEventQueue()
+
+    private static let batchDelay: DispatchTimeInterval = .milliseconds(50)
+
+    private let lock = NSLock()
+    private var pending: [[String: Any]] = []
+    private var scheduled = false
+
+    /// From any thread.
+    func enqueue(_ event: String, _ payload: [String: Any]) {
+        guard let data = try? JSONSerialization.data(withJSONObject: payload) else {
+            print("⚠️ Dropped native event \(event): payload isn't JSON")
+            return
+        }
+
+        // Shaped like a handle 0 result from nativephp_events() on Android
+        let result: [String: Any] = [
+            "handle": 0,
+            "action": "",
+            "event": event,
+            "payload": String(decoding: data, as: UTF8.self),
+            "code": 0,
+            "count": 1,
+            "batch": false,
+        ]
+
+        lock.lock()
+        pending.append(result)
+        let schedule = !scheduled
+        scheduled = true
+        lock.unlock()
+
+        guard schedule else { return }
+
+        NativePHPApp.phpQueue.asyncAfter(deadline: .now() + NativeEventQueue.batchDelay) {
+            self.dispatch()
+        }
+    }
+
+    /// Moves everything queued out, oldest first.
+    private func take() -> [[String: Any]] {
+        lock.lock()
+        defer { lock.unlock() }
+
+        // Events queued from here on need a run of their own
+        let taken = pending
+        pending.removeAll()
+        scheduled = false
+        return taken
+    }
+
+    /// On the PHP queue.
+    private func dispatch() {
+        let results = take()
+        guard !results.isEmpty,
+              let data = try? JSONSerialization.data(withJSONObject: results) else {
+            return
+        }
+
+        print("📬 Dispatching \(results.count) native events")
+
+        let output = Trace.shared.span("dispatch native events", category: "php") {
+            NativePHPApp.artisan(additionalArgs: ["native:dispatch-events", "--results=" + String(decoding: data, as: UTF8.self)])
+        }
+        // Artisan leaves this set for the console; requests run as the web app
+        setenv("APP_RUNNING_IN_CONSOLE", "false", 1)
+        Trace.shared.flush()
+
+        print("📬 \(output.trimmingCharacters(in: .whitespacesAndNewlines))")
+    }
+}
@@ -10,16 +10,33 @@ var output = ""
 public func pipe_php_output(_ cString: UnsafePointer<CChar>?) {
     guard let cString = cString else { return }
 
+    let start = Trace.now()
     output += String(cString: cString)
+    RequestTiming.active?.add(.output, Trace.now() - start)
 }
 
 @main
 struct NativePHPApp: App {
     @UIApplicationDelegateAdaptor(AppDelegate.self) var appDelegate
 
+    /// Every request and artisan run after startup goes through this queue;
+    /// the embedded engine only runs one script at a time.
+    static let phpQueue = DispatchQueue(
+        label: "com.NativePHP.\(Bundle.main.infoDictionary?["CFBundleName"] as? String ?? "DefaultAppName").phpSerialQueue"
+    )
+
     init() {
-        _ = preparePhpEnvironment()
-        FirebaseManager.shared.configureIfAvailable()
+        Trace.shared.configure()
+
+        Trace.shared.span("NativePHPApp.init", category: "startup") {
+            AssetIndex.shared.warm()
+            TrafficRecorder.shared.startIfRequested()
+            _ = Trace.shared.span("preparePhpEnvironment", category: "startup") { preparePhpEnvironment() }
+            Trace.shared.span("FirebaseManager.configure", category: "startup") {
+                FirebaseManager.shared.configureIfAvailable()
+            }
+        }
+        Trace.shared.flush()
     }
     
     var body: some Scene {
@@ -88,25 +105,25 @@ struct NativePHPApp: App {
     }
 
     private func migrateDatabase() {
-        _ = artisan(additionalArgs: ["migrate", "--force"])
+        _ = NativePHPApp.artisan(additionalArgs: ["migrate", "--force"])
     }
     
     private func clearCaches() {
-        _ = artisan(additionalArgs: ["view:clear"])
+        _ = NativePHPApp.artisan(additionalArgs: ["view:clear"])
     }
 
     private func preparePhpEnvironment() -> String {
-        let phpIniPath = createPhpIni()
+        let phpIniPath = Trace.shared.span("createPhpIni", category: "startup") { createPhpIni() }
 
         setenv("PHPRC", phpIniPath, 1)
 
-        setupEnvironment()
+        Trace.shared.span("setupEnvironment", category: "startup") { setupEnvironment() }
 
         output = ""
 
         override_embed_module_output(pipe_php_output)
 
-        createDatabase()
+        Trace.shared.span("createDatabase", category: "startup") { createDatabase() }
 
         migrateDatabase()
         
@@ -115,7 +132,13 @@ struct NativePHPApp: App {
         return output
     }
 
-    static func laravel(request: RequestData) -> String? {
+    /// Runs `request` through Laravel. `timing` receives the PHP phases; the
+    /// caller adds the queue wait and its own response conversion.
+    static func laravel(request: RequestData, timing: RequestTiming? = nil) -> String? {
+        let timing = timing ?? RequestTiming(method: request.method, uri: request.uri)
+        RequestTiming.active = timing
+        defer { RequestTiming.active = nil }
+
         // Convert Swift strings to C strings
         let postDataC = strdup(request.data ?? "")
         let methodC = strdup(request.method)
@@ -179,19 +202,34 @@ struct NativePHPApp: App {
             envKeys.append(formattedKey)
         }
 
+        let requestStart = Trace.now()
+
         // Equivalent to PHP_EMBED_START_BLOCK
         argv.withUnsafeMutableBufferPointer { bufferPtr in
-            php_embed_init(argc, bufferPtr.baseAddress)
+            timing.measure(.startup) {
+                Trace.shared.span("php_embed_init", category: "php") {
+                    php_embed_init(argc, bufferPtr.baseAddress)
+                    RequestTiming.hookCompile()
 
-            initialize_php_with_request(postDataC, methodC, uriC)
+                    initialize_php_with_request(postDataC, methodC, uriC)
+                }
+            }
 
             var fileHandle = zend_file_handle()
             zend_stream_init_filename(&fileHandle, phpFilePath)
 
-            php_execute_script(&fileHandle)
+            timing.measureExecute {
+                Trace.shared.span("php_execute_script", category: "php") {
+                    php_execute_script(&fileHandle)
+                }
+            }
 
             // Equivalent to PHP_EMBED_END_BLOCK
-            php_embed_shutdown()
+            timing.measure(.shutdown) {
+                Trace.shared.span("php_embed_shutdown", category: "php") {
+                    php_embed_shutdown()
+                }
+            }
 
             // Clean up env variables for headers
             for key in envKeys {
@@ -203,6 +241,9 @@ struct NativePHPApp: App {
         // Free argv strings
         argv.forEach { free($0) }
 
+        Trace.shared.record("\(request.method) \(request.uri)", category: "request", start: requestStart, end: Trace.now())
+        Trace.shared.flush()
+
         print()
         print("=== LARAVEL FINISHED ===")
         print()
@@ -224,7 +265,7 @@ struct NativePHPApp: App {
         setenv("DB_DATABASE", "\(databaseDir)/database.sqlite", 1)
     }
 
-    private func artisan(additionalArgs: [String] = []) -> String {
+    static func artisan(additionalArgs: [String] = []) -> String {
         output = ""
 
         override_embed_module_output(pipe_php_output)
@@ -243,19 +284,29 @@ struct NativePHPApp: App {
 
         let phpFilePath = Bundle.main.path(forResource: "artisan", ofType: "php", inDirectory: "app/vendor/nativephp/mobile/bootstrap/ios")
 
+        let start = Trace.now()
+
         argv.withUnsafeMutableBufferPointer { bufferPtr in
-            php_embed_init(argc, bufferPtr.baseAddress)
+            Trace.shared.span("php_embed_init", category: "php") {
+                php_embed_init(argc, bufferPtr.baseAddress)
+            }
 
             var fileHandle = zend_file_handle()
             zend_stream_init_filename(&fileHandle, phpFilePath)
 
-            php_execute_script(&fileHandle)
+            Trace.shared.span("php_execute_script", category: "php") {
+                php_execute_script(&fileHandle)
+            }
 
-            php_embed_shutdown()
+            Trace.shared.span("php_embed_shutdown", category: "php") {
+                php_embed_shutdown()
+            }
         }
 
         argv.forEach { free($0) }
 
+        Trace.shared.record("artisan \(additionalArgs.joined(separator: " "))", category: "artisan", start: start, end: Trace.now())
+
         return output
     }
 }
@@ -6,13 +6,8 @@ class PHPSchemeHandler: NSObject, WKURLSchemeHandler {
     var redirectCount = 0
     let maxRedirects = 10
     
-    private let phpSerialQueue: DispatchQueue
-
-    override init() {
-        let appName = Bundle.main.infoDictionary?["CFBundleName"] as? String ?? "DefaultAppName"
-        let queueLabel = "com.NativePHP.\(appName).phpSerialQueue"
-        self.phpSerialQueue = DispatchQueue(label: queueLabel)
-    }
+    // Shared with NativeEventQueue, so event dispatch never overlaps a request
+    private let phpSerialQueue = NativePHPApp.phpQueue
 
     // This method is called when the web view starts loading a request with your custom scheme
     func webView(_ webView: WKWebView, start schemeTask: WKURLSchemeTask) {
@@ -48,31 +43,22 @@ class PHPSchemeHandler: NSObject, WKURLSchemeHandler {
                     let relativeAssetPath = subComponents.joined(separator: "/")
 
                     // Attempt to find this file in app/public
-                    let assetDir = "app/public"
-
-                    // Combine that with the subpath.
-                    if let localPath = Bundle.main.path(forResource: relativeAssetPath,
-                                                        ofType: nil,
-                                                        inDirectory: assetDir) {
-
-                        do {
-                            let fileData = try Data(contentsOf: URL(fileURLWithPath: localPath))
-
-                            let mimeType = self!.guessMimeType(for: relativeAssetPath)
-
-                            let response = HTTPURLResponse(url: url,
-                                                           statusCode: 200,
-                                                           httpVersion: "HTTP/1.1",
-                                                           headerFields: ["Content-Type": mimeType])
-
-                            schemeTask.didReceive(response!)
-                            schemeTask.didReceive(fileData)
-                            schemeTask.didFinish()
-
+                    if let localPath = AssetIndex.shared.path(for: relativeAssetPath) {
+
+                        let mimeType = self!.guessMimeType(for: relativeAssetPath)
+
+                        if self!.serveFile(atPath: localPath,
+                                           url: url,
+                                           headers: [
+                                               "Content-Type": mimeType,
+                                               "Cache-Control": "max-age=86400, public",
+                                           ],
+                                           rangeHeader: request.value(forHTTPHeaderField: "Range"),
+                                           schemeTask: schemeTask) {
                             return
-                        } catch {
-                            // Just fall back to PHP
                         }
+
+                        // Just fall back to PHP
                     }
                 }
 
@@ -95,6 +81,9 @@ class PHPSchemeHandler: NSObject, WKURLSchemeHandler {
                     request.headers["Cookie"] = cookieHeader
                     request.headers["X-XSRF-TOKEN"] = csrfToken
 
+                    // Let BinaryFileResponse hand us the file path instead of the bytes
+                    request.headers["X-Sendfile-Type"] = "X-Sendfile"
+
                     self!.forwardToPHP(requestData: request, schemeTask: schemeTask)
                 }
 
@@ -109,26 +98,113 @@ class PHPSchemeHandler: NSObject, WKURLSchemeHandler {
         // Handle stopping the loading if needed
     }
 
-    private func guessMimeType(for fileName: String) -> String {
-        let pathExtension = (fileName as NSString).pathExtension.lowercased()
-        switch pathExtension {
-        case "html", "htm":
-            return "text/html"
-        case "css":
-            return "text/css"
-        case "js":
-            return "application/javascript"
-        case "png":
-            return "image/png"
-        case "jpg", "jpeg":
-            return "image/jpeg"
-        case "gif":
-            return "image/gif"
-        case "svg":
-            return "image/svg+xml"
-        default:
-            return "application/octet-stream"
+    /// Serve a file either whole or, for a single `bytes=` range, as a 206. The file is
+    /// memory-mapped and handed to WebKit in chunks, so only the pages covering the
+    /// requested bytes are ever read. Multi-range requests are rejected with a 416.
+    /// Returns false if the file couldn't be mapped so the caller can fall back.
+    private func serveFile(atPath path: String,
+                           url: URL,
+                           headers: [String: String],
+                           rangeHeader: String?,
+                           schemeTask: WKURLSchemeTask) -> Bool {
+        let data: Data
+        do {
+            data = try Data(contentsOf: URL(fileURLWithPath: path), options: .alwaysMapped)
+        } catch {
+            return false
+        }
+
+        let length = UInt64(data.count)
+
+        var responseHeaders = headers
+        responseHeaders["Accept-Ranges"] = "bytes"
+
+        var statusCode = 200
+        var start: UInt64 = 0
+        var end: UInt64 = length > 0 ? length - 1 : 0
+
+        if let rangeHeader = rangeHeader {
+            guard let range = parseRange(rangeHeader, length: length) else {
+                responseHeaders["Content-Range"] = "bytes */\(length)"
+                responseHeaders["Content-Length"] = "0"
+
+                let response = HTTPURLResponse(url: url,
+                                               statusCode: 416,
+                                               httpVersion: "HTTP/1.1",
+                                               headerFields: responseHeaders)
+                schemeTask.didReceive(response!)
+                schemeTask.didFinish()
+                return true
+            }
+
+            statusCode = 206
+            (start, end) = range
+            responseHeaders["Content-Range"] = "bytes \(start)-\(end)/\(length)"
+        }
+
+        let count = length == 0 ? 0 : end - start + 1
+        responseHeaders["Content-Length"] = "\(count)"
+
+        let response = HTTPURLResponse(url: url,
+                                       statusCode: statusCode,
+                                       httpVersion: "HTTP/1.1",
+                                       headerFields: responseHeaders)
+
+        schemeTask.didReceive(response!)
+
+        var offset = Int(start)
+        let upperBound = Int(start + count)
+        while offset < upperBound {
+            let chunkEnd = min(offset + AssetIndex.chunkSize, upperBound)
+            schemeTask.didReceive(data.subdata(in: offset..<chunkEnd))
+            offset = chunkEnd
+        }
+
+        schemeTask.didFinish()
+
+        return true
+    }
+
+    /// Parse a single `bytes=` range into inclusive offsets, or nil if it can't be served.
+    private func parseRange(_ header: String, length: UInt64) -> (UInt64, UInt64)? {
+        let spec = header.trimmingCharacters(in: .whitespaces)
+        guard spec.lowercased().hasPrefix("bytes="), length > 0 else {
+            return nil
+        }
+
+        let ranges = spec.dropFirst(6).trimmingCharacters(in: .whitespaces)
+        guard !ranges.contains(","), let dash = ranges.firstIndex(of: "-") else {
+            return nil
+        }
+
+        let first = ranges[..<dash].trimmingCharacters(in: .whitespaces)
+        let last = ranges[ranges.index(after: dash)...].trimmingCharacters(in: .whitespaces)
+
+        if first.isEmpty {
+            // Suffix range: the last N bytes
+            guard let suffix = UInt64(last), suffix > 0 else {
+                return nil
+            }
+            return (length > suffix ? length - suffix : 0, length - 1)
+        }
+
+        guard let start = UInt64(first), start < length else {
+            return nil
+        }
+
+        var end = length - 1
+        if !last.isEmpty {
+            guard let requested = UInt64(last) else {
+                return nil
+            }
+            end = min(requested, length - 1)
         }
+
+        return end >= start ? (start, end) : nil
+    }
+
+    private func guessMimeType(for fileName: String) -> String {
+        return AssetIndex.mimeType(for: fileName)
     }
 
     // Helper method to extract request data
@@ -251,9 +327,14 @@ class PHPSchemeHandler: NSObject, WKURLSchemeHandler {
     }
 
     private func forwardToPHP(requestData: RequestData, schemeTask: WKURLSchemeTask) {
-        getResponse(request: requestData) { result in
+        let arrived = Trace.now()
+        let timing = RequestTiming(method: requestData.method, uri: requestData.uri)
+
+        getResponse(request: requestData, timing: timing) { result in
             switch result {
             case .success(let responseData):
+                let convertStart = Trace.now()
+
                 // Parse the response data into headers and body
                 guard let responseString = String(data: responseData, encoding: .utf8) else {
                     let error = self.error(code: 500, description: "Failed to decode response")
@@ -319,6 +400,11 @@ class PHPSchemeHandler: NSObject, WKURLSchemeHandler {
                     statusCode = code
                 }
 
+                timing.add(.convert, Trace.now() - convertStart)
+                headers["Server-Timing"] = timing.serverTimingHeader
+                RequestMetrics.shared.record(timing)
+                TrafficRecorder.shared.record(requestData, arrived: arrived, status: statusCode, timing: timing)
+
                 var request = requestData
                 if let location = headers["Location"] {
                     request.uri = location.trimmingCharacters(in: .whitespaces)
@@ -356,6 +442,21 @@ class PHPSchemeHandler: NSObject, WKURLSchemeHandler {
 
                 self.redirectCount = 0
 
+                // File responses are streamed from disk, honouring Range
+                if statusCode == 200, let sendfile = headers["X-Sendfile"] {
+                    var fileHeaders = headers
+                    fileHeaders.removeValue(forKey: "X-Sendfile")
+                    fileHeaders.removeValue(forKey: "Content-Length")
+
+                    if self.serveFile(atPath: sendfile,
+                                      url: URL(string: requestData.uri) ?? URL(string: "/")!,
+                                      headers: fileHeaders,
+                                      rangeHeader: requestData.headers["Range"],
+                                      schemeTask: schemeTask) {
+                        return
+                    }
+                }
+
                 print("Forwarding response to WebView")
 
                 guard let httpResponse = HTTPURLResponse(url: (URL(string: requestData.uri) ?? URL(string: "/"))!,
@@ -391,15 +492,20 @@ class PHPSchemeHandler: NSObject, WKURLSchemeHandler {
     }
 
     private func getResponse(request: RequestData,
+                              timing: RequestTiming,
                               completion: @escaping (Result<Data, Error>) -> Void) {
+        let submitted = Trace.now()
+
         phpSerialQueue.async {
+            timing.add(.queue, Trace.now() - submitted)
+
             print()
             print("\(request.method) \(request.uri)")
             print()
             print(request.headers.map { "\($0.key)=\($0.value)" }.joined(separator: "\n"))
 
             // Pass the request to Laravel and get Laravel's response
-            let response = NativePHPApp.laravel(request: request) ?? "No response from Laravel"
+            let response = NativePHPApp.laravel(request: request, timing: timing) ?? "No response from Laravel"
 
             // Extract cookie headers
             let components = response.components(separatedBy: "\r\n\r\n")
@@ -0,0 +1,180 @@
+import Foundation
+import PHP
+
+/// Phase durations of one request, in nanoseconds, in the same phases as
+/// request_phase on Android. PHPSchemeHandler fills in the queue wait and
+/// its own response conversion; NativePHPApp.laravel measures the PHP phases
+/// around the embed calls.
+final class RequestTiming {
+    enum Phase: Int, CaseIterable {
+        case queue, startup, compile, execute, output, shutdown, convert
+
+        var name: String {
+            return String(describing: self)
+        }
+    }
+
+    /// The request PHP is running now. Only touched on the PHP queue, where
+    /// the output and compile hooks add to it.
+    static var active: RequestTiming?
+
+    let method: String
+    let uri: String
+    private(set) var phases = [UInt64](repeating: 0, count: Phase.allCases.count)
+
+    init(method: String, uri: String) {
+        self.method = method
+        self.uri = uri
+    }
+
+    func add(_ phase: Phase, _ ns: UInt64) {
+        phases[phase.rawValue] += ns
+    }
+
+    @discardableResult
+    func measure<T>(_ phase: Phase, _ block: () throws -> T) rethrows -> T {
+        let start = Trace.now()
+        defer { add(phase, Trace.now() - start) }
+        return try block()
+    }
+
+    /// Times php_execute_script, leaving out the compile and output time nested inside it.
+    func measureExecute(_ block: () -> Void) {
+        let nested = phases[Phase.compile.rawValue] + phases[Phase.output.rawValue]
+        let start = Trace.now()
+        block()
+        let elapsed = Trace.now() - start
+        let inner = phases[Phase.compile.rawValue] + phases[Phase.output.rawValue] - nested
+        add(.execute, elapsed > inner ? elapsed - inner : 0)
+    }
+
+    var total: UInt64 {
+        return phases.reduce(0, +)
+    }
+
+    /// `Server-Timing` value, so the breakdown shows up in Web Inspector.
+    var serverTimingHeader: String {
+        let entries = Phase.allCases.map { ($0.name, phases[$0.rawValue]) } + [("total", total)]
+        return entries
+            .map { String(format: "%@;dur=%.2f", $0.0, Double($0.1) / 1e6) }
+            .joined(separator: ", ")
+    }
+
+    private typealias CompileFile = @convention(c) (UnsafeMutablePointer<zend_file_handle>?, Int32) -> UnsafeMutablePointer<zend_op_array>?
+
+    private static var originalCompileFile: CompileFile?
+
+    private static let timedCompileFile: CompileFile = { fileHandle, type in
+        let start = Trace.now()
+        let opArray = RequestTiming.originalCompileFile?(fileHandle, type)
+        RequestTiming.active?.add(.compile, Trace.now() - start)
+        return opArray
+    }
+
+    /// Engine startup resets zend_compile_file, so this is hooked after every
+    /// php_embed_init. It counts every autoloaded include.
+    static func hookCompile() {
+        guard let current = zend_compile_file,
+              unsafeBitCast(current, to: UnsafeRawPointer.self) != unsafeBitCast(timedCompileFile, to: UnsafeRawPointer.self) else {
+            return
+        }
+
+        originalCompileFile = current
+        zend_compile_file = timedCompileFile
+    }
+}
+
+/// Rolling p50/p95/p99 per route, over each route's most recent requests.
+/// Routes are the method plus path, with the query dropped and numeric and
+/// id-like segments folded to `{id}`, as on Android.
+final class RequestMetrics {
+    static let shared = RequestMetrics()
+
+    private static let maxRoutes = 64
+    private static let samplesPerRoute = 128
+
+    private struct Route {
+        var count = 0
+        // Ring of the last samplesPerRoute requests; the last column is the total
+        var samples: [[UInt64]] = []
+    }
+
+    private let lock = NSLock()
+    private var routes: [String: Route] = [:]
+
+    static func routeKey(method: String, uri: String) -> String {
+        let path = uri.prefix { $0 != "?" && $0 != "#" }
+        let segments = path.split(separator: "/", omittingEmptySubsequences: false).map { segment -> String in
+            isIdSegment(segment) ? "{id}" : String(segment)
+        }
+        return "\(method) \(segments.joined(separator: "/"))"
+    }
+
+    private static func isIdSegment(_ segment: Substring) -> Bool {
+        guard !segment.isEmpty else { return false }
+
+        // Plain numbers, and hashes or UUIDs
+        let digits = segment.allSatisfy { $0.isASCII && $0.isNumber }
+        let hex = segment.allSatisfy { $0.isHexDigit || $0 == "-" }
+        return digits || (hex && segment.count >= 16)
+    }
+
+    func record(_ timing: RequestTiming) {
+        var key = RequestMetrics.routeKey(method: timing.method, uri: timing.uri)
+        let sample = timing.phases + [timing.total]
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        // Full: everything new is counted under one catch-all route
+        if routes[key] == nil && routes.count >= RequestMetrics.maxRoutes {
+            key = "other"
+        }
+
+        var route = routes[key] ?? Route()
+        if route.samples.count < RequestMetrics.samplesPerRoute {
+            route.samples.append(sample)
+        } else {
+            route.samples[route.count % RequestMetrics.samplesPerRoute] = sample
+        }
+        route.count += 1
+        routes[key] = route
+    }
+
+    /// `{"GET /users/{id}": {"count": n, "total": {"p50": ms, ...}, "phases": {"queue": {...}, ...}}}`
+    func snapshot() -> [String: Any] {
+        lock.lock()
+        defer { lock.unlock() }
+
+        var result: [String: Any] = [:]
+        for (key, route) in routes {
+            var phases: [String: Any] = [:]
+            for phase in RequestTiming.Phase.allCases {
+                phases[phase.name] = RequestMetrics.percentiles(route.samples.map { $0[phase.rawValue] })
+            }
+            result[key] = [
+                "count": route.count,
+                "total": RequestMetrics.percentiles(route.samples.map { $0[RequestTiming.Phase.allCases.count] }),
+                "phases": phases,
+            ]
+        }
+        return result
+    }
+
+    func json() -> String {
+        guard let data = try? JSONSerialization.data(withJSONObject: snapshot(), options: [.sortedKeys]) else {
+            return "{}"
+        }
+        return String(decoding: data, as: UTF8.self)
+    }
+
+    // Nearest rank, in milliseconds
+    private static func percentiles(_ series: [UInt64]) -> [String: Double] {
+        let sorted = series.sorted()
+        func rank(_ pct: Int) -> Double {
+            let index = (sorted.count * pct + 99) / 100
+            return Double(sorted[max(index, 1) - 1]) / 1e6
+        }
+        return ["p50": rank(50), "p95": rank(95), "p99": rank(99)]
+    }
+}
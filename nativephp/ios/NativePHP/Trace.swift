@@ -0,0 +1,124 @@
+import Foundation
+
+/// Boot and request spans in Chrome trace-event format, the Swift counterpart
+/// of trace/trace.c on Android. Off unless the flag file exists in
+/// Application Support, which can be toggled without a rebuild:
+///
+///     touch "$(xcrun simctl get_app_container booted <bundle id> data)/Library/Application Support/trace.enabled"
+///
+/// Traces go to Application Support/traces/ and open in chrome://tracing or
+/// Perfetto. The file is a JSON array left open at the end, which both
+/// accept, so it is readable at any point without a clean shutdown.
+final class Trace {
+    static let shared = Trace()
+
+    private static let flagFile = "trace.enabled"
+    private static let traceDir = "traces"
+    private static let maxTraces = 5
+
+    private struct Event {
+        let name: String
+        let category: String
+        let start: UInt64
+        let end: UInt64
+        let thread: UInt64
+    }
+
+    private let lock = NSLock()
+    private var events: [Event] = []
+    private var file: FileHandle?
+    private var written = 0
+    private(set) var enabled = false
+
+    /// Monotonic nanoseconds, the clock every span is measured on
+    static func now() -> UInt64 {
+        return DispatchTime.now().uptimeNanoseconds
+    }
+
+    /// Read the runtime flag and, if it's set, start a new trace file.
+    func configure() {
+        guard let supportDir = FileManager.default.urls(for: .applicationSupportDirectory, in: .userDomainMask).first,
+              FileManager.default.fileExists(atPath: supportDir.appendingPathComponent(Trace.flagFile).path) else {
+            return
+        }
+
+        let dir = supportDir.appendingPathComponent(Trace.traceDir, isDirectory: true)
+        try? FileManager.default.createDirectory(at: dir, withIntermediateDirectories: true)
+
+        // Keep the newest few
+        let old = (try? FileManager.default.contentsOfDirectory(at: dir, includingPropertiesForKeys: [.contentModificationDateKey])) ?? []
+        let sorted = old.sorted {
+            let a = (try? $0.resourceValues(forKeys: [.contentModificationDateKey]))?.contentModificationDate ?? .distantPast
+            let b = (try? $1.resourceValues(forKeys: [.contentModificationDateKey]))?.contentModificationDate ?? .distantPast
+            return a > b
+        }
+        sorted.dropFirst(Trace.maxTraces - 1).forEach { try? FileManager.default.removeItem(at: $0) }
+
+        let url = dir.appendingPathComponent("trace-\(Int(Date().timeIntervalSince1970 * 1000)).json")
+        guard FileManager.default.createFile(atPath: url.path, contents: Data("[\n".utf8)),
+              let handle = try? FileHandle(forWritingTo: url) else {
+            print("⚠️ Couldn't create trace file \(url.path)")
+            return
+        }
+        handle.seekToEndOfFile()
+
+        lock.lock()
+        file = handle
+        enabled = true
+        lock.unlock()
+
+        print("🧵 Tracing to \(url.path)")
+    }
+
+    func record(_ name: String, category: String, start: UInt64, end: UInt64) {
+        guard enabled else { return }
+
+        var thread: UInt64 = 0
+        pthread_threadid_np(nil, &thread)
+
+        lock.lock()
+        events.append(Event(name: name, category: category, start: start, end: end, thread: thread))
+        lock.unlock()
+    }
+
+    @discardableResult
+    func span<T>(_ name: String, category: String = "swift", _ block: () throws -> T) rethrows -> T {
+        guard enabled else { return try block() }
+
+        let start = Trace.now()
+        defer { record(name, category: category, start: start, end: Trace.now()) }
+        return try block()
+    }
+
+    /// Write buffered spans out; cheap enough to call after every request.
+    func flush() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard let file = file, !events.isEmpty else { return }
+
+        let pid = Int(getpid())
+        var out = Data()
+        for event in events {
+            let object: [String: Any] = [
+                "name": event.name,
+                "cat": event.category,
+                "ph": "X",
+                "pid": pid,
+                "tid": event.thread,
+                "ts": Double(event.start) / 1000,
+                "dur": Double(event.end - event.start) / 1000,
+            ]
+            guard let json = try? JSONSerialization.data(withJSONObject: object) else { continue }
+
+            if written > 0 {
+                out.append(Data(",\n".utf8))
+            }
+            out.append(json)
+            written += 1
+        }
+        events.removeAll()
+
+        file.write(out)
+    }
+}
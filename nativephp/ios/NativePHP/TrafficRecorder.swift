@@ -0,0 +1,168 @@
+import Foundation
+
+/// Records the requests the WebView sends to PHP, with their timings, so real
+/// sessions can be replayed against the host build by runtime/traffic_replay.
+/// Writes the same log format and applies the same redaction as
+/// TrafficRecorder.kt on Android: cookie, auth and CSRF headers are dropped,
+/// `_token` is blanked and password-like fields in bodies and query strings
+/// are replaced.
+///
+/// Start the app with `-recordTraffic YES` as a launch argument; logs go to
+/// Application Support/traffic/<start>.nptr.
+final class TrafficRecorder {
+    static let shared = TrafficRecorder()
+
+    private static let version: UInt8 = 1
+    private static let redacted = "redacted"
+
+    private static let droppedHeaders: Set<String> = ["cookie", "authorization", "proxy-authorization", "x-csrf-token", "x-xsrf-token"]
+    private static let blankedFields = ["_token"]
+    private static let redactedFields = ["password", "password_confirmation", "current_password", "token", "secret", "signature"]
+
+    private let lock = NSLock()
+    private var file: FileHandle?
+    private var start: UInt64 = 0
+
+    var isRecording: Bool {
+        lock.lock()
+        defer { lock.unlock() }
+        return file != nil
+    }
+
+    /// Starts a log if the launch arguments ask for one.
+    func startIfRequested() {
+        guard UserDefaults.standard.bool(forKey: "recordTraffic"),
+              let supportDir = FileManager.default.urls(for: .applicationSupportDirectory, in: .userDomainMask).first else {
+            return
+        }
+
+        start(in: supportDir.appendingPathComponent("traffic", isDirectory: true))
+    }
+
+    /// Starts a new log in `dir`, closing any open one.
+    func start(in dir: URL) {
+        stop()
+        try? FileManager.default.createDirectory(at: dir, withIntermediateDirectories: true)
+
+        let startMillis = UInt64(Date().timeIntervalSince1970 * 1000)
+        let url = dir.appendingPathComponent("\(startMillis).nptr")
+
+        var header = Data("NPTR".utf8)
+        header.append(TrafficRecorder.version)
+        TrafficRecorder.appendVarint(&header, startMillis)
+
+        guard FileManager.default.createFile(atPath: url.path, contents: header),
+              let handle = try? FileHandle(forWritingTo: url) else {
+            print("⚠️ Couldn't create traffic log \(url.path)")
+            return
+        }
+        handle.seekToEndOfFile()
+
+        lock.lock()
+        file = handle
+        start = Trace.now()
+        lock.unlock()
+
+        print("🎙️ Recording traffic to \(url.path)")
+    }
+
+    func stop() {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if let file = file {
+            file.closeFile()
+            print("🎙️ Traffic recording stopped")
+        }
+        file = nil
+    }
+
+    /// Logs one request. `arrived` is Trace.now() when the scheme handler
+    /// took it; `timing` holds the measured phases.
+    func record(_ request: RequestData, arrived: UInt64, status: Int, timing: RequestTiming) {
+        lock.lock()
+        defer { lock.unlock() }
+
+        guard let file = file else { return }
+
+        var uri = request.uri
+        if let query = request.query, !query.isEmpty {
+            uri += "?" + query
+        }
+
+        let headers = TrafficRecorder.redactHeaders(request.headers).sorted { $0.key < $1.key }
+
+        var record = Data()
+        TrafficRecorder.appendVarint(&record, arrived > start ? (arrived - start) / 1000 : 0)
+        TrafficRecorder.appendString(&record, request.method.uppercased())
+        TrafficRecorder.appendString(&record, TrafficRecorder.redactUri(uri))
+        TrafficRecorder.appendVarint(&record, UInt64(headers.count))
+        for (name, value) in headers {
+            TrafficRecorder.appendString(&record, name)
+            TrafficRecorder.appendString(&record, value)
+        }
+        TrafficRecorder.appendString(&record, TrafficRecorder.redactBody(request.data ?? ""))
+        TrafficRecorder.appendVarint(&record, UInt64(max(status, 0)))
+        TrafficRecorder.appendVarint(&record, UInt64(timing.phases.count))
+        for ns in timing.phases {
+            TrafficRecorder.appendVarint(&record, ns / 1000)
+        }
+
+        // Unbuffered, so a killed app keeps everything up to its last request
+        file.write(record)
+    }
+
+    static func redactHeaders(_ headers: [String: String]) -> [String: String] {
+        return headers.filter { !droppedHeaders.contains($0.key.lowercased()) }
+    }
+
+    /// Redacts `application/x-www-form-urlencoded` and JSON bodies, and query strings.
+    static func redactBody(_ body: String) -> String {
+        var result = body
+        blankedFields.forEach { result = replaceField(result, $0, "") }
+        redactedFields.forEach { result = replaceField(result, $0, redacted) }
+        return result
+    }
+
+    static func redactUri(_ uri: String) -> String {
+        guard let query = uri.firstIndex(of: "?") else { return uri }
+        return String(uri[...query]) + redactBody(String(uri[uri.index(after: query)...]))
+    }
+
+    private static func replaceField(_ text: String, _ field: String, _ value: String) -> String {
+        let name = NSRegularExpression.escapedPattern(for: field)
+        let replacements = [
+            // "field":"value", as in a JSON body or Livewire's updates
+            (#""\#(name)"\s*:\s*"(?:[^"\\]|\\.)*""#, #""\#(field)":"\#(value)""#),
+            // \"field\":\"value\", as in a snapshot embedded in JSON
+            (#"\\"\#(name)\\":\\".*?\\""#, #"\\"\#(field)\\":\\"\#(value)\\""#),
+            // field=value in a form body or query string
+            (#"(^|&)\#(name)=[^&]*"#, #"$1\#(field)=\#(value)"#),
+        ]
+
+        var result = text
+        for (pattern, template) in replacements {
+            guard let regex = try? NSRegularExpression(pattern: pattern) else { continue }
+            result = regex.stringByReplacingMatches(in: result,
+                                                    range: NSRange(result.startIndex..., in: result),
+                                                    withTemplate: template)
+        }
+        return result
+    }
+
+    // Unsigned LEB128
+    private static func appendVarint(_ data: inout Data, _ value: UInt64) {
+        var remaining = value
+        while remaining & ~UInt64(0x7f) != 0 {
+            data.append(UInt8(remaining & 0x7f) | 0x80)
+            remaining >>= 7
+        }
+        data.append(UInt8(remaining))
+    }
+
+    private static func appendString(_ data: inout Data, _ value: String) {
+        let bytes = Data(value.utf8)
+        appendVarint(&data, UInt64(bytes.count))
+        data.append(bytes)
+    }
+}
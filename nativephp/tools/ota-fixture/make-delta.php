@@ -0,0 +1,145 @@
+<?php
+
+/**
+ * Build a delta OTA patch between two bundle zips.
+ *
+ *     php make-delta.php <installed.zip> <new.zip> <patch.zip>
+ *
+ * The patch is a zip holding `delta.manifest` plus payloads: new and replaced
+ * files whole under files/, changed files as NPD1 op streams under patches/.
+ * See bundle/bundle_delta.h in the Android runtime for the format the app applies.
+ */
+
+const DELTA_BLOCK = 16;
+
+function read_bundle(string $path): array
+{
+    $zip = new ZipArchive();
+    if ($zip->open($path) !== true) {
+        throw new RuntimeException("Cannot open $path");
+    }
+
+    $files = [];
+    for ($i = 0; $i < $zip->numFiles; $i++) {
+        $name = $zip->getNameIndex($i);
+        if (! str_ends_with($name, '/')) {
+            $files[$name] = $zip->getFromIndex($i);
+        }
+    }
+    $zip->close();
+
+    return $files;
+}
+
+function varint(int $value): string
+{
+    $out = '';
+    do {
+        $byte = $value & 0x7F;
+        $value >>= 7;
+        $out .= chr($value ? $byte | 0x80 : $byte);
+    } while ($value);
+
+    return $out;
+}
+
+/**
+ * Greedy block match: index the old file every DELTA_BLOCK bytes, then walk
+ * the new file copying the longest run from any matching block.
+ */
+function diff_file(string $old, string $new): string
+{
+    $blocks = [];
+    for ($offset = 0; $offset + DELTA_BLOCK <= strlen($old); $offset += DELTA_BLOCK) {
+        $blocks[substr($old, $offset, DELTA_BLOCK)] ??= $offset;
+    }
+
+    $patch = 'NPD1'.varint(strlen($new));
+    $literal = '';
+    $flush = function () use (&$patch, &$literal) {
+        if ($literal !== '') {
+            $patch .= "\x02".varint(strlen($literal)).$literal;
+            $literal = '';
+        }
+    };
+
+    $i = 0;
+    $length = strlen($new);
+    while ($i < $length) {
+        $source = $i + DELTA_BLOCK <= $length ? ($blocks[substr($new, $i, DELTA_BLOCK)] ?? null) : null;
+        if ($source === null) {
+            $literal .= $new[$i++];
+            continue;
+        }
+
+        $run = DELTA_BLOCK;
+        while ($i + $run < $length && $source + $run < strlen($old) && $new[$i + $run] === $old[$source + $run]) {
+            $run++;
+        }
+
+        $flush();
+        $patch .= "\x01".varint($source).varint($run);
+        $i += $run;
+    }
+    $flush();
+
+    return $patch."\x00";
+}
+
+function make_delta(string $installedZip, string $newZip, string $patchZip): array
+{
+    $old = read_bundle($installedZip);
+    $new = read_bundle($newZip);
+
+    $zip = new ZipArchive();
+    if ($zip->open($patchZip, ZipArchive::CREATE | ZipArchive::OVERWRITE) !== true) {
+        throw new RuntimeException("Cannot write $patchZip");
+    }
+
+    $manifest = "# bundle delta v1\n";
+    $counts = ['add' => 0, 'patch' => 0, 'remove' => 0];
+
+    ksort($new);
+    foreach ($new as $path => $content) {
+        if (isset($old[$path]) && $old[$path] === $content) {
+            continue;
+        }
+
+        $sha = hash('sha256', $content);
+        $size = strlen($content);
+
+        // The app rewrites NATIVEPHP_APP_VERSION in its installed .env, so that
+        // file never matches the bundle and is always shipped whole.
+        $patch = isset($old[$path]) && $path !== '.env' ? diff_file($old[$path], $content) : null;
+
+        if ($patch !== null && strlen($patch) < $size) {
+            $zip->addFromString("patches/$path", $patch);
+            $manifest .= sprintf("patch %s %d %s %s\n", $sha, $size, hash('crc32b', $old[$path]), $path);
+            $counts['patch']++;
+        } else {
+            $zip->addFromString("files/$path", $content);
+            $manifest .= sprintf("add %s %d - %s\n", $sha, $size, $path);
+            $counts['add']++;
+        }
+    }
+
+    foreach (array_diff_key($old, $new) as $path => $content) {
+        $manifest .= "remove - 0 - $path\n";
+        $counts['remove']++;
+    }
+
+    $zip->addFromString('delta.manifest', $manifest);
+    $zip->close();
+
+    return $counts;
+}
+
+if (PHP_SAPI === 'cli' && realpath($argv[0] ?? '') === __FILE__) {
+    if ($argc !== 4) {
+        fwrite(STDERR, "usage: php make-delta.php <installed.zip> <new.zip> <patch.zip>\n");
+        exit(2);
+    }
+
+    $counts = make_delta($argv[1], $argv[2], $argv[3]);
+    printf("%d added, %d patched, %d removed, %d bytes\n", $counts['add'], $counts['patch'], $counts['remove'], filesize($argv[3]));
+}
@@ -0,0 +1,107 @@
+<?php
+
+/**
+ * Stand-in for the OTA update service, for testing updates offline.
+ *
+ *     OTA_RELEASES=/path/to/releases php -S 0.0.0.0:8787 router.php
+ *
+ * The releases directory holds one bundle zip per version (`1.0.0.zip`) and a
+ * `latest` file naming the current one. Patches from an installed version are
+ * built on first request and cached under patches/. Point the app at it with
+ * NATIVEPHP_OTA_URL=http://10.0.2.2:8787 in its bundled .env.
+ *
+ * Files are served with Range support. Set OTA_DROP_AFTER=<bytes> to hang up
+ * every download after that many bytes, like a flaky mobile link.
+ */
+
+require __DIR__.'/make-delta.php';
+
+$releases = rtrim(getenv('OTA_RELEASES') ?: __DIR__.'/releases', '/');
+$path = parse_url($_SERVER['REQUEST_URI'], PHP_URL_PATH);
+$base = 'http://'.$_SERVER['HTTP_HOST'];
+
+function valid_version(string $version): bool
+{
+    return (bool) preg_match('/^[A-Za-z0-9._-]+$/', $version) && ! str_contains($version, '..');
+}
+
+function serve_file(string $file): void
+{
+    $size = filesize($file);
+    $start = 0;
+    $end = $size - 1;
+    $etag = '"'.md5_file($file).'"';
+
+    header('Content-Type: application/zip');
+    header('Accept-Ranges: bytes');
+    header("ETag: $etag");
+
+    $ifRange = $_SERVER['HTTP_IF_RANGE'] ?? null;
+    if (preg_match('/^bytes=(\d+)-(\d*)$/', $_SERVER['HTTP_RANGE'] ?? '', $range) && ($ifRange === null || $ifRange === $etag)) {
+        $start = (int) $range[1];
+        $end = $range[2] === '' ? $end : min($end, (int) $range[2]);
+        if ($start > $end) {
+            http_response_code(416);
+            header("Content-Range: bytes */$size");
+            return;
+        }
+        http_response_code(206);
+        header("Content-Range: bytes $start-$end/$size");
+    }
+
+    $length = $end - $start + 1;
+    header("Content-Length: $length");
+
+    // Declare the full length but stop early, so the client sees a dropped connection
+    $drop = (int) (getenv('OTA_DROP_AFTER') ?: 0);
+    $send = $drop > 0 ? min($length, $drop) : $length;
+
+    $fp = fopen($file, 'rb');
+    fseek($fp, $start);
+    while ($send > 0 && ! feof($fp)) {
+        $chunk = fread($fp, min(65536, $send));
+        echo $chunk;
+        $send -= strlen($chunk);
+    }
+    fclose($fp);
+}
+
+if (preg_match('#^/api/apps/[^/]+/ota$#', $path)) {
+    $installed = $_GET['installed'] ?? '';
+    $latest = trim((string) @file_get_contents("$releases/latest"));
+
+    if ($latest === '' || ! is_file("$releases/$latest.zip")) {
+        http_response_code(404);
+        exit;
+    }
+
+    $response = [
+        'upToDate' => $installed === $latest,
+        'current_version' => $latest,
+        'download_url' => "$base/releases/$latest.zip",
+        'download_sha256' => hash_file('sha256', "$releases/$latest.zip"),
+    ];
+
+    if ($installed !== $latest && valid_version($installed) && is_file("$releases/$installed.zip")) {
+        $patch = "$releases/patches/$installed-$latest.zip";
+        if (! is_file($patch)) {
+            @mkdir(dirname($patch), 0755, true);
+            make_delta("$releases/$installed.zip", "$releases/$latest.zip", $patch);
+        }
+        $response['patch_url'] = "$base/releases/patches/$installed-$latest.zip";
+        $response['patch_from'] = $installed;
+        $response['patch_sha256'] = hash_file('sha256', $patch);
+    }
+
+    header('Content-Type: application/json');
+    echo json_encode($response);
+    exit;
+}
+
+if (preg_match('#^/releases/((?:patches/)?[A-Za-z0-9._-]+\.zip)$#', $path, $match)
+    && ! str_contains($match[1], '..') && is_file("$releases/$match[1]")) {
+    serve_file("$releases/$match[1]");
+    exit;
+}
+
+http_response_code(404);
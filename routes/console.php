@@ -1,8 +1,19 @@
 <?php
 
+use App\Support\NativeEvents;
 use Illuminate\Foundation\Inspiring;
 use Illuminate\Support\Facades\Artisan;
 
 Artisan::command('inspire', function () {
     $this->comment(Inspiring::quote());
 })->purpose('Display an inspiring quote');
+
+Artisan::command('native:dispatch-events {--results= : Results as JSON, from a runtime without nativephp_events()}', function () {
+    $results = $this->option('results');
+
+    $count = $results === null
+        ? NativeEvents::dispatchPending()
+        : NativeEvents::dispatchResults(json_decode($results, true) ?: []);
+
+    $this->line('Dispatched '.$count.' native events');
+})->purpose('Dispatch the native action results the mobile runtime has queued');
@@ -0,0 +1,70 @@
+<?php
+
+use App\Support\NativeEvents;
+use Illuminate\Support\Facades\Event;
+use Illuminate\Support\Facades\Exceptions;
+
+class NativeLocationUpdated
+{
+    public function __construct(public float $lat, public float $lng, public int $count = 1) {}
+}
+
+class NativeFileAdded
+{
+    public function __construct(public string $path) {}
+}
+
+beforeEach(function () {
+    Event::fake();
+    Exceptions::fake();
+});
+
+test('counted results build the event from the latest payload', function () {
+    $dispatched = NativeEvents::dispatchResults([
+        ['event' => NativeLocationUpdated::class, 'payload' => '{"lat":1.5,"lng":2}', 'count' => 3, 'batch' => false],
+        ['event' => NativeFileAdded::class, 'payload' => '{"path":"/a.jpg"}', 'count' => 2, 'batch' => false],
+    ]);
+
+    expect($dispatched)->toBe(2);
+    Event::assertDispatched(NativeLocationUpdated::class, fn ($e) => $e->lat === 1.5 && $e->lng === 2.0 && $e->count === 3);
+    Event::assertDispatched(NativeFileAdded::class, fn ($e) => $e->path === '/a.jpg');
+    Exceptions::assertNothingReported();
+});
+
+test('batched results dispatch every payload in order', function () {
+    NativeEvents::dispatchResults([
+        ['event' => NativeFileAdded::class, 'payload' => '[{"path":"/a.jpg"},{"path":"/b.jpg"}]', 'count' => 2, 'batch' => true],
+    ]);
+
+    $paths = [];
+    Event::assertDispatched(NativeFileAdded::class, function ($e) use (&$paths) {
+        $paths[] = $e->path;
+
+        return true;
+    });
+
+    expect($paths)->toBe(['/a.jpg', '/b.jpg']);
+    Exceptions::assertNothingReported();
+});
+
+test('named events get the payload and count', function () {
+    NativeEvents::dispatchResults([
+        ['event' => 'native.tick', 'payload' => '{"n":4}', 'count' => 4, 'batch' => false],
+        ['event' => '', 'payload' => '{}', 'count' => 1, 'batch' => false],
+    ]);
+
+    Event::assertDispatched('native.tick', fn ($name, $arguments) => $arguments === [['n' => 4], 4]);
+    Event::assertDispatchedTimes('native.tick', 1);
+});
+
+test('the dispatch command takes results from runtimes without nativephp_events', function () {
+    $results = [
+        ['handle' => 0, 'action' => '', 'event' => NativeFileAdded::class, 'payload' => '{"path":"/c.jpg"}', 'code' => 0, 'count' => 1, 'batch' => false],
+    ];
+
+    $this->artisan('native:dispatch-events', ['--results' => json_encode($results)])
+        ->expectsOutput('Dispatched 1 native events')
+        ->assertExitCode(0);
+
+    Event::assertDispatched(NativeFileAdded::class, fn ($e) => $e->path === '/c.jpg');
+});